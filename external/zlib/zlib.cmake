@@ -0,0 +1,21 @@
+cmake_minimum_required(VERSION 3.14)
+
+enable_language(C)
+
+# Only the decoder is needed
+set(zlib_source_files
+        "${zlib_SOURCE_DIR}/adler32.c"
+        "${zlib_SOURCE_DIR}/crc32.c"
+        "${zlib_SOURCE_DIR}/infback.c"
+        "${zlib_SOURCE_DIR}/inffast.c"
+        "${zlib_SOURCE_DIR}/inflate.c"
+        "${zlib_SOURCE_DIR}/inftrees.c"
+        "${zlib_SOURCE_DIR}/zutil.c"
+        "${zlib_SOURCE_DIR}/zconf.h"
+        "${zlib_SOURCE_DIR}/zlib.h")
+
+add_library(zlib STATIC)
+
+target_sources(zlib PRIVATE ${zlib_source_files})
+
+target_include_directories(zlib PUBLIC "${zlib_SOURCE_DIR}")
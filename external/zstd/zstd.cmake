@@ -0,0 +1,17 @@
+cmake_minimum_required(VERSION 3.14)
+
+enable_language(C)
+
+file(GLOB zstd_source_files
+        "${zstd_SOURCE_DIR}/lib/common/*.c"
+        "${zstd_SOURCE_DIR}/lib/common/*.h"
+        "${zstd_SOURCE_DIR}/lib/compress/*.c"
+        "${zstd_SOURCE_DIR}/lib/compress/*.h"
+        "${zstd_SOURCE_DIR}/lib/decompress/*.c"
+        "${zstd_SOURCE_DIR}/lib/decompress/*.h")
+
+add_library(zstd STATIC)
+
+target_sources(zstd PRIVATE ${zstd_source_files} "${zstd_SOURCE_DIR}/lib/zstd.h")
+
+target_include_directories(zstd PUBLIC "${zstd_SOURCE_DIR}/lib")
@@ -434,6 +434,17 @@ enum class VertexInputRate { Vertex = VK_VERTEX_INPUT_RATE_VERTEX, Instance = VK
 
 ETNA_DEFINE_ENUM_ANALOGUE(VertexInputRate)
 
+enum class PrimitiveTopology {
+    PointList     = VK_PRIMITIVE_TOPOLOGY_POINT_LIST,
+    LineList      = VK_PRIMITIVE_TOPOLOGY_LINE_LIST,
+    LineStrip     = VK_PRIMITIVE_TOPOLOGY_LINE_STRIP,
+    TriangleList  = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+    TriangleStrip = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP,
+    TriangleFan   = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_FAN
+};
+
+ETNA_DEFINE_ENUM_ANALOGUE(PrimitiveTopology)
+
 enum class IndexType {
     Uint16   = VK_INDEX_TYPE_UINT16,
     Uint32   = VK_INDEX_TYPE_UINT32,
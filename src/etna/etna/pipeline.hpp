@@ -75,6 +75,8 @@ class Pipeline {
 
         void SetDepthState(DepthTest depth_test, DepthWrite depth_write, CompareOp compare_op) noexcept;
 
+        void SetPrimitiveTopology(PrimitiveTopology topology) noexcept;
+
         VkGraphicsPipelineCreateInfo state{};
 
       private:
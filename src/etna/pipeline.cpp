@@ -277,6 +277,11 @@ void Pipeline::Builder::SetDepthState(DepthTest depth_test, DepthWrite depth_wri
     m_depth_stencil_state.depthCompareOp   = VkEnum(compare_op);
 }
 
+void Pipeline::Builder::SetPrimitiveTopology(PrimitiveTopology topology) noexcept
+{
+    m_input_assembly_state.topology = VkEnum(topology);
+}
+
 UniquePipelineLayout PipelineLayout::Create(VkDevice vk_device, const VkPipelineLayoutCreateInfo& create_info)
 {
     VkPipelineLayout vk_pipeline_layout{};
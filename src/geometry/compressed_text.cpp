@@ -0,0 +1,260 @@
+#include "compressed_text.hpp"
+
+#include "platform.hpp"
+#include "utils/misc.hpp"
+
+BEGIN_DISABLE_WARNINGS
+
+#include <zlib.h>
+#include <zstd.h>
+
+END_DISABLE_WARNINGS
+
+#include <algorithm>
+#include <cctype>
+
+namespace {
+
+// Amount of text decoded at a time once a block is full but does not end on a line break yet
+constexpr size_t kLineStep = size_t{ 1 } << 20;
+
+// zlib counts bytes in 32 bits
+constexpr size_t kMaxZlibStep = size_t{ 1 } << 30;
+
+} // namespace
+
+class CompressedTextReader::Decoder {
+  public:
+    virtual ~Decoder() = default;
+
+    // Decodes from the front of 'input' into 'output' until 'output' is full or the input ends, and returns the number
+    // of bytes written. The decoded part of 'input' is removed, and 'is_end' is set once all of it has been decoded.
+    virtual auto Decode(std::string_view* input, char* output, size_t size, bool* is_end) -> size_t = 0;
+};
+
+namespace {
+
+class GzipDecoder final : public CompressedTextReader::Decoder {
+  public:
+    GzipDecoder()
+    {
+        // Detects gzip and zlib headers
+        utils::throw_runtime_error_if(inflateInit2(&m_stream, 15 + 32) != Z_OK, "Failed to initialize gzip decoder");
+    }
+
+    GzipDecoder(const GzipDecoder&) = delete;
+    GzipDecoder& operator=(const GzipDecoder&) = delete;
+
+    ~GzipDecoder() noexcept override { inflateEnd(&m_stream); }
+
+    auto Decode(std::string_view* input, char* output, size_t size, bool* is_end) -> size_t override
+    {
+        auto written = size_t{ 0 };
+
+        while (written != size && !*is_end) {
+            auto input_size  = std::min(input->size(), kMaxZlibStep);
+            auto output_size = std::min(size - written, kMaxZlibStep);
+
+            m_stream.next_in   = reinterpret_cast<Bytef*>(const_cast<char*>(input->data()));
+            m_stream.avail_in  = static_cast<uInt>(input_size);
+            m_stream.next_out  = reinterpret_cast<Bytef*>(output + written);
+            m_stream.avail_out = static_cast<uInt>(output_size);
+
+            auto result = inflate(&m_stream, Z_NO_FLUSH);
+
+            input->remove_prefix(input_size - m_stream.avail_in);
+            written += output_size - m_stream.avail_out;
+
+            if (result == Z_STREAM_END) {
+                // A gzip file may hold several members, which are decoded as one text
+                if (input->empty()) {
+                    *is_end = true;
+                } else {
+                    inflateReset(&m_stream);
+                }
+            } else if (result == Z_BUF_ERROR && input->empty()) {
+                utils::throw_runtime_error("Failed to decompress file: truncated gzip data");
+            } else if (result != Z_OK && result != Z_BUF_ERROR) {
+                utils::throw_runtime_error("Failed to decompress file: corrupt gzip data");
+            }
+        }
+
+        return written;
+    }
+
+  private:
+    z_stream m_stream{};
+};
+
+class ZstdDecoder final : public CompressedTextReader::Decoder {
+  public:
+    ZstdDecoder() : m_stream(ZSTD_createDStream())
+    {
+        utils::throw_runtime_error_if(m_stream == nullptr, "Failed to initialize zstd decoder");
+    }
+
+    ZstdDecoder(const ZstdDecoder&) = delete;
+    ZstdDecoder& operator=(const ZstdDecoder&) = delete;
+
+    ~ZstdDecoder() noexcept override { ZSTD_freeDStream(m_stream); }
+
+    auto Decode(std::string_view* input, char* output, size_t size, bool* is_end) -> size_t override
+    {
+        auto written = size_t{ 0 };
+
+        while (written != size && !*is_end) {
+            auto in  = ZSTD_inBuffer{ input->data(), input->size(), 0 };
+            auto out = ZSTD_outBuffer{ output + written, size - written, 0 };
+
+            auto result = ZSTD_decompressStream(m_stream, &out, &in);
+
+            utils::throw_runtime_error_if(ZSTD_isError(result), "Failed to decompress file: corrupt zstd data");
+
+            input->remove_prefix(in.pos);
+            written += out.pos;
+
+            // Frames follow each other, and a result of zero means that a frame is complete and flushed
+            if (result == 0 && input->empty()) {
+                *is_end = true;
+            } else if (in.pos == 0 && out.pos == 0) {
+                utils::throw_runtime_error("Failed to decompress file: truncated zstd data");
+            }
+        }
+
+        return written;
+    }
+
+  private:
+    ZSTD_DStream* m_stream = nullptr;
+};
+
+} // namespace
+
+Compression GetCompression(const std::filesystem::path& filepath)
+{
+    auto extension = filepath.extension().string();
+    for (auto& c : extension) {
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+
+    if (extension == ".gz") {
+        return Compression::Gzip;
+    }
+    if (extension == ".zst") {
+        return Compression::Zstd;
+    }
+    return Compression::None;
+}
+
+CompressedTextReader::CompressedTextReader(
+    const std::filesystem::path& filepath,
+    Compression                  compression,
+    size_t                       block_size)
+    : m_file(filepath, MappedFile::Access::Sequential), m_block_size(block_size)
+{
+    switch (compression) {
+    case Compression::Gzip: m_decoder = std::make_unique<GzipDecoder>(); break;
+    case Compression::Zstd: m_decoder = std::make_unique<ZstdDecoder>(); break;
+    default: utils::throw_runtime_error("Failed to decompress file: unknown compression");
+    }
+
+    m_thread = std::thread(&CompressedTextReader::Decompress, this);
+}
+
+CompressedTextReader::~CompressedTextReader() noexcept
+{
+    {
+        auto lock  = std::scoped_lock(m_mutex);
+        m_stopping = true;
+    }
+    m_condition.notify_all();
+    m_thread.join();
+}
+
+auto CompressedTextReader::Next() -> Block
+{
+    auto lock = std::unique_lock(m_mutex);
+
+    if (m_is_done) {
+        return { {}, m_file.Size() };
+    }
+
+    if (m_has_block) {
+        m_buffers[m_next].is_full = false;
+        m_next ^= 1;
+        m_condition.notify_all();
+    }
+
+    m_condition.wait(lock, [this] { return m_buffers[m_next].is_full || m_error; });
+
+    const auto& buffer = m_buffers[m_next];
+    if (!buffer.is_full) {
+        std::rethrow_exception(m_error);
+    }
+
+    m_has_block = true;
+    m_is_done   = buffer.text.empty();
+
+    return { buffer.text, buffer.compressed_size };
+}
+
+void CompressedTextReader::Decompress()
+{
+    try {
+        auto input     = m_file.View();
+        auto discarded = size_t{ 0 };
+        auto carry     = std::string{}; // Partial line at the end of the previous block
+        auto is_end    = false;
+
+        for (size_t i = 0;; i ^= 1) {
+            auto& buffer = m_buffers[i];
+            {
+                auto lock = std::unique_lock(m_mutex);
+                m_condition.wait(lock, [this, &buffer] { return !buffer.is_full || m_stopping; });
+                if (m_stopping) {
+                    return;
+                }
+            }
+
+            auto& text     = buffer.text;
+            auto  line_end = std::string::npos;
+
+            text.assign(carry);
+            carry.clear();
+
+            // Fill the block, then keep going in small steps until it ends on a line break
+            while (!is_end && (text.size() < m_block_size || (line_end = text.rfind('\n')) == std::string::npos)) {
+                auto size = text.size();
+                text.resize(std::max(m_block_size, size + kLineStep));
+                text.resize(size + m_decoder->Decode(&input, text.data() + size, text.size() - size, &is_end));
+            }
+
+            if (!is_end) {
+                carry.assign(text, line_end + 1);
+                text.resize(line_end + 1);
+            }
+
+            auto position = m_file.Size() - input.size();
+
+            m_file.Discard(m_file.View().substr(discarded, position - discarded));
+            discarded = position;
+
+            {
+                auto lock              = std::scoped_lock(m_mutex);
+                buffer.compressed_size = position;
+                buffer.is_full         = true;
+            }
+            m_condition.notify_all();
+
+            if (text.empty()) {
+                return;
+            }
+        }
+    } catch (...) {
+        {
+            auto lock = std::scoped_lock(m_mutex);
+            m_error   = std::current_exception();
+        }
+        m_condition.notify_all();
+    }
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "mapped_file.hpp"
+
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+enum class Compression { None, Gzip, Zstd };
+
+// Compression of a file as given by its last extension, .gz or .zst
+auto GetCompression(const std::filesystem::path& filepath) -> Compression;
+
+// Decompresses a text file on a thread of its own, ahead of its consumer. The text is handed out in blocks that end on
+// a line break, so they can be parsed without looking at the next block. Two blocks are buffered: one is filled while
+// the other is being consumed, so memory use is bounded by the block size and the length of the longest line rather
+// than by the size of the text. The compressed file is mapped and its pages are dropped once they are decompressed.
+class CompressedTextReader final {
+  public:
+    // Implemented per compression in the source file
+    class Decoder;
+
+    struct Block final {
+        std::string_view text;            // Empty at the end of the file
+        size_t           compressed_size; // Compressed bytes decoded up to the end of this block
+    };
+
+    CompressedTextReader(const std::filesystem::path& filepath, Compression compression, size_t block_size);
+
+    CompressedTextReader(const CompressedTextReader&) = delete;
+    CompressedTextReader& operator=(const CompressedTextReader&) = delete;
+
+    // Stops the decompressing thread and waits for it
+    ~CompressedTextReader() noexcept;
+
+    // Returns the next block, which stays valid until the following call. Throws std::runtime_error if the file is
+    // corrupt or truncated.
+    auto Next() -> Block;
+
+    auto GetCompressedSize() const noexcept { return m_file.Size(); }
+
+  private:
+    struct Buffer final {
+        std::string text;
+        size_t      compressed_size = 0;
+        bool        is_full         = false; // Filled and not yet released by the consumer
+    };
+
+    void Decompress();
+
+    MappedFile               m_file;
+    std::unique_ptr<Decoder> m_decoder;
+    size_t                   m_block_size = 0;
+    Buffer                   m_buffers[2];
+    size_t                   m_next       = 0;     // Buffer to be returned by Next
+    bool                     m_has_block  = false; // Whether Next has returned a block that is still in use
+    bool                     m_is_done    = false; // Whether Next has returned the end of the file
+    bool                     m_stopping   = false;
+    std::exception_ptr       m_error;
+    std::mutex               m_mutex;
+    std::condition_variable  m_condition;
+    std::thread              m_thread;
+};
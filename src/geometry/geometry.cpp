@@ -0,0 +1,409 @@
+#include "geometry.hpp"
+
+#include "meshlet_builder.hpp"
+#include "vertex_quantizer.hpp"
+#include "vertex_welder.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <string>
+
+auto IsPointCloud(std::span<const ShapeRecord> shapes) noexcept -> bool
+{
+    auto is_points  = [](const MeshRecord& mesh) { return mesh.topology == Topology::Points; };
+    auto has_points = [&](const ShapeRecord& shape) { return std::ranges::any_of(shape.meshes, is_points); };
+
+    return std::ranges::any_of(shapes, has_points);
+}
+
+auto ComputeBoundingBox(std::span<const uint32_t> indices, std::span<const VertexPN> vertices) noexcept -> AABB
+{
+    auto aabb = AABB{ { FLT_MAX, FLT_MAX, FLT_MAX }, { -FLT_MAX, -FLT_MAX, -FLT_MAX } };
+
+    for (uint32_t index : indices) {
+        auto position = vertices[index].position;
+
+        aabb.min = { std::min(aabb.min.x, position.x),
+                     std::min(aabb.min.y, position.y),
+                     std::min(aabb.min.z, position.z) };
+
+        aabb.max = { std::max(aabb.max.x, position.x),
+                     std::max(aabb.max.y, position.y),
+                     std::max(aabb.max.z, position.z) };
+    }
+
+    return aabb;
+}
+
+auto MakeRigidTransform(const glm::mat3& rotation, const glm::vec3& translation) noexcept -> RigidTransform
+{
+    const auto& m = rotation;
+
+    auto trace = m[0][0] + m[1][1] + m[2][2];
+    auto q     = glm::vec4(0.0f); // x, y, z, w
+
+    if (trace > 0.0f) {
+        auto s = 2.0f * std::sqrt(trace + 1.0f);
+        q      = { (m[1][2] - m[2][1]) / s, (m[2][0] - m[0][2]) / s, (m[0][1] - m[1][0]) / s, 0.25f * s };
+    } else if (m[0][0] > m[1][1] && m[0][0] > m[2][2]) {
+        auto s = 2.0f * std::sqrt(1.0f + m[0][0] - m[1][1] - m[2][2]);
+        q      = { 0.25f * s, (m[1][0] + m[0][1]) / s, (m[2][0] + m[0][2]) / s, (m[1][2] - m[2][1]) / s };
+    } else if (m[1][1] > m[2][2]) {
+        auto s = 2.0f * std::sqrt(1.0f + m[1][1] - m[0][0] - m[2][2]);
+        q      = { (m[1][0] + m[0][1]) / s, 0.25f * s, (m[2][1] + m[1][2]) / s, (m[2][0] - m[0][2]) / s };
+    } else {
+        auto s = 2.0f * std::sqrt(1.0f + m[2][2] - m[0][0] - m[1][1]);
+        q      = { (m[2][0] + m[0][2]) / s, (m[2][1] + m[1][2]) / s, 0.25f * s, (m[0][1] - m[1][0]) / s };
+    }
+
+    auto axis   = glm::vec3(q.x, q.y, q.z);
+    auto length = std::sqrt(glm::dot(axis, axis));
+
+    if (length == 0.0f) {
+        return RigidTransform{ .translation = translation };
+    }
+
+    return RigidTransform{ .axis = axis / length, .angle = 2.0f * std::atan2(length, q.w), .translation = translation };
+}
+
+void SplitGeometry(
+    const GeometryView&                       geometry,
+    size_t                                    index_budget,
+    const std::function<void(GeometryBatch)>& emit)
+{
+    constexpr auto kUnused = std::numeric_limits<uint32_t>::max();
+
+    // File vertex -> batch vertex. Only the entries of the current batch are set, they are reset on every flush.
+    auto remap = std::vector<uint32_t>(geometry.vertices.size(), kUnused);
+    auto used  = std::vector<uint32_t>{};
+    auto batch = GeometryBatch{};
+
+    auto flush = [&]() {
+        for (auto vertex : used) {
+            remap[vertex] = kUnused;
+        }
+        used.clear();
+
+        batch.geometry.material_count = geometry.material_count;
+        emit(std::move(batch));
+        batch = GeometryBatch{};
+    };
+
+    for (size_t shape = 0; shape != geometry.shapes.size(); ++shape) {
+        for (const auto& mesh : geometry.shapes[shape].meshes) {
+            auto& indices = batch.geometry.indices;
+            auto  lods    = geometry.lods.subspan(mesh.first_lod, mesh.lod_count);
+
+            auto index_count = mesh.index_count;
+            for (const auto& lod : lods) {
+                index_count += lod.index_count;
+            }
+
+            if (!indices.empty() && indices.size() + index_count > index_budget) {
+                flush();
+            }
+
+            auto& shapes = batch.geometry.shapes;
+
+            if (shapes.empty()) {
+                batch.first_shape = shape;
+            }
+            while (batch.first_shape + shapes.size() <= shape) {
+                shapes.push_back({ geometry.shapes[batch.first_shape + shapes.size()].name, {} });
+            }
+
+            auto record          = mesh;
+            record.first_index   = indices.size();
+            record.first_meshlet = batch.geometry.meshlets.size();
+            record.first_lod     = batch.geometry.lods.size();
+
+            for (auto meshlet : geometry.meshlets.subspan(mesh.first_meshlet, mesh.meshlet_count)) {
+                meshlet.first_index = meshlet.first_index - mesh.first_index + record.first_index;
+                batch.geometry.meshlets.push_back(meshlet);
+            }
+
+            auto add_indices = [&](size_t first_index, size_t count) {
+                for (auto vertex : geometry.indices.subspan(first_index, count)) {
+                    auto& local = remap[vertex];
+                    if (local == kUnused) {
+                        local = utils::narrow_cast<uint32_t>(batch.geometry.vertices.size());
+                        batch.geometry.vertices.push_back(geometry.vertices[vertex]);
+                        used.push_back(vertex);
+                    }
+                    indices.push_back(local);
+                }
+            };
+
+            add_indices(mesh.first_index, mesh.index_count);
+
+            for (auto lod : lods) {
+                auto first_index = lod.first_index;
+                lod.first_index  = indices.size();
+                batch.geometry.lods.push_back(lod);
+                add_indices(first_index, lod.index_count);
+            }
+
+            shapes.back().meshes.push_back(record);
+        }
+    }
+
+    // Instances of earlier meshes have no indices, a batch may consist of them alone
+    if (!batch.geometry.shapes.empty()) {
+        flush();
+    }
+}
+
+auto PackIndices(
+    std::span<const uint32_t>    indices,
+    std::span<const ShapeRecord> shapes,
+    std::span<const LodRecord>   lods) -> PackedIndices
+{
+    auto packed = PackedIndices{};
+
+    for (const auto& shape : shapes) {
+        for (const auto& mesh : shape.meshes) {
+            auto mesh_indices = indices.subspan(mesh.first_index, mesh.index_count);
+            auto mesh_lods    = lods.subspan(mesh.first_lod, mesh.lod_count);
+            auto record       = PackedMeshRecord{};
+
+            // The LODs use a subset of the vertices of the mesh and need not be searched
+            if (!mesh_indices.empty()) {
+                auto [min, max]      = std::minmax_element(mesh_indices.begin(), mesh_indices.end());
+                record.vertex_offset = *min;
+                if (*max - *min <= std::numeric_limits<uint16_t>::max()) {
+                    record.index_format = IndexFormat::Uint16;
+                }
+            }
+
+            // Start every range on a four byte boundary
+            if (packed.data.size() % 2) {
+                packed.data.push_back(0);
+            }
+
+            auto base = utils::narrow_cast<uint32_t>(record.vertex_offset);
+
+            // Appends a range in the format of the mesh and returns its first index
+            auto append = [&](std::span<const uint32_t> range) {
+                auto first = packed.data.size();
+
+                if (record.index_format == IndexFormat::Uint16) {
+                    packed.data.resize(first + range.size());
+                    for (size_t i = 0; i != range.size(); ++i) {
+                        packed.data[first + i] = static_cast<uint16_t>(range[i] - base);
+                    }
+                    return first;
+                }
+
+                packed.data.resize(first + 2 * range.size());
+                for (size_t i = 0; i != range.size(); ++i) {
+                    auto index = range[i] - base;
+                    std::memcpy(&packed.data[first + 2 * i], &index, sizeof(index));
+                }
+                return first / 2;
+            };
+
+            record.first_index = append(mesh_indices);
+
+            for (const auto& [first_index, index_count, error] : mesh_lods) {
+                auto first = append(indices.subspan(first_index, index_count));
+                record.lods.push_back({ first, index_count, error });
+            }
+
+            packed.meshes.push_back(std::move(record));
+        }
+    }
+
+    return packed;
+}
+
+SceneBuilder::SceneBuilder(
+    ScenePtr                     scene,
+    std::span<const ShapeRecord> shapes,
+    size_t                       material_count,
+    const std::filesystem::path& filepath,
+    VertexLayout                 vertex_layout)
+    : m_scene(scene), m_vertex_layout(IsPointCloud(shapes) ? VertexLayout::Float : vertex_layout)
+{
+    auto shader = scene->CreateShader();
+    {
+        auto default_material = scene->CreateMaterial(shader);
+        m_material_map[-1]    = default_material;
+
+        for (size_t material_index = 0; material_index != material_count; ++material_index) {
+            auto material         = scene->CreateMaterial(shader);
+            auto index            = utils::narrow_cast<int>(material_index);
+            m_material_map[index] = material;
+        }
+    }
+
+    auto root_node = scene->GetRootNode();
+
+    m_file_node = root_node->AttachNode(scene->CreateGroupNode());
+
+    m_file_node->SetProperty("name", filepath.filename().string());
+    m_file_node->SetProperty("Path", filepath.string());
+
+    auto shape_num = 1;
+
+    m_shapes.reserve(shapes.size());
+
+    for (const auto& [shape_name, mesh_records] : shapes) {
+        auto name = shape_name;
+        if (name.empty()) {
+            name = std::string("Mesh ") + std::to_string(shape_num++);
+        }
+        m_shapes.push_back({ std::move(name), mesh_records.size() });
+    }
+}
+
+auto PrepareBuffers(const GeometryView& geometry, VertexLayout vertex_layout) -> BatchBuffers
+{
+    auto buffers = BatchBuffers{};
+
+    auto assign_vertices = [&buffers](const void* data, size_t size) {
+        buffers.vertices.resize(size);
+        std::memcpy(buffers.vertices.data(), data, size);
+    };
+
+    if (IsPointCloud(geometry.shapes)) {
+        vertex_layout = VertexLayout::Float;
+    }
+
+    if (geometry.indices.empty()) {
+        buffers.indices = PackIndices(geometry.indices, geometry.shapes, geometry.lods);
+    } else if (vertex_layout == VertexLayout::Quantized) {
+        auto quantized = QuantizeGeometry(geometry);
+
+        assign_vertices(quantized.vertices.data(), quantized.vertices.size() * sizeof(VertexPN16));
+        buffers.indices = PackIndices(quantized.indices, geometry.shapes, geometry.lods);
+    } else if (vertex_layout == VertexLayout::Flat) {
+        auto [remap, unique] = WeldPositions(geometry.vertices, nullptr);
+
+        auto vertices = std::vector<VertexP>{};
+        auto indices  = std::vector<uint32_t>{};
+
+        vertices.reserve(unique.size());
+        for (auto vertex : unique) {
+            vertices.push_back({ geometry.vertices[vertex].position });
+        }
+
+        indices.reserve(geometry.indices.size());
+        for (auto index : geometry.indices) {
+            indices.push_back(remap[index]);
+        }
+
+        assign_vertices(vertices.data(), vertices.size() * sizeof(VertexP));
+        buffers.indices = PackIndices(indices, geometry.shapes, geometry.lods);
+    } else {
+        assign_vertices(geometry.vertices.data(), geometry.vertices.size_bytes());
+        buffers.indices = PackIndices(geometry.indices, geometry.shapes, geometry.lods);
+    }
+
+    return buffers;
+}
+
+auto SceneBuilder::Add(const GeometryView& geometry, size_t first_shape) -> Buffers
+{
+    return Add(geometry, PrepareBuffers(geometry, m_vertex_layout), first_shape);
+}
+
+auto SceneBuilder::Add(const GeometryView& geometry, BatchBuffers buffers, size_t first_shape) -> Buffers
+{
+    auto  vertex_buffer = VertexBufferPtr{};
+    auto  index_buffer  = IndexBufferPtr{};
+    auto& packed        = buffers.indices;
+
+    if (!packed.data.empty()) {
+        auto vertices_size = buffers.vertices.size();
+        auto indices_size  = packed.data.size() * sizeof(uint16_t);
+
+        vertex_buffer = m_scene->CreateVertexBuffer(buffers.vertices.data(), vertices_size, std::align_val_t(32));
+        index_buffer  = m_scene->CreateIndexBuffer(packed.data.data(), indices_size, std::align_val_t(32));
+    }
+
+    auto packed_mesh = packed.meshes.begin();
+
+    for (size_t i = 0; i != geometry.shapes.size(); ++i) {
+        auto& shape = m_shapes[first_shape + i];
+
+        for (const auto& record : geometry.shapes[i].meshes) {
+            if (shape.parent == nullptr) {
+                shape.parent = m_file_node;
+                if (shape.mesh_count > 1) {
+                    shape.parent = m_file_node->AttachNode(m_scene->CreateGroupNode());
+                    shape.parent->SetProperty("name", shape.name);
+                }
+            }
+            auto& [format, first, vertex_offset, lods] = *packed_mesh++;
+
+            auto material = m_material_map[record.material_id];
+            auto parent   = shape.parent;
+            auto mesh     = MeshPtr{};
+
+            if (record.prototype != kNoPrototype) {
+                const auto& [axis, angle, translation] = record.transform;
+
+                if (translation != glm::vec3(0.0f)) {
+                    auto distance = Float3{ translation.x, translation.y, translation.z };
+                    parent        = parent->AttachNode(m_scene->CreateTranslateNode(distance));
+                }
+                if (angle != 0.0f) {
+                    parent = parent->AttachNode(m_scene->CreateRotateNode({ axis.x, axis.y, axis.z }, Radians(angle)));
+                }
+                mesh = m_meshes[record.prototype];
+            } else {
+                // The meshlets are contiguous ranges of the mesh, whose indices stay together in the packed buffer
+                auto clusters = MeshClusters{};
+                auto bounds   = std::vector<ClusterBounds>{};
+
+                for (const auto& meshlet : geometry.meshlets.subspan(record.first_meshlet, record.meshlet_count)) {
+                    auto offset = meshlet.first_index - record.first_index;
+                    clusters.push_back({ first + offset, meshlet.index_count, meshlet.bounds });
+                    bounds.push_back(meshlet.bounds);
+                }
+
+                mesh = m_scene->CreateMesh(
+                    record.aabb,
+                    vertex_buffer,
+                    index_buffer,
+                    first,
+                    record.index_count,
+                    format,
+                    vertex_offset,
+                    m_vertex_layout,
+                    std::move(lods),
+                    MergeClusterBounds(bounds),
+                    std::move(clusters),
+                    record.topology);
+            }
+
+            m_meshes.push_back(mesh);
+
+            auto instance = parent->AttachNode(m_scene->CreateInstanceNode(mesh, material));
+            if (shape.mesh_count == 1) {
+                instance->SetProperty("name", shape.name);
+            } else {
+                auto suffix = std::string(" (") + std::to_string(shape.mesh_number++) + (")");
+                instance->SetProperty("name", shape.name + suffix);
+            }
+        }
+    }
+
+    return { vertex_buffer, index_buffer };
+}
+
+NodePtr BuildScene(
+    ScenePtr                     scene,
+    const GeometryView&          geometry,
+    const std::filesystem::path& filepath,
+    VertexLayout                 vertex_layout)
+{
+    auto builder = SceneBuilder(scene, geometry.shapes, geometry.material_count, filepath, vertex_layout);
+
+    builder.Add(geometry, 0);
+
+    return builder.GetFileNode();
+}
@@ -0,0 +1,239 @@
+#pragma once
+
+#include "platform.hpp"
+#include "scene.hpp"
+#include "utils/math.hpp"
+
+BEGIN_DISABLE_WARNINGS
+
+#include <glm/gtc/type_precision.hpp>
+#include <glm/matrix.hpp>
+
+END_DISABLE_WARNINGS
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <limits>
+#include <map>
+#include <span>
+#include <string>
+#include <vector>
+
+struct VertexPN final {
+    constexpr VertexPN(const glm::vec3& position, const glm::vec3 normal) noexcept : position(position), normal(normal)
+    {}
+    glm::vec3 position;
+    glm::vec3 normal;
+};
+
+inline bool operator==(const VertexPN& lhs, const VertexPN& rhs) noexcept
+{
+    return (lhs.position == rhs.position) && (glm::dot(lhs.normal, rhs.normal) > 0.999847695f);
+}
+
+// Compact vertex of 12 bytes instead of 24. The position is quantized to 16 bits per axis relative to the bounding box
+// of its mesh, the normal is octahedral encoded into two 16 bit values. See vertex_quantizer.hpp.
+struct VertexPN16 final {
+    glm::u16vec4 position; // Unorm, w is unused
+    glm::i16vec2 normal;   // Snorm
+};
+
+// Position only vertex of VertexLayout::Flat, the fragment shader derives the face normal
+struct VertexP final {
+    glm::vec3 position;
+};
+
+// Cluster of triangles of a mesh, a contiguous range of its indices. See meshlet_builder.hpp.
+struct MeshletRecord final {
+    size_t        first_index{};
+    size_t        index_count{};
+    ClusterBounds bounds;
+};
+
+using MeshletRecords = std::vector<MeshletRecord>;
+
+// Simplified version of a mesh, a range of indices that refers to the vertices of the mesh. See mesh_simplifier.hpp.
+struct LodRecord final {
+    size_t first_index{};
+    size_t index_count{};
+    float  error{}; // Deviation from the full resolution surface, relative to the largest extent of the mesh
+};
+
+using LodRecords = std::vector<LodRecord>;
+
+// Rotation by 'angle' about 'axis' followed by a translation
+struct RigidTransform final {
+    glm::vec3 axis{ 0.0f, 0.0f, 1.0f };
+    float     angle{};
+    glm::vec3 translation{ 0.0f };
+};
+
+// Transform of 'rotation', a proper rotation matrix, followed by 'translation'. The axis and angle are taken from the
+// quaternion of the rotation, which stays precise near half turns.
+auto MakeRigidTransform(const glm::mat3& rotation, const glm::vec3& translation) noexcept -> RigidTransform;
+
+constexpr size_t kNoPrototype = std::numeric_limits<size_t>::max();
+
+struct MeshRecord final {
+    AABB   aabb{};
+    int    material_id{};
+    size_t first_index{};
+    size_t index_count{};
+    size_t first_meshlet{};
+    size_t meshlet_count{}; // Zero if the mesh has not been split into meshlets
+    size_t first_lod{};
+    size_t lod_count{}; // Simplified levels following the full resolution one, finest first
+
+    // Earlier mesh record of the file, numbered in shape order, whose triangles this one repeats at 'transform'.
+    // Such records have no indices, meshlets or LODs of their own. See mesh_deduplicator.hpp.
+    size_t         prototype{ kNoPrototype };
+    RigidTransform transform{};
+
+    // Point meshes draw their indices as points and skip the stages that need triangles, see IsPointCloud
+    Topology topology{ Topology::Triangles };
+};
+
+using MeshRecords = std::vector<MeshRecord>;
+
+struct ShapeRecord final {
+    std::string name;
+    MeshRecords meshes;
+};
+
+using ShapeRecords = std::vector<ShapeRecord>;
+
+// Non-owning view of welded geometry. The vertex and index data may live in memory owned by a Geometry object or in a
+// memory mapped cache file.
+struct GeometryView final {
+    std::span<const VertexPN>      vertices;
+    std::span<const uint32_t>      indices;
+    std::span<const ShapeRecord>   shapes;
+    size_t                         material_count{};
+    std::span<const MeshletRecord> meshlets;
+    std::span<const LodRecord>     lods;
+};
+
+// Welded geometry of a loaded file: a shared vertex and index array, and one entry per shape with the index ranges of
+// its meshes (one mesh per material). The meshlets and LODs of all meshes are in one table each, referenced by range.
+// The LODs have index ranges of their own, apart from the ones of the meshes.
+struct Geometry final {
+    std::vector<VertexPN> vertices;
+    std::vector<uint32_t> indices;
+    ShapeRecords          shapes;
+    size_t                material_count{};
+    MeshletRecords        meshlets;
+    LodRecords            lods;
+
+    auto View() const noexcept { return GeometryView{ vertices, indices, shapes, material_count, meshlets, lods }; }
+};
+
+// True if the meshes of 'shapes' are points. A file holds either triangles or points, so point clouds skip normal
+// generation, deduplication, optimization, meshlets, LODs and the geometry cache, and are stored as VertexLayout::Float
+// whatever the layout, which is the only one that keeps their missing normals apart from the others.
+auto IsPointCloud(std::span<const ShapeRecord> shapes) noexcept -> bool;
+
+// Bounding box of the vertices referenced by 'indices'
+auto ComputeBoundingBox(std::span<const uint32_t> indices, std::span<const VertexPN> vertices) noexcept -> AABB;
+
+// Part of the geometry of a file with its own compact vertex and index arrays. shapes[i] holds the meshes of shape
+// first_shape + i of the file that are in this batch, the remaining meshes of that shape are in neighbouring batches.
+struct GeometryBatch final {
+    Geometry geometry;
+    size_t   first_shape{};
+};
+
+// Splits 'geometry' into batches of whole meshes in shape order. A mesh is added to the current batch as long as the
+// batch stays within 'index_budget' indices, so only batches holding a single mesh can be larger than the budget.
+void SplitGeometry(
+    const GeometryView&                       geometry,
+    size_t                                    index_budget,
+    const std::function<void(GeometryBatch)>& emit);
+
+// Index range of a mesh in a packed index buffer
+struct PackedMeshRecord final {
+    IndexFormat index_format = IndexFormat::Uint32;
+    size_t      first_index{};   // In indices of 'index_format'
+    size_t      vertex_offset{}; // Lowest vertex referenced by the mesh, the indices are relative to it
+    MeshLods    lods;            // Follow the full resolution range, in the same format and relative to the same vertex
+};
+
+// Index buffer contents with the narrowest index format per mesh. meshes[i] is the i-th mesh of the geometry in shape
+// order. The ranges start on four byte boundaries, so a 32-bit range can follow a 16-bit one in the same buffer.
+struct PackedIndices final {
+    std::vector<uint16_t>         data;
+    std::vector<PackedMeshRecord> meshes;
+};
+
+// Stores the indices of every mesh of 'shapes' and of its LODs relative to the lowest vertex the mesh references, as
+// 16-bit values if the mesh spans at most 65536 vertices and as 32-bit values otherwise
+auto PackIndices(
+    std::span<const uint32_t>    indices,
+    std::span<const ShapeRecord> shapes,
+    std::span<const LodRecord>   lods) -> PackedIndices;
+
+// Contents of the vertex and index buffer of a batch: its vertices as the vertex type of a layout, and its packed
+// indices. Building them quantizes or welds the vertices of VertexLayout::Quantized and VertexLayout::Flat, so the
+// loaders prepare them on their workers and leave only the copy into the scene to the render thread.
+struct BatchBuffers final {
+    std::vector<std::byte> vertices;
+    PackedIndices          indices;
+};
+
+// 'geometry' is a whole batch, see SceneBuilder::Add
+auto PrepareBuffers(const GeometryView& geometry, VertexLayout vertex_layout) -> BatchBuffers;
+
+// Attaches the geometry of a file to the scene root under a group node named after the file. The geometry can be added
+// at once or in batches, each batch getting its own vertex and index buffer. The node layout and names do not depend
+// on how the geometry is split.
+class SceneBuilder final {
+  public:
+    struct Buffers final {
+        VertexBufferPtr vertices = nullptr;
+        IndexBufferPtr  indices  = nullptr;
+    };
+
+    // Creates the file node and the materials. 'shapes' is the layout of the whole file.
+    SceneBuilder(
+        ScenePtr                     scene,
+        std::span<const ShapeRecord> shapes,
+        size_t                       material_count,
+        const std::filesystem::path& filepath,
+        VertexLayout                 vertex_layout = VertexLayout::Float);
+
+    // Creates the buffers, meshes and nodes of 'geometry', whose first shape is shape 'first_shape' of the file.
+    // With VertexLayout::Quantized every mesh gets its own range of VertexPN16 vertices, with VertexLayout::Flat the
+    // vertices at equal positions are merged into one VertexP. Records with a prototype become instances of its mesh
+    // under translate and rotate nodes. Returns null buffers if 'geometry' holds no indices.
+    auto Add(const GeometryView& geometry, size_t first_shape) -> Buffers;
+
+    // Same as above with the buffer contents already prepared by PrepareBuffers in the layout of the builder. Only the
+    // records of 'geometry' are read, its vertices and indices may have been released.
+    auto Add(const GeometryView& geometry, BatchBuffers buffers, size_t first_shape) -> Buffers;
+
+    auto GetFileNode() const noexcept { return m_file_node; }
+
+  private:
+    struct ShapeNode final {
+        std::string name;
+        size_t      mesh_count{};
+        size_t      mesh_number{ 1 };
+        NodePtr     parent = nullptr;
+    };
+
+    ScenePtr                   m_scene         = nullptr;
+    NodePtr                    m_file_node     = nullptr;
+    VertexLayout               m_vertex_layout = VertexLayout::Float;
+    std::map<int, MaterialPtr> m_material_map;
+    std::vector<ShapeNode>     m_shapes;
+    std::vector<MeshPtr>       m_meshes; // Mesh of every record added so far, in shape order
+};
+
+// Creates the buffers, meshes, materials and nodes for 'geometry' and attaches them to the scene root under a group
+// node named after the file.
+auto BuildScene(
+    ScenePtr                     scene,
+    const GeometryView&          geometry,
+    const std::filesystem::path& filepath,
+    VertexLayout                 vertex_layout = VertexLayout::Float) -> NodePtr;
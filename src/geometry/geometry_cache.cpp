@@ -0,0 +1,525 @@
+#include "geometry_cache.hpp"
+
+#include "load_progress.hpp"
+#include "mapped_file.hpp"
+#include "mesh_codec.hpp"
+#include "thread_pool.hpp"
+#include "utils/cast.hpp"
+#include "utils/hash.hpp"
+#include "utils/misc.hpp"
+
+BEGIN_DISABLE_WARNINGS
+
+#include <spdlog/spdlog.h>
+
+END_DISABLE_WARNINGS
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <span>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+namespace {
+
+constexpr uint32_t kBlobMagic     = 0x31434756; // "VGC1"
+constexpr uint32_t kBlobVersion   = 8;
+constexpr uint64_t kBlobAlignment = 16;
+constexpr size_t   kHashBlockSize = size_t{ 4 } << 20;
+
+static_assert(std::is_trivially_copyable_v<MeshletRecord>);
+
+struct BlobHeader final {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t source_size;
+    int64_t  source_mtime;
+    uint64_t source_hash;
+    uint64_t source_variant;
+    uint64_t blob_size;
+    uint64_t material_count;
+    uint64_t vertex_count;
+    uint64_t index_count;
+    uint64_t mesh_size; // Vertices and indices, as written by EncodeMesh
+    uint64_t mesh_offset;
+    uint64_t shape_count;
+    uint64_t shape_offset;
+    uint64_t record_count;
+    uint64_t record_offset;
+    uint64_t names_size;
+    uint64_t names_offset;
+    uint64_t meshlet_count;
+    uint64_t meshlet_offset;
+    uint64_t lod_count;
+    uint64_t lod_offset;
+};
+
+struct BlobShape final {
+    uint64_t name_offset;
+    uint64_t name_size;
+    uint64_t first_record;
+    uint64_t record_count;
+};
+
+struct BlobRecord final {
+    float    min[3];
+    float    max[3];
+    int32_t  material_id;
+    uint32_t reserved;
+    uint64_t first_index;
+    uint64_t index_count;
+    uint64_t first_meshlet;
+    uint64_t meshlet_count;
+    uint64_t first_lod;
+    uint64_t lod_count;
+    uint64_t prototype; // Record number, or all ones
+    float    axis[3];
+    float    angle;
+    float    translation[3];
+    uint32_t reserved2;
+};
+
+struct BlobMeshlet final {
+    uint64_t first_index;
+    uint64_t index_count;
+    float    center[3];
+    float    radius;
+    float    cone_axis[3];
+    float    cone_cutoff;
+};
+
+struct BlobLod final {
+    uint64_t first_index;
+    uint64_t index_count;
+    float    error;
+    uint32_t reserved;
+};
+
+constexpr uint64_t AlignUp(uint64_t value) noexcept
+{
+    return (value + kBlobAlignment - 1) & ~(kBlobAlignment - 1);
+}
+
+// Byte range [offset, offset + count * size) lies inside a blob of 'blob_size' bytes
+bool IsInside(uint64_t offset, uint64_t count, uint64_t size, uint64_t blob_size) noexcept
+{
+    return offset % kBlobAlignment == 0 && offset <= blob_size && count <= (blob_size - offset) / size;
+}
+
+template <typename T>
+auto BlobArray(const MappedFile& blob, uint64_t offset, uint64_t count) noexcept
+{
+    auto data = reinterpret_cast<const T*>(blob.Data() + offset);
+    return std::span<const T>(data, utils::narrow_cast<size_t>(count));
+}
+
+// Hashes the contents of 'filepath'. Each block is hashed independently with its index as the seed, the block hashes
+// are then hashed together.
+uint64_t HashFile(const std::filesystem::path& filepath, ThreadPool* thread_pool, LoadProgress* progress)
+{
+    auto file         = MappedFile(filepath, MappedFile::Access::Sequential);
+    auto block_count  = (file.Size() + kHashBlockSize - 1) / kHashBlockSize;
+    auto block_hashes = std::vector<uint64_t>(block_count);
+
+    StartProgress(progress, "Hashing", block_count);
+
+    auto hash_block = [&](size_t i) {
+        auto offset     = i * kHashBlockSize;
+        auto size       = std::min(kHashBlockSize, file.Size() - offset);
+        block_hashes[i] = utils::Hash64(file.Data() + offset, size, i);
+        AdvanceProgress(progress);
+    };
+
+    ParallelFor(thread_pool, block_count, hash_block);
+
+    return utils::Hash64(block_hashes.data(), block_hashes.size() * sizeof(uint64_t), file.Size());
+}
+
+// Unique among the processes and threads that may write the same blob at the same time
+std::string TempSuffix()
+{
+    auto random = std::random_device{};
+    auto value  = (uint64_t{ random() } << 32) | random();
+
+#ifdef _WIN32
+    auto pid = _getpid();
+#else
+    auto pid = getpid();
+#endif
+
+    return fmt::format(".{}.{:016x}.tmp", pid, value);
+}
+
+} // namespace
+
+GeometryCache::GeometryCache(std::filesystem::path directory, Validation validation)
+    : m_directory(std::move(directory)), m_validation(validation)
+{}
+
+auto GeometryCache::DefaultDirectory() -> std::filesystem::path
+{
+    namespace fs = std::filesystem;
+
+#ifdef _WIN32
+    if (auto local_app_data = std::getenv("LOCALAPPDATA")) {
+        return fs::path(local_app_data) / "vega" / "cache";
+    }
+#else
+    if (auto xdg_cache_home = std::getenv("XDG_CACHE_HOME"); xdg_cache_home && *xdg_cache_home) {
+        return fs::path(xdg_cache_home) / "vega";
+    }
+    if (auto home = std::getenv("HOME"); home && *home) {
+        return fs::path(home) / ".cache" / "vega";
+    }
+#endif
+    auto error = std::error_code{};
+    auto temp  = fs::temp_directory_path(error);
+    return error ? fs::path("vega-cache") : temp / "vega-cache";
+}
+
+auto GeometryCache::ComputeKey(const std::filesystem::path& filepath, uint64_t variant) -> Key
+{
+    namespace fs = std::filesystem;
+
+    auto key = Key{};
+
+    key.path    = fs::absolute(filepath).lexically_normal();
+    key.size    = fs::file_size(filepath);
+    key.mtime   = static_cast<int64_t>(fs::last_write_time(filepath).time_since_epoch().count());
+    key.variant = variant;
+
+    return key;
+}
+
+auto GeometryCache::Find(const Key& key, ThreadPool* thread_pool, LoadProgress* progress) const
+    -> std::optional<Geometry>
+{
+    namespace fs = std::filesystem;
+
+    auto blob_path = BlobPath(key);
+    auto error     = std::error_code{};
+
+    if (false == fs::is_regular_file(blob_path, error)) {
+        return std::nullopt;
+    }
+
+    auto blob = MappedFile();
+    try {
+        blob = MappedFile(blob_path, MappedFile::Access::Random);
+    } catch (const std::exception& exception) {
+        spdlog::warn("Failed to open geometry cache blob {}: {}", blob_path.string(), exception.what());
+        return std::nullopt;
+    }
+
+    if (blob.Size() < sizeof(BlobHeader)) {
+        return std::nullopt;
+    }
+
+    auto header = BlobHeader{};
+    std::memcpy(&header, blob.Data(), sizeof(header));
+
+    auto is_current = header.magic == kBlobMagic && header.version == kBlobVersion && header.blob_size == blob.Size();
+
+    auto is_match = header.source_size == key.size && header.source_mtime == key.mtime &&
+                    header.source_variant == key.variant;
+
+    if (!is_current || !is_match) {
+        return std::nullopt;
+    }
+
+    if (m_validation == Validation::Contents && header.source_hash != HashFile(key.path, thread_pool, progress)) {
+        spdlog::info("Geometry cache blob {} does not match the contents of {}", blob_path.string(), key.path.string());
+        return std::nullopt;
+    }
+
+    auto is_valid = IsInside(header.mesh_offset, header.mesh_size, 1, header.blob_size) &&
+                    IsInside(header.shape_offset, header.shape_count, sizeof(BlobShape), header.blob_size) &&
+                    IsInside(header.record_offset, header.record_count, sizeof(BlobRecord), header.blob_size) &&
+                    IsInside(header.names_offset, header.names_size, 1, header.blob_size) &&
+                    IsInside(header.meshlet_offset, header.meshlet_count, sizeof(BlobMeshlet), header.blob_size) &&
+                    IsInside(header.lod_offset, header.lod_count, sizeof(BlobLod), header.blob_size);
+
+    if (!is_valid) {
+        spdlog::warn("Geometry cache blob {} is corrupted", blob_path.string());
+        return std::nullopt;
+    }
+
+    auto blob_shapes   = BlobArray<BlobShape>(blob, header.shape_offset, header.shape_count);
+    auto blob_records  = BlobArray<BlobRecord>(blob, header.record_offset, header.record_count);
+    auto blob_meshlets = BlobArray<BlobMeshlet>(blob, header.meshlet_offset, header.meshlet_count);
+    auto blob_lods     = BlobArray<BlobLod>(blob, header.lod_offset, header.lod_count);
+    auto names         = BlobArray<char>(blob, header.names_offset, header.names_size);
+
+    auto shapes    = ShapeRecords{};
+    auto instances = std::vector<bool>{}; // Whether every record read so far has a prototype
+
+    shapes.reserve(blob_shapes.size());
+
+    for (const auto& blob_shape : blob_shapes) {
+        auto is_valid_shape = blob_shape.name_offset <= names.size() &&
+                              blob_shape.name_size <= names.size() - blob_shape.name_offset &&
+                              blob_shape.first_record <= blob_records.size() &&
+                              blob_shape.record_count <= blob_records.size() - blob_shape.first_record;
+        if (!is_valid_shape) {
+            spdlog::warn("Geometry cache blob {} is corrupted", blob_path.string());
+            return std::nullopt;
+        }
+
+        auto& shape = shapes.emplace_back();
+
+        shape.name = std::string(names.data() + blob_shape.name_offset, blob_shape.name_size);
+        shape.meshes.reserve(blob_shape.record_count);
+
+        for (const auto& blob_record : blob_records.subspan(blob_shape.first_record, blob_shape.record_count)) {
+            auto is_valid_record = blob_record.first_index <= header.index_count &&
+                                   blob_record.index_count <= header.index_count - blob_record.first_index &&
+                                   blob_record.first_meshlet <= header.meshlet_count &&
+                                   blob_record.meshlet_count <= header.meshlet_count - blob_record.first_meshlet &&
+                                   blob_record.first_lod <= header.lod_count &&
+                                   blob_record.lod_count <= header.lod_count - blob_record.first_lod &&
+                                   (blob_record.prototype == kNoPrototype ||
+                                    (blob_record.prototype < instances.size() && !instances[blob_record.prototype]));
+            if (!is_valid_record) {
+                spdlog::warn("Geometry cache blob {} is corrupted", blob_path.string());
+                return std::nullopt;
+            }
+
+            const auto& axis        = blob_record.axis;
+            const auto& translation = blob_record.translation;
+
+            instances.push_back(blob_record.prototype != kNoPrototype);
+
+            shape.meshes.push_back(MeshRecord{
+
+                .aabb          = AABB{ { blob_record.min[0], blob_record.min[1], blob_record.min[2] },
+                                { blob_record.max[0], blob_record.max[1], blob_record.max[2] } },
+                .material_id   = blob_record.material_id,
+                .first_index   = utils::narrow_cast<size_t>(blob_record.first_index),
+                .index_count   = utils::narrow_cast<size_t>(blob_record.index_count),
+                .first_meshlet = utils::narrow_cast<size_t>(blob_record.first_meshlet),
+                .meshlet_count = utils::narrow_cast<size_t>(blob_record.meshlet_count),
+                .first_lod     = utils::narrow_cast<size_t>(blob_record.first_lod),
+                .lod_count     = utils::narrow_cast<size_t>(blob_record.lod_count),
+                .prototype     = utils::narrow_cast<size_t>(blob_record.prototype),
+                .transform     = { .axis        = { axis[0], axis[1], axis[2] },
+                                   .angle       = blob_record.angle,
+                                   .translation = { translation[0], translation[1], translation[2] } } });
+        }
+    }
+
+    auto meshlets = MeshletRecords{};
+    meshlets.reserve(blob_meshlets.size());
+
+    for (const auto& blob_meshlet : blob_meshlets) {
+        auto is_valid_meshlet = blob_meshlet.first_index <= header.index_count &&
+                                blob_meshlet.index_count <= header.index_count - blob_meshlet.first_index;
+        if (!is_valid_meshlet) {
+            spdlog::warn("Geometry cache blob {} is corrupted", blob_path.string());
+            return std::nullopt;
+        }
+
+        const auto& center = blob_meshlet.center;
+        const auto& axis   = blob_meshlet.cone_axis;
+
+        auto bounds = ClusterBounds{
+
+            .center      = glm::vec3(center[0], center[1], center[2]),
+            .radius      = blob_meshlet.radius,
+            .cone_axis   = glm::vec3(axis[0], axis[1], axis[2]),
+            .cone_cutoff = blob_meshlet.cone_cutoff
+        };
+
+        meshlets.push_back(MeshletRecord{
+
+            .first_index = utils::narrow_cast<size_t>(blob_meshlet.first_index),
+            .index_count = utils::narrow_cast<size_t>(blob_meshlet.index_count),
+            .bounds      = bounds });
+    }
+
+    auto lods = LodRecords{};
+    lods.reserve(blob_lods.size());
+
+    for (const auto& [first_index, index_count, error, reserved] : blob_lods) {
+        if (first_index > header.index_count || index_count > header.index_count - first_index) {
+            spdlog::warn("Geometry cache blob {} is corrupted", blob_path.string());
+            return std::nullopt;
+        }
+
+        lods.push_back(LodRecord{
+
+            .first_index = utils::narrow_cast<size_t>(first_index),
+            .index_count = utils::narrow_cast<size_t>(index_count),
+            .error       = error });
+    }
+
+    auto mesh_data = BlobArray<char>(blob, header.mesh_offset, header.mesh_size);
+    auto mesh      = DecodeMesh(std::string_view(mesh_data.data(), mesh_data.size()), thread_pool);
+
+    if (!mesh || mesh->vertices.size() != header.vertex_count || mesh->indices.size() != header.index_count) {
+        spdlog::warn("Geometry cache blob {} is corrupted", blob_path.string());
+        return std::nullopt;
+    }
+
+    return Geometry{
+
+        .vertices       = std::move(mesh->vertices),
+        .indices        = std::move(mesh->indices),
+        .shapes         = std::move(shapes),
+        .material_count = utils::narrow_cast<size_t>(header.material_count),
+        .meshlets       = std::move(meshlets),
+        .lods           = std::move(lods)
+    };
+}
+
+void GeometryCache::Store(const Key& key, const Geometry& geometry, ThreadPool* thread_pool) const noexcept
+{
+    namespace fs = std::filesystem;
+
+    auto blob_path = fs::path();
+    auto temp_path = fs::path();
+
+    try {
+        // Blobs are written under a temporary name and renamed afterwards, so a reader never sees a partial blob
+        blob_path = BlobPath(key);
+        temp_path = blob_path;
+        temp_path += TempSuffix();
+
+        auto shapes   = std::vector<BlobShape>{};
+        auto records  = std::vector<BlobRecord>{};
+        auto names    = std::string{};
+        auto meshlets = std::vector<BlobMeshlet>{};
+        auto lods     = std::vector<BlobLod>{};
+
+        for (const auto& [name, meshes] : geometry.shapes) {
+            shapes.push_back({ names.size(), name.size(), records.size(), meshes.size() });
+            names += name;
+            for (const auto& mesh : meshes) {
+                records.push_back({ { mesh.aabb.min.x, mesh.aabb.min.y, mesh.aabb.min.z },
+                                    { mesh.aabb.max.x, mesh.aabb.max.y, mesh.aabb.max.z },
+                                    mesh.material_id,
+                                    0,
+                                    mesh.first_index,
+                                    mesh.index_count,
+                                    mesh.first_meshlet,
+                                    mesh.meshlet_count,
+                                    mesh.first_lod,
+                                    mesh.lod_count,
+                                    mesh.prototype,
+                                    { mesh.transform.axis.x, mesh.transform.axis.y, mesh.transform.axis.z },
+                                    mesh.transform.angle,
+                                    { mesh.transform.translation.x,
+                                      mesh.transform.translation.y,
+                                      mesh.transform.translation.z },
+                                    0 });
+            }
+        }
+
+        meshlets.reserve(geometry.meshlets.size());
+        for (const auto& [first_index, index_count, bounds] : geometry.meshlets) {
+            const auto& [center, radius, axis, cutoff] = bounds;
+
+            meshlets.push_back({ first_index,
+                                 index_count,
+                                 { center.x, center.y, center.z },
+                                 radius,
+                                 { axis.x, axis.y, axis.z },
+                                 cutoff });
+        }
+
+        lods.reserve(geometry.lods.size());
+        for (const auto& [first_index, index_count, error] : geometry.lods) {
+            lods.push_back({ first_index, index_count, error, 0 });
+        }
+
+        auto mesh = EncodeMesh(geometry.vertices, geometry.indices, MeshCodecOptions{}, thread_pool);
+
+        auto header = BlobHeader{};
+
+        header.magic          = kBlobMagic;
+        header.version        = kBlobVersion;
+        header.source_size    = key.size;
+        header.source_mtime   = key.mtime;
+        header.source_variant = key.variant;
+        header.source_hash    = m_validation == Validation::Contents ? HashFile(key.path, thread_pool, nullptr) : 0;
+        header.material_count = geometry.material_count;
+        header.vertex_count   = geometry.vertices.size();
+        header.index_count    = geometry.indices.size();
+        header.mesh_size      = mesh.size();
+        header.mesh_offset    = AlignUp(sizeof(BlobHeader));
+        header.shape_count    = shapes.size();
+        header.shape_offset   = AlignUp(header.mesh_offset + mesh.size());
+        header.record_count   = records.size();
+        header.record_offset  = AlignUp(header.shape_offset + shapes.size() * sizeof(BlobShape));
+        header.names_size     = names.size();
+        header.names_offset   = AlignUp(header.record_offset + records.size() * sizeof(BlobRecord));
+        header.meshlet_count  = meshlets.size();
+        header.meshlet_offset = AlignUp(header.names_offset + names.size());
+        header.lod_count      = lods.size();
+        header.lod_offset     = AlignUp(header.meshlet_offset + meshlets.size() * sizeof(BlobMeshlet));
+        header.blob_size      = header.lod_offset + lods.size() * sizeof(BlobLod);
+
+        fs::create_directories(m_directory);
+
+        auto file = std::ofstream(temp_path, std::ios::binary | std::ios::trunc);
+
+        utils::throw_runtime_error_if(!file, "Failed to create file");
+
+        auto position = uint64_t{ 0 };
+        auto write    = [&](uint64_t offset, const void* data, uint64_t size) {
+            static constexpr char padding[kBlobAlignment] = {};
+            file.write(padding, utils::narrow_cast<std::streamsize>(offset - position));
+            file.write(static_cast<const char*>(data), utils::narrow_cast<std::streamsize>(size));
+            position = offset + size;
+        };
+
+        write(0, &header, sizeof(header));
+        write(header.mesh_offset, mesh.data(), mesh.size());
+        write(header.shape_offset, shapes.data(), shapes.size() * sizeof(BlobShape));
+        write(header.record_offset, records.data(), records.size() * sizeof(BlobRecord));
+        write(header.names_offset, names.data(), names.size());
+        write(header.meshlet_offset, meshlets.data(), meshlets.size() * sizeof(BlobMeshlet));
+        write(header.lod_offset, lods.data(), lods.size() * sizeof(BlobLod));
+
+        file.close();
+
+        utils::throw_runtime_error_if(!file, "Failed to write file");
+
+        fs::rename(temp_path, blob_path);
+
+        auto raw_size = geometry.vertices.size() * sizeof(VertexPN) + geometry.indices.size() * sizeof(uint32_t);
+
+        spdlog::info(
+            "Geometry cache blob written to {}, vertices and indices compressed from {:.1f} MB to {:.1f} MB",
+            blob_path.string(),
+            static_cast<double>(raw_size) / (1024.0 * 1024.0),
+            static_cast<double>(mesh.size()) / (1024.0 * 1024.0));
+    } catch (const std::exception& exception) {
+        spdlog::warn("Failed to write geometry cache blob {}: {}", blob_path.string(), exception.what());
+        if (!temp_path.empty()) {
+            auto error = std::error_code{};
+            fs::remove(temp_path, error);
+        }
+    }
+}
+
+auto GeometryCache::BlobPath(const Key& key) const -> std::filesystem::path
+{
+    auto path_string = key.path.u8string();
+    auto path_hash   = utils::Hash64(path_string.data(), path_string.size());
+
+    if (key.variant != 0) {
+        return m_directory / fmt::format("{:016x}-{:x}.vgc", path_hash, key.variant);
+    }
+    return m_directory / fmt::format("{:016x}.vgc", path_hash);
+}
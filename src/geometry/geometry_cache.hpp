@@ -0,0 +1,53 @@
+#pragma once
+
+#include "geometry.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+
+class LoadProgress;
+class ThreadPool;
+
+// Directory of binary blobs holding the welded geometry of previously loaded files. Blobs are looked up by the path of
+// the source file and only used if its size and modification time match the ones the blob was created from. The
+// contents of the source file are only checked on request: with the default Validation::Metadata an edit that keeps the
+// size and lands within the resolution of the modification time returns the stale geometry. With Validation::Contents
+// (vega --verify-cache) the source file is also hashed, once when its blob is written and again whenever the blob is a
+// candidate, which costs an extra read of the file in both cases. The vertices and indices are stored through
+// EncodeMesh, so positions and normals are read back quantized; the records are stored as they are, and the bounds of
+// meshes and meshlets are off by less than a quantization step for the vertices read back.
+class GeometryCache final {
+  public:
+    enum class Validation { Metadata, Contents };
+
+    struct Key final {
+        std::filesystem::path path;
+        uint64_t              size{};
+        int64_t               mtime{};
+        uint64_t              variant{}; // Of the options the geometry was built with, see ComputeKey
+    };
+
+    explicit GeometryCache(std::filesystem::path directory, Validation validation = Validation::Metadata);
+
+    // Platform specific per-user cache directory
+    static auto DefaultDirectory() -> std::filesystem::path;
+
+    // Identifies 'filepath' by its absolute path, size and modification time, without reading it. Geometry built from
+    // the same file with other options is to be given another 'variant', which is stored in a blob of its own.
+    static auto ComputeKey(const std::filesystem::path& filepath, uint64_t variant = 0) -> Key;
+
+    // Reads the blob for 'key', decoding the vertices and indices in parallel blocks. With Validation::Contents the
+    // source file is hashed in parallel blocks first, which are reported to 'progress'.
+    auto Find(const Key& key, ThreadPool* thread_pool, LoadProgress* progress = nullptr) const
+        -> std::optional<Geometry>;
+
+    // Writes the blob for 'key'. Failures are logged and otherwise ignored since the cache is only an optimization.
+    void Store(const Key& key, const Geometry& geometry, ThreadPool* thread_pool) const noexcept;
+
+  private:
+    auto BlobPath(const Key& key) const -> std::filesystem::path;
+
+    std::filesystem::path m_directory;
+    Validation            m_validation = Validation::Metadata;
+};
@@ -0,0 +1,1013 @@
+#include "gltf_loader.hpp"
+
+#include "load_progress.hpp"
+#include "normal_generator.hpp"
+#include "thread_pool.hpp"
+#include "utils/cast.hpp"
+#include "vertex_quantizer.hpp"
+
+BEGIN_DISABLE_WARNINGS
+
+#include <spdlog/spdlog.h>
+
+END_DISABLE_WARNINGS
+
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <optional>
+#include <string_view>
+#include <utility>
+
+namespace {
+
+constexpr uint32_t kGlbMagic       = 0x46546c67; // "glTF"
+constexpr uint32_t kGlbJsonChunk   = 0x4e4f534a; // "JSON"
+constexpr uint32_t kGlbBinaryChunk = 0x004e4942; // "BIN\0"
+
+// Enumerants of the glTF specification
+constexpr int kUnsignedByte  = 5121;
+constexpr int kUnsignedShort = 5123;
+constexpr int kUnsignedInt   = 5125;
+constexpr int kFloat         = 5126;
+constexpr int kTriangles     = 4;
+
+// Range of a buffer view, and the blob made of it once a primitive uses it without conversion
+struct BufferView final {
+    std::span<const std::byte> data;
+    size_t                     stride{}; // Zero if the elements are tightly packed
+};
+
+struct Accessor final {
+    std::optional<size_t> view;
+    size_t                offset{}; // Of the first element in the view
+    size_t                stride{};
+    size_t                count{};
+    int                   component_type{};
+    size_t                components{};
+    std::optional<AABB>   bounds;
+    bool                  is_sparse{};
+};
+
+// Result of converting one primitive on a worker. Ranges that are used as they are refer to a buffer view, the others
+// are owned until they are moved into the model.
+struct PrimitiveData final {
+    GltfPrimitive          primitive;
+    std::optional<size_t>  vertex_view;
+    std::optional<size_t>  index_view;
+    std::vector<std::byte> vertices;
+    std::vector<std::byte> indices;
+    bool                   is_valid{};
+};
+
+uint32_t ReadUint32(const char* data) noexcept
+{
+    auto value = uint32_t{};
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+size_t ComponentSize(int component_type) noexcept
+{
+    switch (component_type) {
+    case 5120: // BYTE
+    case kUnsignedByte:
+        return 1;
+    case 5122: // SHORT
+    case kUnsignedShort:
+        return 2;
+    case kUnsignedInt:
+    case kFloat:
+        return 4;
+    default:
+        return 0;
+    }
+}
+
+size_t ComponentCount(const std::string& type) noexcept
+{
+    static const auto counts = std::map<std::string, size_t, std::less<>>{
+        { "SCALAR", 1 }, { "VEC2", 2 }, { "VEC3", 3 }, { "VEC4", 4 }, { "MAT2", 4 }, { "MAT3", 9 }, { "MAT4", 16 },
+    };
+    auto it = counts.find(type);
+    return it != counts.end() ? it->second : 0;
+}
+
+auto DecodeBase64(std::string_view text) -> std::vector<std::byte>
+{
+    auto decode = [](char c) -> int {
+        if (c >= 'A' && c <= 'Z') {
+            return c - 'A';
+        }
+        if (c >= 'a' && c <= 'z') {
+            return c - 'a' + 26;
+        }
+        if (c >= '0' && c <= '9') {
+            return c - '0' + 52;
+        }
+        if (c == '+') {
+            return 62;
+        }
+        if (c == '/') {
+            return 63;
+        }
+        return -1;
+    };
+
+    auto data  = std::vector<std::byte>{};
+    auto bits  = uint32_t{};
+    auto count = 0;
+
+    data.reserve(text.size() / 4 * 3);
+
+    for (char c : text) {
+        if (c == '=') {
+            break;
+        }
+        auto value = decode(c);
+        utils::throw_runtime_error_if(value < 0, "Failed to parse glTF file: invalid base64 data");
+
+        bits = ((bits << 6) | static_cast<uint32_t>(value)) & 0xffffff;
+        count += 6;
+
+        if (count >= 8) {
+            count -= 8;
+            data.push_back(static_cast<std::byte>((bits >> count) & 0xff));
+        }
+    }
+
+    return data;
+}
+
+// Relative URIs of external buffers may escape characters such as spaces
+auto DecodeUri(std::string_view uri) -> std::string
+{
+    auto hex = [](char c) -> int {
+        if (c >= '0' && c <= '9') {
+            return c - '0';
+        }
+        if (c >= 'a' && c <= 'f') {
+            return c - 'a' + 10;
+        }
+        if (c >= 'A' && c <= 'F') {
+            return c - 'A' + 10;
+        }
+        return -1;
+    };
+
+    auto decoded = std::string{};
+
+    for (size_t i = 0; i < uri.size(); ++i) {
+        if (uri[i] == '%' && i + 2 < uri.size() && hex(uri[i + 1]) >= 0 && hex(uri[i + 2]) >= 0) {
+            decoded.push_back(static_cast<char>(hex(uri[i + 1]) * 16 + hex(uri[i + 2])));
+            i += 2;
+        } else {
+            decoded.push_back(uri[i]);
+        }
+    }
+
+    return decoded;
+}
+
+auto ReadFloat3(const std::byte* data) noexcept -> glm::vec3
+{
+    auto value = glm::vec3{};
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+uint32_t ReadIndex(const std::byte* data, int component_type) noexcept
+{
+    switch (component_type) {
+    case kUnsignedByte:
+        return std::to_integer<uint32_t>(*data);
+    case kUnsignedShort: {
+        auto value = uint16_t{};
+        std::memcpy(&value, data, sizeof(value));
+        return value;
+    }
+    default: {
+        auto value = uint32_t{};
+        std::memcpy(&value, data, sizeof(value));
+        return value;
+    }
+    }
+}
+
+auto ParseAccessor(const json& object, const std::vector<BufferView>& views) -> Accessor
+{
+    auto accessor = Accessor{};
+
+    accessor.count          = object.at("count").get<size_t>();
+    accessor.component_type = object.at("componentType").get<int>();
+    accessor.components     = ComponentCount(object.at("type").get<std::string>());
+    accessor.offset         = object.value("byteOffset", size_t{ 0 });
+    accessor.is_sparse      = object.contains("sparse");
+
+    auto element_size = ComponentSize(accessor.component_type) * accessor.components;
+    utils::throw_runtime_error_if(element_size == 0, "Failed to parse glTF file: unknown accessor type");
+
+    if (object.contains("bufferView")) {
+        auto view_index = object["bufferView"].get<size_t>();
+        utils::throw_runtime_error_if(view_index >= views.size(), "Failed to parse glTF file: invalid buffer view");
+
+        const auto& view = views[view_index];
+
+        accessor.view   = view_index;
+        accessor.stride = view.stride != 0 ? view.stride : element_size;
+
+        // Divided rather than multiplied, so a huge count cannot overflow past the check
+        auto size       = view.data.size();
+        auto is_in_view = accessor.count == 0 || (accessor.offset <= size && element_size <= size - accessor.offset &&
+                                                  accessor.count - 1 <= (size - accessor.offset - element_size) /
+                                                                            accessor.stride);
+        utils::throw_runtime_error_if(!is_in_view, "Failed to parse glTF file: accessor out of buffer view");
+    }
+
+    if (object.contains("min") && object.contains("max") && accessor.components == 3) {
+        auto min = object["min"].get<std::vector<float>>();
+        auto max = object["max"].get<std::vector<float>>();
+        if (min.size() == 3 && max.size() == 3) {
+            accessor.bounds = AABB{ { min[0], min[1], min[2] }, { max[0], max[1], max[2] } };
+        }
+    }
+
+    return accessor;
+}
+
+// Rotation of a glTF node as a matrix. The quaternion is normalized, some exporters write it with limited precision.
+auto RotationMatrix(glm::vec4 q) noexcept -> glm::mat3
+{
+    auto length = std::sqrt(glm::dot(q, q));
+    q           = length > 0.0f ? q / length : glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+
+    auto [x, y, z, w] = std::array{ q.x, q.y, q.z, q.w };
+
+    return glm::mat3(
+        1.0f - 2.0f * (y * y + z * z),
+        2.0f * (x * y + z * w),
+        2.0f * (x * z - y * w),
+        2.0f * (x * y - z * w),
+        1.0f - 2.0f * (x * x + z * z),
+        2.0f * (y * z + x * w),
+        2.0f * (x * z + y * w),
+        2.0f * (y * z - x * w),
+        1.0f - 2.0f * (x * x + y * y));
+}
+
+// Singular value decomposition of 'm' into u * diag(s) * transpose(v), where u and v are proper rotations and a
+// mirroring 'm' gets a negative first singular value. v holds the eigenvectors of transpose(m) * m, which are found by
+// cyclic Jacobi rotations. Returns false if 'm' has more than one vanishing singular value.
+bool DecomposeSingular(const glm::mat3& m, glm::mat3* u, glm::vec3* s, glm::mat3* v) noexcept
+{
+    auto a = glm::transpose(m) * m;
+
+    *v = glm::mat3(1.0f);
+
+    for (int sweep = 0; sweep != 32; ++sweep) {
+        auto off_diagonal = a[1][0] * a[1][0] + a[2][0] * a[2][0] + a[2][1] * a[2][1];
+        auto diagonal     = a[0][0] * a[0][0] + a[1][1] * a[1][1] + a[2][2] * a[2][2];
+        if (off_diagonal <= 1e-14f * diagonal) {
+            break;
+        }
+
+        for (auto [p, q] : { std::pair{ 0, 1 }, std::pair{ 0, 2 }, std::pair{ 1, 2 } }) {
+            if (a[q][p] == 0.0f) {
+                continue;
+            }
+
+            auto theta = (a[q][q] - a[p][p]) / (2.0f * a[q][p]);
+            auto t     = std::copysign(1.0f, theta) / (std::abs(theta) + std::sqrt(theta * theta + 1.0f));
+            auto c     = 1.0f / std::sqrt(t * t + 1.0f);
+
+            auto rotation = glm::mat3(1.0f);
+
+            rotation[p][p] = c;
+            rotation[q][q] = c;
+            rotation[q][p] = t * c;
+            rotation[p][q] = -t * c;
+
+            a  = glm::transpose(rotation) * a * rotation;
+            *v = *v * rotation;
+        }
+    }
+
+    if (glm::determinant(*v) < 0.0f) {
+        (*v)[2] = -(*v)[2];
+    }
+
+    auto largest   = std::sqrt(std::max({ a[0][0], a[1][1], a[2][2], 0.0f }));
+    auto vanishing = -1;
+
+    for (int i = 0; i != 3; ++i) {
+        (*s)[i] = std::sqrt(std::max(a[i][i], 0.0f));
+        if ((*s)[i] > 1e-6f * largest) {
+            (*u)[i] = m * (*v)[i] / (*s)[i];
+        } else if (vanishing < 0) {
+            vanishing = i;
+        } else {
+            return false;
+        }
+    }
+
+    // The direction 'm' collapses is completed from the other two
+    if (vanishing >= 0) {
+        (*s)[vanishing] = 0.0f;
+        (*u)[vanishing] = glm::cross((*u)[(vanishing + 1) % 3], (*u)[(vanishing + 2) % 3]);
+    }
+
+    if (glm::determinant(*u) < 0.0f) {
+        (*u)[0] = -(*u)[0];
+        (*s)[0] = -(*s)[0];
+    }
+
+    return true;
+}
+
+// Splits the local transform of 'object' into the one of GltfNode. Node matrices whose columns are orthogonal are split
+// by the lengths and directions of their columns, the others through their singular value decomposition, which leaves
+// no shear behind. A mirroring matrix gets a negative scale along its first axis.
+void SetTransform(const json& object, GltfNode* node)
+{
+    auto translation    = glm::vec3(0.0f);
+    auto rotation       = glm::mat3(1.0f);
+    auto scale          = glm::vec3(1.0f);
+    auto scale_rotation = glm::mat3(1.0f);
+
+    if (object.contains("matrix")) {
+        auto m = object["matrix"].get<std::vector<float>>();
+        utils::throw_runtime_error_if(m.size() != 16, "Failed to parse glTF file: invalid node matrix");
+
+        auto columns = glm::mat3(m[0], m[1], m[2], m[4], m[5], m[6], m[8], m[9], m[10]);
+
+        translation = { m[12], m[13], m[14] };
+
+        for (int i = 0; i != 3; ++i) {
+            scale[i] = std::sqrt(glm::dot(columns[i], columns[i]));
+        }
+        if (glm::determinant(columns) < 0.0f) {
+            scale.x = -scale.x;
+        }
+
+        // A degenerate matrix has no rotation to recover, its instances collapse through the zero scale anyway
+        if (scale.x != 0.0f && scale.y != 0.0f && scale.z != 0.0f) {
+            for (int i = 0; i != 3; ++i) {
+                rotation[i] = columns[i] / scale[i];
+            }
+
+            auto is_orthogonal = std::abs(glm::dot(rotation[0], rotation[1])) <= 1e-4f &&
+                                 std::abs(glm::dot(rotation[0], rotation[2])) <= 1e-4f &&
+                                 std::abs(glm::dot(rotation[1], rotation[2])) <= 1e-4f;
+
+            auto u = glm::mat3(1.0f);
+            auto s = glm::vec3(1.0f);
+            auto v = glm::mat3(1.0f);
+
+            if (!is_orthogonal && DecomposeSingular(columns, &u, &s, &v)) {
+                rotation       = u;
+                scale          = s;
+                scale_rotation = glm::transpose(v);
+            } else if (!is_orthogonal) {
+                // Flattens everything onto a line, which is as good as collapsing it
+                rotation = glm::mat3(1.0f);
+                scale    = glm::vec3(0.0f);
+            }
+        }
+    } else {
+        if (object.contains("translation")) {
+            auto t = object["translation"].get<std::vector<float>>();
+            utils::throw_runtime_error_if(t.size() != 3, "Failed to parse glTF file: invalid node translation");
+            translation = { t[0], t[1], t[2] };
+        }
+        if (object.contains("rotation")) {
+            auto r = object["rotation"].get<std::vector<float>>();
+            utils::throw_runtime_error_if(r.size() != 4, "Failed to parse glTF file: invalid node rotation");
+            rotation = RotationMatrix({ r[0], r[1], r[2], r[3] });
+        }
+        if (object.contains("scale")) {
+            auto s = object["scale"].get<std::vector<float>>();
+            utils::throw_runtime_error_if(s.size() != 3, "Failed to parse glTF file: invalid node scale");
+            scale = { s[0], s[1], s[2] };
+        }
+    }
+
+    auto transform       = MakeRigidTransform(rotation, translation);
+    auto scale_transform = MakeRigidTransform(scale_rotation, glm::vec3(0.0f));
+
+    node->translation = { translation.x, translation.y, translation.z };
+    node->axis        = { transform.axis.x, transform.axis.y, transform.axis.z };
+    node->angle       = Radians(transform.angle);
+    node->scale       = { scale.x, scale.y, scale.z };
+    node->scale_axis  = { scale_transform.axis.x, scale_transform.axis.y, scale_transform.axis.z };
+    node->scale_angle = Radians(scale_transform.angle);
+}
+
+auto ComputeBoundingBox(const std::vector<glm::vec3>& positions) noexcept -> AABB
+{
+    auto aabb = AABB{ { FLT_MAX, FLT_MAX, FLT_MAX }, { -FLT_MAX, -FLT_MAX, -FLT_MAX } };
+
+    for (const auto& position : positions) {
+        aabb.Expand({ position.x, position.y, position.z });
+    }
+
+    if (positions.empty()) {
+        aabb = AABB{};
+    }
+
+    return aabb;
+}
+
+template <typename Vertex>
+auto ToBytes(const std::vector<Vertex>& vertices) -> std::vector<std::byte>
+{
+    auto bytes = std::vector<std::byte>(vertices.size() * sizeof(Vertex));
+    std::memcpy(bytes.data(), vertices.data(), bytes.size());
+    return bytes;
+}
+
+// Converts one primitive, or leaves it invalid if it is not supported
+auto ReadPrimitive(
+    const json&                    object,
+    const std::vector<Accessor>&   accessors,
+    const std::vector<BufferView>& views,
+    size_t                         material_count,
+    VertexLayout                   vertex_layout) -> PrimitiveData
+{
+    auto data = PrimitiveData{};
+
+    if (object.value("mode", kTriangles) != kTriangles) {
+        return data;
+    }
+
+    const auto& attributes = object.at("attributes");
+
+    auto find_accessor = [&accessors](const json& index) -> const Accessor* {
+        auto accessor_index = index.get<size_t>();
+        utils::throw_runtime_error_if(
+            accessor_index >= accessors.size(),
+            "Failed to parse glTF file: invalid accessor");
+        const auto& accessor = accessors[accessor_index];
+        return accessor.view && !accessor.is_sparse ? &accessor : nullptr;
+    };
+
+    if (!attributes.contains("POSITION")) {
+        return data;
+    }
+
+    auto position = find_accessor(attributes["POSITION"]);
+    if (!position || position->component_type != kFloat || position->components != 3) {
+        return data;
+    }
+
+    auto normal = attributes.contains("NORMAL") ? find_accessor(attributes["NORMAL"]) : nullptr;
+    if (normal && (normal->component_type != kFloat || normal->components != 3 || normal->count != position->count)) {
+        normal = nullptr;
+    }
+
+    auto vertex_count = position->count;
+
+    auto& primitive = data.primitive;
+
+    if (auto material_id = object.value("material", -1); material_id >= 0) {
+        primitive.material_id = utils::narrow_cast<size_t>(material_id) < material_count ? material_id : -1;
+    }
+
+    // Indices as they are if their layout is one of the index buffer formats, widened otherwise
+
+    auto indices = std::vector<uint32_t>{};
+
+    if (object.contains("indices")) {
+        auto accessor = find_accessor(object["indices"]);
+        if (!accessor || accessor->components != 1) {
+            return data;
+        }
+        auto type = accessor->component_type;
+        auto size = ComponentSize(type);
+        if (type != kUnsignedByte && type != kUnsignedShort && type != kUnsignedInt) {
+            return data;
+        }
+
+        auto bytes = views[*accessor->view].data.data() + accessor->offset;
+
+        indices.resize(accessor->count);
+        for (size_t i = 0; i != accessor->count; ++i) {
+            indices[i] = ReadIndex(bytes + i * accessor->stride, type);
+        }
+
+        auto is_in_range = std::ranges::all_of(indices, [vertex_count](auto index) { return index < vertex_count; });
+        utils::throw_runtime_error_if(!is_in_range, "Failed to parse glTF file: index out of range");
+
+        primitive.index_count = accessor->count - accessor->count % 3;
+
+        if (type != kUnsignedByte && accessor->stride == size && accessor->offset % size == 0) {
+            data.index_view        = accessor->view;
+            primitive.first_index  = accessor->offset / size;
+            primitive.index_format = type == kUnsignedShort ? IndexFormat::Uint16 : IndexFormat::Uint32;
+        }
+    } else {
+        indices.resize(vertex_count);
+        for (size_t i = 0; i != vertex_count; ++i) {
+            indices[i] = utils::narrow_cast<uint32_t>(i);
+        }
+        primitive.index_count = vertex_count - vertex_count % 3;
+    }
+
+    if (primitive.index_count == 0) {
+        return data;
+    }
+
+    auto positions = std::vector<glm::vec3>(vertex_count);
+    {
+        auto bytes = views[*position->view].data.data() + position->offset;
+        for (size_t i = 0; i != vertex_count; ++i) {
+            positions[i] = ReadFloat3(bytes + i * position->stride);
+        }
+    }
+
+    primitive.aabb = position->bounds ? *position->bounds : ComputeBoundingBox(positions);
+
+    // Vertices as they are if the buffer view already holds the vertex layout of the scene
+
+    auto is_flat_view = position->stride == sizeof(VertexP) && position->offset % sizeof(VertexP) == 0;
+
+    auto is_interleaved_view = normal && normal->view == position->view && position->stride == sizeof(VertexPN) &&
+                               position->offset % sizeof(VertexPN) == 0 &&
+                               normal->offset == position->offset + offsetof(VertexPN, normal);
+
+    if (vertex_layout == VertexLayout::Flat && is_flat_view) {
+        data.vertex_view        = position->view;
+        primitive.vertex_offset = position->offset / sizeof(VertexP);
+    } else if (vertex_layout == VertexLayout::Float && is_interleaved_view) {
+        data.vertex_view        = position->view;
+        primitive.vertex_offset = position->offset / sizeof(VertexPN);
+    } else if (vertex_layout == VertexLayout::Flat) {
+        auto vertices = std::vector<VertexP>{};
+        vertices.reserve(vertex_count);
+        for (const auto& p : positions) {
+            vertices.push_back({ p });
+        }
+        data.vertices = ToBytes(vertices);
+    } else {
+        auto geometry = Geometry{};
+
+        // A zero normal is what GenerateNormals fills in
+        auto normal_data = normal ? views[*normal->view].data.data() + normal->offset : nullptr;
+
+        geometry.vertices.reserve(vertex_count);
+        for (size_t i = 0; i != vertex_count; ++i) {
+            auto n = normal_data ? ReadFloat3(normal_data + i * normal->stride) : glm::vec3(0.0f);
+            geometry.vertices.emplace_back(positions[i], n);
+        }
+
+        if (!normal) {
+            // Vertices may be split at creases, so the indices are converted along with them
+            geometry.indices = std::move(indices);
+            geometry.indices.resize(primitive.index_count);
+
+            GenerateNormals(&geometry, {}, nullptr);
+
+            indices         = std::move(geometry.indices);
+            data.index_view = std::nullopt;
+        }
+
+        if (vertex_layout == VertexLayout::Quantized) {
+            auto vertices = std::vector<VertexPN16>{};
+            vertices.reserve(geometry.vertices.size());
+            for (const auto& vertex : geometry.vertices) {
+                auto position = QuantizePosition(vertex.position, primitive.aabb);
+                vertices.push_back({ position, EncodeOctahedral(vertex.normal) });
+            }
+            data.vertices = ToBytes(vertices);
+        } else {
+            data.vertices = ToBytes(geometry.vertices);
+        }
+    }
+
+    if (!data.index_view) {
+        indices.resize(primitive.index_count);
+
+        auto max_index = std::ranges::max(indices);
+
+        if (max_index <= UINT16_MAX) {
+            auto narrow = std::vector<uint16_t>(indices.begin(), indices.end());
+
+            data.indices.resize(narrow.size() * sizeof(uint16_t));
+            std::memcpy(data.indices.data(), narrow.data(), data.indices.size());
+            primitive.index_format = IndexFormat::Uint16;
+        } else {
+            data.indices           = ToBytes(indices);
+            primitive.index_format = IndexFormat::Uint32;
+        }
+        primitive.first_index = 0;
+    }
+
+    data.is_valid = true;
+
+    return data;
+}
+
+} // namespace
+
+auto ReadGltf(
+    const std::filesystem::path& filepath,
+    VertexLayout                 vertex_layout,
+    ThreadPool*                  thread_pool,
+    LoadProgress*                progress) -> GltfModel
+{
+    auto model = GltfModel{};
+
+    model.m_vertex_layout = vertex_layout;
+
+    StartProgress(progress, "Reading");
+
+    auto file = MappedFile(filepath, MappedFile::Access::Random);
+
+    // A GLB file is a header followed by a JSON chunk and an optional binary chunk, a .gltf file is the JSON alone
+
+    auto text   = file.View();
+    auto binary = std::span<const std::byte>{};
+
+    if (file.Size() >= 12 && ReadUint32(file.Data()) == kGlbMagic) {
+        auto version = ReadUint32(file.Data() + 4);
+        utils::throw_runtime_error_if(version != 2, "Failed to parse glTF file: unsupported version");
+
+        auto length = std::min(size_t{ ReadUint32(file.Data() + 8) }, file.Size());
+        auto offset = size_t{ 12 };
+
+        text = {};
+
+        while (offset + 8 <= length) {
+            auto chunk_length = size_t{ ReadUint32(file.Data() + offset) };
+            auto chunk_type   = ReadUint32(file.Data() + offset + 4);
+
+            offset += 8;
+            utils::throw_runtime_error_if(chunk_length > length - offset, "Failed to parse glTF file: truncated chunk");
+
+            if (chunk_type == kGlbJsonChunk && text.empty()) {
+                text = file.View().substr(offset, chunk_length);
+            } else if (chunk_type == kGlbBinaryChunk && binary.empty()) {
+                binary = { reinterpret_cast<const std::byte*>(file.Data() + offset), chunk_length };
+            }
+
+            offset += (chunk_length + 3) & ~size_t{ 3 };
+        }
+
+        utils::throw_runtime_error_if(text.empty(), "Failed to parse glTF file: missing JSON chunk");
+    }
+
+    auto primitive_count = size_t{ 0 };
+    auto skipped_count   = size_t{ 0 };
+    auto view_blob_count = size_t{ 0 };
+    auto primitives      = std::vector<PrimitiveData>{};
+
+    try {
+        auto document = json::parse(text);
+
+        // Top level arrays are optional, the elements are referred to by pointer so they must not be copies
+        auto empty = json::array();
+        auto array = [&document, &empty](const char* key) -> const json& {
+            return document.contains(key) ? document[key] : empty;
+        };
+
+        auto version = document.at("asset").at("version").get<std::string>();
+        utils::throw_runtime_error_if(!version.starts_with("2."), "Failed to parse glTF file: unsupported version");
+
+        // Buffers, each either the binary chunk, an external file or a data URI
+
+        auto buffers = std::vector<std::span<const std::byte>>{};
+
+        for (const auto& object : array("buffers")) {
+            auto length = object.at("byteLength").get<size_t>();
+            auto data   = std::span<const std::byte>{};
+
+            if (!object.contains("uri")) {
+                utils::throw_runtime_error_if(!buffers.empty(), "Failed to parse glTF file: buffer without data");
+                data = binary;
+            } else if (auto uri = object["uri"].get<std::string>(); uri.starts_with("data:")) {
+                auto comma     = uri.find(',');
+                auto is_base64 = comma != std::string::npos && uri.substr(0, comma).ends_with(";base64");
+                utils::throw_runtime_error_if(!is_base64, "Failed to parse glTF file: unsupported data URI");
+
+                model.m_buffers.push_back(DecodeBase64(std::string_view(uri).substr(comma + 1)));
+                data = model.m_buffers.back();
+            } else {
+                auto buffer_path = filepath.parent_path() / std::filesystem::path(DecodeUri(uri));
+
+                model.m_files.emplace_back(buffer_path, MappedFile::Access::Random);
+
+                const auto& buffer_file = model.m_files.back();
+
+                data = { reinterpret_cast<const std::byte*>(buffer_file.Data()), buffer_file.Size() };
+            }
+
+            utils::throw_runtime_error_if(data.size() < length, "Failed to parse glTF file: buffer too short");
+
+            buffers.push_back(data.first(length));
+        }
+
+        auto views = std::vector<BufferView>{};
+
+        for (const auto& object : array("bufferViews")) {
+            auto buffer = object.at("buffer").get<size_t>();
+            auto offset = object.value("byteOffset", size_t{ 0 });
+            auto length = object.at("byteLength").get<size_t>();
+
+            utils::throw_runtime_error_if(buffer >= buffers.size(), "Failed to parse glTF file: invalid buffer");
+            utils::throw_runtime_error_if(
+                offset > buffers[buffer].size() || length > buffers[buffer].size() - offset,
+                "Failed to parse glTF file: buffer view out of buffer");
+
+            views.push_back({ buffers[buffer].subspan(offset, length), object.value("byteStride", size_t{ 0 }) });
+        }
+
+        auto accessors = std::vector<Accessor>{};
+
+        for (const auto& object : array("accessors")) {
+            accessors.push_back(ParseAccessor(object, views));
+        }
+
+        model.m_material_count = array("materials").size();
+
+        // Primitives, converted in parallel
+
+        auto primitive_objects = std::vector<const json*>{};
+
+        for (const auto& object : array("meshes")) {
+            auto& mesh = model.m_meshes.emplace_back();
+
+            mesh.name = object.value("name", std::string{});
+
+            for (const auto& primitive : object.at("primitives")) {
+                primitive_objects.push_back(&primitive);
+            }
+            mesh.primitives.resize(object.at("primitives").size());
+        }
+
+        primitive_count = primitive_objects.size();
+        primitives.resize(primitive_count);
+
+        StartProgress(progress, "Converting", primitive_count);
+
+        auto convert = [&](size_t i) {
+            const auto& object = *primitive_objects[i];
+            primitives[i]      = ReadPrimitive(object, accessors, views, model.m_material_count, vertex_layout);
+            AdvanceProgress(progress);
+        };
+
+        ParallelFor(thread_pool, primitive_count, convert);
+
+        // Blobs, one per buffer view used as it is and one per converted range
+
+        auto view_blobs = std::map<size_t, size_t>{};
+
+        auto add_view = [&](size_t view) {
+            auto [it, is_new] = view_blobs.try_emplace(view, model.m_blobs.size());
+            if (is_new) {
+                model.m_blobs.push_back(views[view].data);
+            }
+            return it->second;
+        };
+
+        auto add_owned = [&model](std::vector<std::byte> bytes) {
+            model.m_buffers.push_back(std::move(bytes));
+            model.m_blobs.push_back(model.m_buffers.back());
+            return model.m_blobs.size() - 1;
+        };
+
+        auto next = primitives.begin();
+
+        for (auto& mesh : model.m_meshes) {
+            auto supported = std::vector<GltfPrimitive>{};
+
+            for (size_t i = 0; i != mesh.primitives.size(); ++i) {
+                auto& data = *next++;
+                if (!data.is_valid) {
+                    ++skipped_count;
+                    continue;
+                }
+                auto& primitive = data.primitive;
+
+                if (data.vertex_view) {
+                    primitive.vertex_blob = add_view(*data.vertex_view);
+                } else {
+                    primitive.vertex_blob = add_owned(std::move(data.vertices));
+                }
+                if (data.index_view) {
+                    primitive.index_blob = add_view(*data.index_view);
+                } else {
+                    primitive.index_blob = add_owned(std::move(data.indices));
+                }
+
+                supported.push_back(primitive);
+            }
+
+            mesh.primitives = std::move(supported);
+        }
+
+        view_blob_count = view_blobs.size();
+
+        // Node hierarchy
+
+        const auto& nodes = array("nodes");
+
+        auto parent_count = std::vector<size_t>(nodes.size());
+
+        for (const auto& object : nodes) {
+            auto& node = model.m_nodes.emplace_back();
+
+            node.name = object.value("name", std::string{});
+            node.mesh = object.value("mesh", -1);
+
+            utils::throw_runtime_error_if(
+                node.mesh >= 0 && utils::narrow_cast<size_t>(node.mesh) >= model.m_meshes.size(),
+                "Failed to parse glTF file: invalid mesh");
+
+            for (const auto& child : object.value("children", json::array())) {
+                auto index = child.get<size_t>();
+                utils::throw_runtime_error_if(index >= nodes.size(), "Failed to parse glTF file: invalid node");
+                utils::throw_runtime_error_if(
+                    ++parent_count[index] > 1,
+                    "Failed to parse glTF file: node with several parents");
+                node.children.push_back(index);
+            }
+
+            SetTransform(object, &node);
+        }
+
+        const auto& scenes = array("scenes");
+
+        if (!scenes.empty()) {
+            auto scene = document.value("scene", size_t{ 0 });
+            utils::throw_runtime_error_if(scene >= scenes.size(), "Failed to parse glTF file: invalid scene");
+
+            for (const auto& root : scenes[scene].value("nodes", json::array())) {
+                auto index = root.get<size_t>();
+                utils::throw_runtime_error_if(index >= nodes.size(), "Failed to parse glTF file: invalid node");
+                model.m_roots.push_back(index);
+            }
+        } else {
+            for (size_t i = 0; i != nodes.size(); ++i) {
+                if (parent_count[i] == 0) {
+                    model.m_roots.push_back(i);
+                }
+            }
+        }
+
+        // Every node has at most one parent, so a node reached twice from the roots is on a cycle or is a root twice
+        auto is_visited = std::vector<bool>(nodes.size());
+        auto pending    = model.m_roots;
+
+        while (!pending.empty()) {
+            auto index = pending.back();
+            pending.pop_back();
+
+            utils::throw_runtime_error_if(is_visited[index], "Failed to parse glTF file: cyclic node hierarchy");
+            is_visited[index] = true;
+
+            pending.insert(pending.end(), model.m_nodes[index].children.begin(), model.m_nodes[index].children.end());
+        }
+    } catch (const json::exception&) {
+        utils::throw_runtime_error("Failed to parse glTF file: invalid JSON");
+    }
+
+    if (skipped_count > 0) {
+        spdlog::warn("File {}: skipped {} unsupported primitives", filepath.string(), skipped_count);
+    }
+
+    spdlog::info(
+        "File {}: {} primitives, {} of {} blobs used without conversion",
+        filepath.string(),
+        primitive_count - skipped_count,
+        view_blob_count,
+        model.m_blobs.size());
+
+    model.m_files.insert(model.m_files.begin(), std::move(file));
+
+    return model;
+}
+
+auto BuildGltfScene(ScenePtr scene, const GltfModel& model, const std::filesystem::path& filepath) -> GltfBuffers
+{
+    auto buffers = GltfBuffers{};
+
+    auto shader = scene->CreateShader();
+
+    auto material_map = std::map<int, MaterialPtr>{};
+
+    material_map[-1] = scene->CreateMaterial(shader);
+    for (size_t material_index = 0; material_index != model.GetMaterialCount(); ++material_index) {
+        material_map[utils::narrow_cast<int>(material_index)] = scene->CreateMaterial(shader);
+    }
+
+    auto file_node = scene->GetRootNode()->AttachNode(scene->CreateGroupNode());
+
+    file_node->SetProperty("name", filepath.filename().string());
+    file_node->SetProperty("Path", filepath.string());
+
+    // Buffers and meshes are created on first use, a blob may be the source of both a vertex and an index buffer
+
+    const auto& blobs = model.GetBlobs();
+
+    auto vertex_buffers = std::vector<VertexBufferPtr>(blobs.size());
+    auto index_buffers  = std::vector<IndexBufferPtr>(blobs.size());
+    auto meshes         = std::vector<std::vector<MeshPtr>>(model.GetMeshes().size());
+
+    auto get_mesh = [&](size_t mesh_index, size_t primitive_index) {
+        auto& mesh_ptrs = meshes[mesh_index];
+        if (mesh_ptrs.empty()) {
+            for (const auto& primitive : model.GetMeshes()[mesh_index].primitives) {
+                auto& vertex_buffer = vertex_buffers[primitive.vertex_blob];
+                auto& index_buffer  = index_buffers[primitive.index_blob];
+
+                if (!vertex_buffer) {
+                    auto blob     = blobs[primitive.vertex_blob];
+                    vertex_buffer = scene->CreateVertexBuffer(blob.data(), blob.size(), std::align_val_t(32));
+                    buffers.vertex_buffers.push_back(vertex_buffer);
+                }
+                if (!index_buffer) {
+                    auto blob    = blobs[primitive.index_blob];
+                    index_buffer = scene->CreateIndexBuffer(blob.data(), blob.size(), std::align_val_t(32));
+                    buffers.index_buffers.push_back(index_buffer);
+                }
+
+                mesh_ptrs.push_back(scene->CreateMesh(
+                    primitive.aabb,
+                    vertex_buffer,
+                    index_buffer,
+                    primitive.first_index,
+                    primitive.index_count,
+                    primitive.index_format,
+                    primitive.vertex_offset,
+                    model.GetVertexLayout()));
+            }
+        }
+        return mesh_ptrs[primitive_index];
+    };
+
+    const auto& nodes = model.GetNodes();
+
+    auto node_num = 1;
+
+    auto add_node = [&](const auto& self, size_t node_index, NodePtr parent) -> void {
+        const auto& node = nodes[node_index];
+
+        auto mesh_index      = utils::narrow_cast<size_t>(std::max(node.mesh, 0));
+        auto primitive_count = node.mesh >= 0 ? model.GetMeshes()[mesh_index].primitives.size() : 0;
+
+        if (primitive_count == 0 && node.children.empty()) {
+            return;
+        }
+
+        if (node.translation.x != 0.0f || node.translation.y != 0.0f || node.translation.z != 0.0f) {
+            parent = parent->AttachNode(scene->CreateTranslateNode(node.translation));
+        }
+        if (node.angle.value != 0.0f) {
+            parent = parent->AttachNode(scene->CreateRotateNode(node.axis, node.angle));
+        }
+        if (node.scale.x != 1.0f || node.scale.y != 1.0f || node.scale.z != 1.0f) {
+            parent = parent->AttachNode(scene->CreateScaleNode(node.scale));
+        }
+        if (node.scale_angle.value != 0.0f) {
+            parent = parent->AttachNode(scene->CreateRotateNode(node.scale_axis, node.scale_angle));
+        }
+
+        auto name = node.name;
+        if (name.empty() && node.mesh >= 0) {
+            name = model.GetMeshes()[mesh_index].name;
+        }
+        if (name.empty()) {
+            name = std::string("Node ") + std::to_string(node_num++);
+        }
+
+        if (!node.children.empty() || primitive_count > 1) {
+            parent = parent->AttachNode(scene->CreateGroupNode());
+            parent->SetProperty("name", name);
+        }
+
+        for (size_t i = 0; i != primitive_count; ++i) {
+            auto material = material_map[model.GetMeshes()[mesh_index].primitives[i].material_id];
+            auto instance = parent->AttachNode(scene->CreateInstanceNode(get_mesh(mesh_index, i), material));
+
+            if (primitive_count == 1) {
+                instance->SetProperty("name", name);
+            } else {
+                instance->SetProperty("name", name + " (" + std::to_string(i + 1) + ")");
+            }
+        }
+
+        for (auto child : node.children) {
+            self(self, child, parent);
+        }
+    };
+
+    for (auto root : model.GetRootNodes()) {
+        add_node(add_node, root, file_node);
+    }
+
+    return buffers;
+}
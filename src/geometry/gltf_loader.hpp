@@ -0,0 +1,103 @@
+#pragma once
+
+#include "mapped_file.hpp"
+#include "scene.hpp"
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <vector>
+
+class LoadProgress;
+class ThreadPool;
+
+// Triangles of a glTF mesh primitive, as ranges of the blobs of their GltfModel
+struct GltfPrimitive final {
+    int         material_id = -1;
+    AABB        aabb{};
+    size_t      vertex_blob{};
+    size_t      vertex_offset{}; // In vertices of the blob
+    size_t      index_blob{};
+    size_t      first_index{}; // In indices of 'index_format' of the blob
+    size_t      index_count{};
+    IndexFormat index_format = IndexFormat::Uint32;
+};
+
+struct GltfMesh final {
+    std::string                name;
+    std::vector<GltfPrimitive> primitives;
+};
+
+// Node of the glTF hierarchy with its local transform split into a translation, a rotation, a scale per axis and a
+// scale rotation, applied in that order from the outside in. The scale rotation turns the axes the scale is applied
+// along, it is the identity unless the node has a matrix with shear.
+struct GltfNode final {
+    std::string         name;
+    Float3              translation{};
+    Float3              axis{ 0.0f, 0.0f, 1.0f };
+    Radians             angle{};
+    Float3              scale{ 1.0f, 1.0f, 1.0f };
+    Float3              scale_axis{ 0.0f, 0.0f, 1.0f };
+    Radians             scale_angle{};
+    int                 mesh = -1;
+    std::vector<size_t> children;
+};
+
+// Meshes and node hierarchy of a glTF 2.0 file, .gltf or .glb, read without touching any scene so it may run on any
+// thread. The vertex and index data is kept as blobs, each the source of one vertex or index buffer. Index accessors of
+// 16 and 32 bit and vertex accessors that are already laid out as the vertices of the scene are blobs over the buffer
+// views of the mapped file, which the buffers are created from without converting every element. The remaining ones
+// are converted into blobs of their own. Reading is zero-copy, building the scene is not: BuildGltfScene copies every
+// blob once into the CPU side buffer of the scene, which the upload to the GPU then reads like any other buffer.
+class GltfModel final {
+  public:
+    GltfModel() noexcept = default;
+
+    GltfModel(const GltfModel&) = delete;
+    GltfModel& operator=(const GltfModel&) = delete;
+
+    GltfModel(GltfModel&&) noexcept = default;
+    GltfModel& operator=(GltfModel&&) noexcept = default;
+
+    const auto& GetBlobs() const noexcept { return m_blobs; }
+    const auto& GetMeshes() const noexcept { return m_meshes; }
+    const auto& GetNodes() const noexcept { return m_nodes; }
+    const auto& GetRootNodes() const noexcept { return m_roots; }
+    auto        GetMaterialCount() const noexcept { return m_material_count; }
+    auto        GetVertexLayout() const noexcept { return m_vertex_layout; }
+
+  private:
+    friend auto ReadGltf(const std::filesystem::path&, VertexLayout, ThreadPool*, LoadProgress*) -> GltfModel;
+
+    std::vector<MappedFile>                 m_files;
+    std::vector<std::vector<std::byte>>     m_buffers; // Decoded from data URIs, or converted blobs
+    std::vector<std::span<const std::byte>> m_blobs;
+    std::vector<GltfMesh>                   m_meshes;
+    std::vector<GltfNode>                   m_nodes;
+    std::vector<size_t>                     m_roots;
+    size_t                                  m_material_count{};
+    VertexLayout                            m_vertex_layout = VertexLayout::Float;
+};
+
+// Reads the default scene of a glTF 2.0 file. Only triangle lists with float positions are supported, other primitives
+// are skipped. Primitives without normals get smooth normals from GenerateNormals, like OBJ faces without them. Indices
+// are checked against the vertex count. Node transforms are kept exactly, including non-uniform scales and the shear
+// of node matrices, see GltfNode. Throws std::runtime_error if the file is malformed.
+auto ReadGltf(
+    const std::filesystem::path& filepath,
+    VertexLayout                 vertex_layout,
+    ThreadPool*                  thread_pool,
+    LoadProgress*                progress = nullptr) -> GltfModel;
+
+// Vertex and index buffers created by BuildGltfScene, to be uploaded by the caller
+struct GltfBuffers final {
+    std::vector<VertexBufferPtr> vertex_buffers;
+    std::vector<IndexBufferPtr>  index_buffers;
+};
+
+// Adds the node hierarchy of 'model' to 'scene' under a group node named after the file. Every glTF node becomes a
+// chain of translate, rotate, scale and scale rotation nodes, each left out if it is the identity, ending in a group
+// node if it has children or several primitives and in the instance node of its primitive otherwise. Meshes that
+// several nodes refer to are shared by their instances. Every blob is copied once, as it is, into its scene buffer.
+auto BuildGltfScene(ScenePtr scene, const GltfModel& model, const std::filesystem::path& filepath) -> GltfBuffers;
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <stdexcept>
+
+// Thrown out of a load that has been cancelled through its LoadProgress
+class LoadCancelled final : public std::runtime_error {
+  public:
+    LoadCancelled() : std::runtime_error("Load cancelled") {}
+};
+
+// Shared between a load running on a worker thread and the thread that observes it. The loader reports the current
+// stage and how many of its work items are done, and polls for cancellation between work items. Stage and counters
+// are updated independently, so an observer may briefly see the fraction of the previous stage.
+class LoadProgress final {
+  public:
+    void Start(const char* stage, size_t total = 0) noexcept
+    {
+        m_done  = 0;
+        m_total = total;
+        m_stage = stage;
+    }
+
+    void Advance(size_t count = 1) noexcept { m_done += count; }
+
+    void Cancel() noexcept { m_cancelled = true; }
+
+    bool IsCancelled() const noexcept { return m_cancelled; }
+
+    void ThrowIfCancelled() const
+    {
+        if (m_cancelled) {
+            throw LoadCancelled();
+        }
+    }
+
+    auto GetStage() const noexcept -> const char* { return m_stage; }
+
+    // Fraction of the current stage that is done, or zero if the stage has no known amount of work
+    auto GetFraction() const noexcept -> float
+    {
+        auto total = m_total.load();
+        return total ? std::min(1.0f, static_cast<float>(m_done.load()) / static_cast<float>(total)) : 0.0f;
+    }
+
+  private:
+    std::atomic<const char*> m_stage     = "Waiting";
+    std::atomic_size_t       m_done      = 0;
+    std::atomic_size_t       m_total     = 0;
+    std::atomic_bool         m_cancelled = false;
+};
+
+// Helpers for code paths where the progress is optional
+
+inline void StartProgress(LoadProgress* progress, const char* stage, size_t total = 0) noexcept
+{
+    if (progress) {
+        progress->Start(stage, total);
+    }
+}
+
+inline void AdvanceProgress(LoadProgress* progress, size_t count = 1)
+{
+    if (progress) {
+        progress->ThrowIfCancelled();
+        progress->Advance(count);
+    }
+}
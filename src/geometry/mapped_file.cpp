@@ -0,0 +1,159 @@
+#include "mapped_file.hpp"
+
+#include "utils/misc.hpp"
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <cstdint>
+#include <utility>
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::filesystem::path& filepath, Access access)
+{
+    auto flags = (access == Access::Sequential) ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS;
+    auto file  = CreateFileW(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, flags, nullptr);
+
+    utils::throw_runtime_error_if(file == INVALID_HANDLE_VALUE, "Failed to open file");
+
+    m_file = file;
+
+    auto size = LARGE_INTEGER{};
+    if (!GetFileSizeEx(file, &size)) {
+        Unmap();
+        utils::throw_runtime_error("Failed to query file size");
+    }
+
+    m_size = static_cast<size_t>(size.QuadPart);
+    if (m_size == 0) {
+        return;
+    }
+
+    m_mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (m_mapping == nullptr) {
+        Unmap();
+        utils::throw_runtime_error("Failed to map file");
+    }
+
+    m_data = static_cast<const char*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+    if (m_data == nullptr) {
+        Unmap();
+        utils::throw_runtime_error("Failed to map file");
+    }
+}
+
+void MappedFile::Discard(std::string_view) const noexcept
+{}
+
+void MappedFile::Unmap() noexcept
+{
+    if (m_data) {
+        UnmapViewOfFile(m_data);
+    }
+    if (m_mapping) {
+        CloseHandle(m_mapping);
+    }
+    if (m_file) {
+        CloseHandle(m_file);
+    }
+    m_data    = nullptr;
+    m_size    = 0;
+    m_mapping = nullptr;
+    m_file    = nullptr;
+}
+
+#else
+
+MappedFile::MappedFile(const std::filesystem::path& filepath, Access access)
+{
+    auto fd = open(filepath.c_str(), O_RDONLY);
+
+    utils::throw_runtime_error_if(fd < 0, "Failed to open file");
+
+    struct stat status {};
+    if (fstat(fd, &status) != 0) {
+        close(fd);
+        utils::throw_runtime_error("Failed to query file size");
+    }
+
+    m_size = static_cast<size_t>(status.st_size);
+    if (m_size == 0) {
+        close(fd);
+        return;
+    }
+
+    auto data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    close(fd); // The mapping keeps its own reference to the file
+
+    if (data == MAP_FAILED) {
+        m_size = 0;
+        utils::throw_runtime_error("Failed to map file");
+    }
+
+    m_data = static_cast<const char*>(data);
+
+    if (access == Access::Sequential) {
+        madvise(data, m_size, MADV_SEQUENTIAL);
+        madvise(data, m_size, MADV_WILLNEED);
+    } else {
+        madvise(data, m_size, MADV_RANDOM);
+    }
+}
+
+void MappedFile::Discard(std::string_view range) const noexcept
+{
+    static const auto page_size = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+
+    // Only whole pages inside the range can be dropped
+    auto first = (reinterpret_cast<uintptr_t>(range.data()) + page_size - 1) & ~(page_size - 1);
+    auto last  = (reinterpret_cast<uintptr_t>(range.data() + range.size())) & ~(page_size - 1);
+
+    if (first < last) {
+        madvise(reinterpret_cast<void*>(first), last - first, MADV_DONTNEED);
+    }
+}
+
+void MappedFile::Unmap() noexcept
+{
+    if (m_data) {
+        munmap(const_cast<char*>(m_data), m_size);
+    }
+    m_data = nullptr;
+    m_size = 0;
+}
+
+#endif
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+{
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other) {
+        Unmap();
+        std::swap(m_data, other.m_data);
+        std::swap(m_size, other.m_size);
+#ifdef _WIN32
+        std::swap(m_file, other.m_file);
+        std::swap(m_mapping, other.m_mapping);
+#endif
+    }
+    return *this;
+}
+
+MappedFile::~MappedFile() noexcept
+{
+    Unmap();
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <string_view>
+
+// Read-only memory mapping of a whole file.
+class MappedFile {
+  public:
+    enum class Access { Sequential, Random };
+
+    MappedFile() noexcept = default;
+
+    explicit MappedFile(const std::filesystem::path& filepath, Access access = Access::Sequential);
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    ~MappedFile() noexcept;
+
+    auto Data() const noexcept { return m_data; }
+    auto Size() const noexcept { return m_size; }
+    auto View() const noexcept { return std::string_view(m_data, m_size); }
+
+    // Tells the kernel that the pages backing 'range' are not needed anymore. They are dropped from the resident
+    // set and transparently read back from the file if they are accessed again.
+    void Discard(std::string_view range) const noexcept;
+
+  private:
+    void Unmap() noexcept;
+
+    const char* m_data = nullptr;
+    size_t      m_size = 0;
+#ifdef _WIN32
+    void* m_file    = nullptr;
+    void* m_mapping = nullptr;
+#endif
+};
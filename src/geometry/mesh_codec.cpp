@@ -0,0 +1,406 @@
+#include "mesh_codec.hpp"
+
+#include "thread_pool.hpp"
+#include "utils/misc.hpp"
+#include "vertex_quantizer.hpp"
+
+BEGIN_DISABLE_WARNINGS
+
+#include <zstd.h>
+
+END_DISABLE_WARNINGS
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cfloat>
+#include <cstring>
+#include <limits>
+#include <utility>
+
+namespace {
+
+constexpr uint32_t kStreamMagic     = 0x31434D56; // "VMC1"
+constexpr int      kMaxPositionBits = 22;         // Zigzag coded deltas then still fit into three bytes
+constexpr size_t   kVertexBlockSize = size_t{ 1 } << 16;
+constexpr size_t   kIndexBlockSize  = size_t{ 1 } << 18;
+constexpr size_t   kMaxVarintSize   = 5; // Of a zigzag coded 33 bit delta
+
+// Coded width of the three position and two normal components, and the bytes they take per vertex
+constexpr auto   kComponentBits  = std::array{ 24, 24, 24, 16, 16 };
+constexpr size_t kComponentCount = kComponentBits.size();
+constexpr size_t kVertexSize     = 3 * 3 + 2 * 2;
+
+struct StreamHeader final {
+    uint32_t magic;
+    uint32_t position_bits;
+    float    origin[3];
+    float    step[3]; // Size of one quantization step per axis
+    uint64_t vertex_count;
+    uint64_t index_count;
+};
+
+// The vertex blocks come first, followed by the index blocks. Offsets are relative to the start of the stream.
+struct StreamBlock final {
+    uint64_t offset;
+    uint64_t size;
+    uint64_t raw_size; // Before the entropy stage
+    uint64_t base;     // Of index blocks, the highest index of all preceding blocks plus one
+};
+
+using Components = std::array<uint32_t, kComponentCount>;
+
+auto GetBlockCount(uint64_t count, size_t block_size) noexcept
+{
+    return (count + block_size - 1) / block_size;
+}
+
+// Zigzag code of value - previous in 'bits' bits. Values are taken modulo 2^bits, so the delta always fits.
+auto EncodeDelta(uint32_t value, uint32_t previous, int bits) noexcept -> uint32_t
+{
+    auto shift = 32 - bits;
+    auto delta = static_cast<int32_t>((value - previous) << shift) >> shift;
+    auto mask  = ~uint32_t{ 0 } >> shift;
+    return ((static_cast<uint32_t>(delta) << 1) ^ static_cast<uint32_t>(delta >> 31)) & mask;
+}
+
+auto DecodeDelta(uint32_t code, uint32_t previous, int bits) noexcept -> uint32_t
+{
+    auto delta = (code >> 1) ^ (0U - (code & 1U));
+    return (previous + delta) & (~uint32_t{ 0 } >> (32 - bits));
+}
+
+auto Compress(std::span<const uint8_t> raw, int level) -> std::vector<char>
+{
+    auto compressed = std::vector<char>(ZSTD_compressBound(raw.size()));
+    auto size       = ZSTD_compress(compressed.data(), compressed.size(), raw.data(), raw.size(), level);
+
+    utils::throw_runtime_error_if(ZSTD_isError(size), "Failed to compress mesh");
+
+    compressed.resize(size);
+    return compressed;
+}
+
+} // namespace
+
+std::vector<char> EncodeMesh(
+    std::span<const VertexPN> vertices,
+    std::span<const uint32_t> indices,
+    const MeshCodecOptions&   options,
+    ThreadPool*               thread_pool)
+{
+    auto position_bits      = std::clamp(options.position_bits, 1, kMaxPositionBits);
+    auto vertex_block_count = GetBlockCount(vertices.size(), kVertexBlockSize);
+    auto index_block_count  = GetBlockCount(indices.size(), kIndexBlockSize);
+
+    auto vertex_block = [&](size_t block) {
+        auto first = block * kVertexBlockSize;
+        return vertices.subspan(first, std::min(kVertexBlockSize, vertices.size() - first));
+    };
+    auto index_block = [&](size_t block) {
+        auto first = block * kIndexBlockSize;
+        return indices.subspan(first, std::min(kIndexBlockSize, indices.size() - first));
+    };
+
+    // Bounding box of the vertices, and the highest index of every block plus one
+    auto empty_aabb  = AABB{ { FLT_MAX, FLT_MAX, FLT_MAX }, { -FLT_MAX, -FLT_MAX, -FLT_MAX } };
+    auto block_aabbs = std::vector<AABB>(vertex_block_count, empty_aabb);
+    auto block_bases = std::vector<uint64_t>(index_block_count, 0);
+
+    ParallelFor(thread_pool, vertex_block_count + index_block_count, [&](size_t block) {
+        if (block < vertex_block_count) {
+            for (const auto& vertex : vertex_block(block)) {
+                block_aabbs[block].Expand({ vertex.position.x, vertex.position.y, vertex.position.z });
+            }
+        } else {
+            auto block_indices                      = index_block(block - vertex_block_count);
+            block_bases[block - vertex_block_count] = uint64_t{ std::ranges::max(block_indices) } + 1;
+        }
+    });
+
+    auto aabb = empty_aabb;
+    for (const auto& block_aabb : block_aabbs) {
+        aabb.Expand(block_aabb.min);
+        aabb.Expand(block_aabb.max);
+    }
+
+    // Every index block starts from the highest index of the blocks before it
+    for (auto base = uint64_t{ 0 }; auto& block_base : block_bases) {
+        base = std::max(base, std::exchange(block_base, base));
+    }
+
+    auto header = StreamHeader{};
+
+    header.magic         = kStreamMagic;
+    header.position_bits = static_cast<uint32_t>(position_bits);
+    header.vertex_count  = vertices.size();
+    header.index_count   = indices.size();
+
+    auto max_position = (uint32_t{ 1 } << position_bits) - 1;
+    auto mins         = std::array{ aabb.min.x, aabb.min.y, aabb.min.z };
+    auto maxs         = std::array{ aabb.max.x, aabb.max.y, aabb.max.z };
+    auto scales       = std::array<double, 3>{};
+
+    for (size_t axis = 0; axis != 3 && !vertices.empty(); ++axis) {
+        header.origin[axis] = mins[axis];
+        header.step[axis]   = (maxs[axis] - mins[axis]) / static_cast<float>(max_position);
+        scales[axis]        = header.step[axis] > 0.0f ? 1.0 / static_cast<double>(header.step[axis]) : 0.0;
+    }
+
+    auto quantize = [&](const VertexPN& vertex) {
+        auto position   = std::array{ vertex.position.x, vertex.position.y, vertex.position.z };
+        auto normal     = EncodeOctahedral(vertex.normal);
+        auto components = Components{};
+
+        for (size_t axis = 0; axis != 3; ++axis) {
+            // Written so that NaN maps to zero
+            auto value       = (static_cast<double>(position[axis]) - header.origin[axis]) * scales[axis] + 0.5;
+            auto clamped     = std::min(value, static_cast<double>(max_position));
+            components[axis] = value > 0.0 ? static_cast<uint32_t>(clamped) : 0;
+        }
+        components[3] = static_cast<uint16_t>(normal.x);
+        components[4] = static_cast<uint16_t>(normal.y);
+
+        return components;
+    };
+
+    auto blocks   = std::vector<StreamBlock>(vertex_block_count + index_block_count);
+    auto payloads = std::vector<std::vector<char>>(blocks.size());
+
+    ParallelFor(thread_pool, blocks.size(), [&](size_t block) {
+        auto raw = std::vector<uint8_t>{};
+
+        if (block < vertex_block_count) {
+            auto block_vertices = vertex_block(block);
+            auto count          = block_vertices.size();
+            auto previous       = Components{};
+
+            // Every byte of every component has a plane of its own, which holds that byte for all vertices of the block
+            raw.resize(kVertexSize * count);
+
+            for (size_t i = 0; i != count; ++i) {
+                auto components = quantize(block_vertices[i]);
+                auto plane      = raw.data() + i;
+
+                for (size_t c = 0; c != kComponentCount; ++c) {
+                    auto code = EncodeDelta(components[c], previous[c], kComponentBits[c]);
+                    for (auto byte = 0; byte != kComponentBits[c] / 8; ++byte, plane += count) {
+                        *plane = static_cast<uint8_t>(code >> (8 * byte));
+                    }
+                }
+
+                previous = components;
+            }
+        } else {
+            auto block_indices = index_block(block - vertex_block_count);
+            auto next          = block_bases[block - vertex_block_count];
+
+            raw.resize(kMaxVarintSize * block_indices.size());
+
+            auto output = raw.data();
+
+            for (auto index : block_indices) {
+                auto delta = static_cast<int64_t>(next) - static_cast<int64_t>(index);
+                auto code  = (static_cast<uint64_t>(delta) << 1) ^ static_cast<uint64_t>(delta >> 63);
+
+                for (; code >= 0x80; code >>= 7) {
+                    *output++ = static_cast<uint8_t>(code | 0x80);
+                }
+                *output++ = static_cast<uint8_t>(code);
+
+                next = std::max(next, uint64_t{ index } + 1);
+            }
+
+            raw.resize(static_cast<size_t>(output - raw.data()));
+
+            blocks[block].base = block_bases[block - vertex_block_count];
+        }
+
+        blocks[block].raw_size = raw.size();
+        payloads[block]        = Compress(raw, options.compression_level);
+    });
+
+    auto offset = sizeof(StreamHeader) + blocks.size() * sizeof(StreamBlock);
+    for (size_t i = 0; i != blocks.size(); ++i) {
+        blocks[i].offset = offset;
+        blocks[i].size   = payloads[i].size();
+        offset += payloads[i].size();
+    }
+
+    auto stream = std::vector<char>(offset);
+
+    std::memcpy(stream.data(), &header, sizeof(header));
+    if (!blocks.empty()) {
+        std::memcpy(stream.data() + sizeof(header), blocks.data(), blocks.size() * sizeof(StreamBlock));
+    }
+
+    ParallelFor(thread_pool, blocks.size(), [&](size_t block) {
+        std::ranges::copy(payloads[block], stream.data() + blocks[block].offset);
+        payloads[block] = {};
+    });
+
+    return stream;
+}
+
+std::optional<DecodedMesh> DecodeMesh(std::string_view data, ThreadPool* thread_pool)
+{
+    if (data.size() < sizeof(StreamHeader)) {
+        return std::nullopt;
+    }
+
+    auto header = StreamHeader{};
+    std::memcpy(&header, data.data(), sizeof(header));
+
+    auto is_valid_header = header.magic == kStreamMagic && header.position_bits >= 1 &&
+                           header.position_bits <= kMaxPositionBits &&
+                           header.vertex_count <= uint64_t{ std::numeric_limits<uint32_t>::max() } + 1;
+    if (!is_valid_header) {
+        return std::nullopt;
+    }
+
+    auto vertex_block_count = GetBlockCount(header.vertex_count, kVertexBlockSize);
+    auto index_block_count  = GetBlockCount(header.index_count, kIndexBlockSize);
+    auto block_count        = vertex_block_count + index_block_count;
+
+    if (block_count > (data.size() - sizeof(StreamHeader)) / sizeof(StreamBlock)) {
+        return std::nullopt;
+    }
+
+    auto blocks = std::vector<StreamBlock>(static_cast<size_t>(block_count));
+    if (!blocks.empty()) {
+        std::memcpy(blocks.data(), data.data() + sizeof(StreamHeader), blocks.size() * sizeof(StreamBlock));
+    }
+
+    // Number of vertices or indices in a block
+    auto block_length = [&](size_t block) {
+        if (block < vertex_block_count) {
+            auto first = block * kVertexBlockSize;
+            return static_cast<size_t>(std::min<uint64_t>(kVertexBlockSize, header.vertex_count - first));
+        }
+        auto first = (block - vertex_block_count) * kIndexBlockSize;
+        return static_cast<size_t>(std::min<uint64_t>(kIndexBlockSize, header.index_count - first));
+    };
+
+    // Check the sizes of all blocks before anything is allocated for them
+    for (size_t block = 0; block != blocks.size(); ++block) {
+        const auto& [offset, size, raw_size, base] = blocks[block];
+
+        auto count         = block_length(block);
+        auto is_valid_size = block < vertex_block_count ? raw_size == kVertexSize * count
+                                                        : raw_size >= count && raw_size <= kMaxVarintSize * count;
+
+        auto is_valid_block = is_valid_size && offset <= data.size() && size <= data.size() - offset &&
+                              ZSTD_getFrameContentSize(data.data() + offset, size) == raw_size;
+        if (!is_valid_block) {
+            return std::nullopt;
+        }
+    }
+
+    auto mesh     = DecodedMesh{};
+    auto is_valid = std::atomic_bool{ true };
+
+    mesh.vertices.assign(static_cast<size_t>(header.vertex_count), VertexPN(glm::vec3(0.0f), glm::vec3(0.0f)));
+    mesh.indices.resize(static_cast<size_t>(header.index_count));
+
+    ParallelFor(thread_pool, blocks.size(), [&](size_t block) {
+        const auto& [offset, size, raw_size, base] = blocks[block];
+
+        auto raw    = std::vector<uint8_t>(static_cast<size_t>(raw_size));
+        auto result = ZSTD_decompress(raw.data(), raw.size(), data.data() + offset, static_cast<size_t>(size));
+
+        if (ZSTD_isError(result) || result != raw.size()) {
+            is_valid = false;
+            return;
+        }
+
+        auto count = block_length(block);
+
+        if (block < vertex_block_count) {
+            auto vertices = mesh.vertices.data() + block * kVertexBlockSize;
+            auto values   = std::vector<uint32_t>(kComponentCount * count);
+            auto plane    = raw.data();
+
+            // One component at a time, so every loop reads its planes front to back and carries a single delta
+            for (size_t c = 0; c != kComponentCount; ++c) {
+                auto component = values.data() + c * count;
+                auto previous  = uint32_t{ 0 };
+
+                if (kComponentBits[c] == 24) {
+                    for (size_t i = 0; i != count; ++i) {
+                        auto code = uint32_t{ plane[i] } | (uint32_t{ plane[count + i] } << 8) |
+                                    (uint32_t{ plane[2 * count + i] } << 16);
+                        previous     = DecodeDelta(code, previous, 24);
+                        component[i] = previous;
+                    }
+                } else {
+                    for (size_t i = 0; i != count; ++i) {
+                        auto code    = uint32_t{ plane[i] } | (uint32_t{ plane[count + i] } << 8);
+                        previous     = DecodeDelta(code, previous, 16);
+                        component[i] = previous;
+                    }
+                }
+
+                plane += static_cast<size_t>(kComponentBits[c] / 8) * count;
+            }
+
+            auto x  = values.data();
+            auto y  = x + count;
+            auto z  = y + count;
+            auto nx = z + count;
+            auto ny = nx + count;
+
+            for (size_t i = 0; i != count; ++i) {
+                vertices[i].position = glm::vec3(
+                    header.origin[0] + static_cast<float>(x[i]) * header.step[0],
+                    header.origin[1] + static_cast<float>(y[i]) * header.step[1],
+                    header.origin[2] + static_cast<float>(z[i]) * header.step[2]);
+                vertices[i].normal = DecodeOctahedral(
+                    glm::i16vec2(static_cast<int16_t>(nx[i]), static_cast<int16_t>(ny[i])));
+            }
+        } else {
+            auto indices = mesh.indices.data() + (block - vertex_block_count) * kIndexBlockSize;
+            auto input   = raw.data();
+            auto end     = raw.data() + raw.size();
+            auto next    = static_cast<int64_t>(base);
+
+            for (size_t i = 0; i != count; ++i) {
+                auto code  = uint64_t{ 0 };
+                auto shift = 0;
+
+                // Most indices are close to the high-water mark and take a single byte
+                if (input != end && *input < 0x80) {
+                    code = *input++;
+                } else {
+                    for (auto byte = uint8_t{ 0x80 }; byte & 0x80; shift += 7) {
+                        if (input == end || shift > 28) {
+                            is_valid = false;
+                            return;
+                        }
+                        byte = *input++;
+                        code |= uint64_t{ byte & 0x7FU } << shift;
+                    }
+                }
+
+                auto index = next - (static_cast<int64_t>(code >> 1) ^ -static_cast<int64_t>(code & 1));
+
+                if (index < 0 || static_cast<uint64_t>(index) >= header.vertex_count) {
+                    is_valid = false;
+                    return;
+                }
+
+                indices[i] = static_cast<uint32_t>(index);
+                next       = std::max(next, index + 1);
+            }
+
+            if (input != end) {
+                is_valid = false;
+            }
+        }
+    });
+
+    if (!is_valid) {
+        return std::nullopt;
+    }
+
+    return mesh;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "geometry.hpp"
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+class ThreadPool;
+
+struct MeshCodecOptions final {
+    int position_bits     = 21; // Per axis over the bounding box of all vertices, at most 22
+    int compression_level = 3;  // zstd level of the entropy stage
+};
+
+struct DecodedMesh final {
+    std::vector<VertexPN> vertices;
+    std::vector<uint32_t> indices;
+};
+
+// Compresses a vertex and an index array for the geometry cache. Positions are quantized over the bounding box of all
+// vertices and normals are octahedral encoded into 16 bits per component, so the arrays are only restored up to that
+// precision. Both arrays are cut into blocks that are coded independently:
+//
+//  - Vertices are delta coded against the previous vertex of their block, which is small since the vertices of an
+//    optimized geometry are in the order they are first used by the indices. The deltas are zigzag coded and split
+//    into byte planes, so the high bytes, which are mostly zero, end up next to each other.
+//  - Every index is coded as its distance to the highest index of the block so far plus one, zigzag and varint coded.
+//    New vertices code to zero and the vertices of the previous few triangles to small values.
+//
+// Every block then goes through zstd, and blocks are encoded and decoded in parallel on the thread pool.
+auto EncodeMesh(
+    std::span<const VertexPN> vertices,
+    std::span<const uint32_t> indices,
+    const MeshCodecOptions&   options,
+    ThreadPool*               thread_pool) -> std::vector<char>;
+
+// Decodes the output of EncodeMesh. Returns std::nullopt if 'data' is corrupt, including indices that are out of range.
+auto DecodeMesh(std::string_view data, ThreadPool* thread_pool) -> std::optional<DecodedMesh>;
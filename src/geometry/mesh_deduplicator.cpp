@@ -0,0 +1,300 @@
+#include "mesh_deduplicator.hpp"
+
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+constexpr uint32_t kNone = std::numeric_limits<uint32_t>::max();
+
+// Frames whose second axis is shorter than this, relative to the first, are too close to a line to recover a rotation
+constexpr float kMinFrameSine = 1e-3f;
+
+// Finalizer of splitmix64
+constexpr uint64_t Mix(uint64_t value) noexcept
+{
+    value ^= value >> 30;
+    value *= 0xbf58476d1ce4e5b9;
+    value ^= value >> 27;
+    value *= 0x94d049bb133111eb;
+    value ^= value >> 31;
+    return value;
+}
+
+// Mesh record seen through its own vertex numbering
+struct LocalMesh final {
+    std::vector<uint32_t> vertices; // Local vertex -> geometry vertex, in order of first use
+    uint64_t              fingerprint{};
+    glm::vec3             centroid{ 0.0f };
+};
+
+LocalMesh BuildLocalMesh(std::span<const uint32_t> indices, std::span<const VertexPN> vertices)
+{
+    auto mesh = LocalMesh{};
+
+    auto ids = std::vector<uint32_t>(indices.begin(), indices.end());
+    std::ranges::sort(ids);
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
+    auto local = std::vector<uint32_t>(ids.size(), kNone);
+    auto hash  = Mix(indices.size());
+
+    mesh.vertices.reserve(ids.size());
+
+    for (auto index : indices) {
+        auto& slot = local[static_cast<size_t>(std::ranges::lower_bound(ids, index) - ids.begin())];
+        if (slot == kNone) {
+            slot = static_cast<uint32_t>(mesh.vertices.size());
+            mesh.vertices.push_back(index);
+        }
+        hash = Mix(hash ^ slot);
+    }
+
+    auto sum = glm::dvec3(0.0);
+    for (auto vertex : mesh.vertices) {
+        sum += glm::dvec3(vertices[vertex].position);
+    }
+    mesh.centroid = glm::vec3(sum / static_cast<double>(mesh.vertices.size()));
+
+    // Root mean square distance from the centroid, compared on a logarithmic scale in steps of 1/1024 of an octave
+    auto spread = 0.0;
+    for (auto vertex : mesh.vertices) {
+        auto offset = glm::dvec3(vertices[vertex].position - mesh.centroid);
+        spread += glm::dot(offset, offset);
+    }
+    spread = std::sqrt(spread / static_cast<double>(mesh.vertices.size()));
+
+    auto bucket      = spread > 0.0 ? std::llround(std::log2(spread) * 1024.0) : std::numeric_limits<long long>::min();
+    mesh.fingerprint = Mix(hash ^ static_cast<uint64_t>(bucket));
+
+    return mesh;
+}
+
+// Orthonormal frame spanned by local vertices 'a' and 'b' around the centroid, as the columns of a matrix
+std::optional<glm::mat3> ComputeFrame(
+    const LocalMesh&          mesh,
+    std::span<const VertexPN> vertices,
+    uint32_t                  a,
+    uint32_t                  b)
+{
+    auto first  = vertices[mesh.vertices[a]].position - mesh.centroid;
+    auto second = vertices[mesh.vertices[b]].position - mesh.centroid;
+    auto length = std::sqrt(glm::dot(first, first));
+
+    if (length == 0.0f) {
+        return std::nullopt;
+    }
+
+    auto x = first / length;
+    auto y = second - x * glm::dot(second, x);
+
+    auto y_length = std::sqrt(glm::dot(y, y));
+    if (y_length <= kMinFrameSine * std::sqrt(glm::dot(second, second))) {
+        return std::nullopt;
+    }
+
+    y /= y_length;
+
+    return glm::mat3(x, y, glm::cross(x, y));
+}
+
+struct Prototype final {
+    size_t    record; // Number of the mesh record in shape order
+    uint32_t  a{};    // Local vertices that span the frame
+    uint32_t  b{};
+    glm::mat3 frame{ 1.0f };
+};
+
+// Picks the vertex farthest from the centroid and the one that spans the largest area with it, which gives the most
+// precise frame
+std::optional<Prototype> MakePrototype(size_t record, const LocalMesh& mesh, std::span<const VertexPN> vertices)
+{
+    auto prototype = Prototype{ record };
+    auto offset    = [&](uint32_t v) { return vertices[mesh.vertices[v]].position - mesh.centroid; };
+    auto count     = static_cast<uint32_t>(mesh.vertices.size());
+
+    auto best = 0.0f;
+    for (uint32_t v = 0; v != count; ++v) {
+        if (auto distance = glm::dot(offset(v), offset(v)); distance > best) {
+            best        = distance;
+            prototype.a = v;
+        }
+    }
+
+    best = 0.0f;
+    for (uint32_t v = 0; v != count; ++v) {
+        auto normal = glm::cross(offset(prototype.a), offset(v));
+        if (auto area = glm::dot(normal, normal); area > best) {
+            best        = area;
+            prototype.b = v;
+        }
+    }
+
+    auto frame = ComputeFrame(mesh, vertices, prototype.a, prototype.b);
+    if (!frame) {
+        return std::nullopt;
+    }
+
+    prototype.frame = *frame;
+
+    return prototype;
+}
+
+} // namespace
+
+DeduplicatorReport DeduplicateMeshes(Geometry* geometry, const DeduplicatorOptions& options, ThreadPool* thread_pool)
+{
+    auto records = std::vector<MeshRecord*>{};
+    for (auto& shape : geometry->shapes) {
+        for (auto& mesh : shape.meshes) {
+            records.push_back(&mesh);
+        }
+    }
+
+    auto vertices = std::span<const VertexPN>(geometry->vertices);
+    auto locals   = std::vector<LocalMesh>(records.size());
+
+    ParallelFor(thread_pool, records.size(), [&](size_t r) {
+        if (records[r]->index_count != 0) {
+            auto indices = std::span(geometry->indices).subspan(records[r]->first_index, records[r]->index_count);
+            locals[r]    = BuildLocalMesh(indices, vertices);
+        }
+    });
+
+    auto groups = std::vector<std::vector<size_t>>{};
+    {
+        auto group_of = std::unordered_map<uint64_t, size_t>{};
+        for (size_t r = 0; r != records.size(); ++r) {
+            if (records[r]->index_count != 0) {
+                auto [it, is_new] = group_of.try_emplace(locals[r].fingerprint, groups.size());
+                if (is_new) {
+                    groups.emplace_back();
+                }
+                groups[it->second].push_back(r);
+            }
+        }
+    }
+
+    std::erase_if(groups, [](const auto& group) { return group.size() < 2; });
+
+    ParallelFor(thread_pool, groups.size(), [&](size_t g) {
+        auto prototypes = std::vector<Prototype>{};
+
+        auto match = [&](const Prototype& prototype, size_t r) -> std::optional<RigidTransform> {
+            const auto& source = locals[prototype.record];
+            const auto& target = locals[r];
+
+            if (source.vertices.size() != target.vertices.size()) {
+                return std::nullopt;
+            }
+
+            auto frame = ComputeFrame(target, vertices, prototype.a, prototype.b);
+            if (!frame) {
+                return std::nullopt;
+            }
+
+            auto rotation  = *frame * glm::transpose(prototype.frame);
+            auto aabb      = records[r]->aabb;
+            auto extent    = std::max({ aabb.ExtentX(), aabb.ExtentY(), aabb.ExtentZ() });
+            auto scale     = std::max(extent, std::sqrt(glm::dot(target.centroid, target.centroid)));
+            auto tolerance = options.position_tolerance * scale;
+
+            for (size_t v = 0; v != source.vertices.size(); ++v) {
+                const auto& from = vertices[source.vertices[v]];
+                const auto& to   = vertices[target.vertices[v]];
+
+                auto offset = rotation * (from.position - source.centroid) - (to.position - target.centroid);
+                if (glm::dot(offset, offset) > tolerance * tolerance) {
+                    return std::nullopt;
+                }
+                if (glm::dot(rotation * from.normal, to.normal) < options.normal_tolerance) {
+                    return std::nullopt;
+                }
+            }
+
+            return MakeRigidTransform(rotation, target.centroid - rotation * source.centroid);
+        };
+
+        for (auto r : groups[g]) {
+            auto is_duplicate = false;
+
+            for (const auto& prototype : prototypes) {
+                if (auto transform = match(prototype, r)) {
+                    records[r]->prototype = prototype.record;
+                    records[r]->transform = *transform;
+                    is_duplicate          = true;
+                    break;
+                }
+            }
+
+            if (!is_duplicate) {
+                if (auto prototype = MakePrototype(r, locals[r], vertices)) {
+                    prototypes.push_back(*prototype);
+                }
+            }
+        }
+    });
+
+    locals = {};
+
+    // Drop the indices of the duplicates, then the vertices that no index refers to anymore
+    auto report     = DeduplicatorReport{};
+    auto indices    = std::vector<uint32_t>{};
+    auto prototypes = std::vector<bool>(records.size(), false);
+
+    indices.reserve(geometry->indices.size());
+
+    for (auto* record : records) {
+        if (record->prototype != kNoPrototype) {
+            prototypes[record->prototype] = true;
+            record->first_index           = indices.size();
+            record->index_count           = 0;
+            ++report.duplicate_count;
+            continue;
+        }
+        auto range          = std::span(geometry->indices).subspan(record->first_index, record->index_count);
+        record->first_index = indices.size();
+        indices.insert(indices.end(), range.begin(), range.end());
+    }
+
+    report.prototype_count = static_cast<size_t>(std::ranges::count(prototypes, true));
+
+    if (report.duplicate_count == 0) {
+        return report;
+    }
+
+    report.index_count = geometry->indices.size() - indices.size();
+
+    auto remap = std::vector<uint32_t>(geometry->vertices.size(), kNone);
+    for (auto index : indices) {
+        remap[index] = 0;
+    }
+
+    auto compacted = std::vector<VertexPN>{};
+    compacted.reserve(geometry->vertices.size());
+
+    for (size_t v = 0; v != geometry->vertices.size(); ++v) {
+        if (remap[v] != kNone) {
+            remap[v] = static_cast<uint32_t>(compacted.size());
+            compacted.push_back(geometry->vertices[v]);
+        }
+    }
+
+    for (auto& index : indices) {
+        index = remap[index];
+    }
+
+    report.vertex_count = geometry->vertices.size() - compacted.size();
+
+    geometry->vertices = std::move(compacted);
+    geometry->indices  = std::move(indices);
+
+    return report;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "geometry.hpp"
+
+#include <cstddef>
+
+class ThreadPool;
+
+struct DeduplicatorOptions final {
+    // Largest distance between matched vertices, relative to the larger of the extent of the mesh and its distance
+    // from the origin, which covers the rounding of coordinates printed with a fixed number of digits
+    float position_tolerance = 1e-4f;
+    // Smallest cosine of the angle between matched normals
+    float normal_tolerance = 0.999847695f;
+};
+
+struct DeduplicatorReport final {
+    size_t prototype_count = 0; // Mesh records repeated by at least one other record
+    size_t duplicate_count = 0; // Mesh records turned into instances of a prototype
+    size_t vertex_count    = 0; // Vertices removed
+    size_t index_count     = 0; // Indices removed
+};
+
+// Finds mesh records that repeat the triangles of an earlier record, as assemblies do with their fasteners, and turns
+// them into instances of it. Records are grouped by a fingerprint of their triangle list, numbered by first use of
+// its vertices, and of the spread of their vertices, which a rigid transform does not change. Within a group, a record
+// is matched against the prototypes found so far: the rotation is recovered from frames spanned by the same vertices of
+// both records, and every vertex position and normal has to agree within 'options'. Mirrored copies do not match.
+// The indices of the duplicates and the vertices only they used are removed, which renumbers the vertices. Runs
+// before meshlets and LODs are built, geometry->meshlets and geometry->lods must be empty. Groups are matched in
+// parallel.
+auto DeduplicateMeshes(Geometry* geometry, const DeduplicatorOptions& options, ThreadPool* thread_pool)
+    -> DeduplicatorReport;
@@ -0,0 +1,402 @@
+#include "mesh_optimizer.hpp"
+
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+namespace {
+
+constexpr uint32_t kNone = std::numeric_limits<uint32_t>::max();
+
+// Triangles per independently optimized piece of a mesh record
+constexpr size_t kPieceTriangleCount = size_t{ 1 } << 16;
+
+// Scoring of Forsyth, "Linear-Speed Vertex Cache Optimisation". The cache is modelled as LRU, which makes the order
+// perform well on FIFO caches of about the same size too.
+constexpr size_t kCacheSize         = 32;
+constexpr float  kCacheDecayPower   = 1.5f;
+constexpr float  kLastTriangleScore = 0.75f;
+constexpr float  kValenceBoostScale = 2.0f;
+constexpr float  kValenceBoostPower = 0.5f;
+
+// FIFO cache used to find the boundaries of the clusters of the overdraw optimization
+constexpr size_t kClusterCacheSize = 16;
+
+constexpr uint32_t kMaxTabulatedValence = 32;
+
+// Score of a vertex by its position in the cache and its number of live triangles, tabulated for the common cases
+class VertexScores final {
+  public:
+    VertexScores() noexcept
+    {
+        for (size_t position = 0; position != kCacheSize; ++position) {
+            if (position < 3) {
+                m_cache_scores[position] = kLastTriangleScore;
+            } else {
+                auto scale               = 1.0f / static_cast<float>(kCacheSize - 3);
+                auto base                = 1.0f - static_cast<float>(position - 3) * scale;
+                m_cache_scores[position] = std::pow(base, kCacheDecayPower);
+            }
+        }
+        for (uint32_t valence = 1; valence <= kMaxTabulatedValence; ++valence) {
+            m_valence_scores[valence] = ValenceScore(valence);
+        }
+    }
+
+    float operator()(size_t cache_position, uint32_t live_triangles) const noexcept
+    {
+        if (live_triangles == 0) {
+            return -1.0f;
+        }
+
+        auto cache_score   = cache_position < kCacheSize ? m_cache_scores[cache_position] : 0.0f;
+        auto valence_score = live_triangles <= kMaxTabulatedValence ? m_valence_scores[live_triangles]
+                                                                     : ValenceScore(live_triangles);
+        return cache_score + valence_score;
+    }
+
+  private:
+    static float ValenceScore(uint32_t valence) noexcept
+    {
+        return kValenceBoostScale * std::pow(static_cast<float>(valence), -kValenceBoostPower);
+    }
+
+    std::array<float, kCacheSize>               m_cache_scores{};
+    std::array<float, kMaxTabulatedValence + 1> m_valence_scores{};
+};
+
+} // namespace
+
+void OptimizeVertexCache(std::span<uint32_t> indices, size_t vertex_count)
+{
+    auto triangle_count = indices.size() / 3;
+
+    // Live triangles of every vertex, as ranges of 'adjacency' that shrink as triangles are emitted
+    auto live_counts = std::vector<uint32_t>(vertex_count);
+    auto offsets     = std::vector<uint32_t>(vertex_count + 1);
+    auto adjacency   = std::vector<uint32_t>(indices.size());
+
+    for (auto index : indices) {
+        ++live_counts[index];
+    }
+
+    std::exclusive_scan(live_counts.begin(), live_counts.end(), offsets.begin(), uint32_t{ 0 });
+    offsets.back() = static_cast<uint32_t>(indices.size());
+
+    {
+        auto cursors = std::vector<uint32_t>(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i != indices.size(); ++i) {
+            adjacency[cursors[indices[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+    }
+
+    auto score_of        = VertexScores();
+    auto vertex_scores   = std::vector<float>(vertex_count);
+    auto triangle_scores = std::vector<float>(triangle_count, 0.0f);
+    auto is_emitted      = std::vector<bool>(triangle_count);
+
+    for (size_t v = 0; v != vertex_count; ++v) {
+        vertex_scores[v] = score_of(kCacheSize, live_counts[v]);
+    }
+    for (size_t i = 0; i != indices.size(); ++i) {
+        triangle_scores[i / 3] += vertex_scores[indices[i]];
+    }
+
+    auto output     = std::vector<uint32_t>{};
+    auto cache      = std::vector<uint32_t>{};
+    auto next_cache = std::vector<uint32_t>{};
+    auto cursor     = size_t{ 0 }; // Triangles before it are emitted, used when the cache has no candidates
+
+    output.reserve(indices.size());
+    cache.reserve(kCacheSize + 3);
+    next_cache.reserve(kCacheSize + 3);
+
+    auto best = std::max_element(triangle_scores.begin(), triangle_scores.end()) - triangle_scores.begin();
+
+    for (size_t emitted = 0; emitted != triangle_count; ++emitted) {
+        if (best < 0) {
+            while (is_emitted[cursor]) {
+                ++cursor;
+            }
+            best = static_cast<std::ptrdiff_t>(cursor);
+        }
+
+        auto triangle = static_cast<size_t>(best);
+        auto corners  = indices.subspan(3 * triangle, 3);
+
+        is_emitted[triangle] = true;
+        output.insert(output.end(), corners.begin(), corners.end());
+
+        // Remove the triangle from the live triangles of its vertices
+        for (auto v : corners) {
+            auto first = adjacency.begin() + offsets[v];
+            auto last  = first + live_counts[v];
+            if (auto it = std::find(first, last, static_cast<uint32_t>(triangle)); it != last) {
+                std::iter_swap(it, last - 1);
+                --live_counts[v];
+            }
+        }
+
+        // The vertices of the triangle move to the front of the cache
+        next_cache.assign(corners.begin(), corners.end());
+        for (auto v : cache) {
+            if (std::find(corners.begin(), corners.end(), v) == corners.end()) {
+                next_cache.push_back(v);
+            }
+        }
+        std::swap(cache, next_cache);
+
+        // Rescore the vertices in the cache, including the ones just pushed out of it, and their triangles
+        for (size_t position = 0; position != cache.size(); ++position) {
+            auto v     = cache[position];
+            auto score = score_of(position, live_counts[v]);
+            auto delta = score - vertex_scores[v];
+
+            vertex_scores[v] = score;
+
+            for (auto k = offsets[v]; k != offsets[v] + live_counts[v]; ++k) {
+                triangle_scores[adjacency[k]] += delta;
+            }
+        }
+
+        if (cache.size() > kCacheSize) {
+            cache.resize(kCacheSize);
+        }
+
+        // The next triangle is the best one using a cached vertex
+        best            = -1;
+        auto best_score = -1.0f;
+
+        for (auto v : cache) {
+            for (auto k = offsets[v]; k != offsets[v] + live_counts[v]; ++k) {
+                if (triangle_scores[adjacency[k]] > best_score) {
+                    best       = adjacency[k];
+                    best_score = triangle_scores[adjacency[k]];
+                }
+            }
+        }
+    }
+
+    std::copy(output.begin(), output.end(), indices.begin());
+}
+
+namespace {
+
+// Reorders the triangles of 'indices' in clusters, as in Sander et al., "Fast Triangle Reordering for Vertex Locality
+// and Reduced Overdraw". Clusters on the outside of the mesh, facing away from its center, are drawn first since they
+// are likely to occlude the others. Clusters start where the order already restarts the vertex cache, so the vertex
+// cache efficiency is mostly kept.
+void OptimizeOverdraw(std::span<uint32_t> indices, std::span<const VertexPN> vertices, const glm::vec3& center)
+{
+    auto triangle_count = indices.size() / 3;
+
+    auto cluster_starts = std::vector<size_t>{};
+    {
+        auto cache = std::array<uint32_t, kClusterCacheSize>{};
+        auto used  = size_t{ 0 };
+        auto next  = size_t{ 0 };
+
+        for (size_t triangle = 0; triangle != triangle_count; ++triangle) {
+            auto misses = 0;
+            for (auto v : indices.subspan(3 * triangle, 3)) {
+                if (std::find(cache.begin(), cache.begin() + used, v) == cache.begin() + used) {
+                    cache[next] = v;
+                    next        = (next + 1) % kClusterCacheSize;
+                    used        = std::min(used + 1, kClusterCacheSize);
+                    ++misses;
+                }
+            }
+            if (misses == 3) {
+                cluster_starts.push_back(triangle);
+            }
+        }
+    }
+
+    if (cluster_starts.size() < 2) {
+        return;
+    }
+
+    cluster_starts.push_back(triangle_count);
+
+    struct Cluster final {
+        size_t first_triangle;
+        size_t triangle_count;
+        float  sort_key;
+    };
+
+    auto clusters = std::vector<Cluster>{};
+    clusters.reserve(cluster_starts.size() - 1);
+
+    for (size_t c = 0; c + 1 != cluster_starts.size(); ++c) {
+        auto first = cluster_starts[c];
+        auto count = cluster_starts[c + 1] - first;
+        auto key   = ComputeOverdrawKey(indices.subspan(3 * first, 3 * count), vertices, center);
+
+        clusters.push_back({ first, count, key });
+    }
+
+    std::ranges::stable_sort(clusters, std::greater{}, &Cluster::sort_key);
+
+    auto output = std::vector<uint32_t>{};
+    output.reserve(indices.size());
+
+    for (const auto& cluster : clusters) {
+        auto range = indices.subspan(3 * cluster.first_triangle, 3 * cluster.triangle_count);
+        output.insert(output.end(), range.begin(), range.end());
+    }
+
+    std::copy(output.begin(), output.end(), indices.begin());
+}
+
+struct Piece final {
+    size_t    first_index;
+    size_t    index_count;
+    glm::vec3 center;
+};
+
+} // namespace
+
+float ComputeOverdrawKey(std::span<const uint32_t> indices, std::span<const VertexPN> vertices, const glm::vec3& center)
+{
+    auto centroid = glm::vec3(0.0f, 0.0f, 0.0f);
+    auto normal   = glm::vec3(0.0f, 0.0f, 0.0f);
+    auto area     = 0.0f;
+
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        auto p0 = vertices[indices[i + 0]].position;
+        auto p1 = vertices[indices[i + 1]].position;
+        auto p2 = vertices[indices[i + 2]].position;
+
+        auto cross         = glm::cross(p1 - p0, p2 - p0);
+        auto triangle_area = glm::length(cross);
+
+        centroid += triangle_area * (p0 + p1 + p2) / 3.0f;
+        normal += cross;
+        area += triangle_area;
+    }
+
+    if (area > 0.0f && glm::length(normal) > 0.0f) {
+        return glm::dot(centroid / area - center, glm::normalize(normal));
+    }
+    return 0.0f;
+}
+
+void OptimizeVertexFetch(std::vector<VertexPN>* vertices, std::span<uint32_t> indices)
+{
+    auto remap = std::vector<uint32_t>(vertices->size(), kNone);
+    auto next  = uint32_t{ 0 };
+
+    for (auto& index : indices) {
+        if (remap[index] == kNone) {
+            remap[index] = next++;
+        }
+        index = remap[index];
+    }
+
+    for (auto& target : remap) {
+        if (target == kNone) {
+            target = next++;
+        }
+    }
+
+    auto reordered = std::vector<VertexPN>(vertices->size(), VertexPN(glm::vec3(0.0f), glm::vec3(0.0f)));
+    for (size_t v = 0; v != vertices->size(); ++v) {
+        reordered[remap[v]] = (*vertices)[v];
+    }
+
+    *vertices = std::move(reordered);
+}
+
+VertexCacheStats AnalyzeVertexCache(std::span<const uint32_t> indices, size_t cache_size)
+{
+    auto stats = VertexCacheStats{};
+    auto cache = std::vector<uint32_t>(cache_size, kNone);
+    auto next  = size_t{ 0 };
+
+    for (auto v : indices) {
+        if (std::find(cache.begin(), cache.end(), v) == cache.end()) {
+            cache[next] = v;
+            next        = (next + 1) % cache_size;
+            ++stats.miss_count;
+        }
+    }
+
+    auto distinct = std::vector<uint32_t>(indices.begin(), indices.end());
+    std::ranges::sort(distinct);
+
+    stats.triangle_count = indices.size() / 3;
+    stats.vertex_count   = static_cast<size_t>(std::unique(distinct.begin(), distinct.end()) - distinct.begin());
+
+    return stats;
+}
+
+MeshOptimizerReport OptimizeGeometry(Geometry* geometry, const MeshOptimizerOptions& options, ThreadPool* thread_pool)
+{
+    auto pieces = std::vector<Piece>{};
+
+    for (const auto& shape : geometry->shapes) {
+        for (const auto& mesh : shape.meshes) {
+            auto min    = glm::vec3(mesh.aabb.min.x, mesh.aabb.min.y, mesh.aabb.min.z);
+            auto max    = glm::vec3(mesh.aabb.max.x, mesh.aabb.max.y, mesh.aabb.max.z);
+            auto center = 0.5f * (min + max);
+
+            for (size_t first = 0; first < mesh.index_count; first += 3 * kPieceTriangleCount) {
+                auto count = std::min(mesh.index_count - first, 3 * kPieceTriangleCount);
+                pieces.push_back({ mesh.first_index + first, count, center });
+            }
+        }
+    }
+
+    auto before = std::vector<VertexCacheStats>(pieces.size());
+    auto after  = std::vector<VertexCacheStats>(pieces.size());
+
+    auto optimize_piece = [&](size_t p) {
+        auto indices = std::span(geometry->indices).subspan(pieces[p].first_index, pieces[p].index_count);
+
+        before[p] = AnalyzeVertexCache(indices);
+
+        if (options.vertex_cache) {
+            // Number the vertices of the piece compactly, so the per vertex state is proportional to the piece
+            auto ids = std::vector<uint32_t>(indices.begin(), indices.end());
+            std::ranges::sort(ids);
+            ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
+            auto local = std::vector<uint32_t>(indices.size());
+            for (size_t i = 0; i != indices.size(); ++i) {
+                local[i] = static_cast<uint32_t>(std::ranges::lower_bound(ids, indices[i]) - ids.begin());
+            }
+
+            OptimizeVertexCache(local, ids.size());
+
+            for (size_t i = 0; i != indices.size(); ++i) {
+                indices[i] = ids[local[i]];
+            }
+        }
+
+        if (options.overdraw) {
+            OptimizeOverdraw(indices, geometry->vertices, pieces[p].center);
+        }
+
+        after[p] = AnalyzeVertexCache(indices);
+    };
+
+    ParallelFor(thread_pool, pieces.size(), optimize_piece);
+
+    if (options.vertex_fetch) {
+        OptimizeVertexFetch(&geometry->vertices, geometry->indices);
+    }
+
+    auto report = MeshOptimizerReport{};
+
+    for (size_t p = 0; p != pieces.size(); ++p) {
+        report.before += before[p];
+        report.after += after[p];
+    }
+
+    return report;
+}
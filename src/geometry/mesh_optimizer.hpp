@@ -0,0 +1,69 @@
+#pragma once
+
+#include "geometry.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+class ThreadPool;
+
+struct MeshOptimizerOptions final {
+    bool vertex_cache = true; // Reorder triangles for the post-transform vertex cache
+    bool overdraw     = true; // Reorder clusters of triangles so that outward facing ones are drawn first
+    bool vertex_fetch = true; // Renumber vertices in the order they are first used by the index buffer
+};
+
+// Efficiency of an index buffer on a simulated FIFO post-transform cache
+struct VertexCacheStats final {
+    size_t triangle_count = 0;
+    size_t vertex_count   = 0; // Distinct vertices referenced
+    size_t miss_count     = 0; // Vertices transformed
+
+    // Average cache miss ratio, transformed vertices per triangle. 0.5 is optimal for large regular meshes, 3 the
+    // worst case.
+    auto GetACMR() const noexcept
+    {
+        return triangle_count ? static_cast<double>(miss_count) / static_cast<double>(triangle_count) : 0.0;
+    }
+
+    // Average transform to vertex ratio, transformed vertices per distinct vertex. 1 is optimal.
+    auto GetATVR() const noexcept
+    {
+        return vertex_count ? static_cast<double>(miss_count) / static_cast<double>(vertex_count) : 0.0;
+    }
+
+    auto operator+=(const VertexCacheStats& other) noexcept -> VertexCacheStats&
+    {
+        triangle_count += other.triangle_count;
+        vertex_count += other.vertex_count;
+        miss_count += other.miss_count;
+        return *this;
+    }
+};
+
+struct MeshOptimizerReport final {
+    VertexCacheStats before;
+    VertexCacheStats after;
+};
+
+// Simulates a FIFO post-transform cache of 'cache_size' entries on 'indices'
+auto AnalyzeVertexCache(std::span<const uint32_t> indices, size_t cache_size = 16) -> VertexCacheStats;
+
+// Reorders the triangles of 'indices', whose vertices are numbered [0, vertex_count), for the vertex cache
+void OptimizeVertexCache(std::span<uint32_t> indices, size_t vertex_count);
+
+// Sort key of the triangles 'indices' in the overdraw optimization, the distance of their area weighted centroid from
+// 'center' along their average normal. Clusters of triangles with larger keys face outwards and are drawn first.
+auto ComputeOverdrawKey(std::span<const uint32_t> indices, std::span<const VertexPN> vertices, const glm::vec3& center)
+    -> float;
+
+// Renumbers the vertices in the order they are first used by 'indices'. Unused vertices are kept at the end.
+void OptimizeVertexFetch(std::vector<VertexPN>* vertices, std::span<uint32_t> indices);
+
+// Optimizes the index ranges of all mesh records of 'geometry' for rendering. Triangles only move within their mesh
+// record, so the records stay valid. Records are processed in parallel; large records are split into pieces that are
+// optimized independently, which costs a few cache misses at the piece boundaries.
+auto OptimizeGeometry(Geometry* geometry, const MeshOptimizerOptions& options, ThreadPool* thread_pool)
+    -> MeshOptimizerReport;
@@ -0,0 +1,500 @@
+#include "mesh_simplifier.hpp"
+
+#include "mesh_optimizer.hpp"
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <span>
+
+namespace {
+
+// Cost of a collapse that turns the normal of a vertex by 90 degrees, in squared error relative to the mesh extent. It
+// equals a deviation of 1% of the extent, so normals decide between collapses of similar geometric error.
+constexpr double kNormalWeight = 0.5e-4;
+
+// Collapses are rejected if a triangle turns by more than about 75 degrees
+constexpr float kMinFlipCosine = 0.25f;
+
+// A level that removes fewer triangles than this fraction of the previous level ends the chain
+constexpr double kMinLevelReduction = 0.1;
+
+// Sum of the squared distances to a set of planes, weighted by the areas of their triangles
+struct Quadric final {
+    double a00{}, a01{}, a02{}, a11{}, a12{}, a22{};
+    double b0{}, b1{}, b2{};
+    double c{};
+    double weight{};
+
+    static auto FromPlane(const glm::vec3& normal, double d, double weight) noexcept
+    {
+        auto x = static_cast<double>(normal.x);
+        auto y = static_cast<double>(normal.y);
+        auto z = static_cast<double>(normal.z);
+
+        auto q = Quadric{};
+
+        q.a00    = weight * x * x;
+        q.a01    = weight * x * y;
+        q.a02    = weight * x * z;
+        q.a11    = weight * y * y;
+        q.a12    = weight * y * z;
+        q.a22    = weight * z * z;
+        q.b0     = weight * x * d;
+        q.b1     = weight * y * d;
+        q.b2     = weight * z * d;
+        q.c      = weight * d * d;
+        q.weight = weight;
+
+        return q;
+    }
+
+    auto operator+(const Quadric& other) const noexcept
+    {
+        auto q = *this;
+
+        q.a00 += other.a00;
+        q.a01 += other.a01;
+        q.a02 += other.a02;
+        q.a11 += other.a11;
+        q.a12 += other.a12;
+        q.a22 += other.a22;
+        q.b0 += other.b0;
+        q.b1 += other.b1;
+        q.b2 += other.b2;
+        q.c += other.c;
+        q.weight += other.weight;
+
+        return q;
+    }
+
+    // Mean squared distance of 'point' to the planes
+    double Evaluate(const glm::vec3& point) const noexcept
+    {
+        if (weight <= 0.0) {
+            return 0.0;
+        }
+
+        auto x = static_cast<double>(point.x);
+        auto y = static_cast<double>(point.y);
+        auto z = static_cast<double>(point.z);
+
+        auto sum = a00 * x * x + a11 * y * y + a22 * z * z + 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z) +
+                   2.0 * (b0 * x + b1 * y + b2 * z) + c;
+
+        return std::max(sum / weight, 0.0);
+    }
+};
+
+struct Collapse final {
+    uint32_t from;
+    uint32_t to;
+    double   cost;
+    double   error; // Geometric part of the cost
+};
+
+// Simplifies one mesh level by level. Vertices are numbered compactly in the order of their geometry index, and
+// positions are scaled to the largest extent of the mesh, so the errors are relative to it.
+class MeshSimplifier final {
+  public:
+    MeshSimplifier(std::span<const uint32_t> indices, std::span<const VertexPN> vertices, const AABB& aabb)
+        : m_vertices(indices.begin(), indices.end()), m_indices(indices.size())
+    {
+        std::ranges::sort(m_vertices);
+        m_vertices.erase(std::unique(m_vertices.begin(), m_vertices.end()), m_vertices.end());
+
+        for (size_t i = 0; i != indices.size(); ++i) {
+            m_indices[i] = static_cast<uint32_t>(std::ranges::lower_bound(m_vertices, indices[i]) - m_vertices.begin());
+        }
+
+        auto min    = glm::vec3(aabb.min.x, aabb.min.y, aabb.min.z);
+        auto extent = std::max({ aabb.max.x - aabb.min.x, aabb.max.y - aabb.min.y, aabb.max.z - aabb.min.z });
+        auto scale  = extent > 0.0f ? 1.0f / extent : 1.0f;
+
+        m_positions.reserve(m_vertices.size());
+        m_normals.reserve(m_vertices.size());
+
+        for (auto vertex : m_vertices) {
+            m_positions.push_back((vertices[vertex].position - min) * scale);
+            m_normals.push_back(vertices[vertex].normal);
+        }
+
+        WeldAndLock();
+        ComputeQuadrics();
+    }
+
+    // Collapses edges until at most 'target_index_count' indices are left or no collapse within 'max_error' is left
+    void Simplify(size_t target_index_count, float max_error)
+    {
+        auto max_error_squared = static_cast<double>(max_error) * static_cast<double>(max_error);
+
+        while (m_indices.size() > target_index_count) {
+            if (!CollapsePass((m_indices.size() - target_index_count) / 3, max_error_squared)) {
+                break;
+            }
+        }
+    }
+
+    auto TriangleCount() const noexcept { return m_indices.size() / 3; }
+
+    // Largest error of the collapses so far, relative to the mesh extent
+    auto Error() const noexcept { return static_cast<float>(std::sqrt(m_error)); }
+
+    // Indices of the current level in geometry vertices, ordered for the vertex cache
+    auto Indices() const
+    {
+        auto indices = m_indices;
+
+        OptimizeVertexCache(indices, m_vertices.size());
+
+        for (auto& index : indices) {
+            index = m_vertices[index];
+        }
+        return indices;
+    }
+
+  private:
+    auto Corners(size_t triangle) const noexcept { return std::span<const uint32_t>(&m_indices[3 * triangle], 3); }
+
+    // Vertices that compare equal are merged, which the streaming import leaves apart across its blocks. Vertices
+    // whose position is still shared by other vertices are seams. Edges are matched by position, an edge without its
+    // opposite is a border, one used twice in the same direction is non-manifold. Degenerate triangles are dropped,
+    // they would make an edge of a vertex to itself.
+    void WeldAndLock()
+    {
+        auto vertex_count = m_positions.size();
+        auto order        = std::vector<uint32_t>(vertex_count);
+        auto groups       = std::vector<uint32_t>(vertex_count);
+
+        std::iota(order.begin(), order.end(), 0u);
+
+        auto less = [&](uint32_t a, uint32_t b) {
+            const auto& p = m_positions[a];
+            const auto& q = m_positions[b];
+            return p.x != q.x ? p.x < q.x : (p.y != q.y ? p.y < q.y : p.z < q.z);
+        };
+        std::ranges::sort(order, less);
+
+        auto locked_groups = std::vector<bool>{};
+        auto canonical     = std::vector<uint32_t>(vertex_count);
+        auto group_start   = size_t{ 0 };
+
+        std::iota(canonical.begin(), canonical.end(), 0u);
+
+        for (size_t i = 0; i != vertex_count; ++i) {
+            auto v = order[i];
+
+            if (i == 0 || m_positions[v] != m_positions[order[i - 1]]) {
+                locked_groups.push_back(false);
+                group_start = i;
+            } else {
+                auto vertex = VertexPN(m_positions[v], m_normals[v]);
+                for (auto j = group_start; j != i; ++j) {
+                    auto u = order[j];
+                    if (canonical[u] == u && VertexPN(m_positions[u], m_normals[u]) == vertex) {
+                        canonical[v] = u;
+                        break;
+                    }
+                }
+                locked_groups.back() = locked_groups.back() || canonical[v] == v;
+            }
+            groups[v] = static_cast<uint32_t>(locked_groups.size() - 1);
+        }
+
+        auto count = size_t{ 0 };
+        for (size_t i = 0; i + 2 < m_indices.size(); i += 3) {
+            auto a = canonical[m_indices[i + 0]];
+            auto b = canonical[m_indices[i + 1]];
+            auto c = canonical[m_indices[i + 2]];
+            if (a != b && b != c && c != a) {
+                m_indices[count++] = a;
+                m_indices[count++] = b;
+                m_indices[count++] = c;
+            }
+        }
+        m_indices.resize(count);
+
+        auto edges = std::vector<uint64_t>{};
+        edges.reserve(m_indices.size());
+
+        for (size_t t = 0; t != TriangleCount(); ++t) {
+            auto triangle = Corners(t);
+            for (size_t k = 0; k != 3; ++k) {
+                auto a = uint64_t{ groups[triangle[k]] };
+                auto b = uint64_t{ groups[triangle[(k + 1) % 3]] };
+                edges.push_back(a << 32 | b);
+            }
+        }
+        std::ranges::sort(edges);
+
+        for (size_t i = 0; i != edges.size(); ++i) {
+            auto a = static_cast<uint32_t>(edges[i] >> 32);
+            auto b = static_cast<uint32_t>(edges[i]);
+
+            auto is_duplicate = (i != 0 && edges[i - 1] == edges[i]);
+            auto is_border    = !std::ranges::binary_search(edges, uint64_t{ b } << 32 | a);
+
+            if (is_duplicate || is_border) {
+                locked_groups[a] = true;
+                locked_groups[b] = true;
+            }
+        }
+
+        m_locked.resize(vertex_count);
+        for (size_t v = 0; v != vertex_count; ++v) {
+            m_locked[v] = locked_groups[groups[v]];
+        }
+    }
+
+    void ComputeQuadrics()
+    {
+        m_quadrics.assign(m_positions.size(), Quadric{});
+
+        for (size_t t = 0; t != TriangleCount(); ++t) {
+            auto triangle = Corners(t);
+            auto p0       = m_positions[triangle[0]];
+            auto normal   = glm::cross(m_positions[triangle[1]] - p0, m_positions[triangle[2]] - p0);
+            auto length   = std::sqrt(glm::dot(normal, normal));
+
+            if (length == 0.0f) {
+                continue;
+            }
+
+            normal /= length;
+
+            auto plane = Quadric::FromPlane(normal, -static_cast<double>(glm::dot(normal, p0)), 0.5 * length);
+            for (auto v : triangle) {
+                m_quadrics[v] = m_quadrics[v] + plane;
+            }
+        }
+    }
+
+    auto Evaluate(uint32_t from, uint32_t to) const noexcept
+    {
+        auto error = (m_quadrics[from] + m_quadrics[to]).Evaluate(m_positions[to]);
+        auto delta = m_normals[from] - m_normals[to];
+
+        return Collapse{ from, to, error + kNormalWeight * static_cast<double>(glm::dot(delta, delta)), error };
+    }
+
+    // Applies the cheapest collapses that do not share a vertex, until 'goal' triangles are removed. Returns false if
+    // no collapse was possible.
+    bool CollapsePass(size_t goal, double max_error_squared)
+    {
+        auto vertex_count   = m_positions.size();
+        auto triangle_count = TriangleCount();
+
+        // Triangles of every vertex
+        auto offsets   = std::vector<uint32_t>(vertex_count + 1);
+        auto adjacency = std::vector<uint32_t>(m_indices.size());
+
+        for (auto v : m_indices) {
+            ++offsets[v + 1];
+        }
+        std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+        {
+            auto cursors = std::vector<uint32_t>(offsets.begin(), offsets.end() - 1);
+            for (size_t i = 0; i != m_indices.size(); ++i) {
+                adjacency[cursors[m_indices[i]]++] = static_cast<uint32_t>(i / 3);
+            }
+        }
+
+        // Every interior edge is seen from its two triangles in opposite directions, keep the ascending one. Both ends
+        // of a border edge are locked.
+        auto collapses = std::vector<Collapse>{};
+
+        for (size_t t = 0; t != triangle_count; ++t) {
+            auto triangle = Corners(t);
+            for (size_t k = 0; k != 3; ++k) {
+                auto a = triangle[k];
+                auto b = triangle[(k + 1) % 3];
+                if (a > b || (m_locked[a] && m_locked[b])) {
+                    continue;
+                }
+                if (m_locked[a]) {
+                    collapses.push_back(Evaluate(b, a));
+                } else if (m_locked[b]) {
+                    collapses.push_back(Evaluate(a, b));
+                } else {
+                    auto ab = Evaluate(a, b);
+                    auto ba = Evaluate(b, a);
+                    collapses.push_back(ab.cost <= ba.cost ? ab : ba);
+                }
+            }
+        }
+
+        std::ranges::sort(collapses, {}, &Collapse::cost);
+
+        auto remap   = std::vector<uint32_t>(vertex_count);
+        auto touched = std::vector<bool>(vertex_count, false);
+        auto removed = size_t{ 0 };
+
+        std::iota(remap.begin(), remap.end(), 0u);
+
+        for (const auto& [from, to, cost, error] : collapses) {
+            if (removed >= goal) {
+                break;
+            }
+            if (touched[from] || touched[to] || error > max_error_squared) {
+                continue;
+            }
+
+            // Triangles of 'from' either contain 'to' and disappear, or keep their orientation
+            auto collapsed = size_t{ 0 };
+            auto is_flip   = false;
+
+            for (auto i = offsets[from]; i != offsets[from + 1] && !is_flip; ++i) {
+                auto corners = std::array<uint32_t, 3>{};
+                std::ranges::transform(Corners(adjacency[i]), corners.begin(), [&](auto v) { return remap[v]; });
+
+                if (corners[0] == corners[1] || corners[1] == corners[2] || corners[2] == corners[0]) {
+                    continue;
+                }
+                if (std::ranges::find(corners, to) != corners.end()) {
+                    ++collapsed;
+                    continue;
+                }
+
+                auto normal = [&]() {
+                    auto p0 = m_positions[corners[0]];
+                    return glm::cross(m_positions[corners[1]] - p0, m_positions[corners[2]] - p0);
+                };
+
+                auto before = normal();
+                std::ranges::replace(corners, from, to);
+                auto after = normal();
+
+                auto limit = kMinFlipCosine * std::sqrt(glm::dot(before, before) * glm::dot(after, after));
+                is_flip    = glm::dot(before, after) <= limit;
+            }
+
+            if (is_flip) {
+                continue;
+            }
+
+            remap[from]   = to;
+            touched[from] = true;
+            touched[to]   = true;
+
+            m_quadrics[to] = m_quadrics[to] + m_quadrics[from];
+            m_error        = std::max(m_error, error);
+
+            removed += collapsed;
+        }
+
+        if (removed == 0) {
+            return false;
+        }
+
+        auto kept = size_t{ 0 };
+        for (size_t t = 0; t != triangle_count; ++t) {
+            auto a = remap[m_indices[3 * t + 0]];
+            auto b = remap[m_indices[3 * t + 1]];
+            auto c = remap[m_indices[3 * t + 2]];
+            if (a != b && b != c && c != a) {
+                m_indices[kept++] = a;
+                m_indices[kept++] = b;
+                m_indices[kept++] = c;
+            }
+        }
+        m_indices.resize(kept);
+
+        return true;
+    }
+
+    std::vector<uint32_t>  m_vertices; // Local vertex -> geometry vertex
+    std::vector<uint32_t>  m_indices;  // Current level in local vertices
+    std::vector<glm::vec3> m_positions;
+    std::vector<glm::vec3> m_normals;
+    std::vector<Quadric>   m_quadrics;
+    std::vector<bool>      m_locked;
+    double                 m_error = 0.0; // Squared
+};
+
+struct LodLevel final {
+    std::vector<uint32_t> indices;
+    float                 error{};
+};
+
+} // namespace
+
+SimplifierReport BuildLods(Geometry* geometry, const SimplifierOptions& options, ThreadPool* thread_pool)
+{
+    auto meshes = std::vector<MeshRecord*>{};
+
+    for (auto& shape : geometry->shapes) {
+        for (auto& mesh : shape.meshes) {
+            meshes.push_back(&mesh);
+        }
+    }
+
+    auto chains = std::vector<std::vector<LodLevel>>(meshes.size());
+
+    auto simplify_mesh = [&](size_t m) {
+        const auto& mesh = *meshes[m];
+
+        if (mesh.index_count / 3 < options.min_triangles) {
+            return;
+        }
+
+        auto indices    = std::span(geometry->indices).subspan(mesh.first_index, mesh.index_count);
+        auto simplifier = MeshSimplifier(indices, geometry->vertices, mesh.aabb);
+        auto previous   = simplifier.TriangleCount();
+
+        for (size_t level = 0; level != options.max_levels && previous > options.min_triangles; ++level) {
+            auto target = static_cast<size_t>(static_cast<double>(previous) * static_cast<double>(options.reduction));
+
+            simplifier.Simplify(3 * std::max(target, options.min_triangles), options.max_error);
+
+            auto triangle_count = simplifier.TriangleCount();
+            if (static_cast<double>(triangle_count) > static_cast<double>(previous) * (1.0 - kMinLevelReduction)) {
+                break;
+            }
+
+            chains[m].push_back({ simplifier.Indices(), simplifier.Error() });
+            previous = triangle_count;
+        }
+    };
+
+    ParallelFor(thread_pool, meshes.size(), simplify_mesh);
+
+    auto report = SimplifierReport{};
+
+    geometry->lods.clear();
+
+    for (size_t m = 0; m != meshes.size(); ++m) {
+        auto& mesh = *meshes[m];
+
+        mesh.first_lod = geometry->lods.size();
+        mesh.lod_count = chains[m].size();
+
+        for (size_t level = 0; level != chains[m].size(); ++level) {
+            const auto& [indices, error] = chains[m][level];
+
+            geometry->lods.push_back({ geometry->indices.size(), indices.size(), error });
+            geometry->indices.insert(geometry->indices.end(), indices.begin(), indices.end());
+
+            if (report.levels.size() == level) {
+                report.levels.emplace_back();
+            }
+
+            auto& stats = report.levels[level];
+
+            stats.mesh_count += 1;
+            stats.triangle_count += indices.size() / 3;
+            stats.max_error = std::max(stats.max_error, error);
+            stats.mean_error += error;
+        }
+
+        chains[m] = {};
+    }
+
+    for (auto& stats : report.levels) {
+        stats.mean_error /= static_cast<float>(stats.mesh_count);
+    }
+
+    return report;
+}
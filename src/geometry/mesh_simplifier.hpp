@@ -0,0 +1,36 @@
+#pragma once
+
+#include "geometry.hpp"
+
+#include <cstddef>
+#include <vector>
+
+class ThreadPool;
+
+struct SimplifierOptions final {
+    size_t max_levels    = 4;     // Simplified levels per mesh at most
+    float  reduction     = 0.5f;  // Target triangle count of a level relative to the previous level
+    size_t min_triangles = 256;   // Meshes with fewer triangles are not simplified, and no level goes below it
+    float  max_error     = 0.05f; // Largest error of a level, relative to the largest extent of its mesh
+};
+
+// One level of the LOD chains of all meshes
+struct LodLevelStats final {
+    size_t mesh_count     = 0; // Meshes that have this level
+    size_t triangle_count = 0;
+    float  max_error      = 0.0f;
+    float  mean_error     = 0.0f;
+};
+
+struct SimplifierReport final {
+    std::vector<LodLevelStats> levels; // levels[i] is the i-th simplified level, the full resolution one excluded
+};
+
+// Builds a chain of simplified levels for every mesh record of 'geometry'. Every level scales the triangle count of the
+// previous one by 'options.reduction', collapsing edges onto one of their vertices in the order of the quadric error
+// metric plus a penalty for the change of the vertex normal, so the LODs reuse the vertices of their mesh.
+// Collapses that flip a triangle are rejected. Vertices on mesh borders and on attribute seams, where several vertices
+// share a position, never move, which keeps the chains free of cracks between meshes and of torn normals.
+// The LOD indices are appended to geometry->indices, which must not hold LODs yet, and the chains replace
+// geometry->lods. Meshes are simplified in parallel.
+auto BuildLods(Geometry* geometry, const SimplifierOptions& options, ThreadPool* thread_pool) -> SimplifierReport;
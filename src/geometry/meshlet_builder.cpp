@@ -0,0 +1,464 @@
+#include "meshlet_builder.hpp"
+
+#include "mesh_optimizer.hpp"
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+namespace {
+
+constexpr uint32_t kNone = std::numeric_limits<uint32_t>::max();
+
+// Triangles per independently partitioned piece of a mesh record
+constexpr size_t kPieceTriangleCount = size_t{ 1 } << 16;
+
+// Normal cones whose largest angle to a face normal has a cosine below this are too wide to be worth testing
+constexpr float kMinConeCosine = 0.1f;
+
+struct MeshletRange final {
+    size_t first_triangle;
+    size_t triangle_count;
+    size_t vertex_count;
+};
+
+float DistanceSquared(const glm::vec3& a, const glm::vec3& b) noexcept
+{
+    auto d = a - b;
+    return glm::dot(d, d);
+}
+
+// Reorders the triangles of 'indices', whose vertices are numbered [0, positions.size()), meshlet by meshlet and
+// returns the meshlets
+auto PartitionTriangles(
+    std::span<uint32_t>        indices,
+    std::span<const glm::vec3> positions,
+    const MeshletOptions&      options) -> std::vector<MeshletRange>
+{
+    auto triangle_count = indices.size() / 3;
+    auto vertex_count   = positions.size();
+
+    // Triangles of every vertex
+    auto offsets   = std::vector<uint32_t>(vertex_count + 1);
+    auto adjacency = std::vector<uint32_t>(indices.size());
+
+    for (auto v : indices) {
+        ++offsets[v + 1];
+    }
+    for (size_t v = 0; v != vertex_count; ++v) {
+        offsets[v + 1] += offsets[v];
+    }
+
+    auto live_counts = std::vector<uint32_t>(vertex_count);
+    for (size_t v = 0; v != vertex_count; ++v) {
+        live_counts[v] = offsets[v + 1] - offsets[v];
+    }
+
+    {
+        auto cursors = std::vector<uint32_t>(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i != indices.size(); ++i) {
+            adjacency[cursors[indices[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+    }
+
+    auto emitted  = std::vector<bool>(triangle_count, false);
+    auto owner    = std::vector<uint32_t>(vertex_count, kNone); // Last meshlet that a vertex has been added to
+    auto vertices = std::vector<uint32_t>{};                    // Vertices of the current meshlet
+    auto order    = std::vector<uint32_t>{};
+    auto meshlets = std::vector<MeshletRange>{};
+    auto cursor   = size_t{ 0 };
+
+    order.reserve(triangle_count);
+
+    auto corners = [&](size_t t) { return std::span<const uint32_t>(indices.data() + 3 * t, 3); };
+
+    while (order.size() != triangle_count) {
+        auto meshlet_id = static_cast<uint32_t>(meshlets.size());
+        auto first      = order.size();
+        auto sum        = glm::vec3(0.0f);
+
+        vertices.clear();
+
+        auto new_vertex_count = [&](size_t t) {
+            auto count = size_t{ 0 };
+            for (auto v : corners(t)) {
+                count += (owner[v] != meshlet_id);
+            }
+            return count;
+        };
+
+        auto add = [&](size_t t) {
+            emitted[t] = true;
+            order.push_back(static_cast<uint32_t>(t));
+            for (auto v : corners(t)) {
+                --live_counts[v];
+                if (owner[v] != meshlet_id) {
+                    owner[v] = meshlet_id;
+                    vertices.push_back(v);
+                    sum += positions[v];
+                }
+            }
+        };
+
+        while (emitted[cursor]) {
+            ++cursor;
+        }
+        add(cursor);
+
+        while (order.size() - first < options.max_triangles) {
+            auto center        = sum / static_cast<float>(vertices.size());
+            auto best          = size_t{ kNone };
+            auto best_new      = size_t{ 4 };
+            auto best_distance = std::numeric_limits<float>::max();
+
+            // Candidates are the live triangles around the vertices of the meshlet
+            for (auto v : vertices) {
+                if (live_counts[v] == 0) {
+                    continue;
+                }
+                for (auto i = offsets[v]; i != offsets[v + 1]; ++i) {
+                    auto t = adjacency[i];
+                    if (emitted[t]) {
+                        continue;
+                    }
+
+                    auto new_count = new_vertex_count(t);
+                    if (vertices.size() + new_count > options.max_vertices || new_count > best_new) {
+                        continue;
+                    }
+
+                    auto triangle = corners(t);
+                    auto centroid = (positions[triangle[0]] + positions[triangle[1]] + positions[triangle[2]]) / 3.0f;
+                    auto distance = DistanceSquared(centroid, center);
+
+                    if (new_count < best_new || distance < best_distance) {
+                        best          = t;
+                        best_new      = new_count;
+                        best_distance = distance;
+                    }
+                }
+            }
+
+            // Nothing connected is left, continue with the next triangle in index order, which the vertex cache
+            // optimization has left close by
+            if (best == kNone) {
+                while (cursor != triangle_count && emitted[cursor]) {
+                    ++cursor;
+                }
+                if (cursor == triangle_count || vertices.size() + new_vertex_count(cursor) > options.max_vertices) {
+                    break;
+                }
+                best = cursor;
+            }
+
+            add(best);
+        }
+
+        meshlets.push_back({ first, order.size() - first, vertices.size() });
+    }
+
+    auto reordered = std::vector<uint32_t>(indices.size());
+    for (size_t i = 0; i != order.size(); ++i) {
+        std::ranges::copy(corners(order[i]), reordered.begin() + static_cast<std::ptrdiff_t>(3 * i));
+    }
+    std::ranges::copy(reordered, indices.begin());
+
+    // The growth order of a meshlet does not suit the vertex cache, optimize every meshlet on its own vertex numbering
+    auto slots = std::move(owner);
+    std::ranges::fill(slots, kNone);
+
+    for (const auto& [first_triangle, meshlet_triangles, meshlet_vertices] : meshlets) {
+        auto meshlet_indices = indices.subspan(3 * first_triangle, 3 * meshlet_triangles);
+
+        vertices.clear();
+        for (auto& index : meshlet_indices) {
+            if (slots[index] == kNone) {
+                slots[index] = static_cast<uint32_t>(vertices.size());
+                vertices.push_back(index);
+            }
+            index = slots[index];
+        }
+
+        OptimizeVertexCache(meshlet_indices, vertices.size());
+
+        for (auto& index : meshlet_indices) {
+            index = vertices[index];
+        }
+        for (auto vertex : vertices) {
+            slots[vertex] = kNone;
+        }
+    }
+
+    return meshlets;
+}
+
+struct Piece final {
+    size_t    mesh; // Number of the mesh record in shape order
+    size_t    first_index;
+    size_t    index_count;
+    glm::vec3 center; // Of the bounding box of the mesh record
+};
+
+} // namespace
+
+auto ComputeClusterBounds(std::span<const uint32_t> indices, std::span<const VertexPN> vertices) -> ClusterBounds
+{
+    auto bounds = ClusterBounds{};
+
+    if (indices.empty()) {
+        return bounds;
+    }
+
+    auto position = [&](uint32_t index) { return vertices[index].position; };
+
+    // Ritter's sphere: start from two distant points and grow the sphere to include the points outside of it
+    auto farthest = [&](const glm::vec3& from) {
+        auto result = position(indices[0]);
+        for (auto index : indices) {
+            if (DistanceSquared(position(index), from) > DistanceSquared(result, from)) {
+                result = position(index);
+            }
+        }
+        return result;
+    };
+
+    auto a = farthest(position(indices[0]));
+    auto b = farthest(a);
+
+    auto center = 0.5f * (a + b);
+    auto radius = 0.5f * std::sqrt(DistanceSquared(a, b));
+
+    for (auto index : indices) {
+        auto distance = std::sqrt(DistanceSquared(position(index), center));
+        if (distance > radius) {
+            auto grown = 0.5f * (radius + distance);
+            center += (position(index) - center) * ((grown - radius) / distance);
+            radius = grown;
+        }
+    }
+
+    bounds.center = center;
+    bounds.radius = radius;
+
+    // Normal cone around the average face normal. Degenerate triangles have no normal and do not count.
+    auto normals = std::vector<glm::vec3>{};
+    auto sum     = glm::vec3(0.0f);
+
+    normals.reserve(indices.size() / 3);
+
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        auto p0     = position(indices[i + 0]);
+        auto normal = glm::cross(position(indices[i + 1]) - p0, position(indices[i + 2]) - p0);
+        auto length = std::sqrt(glm::dot(normal, normal));
+        if (length > 0.0f) {
+            normals.push_back(normal / length);
+            sum += normals.back();
+        }
+    }
+
+    auto sum_length = std::sqrt(glm::dot(sum, sum));
+    if (sum_length == 0.0f) {
+        return bounds;
+    }
+
+    auto axis    = sum / sum_length;
+    auto min_dot = 1.0f;
+    for (const auto& normal : normals) {
+        min_dot = std::min(min_dot, glm::dot(normal, axis));
+    }
+
+    bounds.cone_axis   = axis;
+    bounds.cone_cutoff = min_dot < kMinConeCosine ? 1.0f : std::sqrt(1.0f - min_dot * min_dot);
+
+    return bounds;
+}
+
+bool IsBackFacing(const ClusterBounds& bounds, const glm::vec3& eye) noexcept
+{
+    auto offset = bounds.center - eye;
+
+    return bounds.cone_cutoff < 1.0f &&
+           glm::dot(offset, bounds.cone_axis) >= bounds.cone_cutoff * glm::length(offset) + bounds.radius;
+}
+
+ClusterBounds MergeClusterBounds(std::span<const ClusterBounds> clusters)
+{
+    auto bounds = ClusterBounds{};
+
+    if (clusters.empty()) {
+        return bounds;
+    }
+
+    auto center = clusters[0].center;
+    auto radius = clusters[0].radius;
+    auto sum    = glm::vec3(0.0f);
+
+    for (const auto& cluster : clusters) {
+        auto distance = std::sqrt(DistanceSquared(cluster.center, center));
+        if (distance + cluster.radius > radius) {
+            auto grown = 0.5f * (radius + distance + cluster.radius);
+            if (distance > 0.0f) {
+                center += (cluster.center - center) * ((grown - radius) / distance);
+            }
+            radius = grown;
+        }
+        sum += cluster.cone_axis;
+    }
+
+    bounds.center = center;
+    bounds.radius = radius;
+
+    auto sum_length = std::sqrt(glm::dot(sum, sum));
+    if (sum_length == 0.0f) {
+        return bounds;
+    }
+
+    // The cone has to reach the edge of every cluster cone, the angle to its axis plus its own half angle
+    auto axis      = sum / sum_length;
+    auto max_angle = 0.0f;
+    for (const auto& cluster : clusters) {
+        if (cluster.cone_cutoff >= 1.0f) {
+            return bounds;
+        }
+        auto angle = std::acos(std::clamp(glm::dot(cluster.cone_axis, axis), -1.0f, 1.0f));
+        max_angle  = std::max(max_angle, angle + std::asin(cluster.cone_cutoff));
+    }
+
+    if (std::cos(max_angle) < kMinConeCosine) {
+        return bounds;
+    }
+
+    bounds.cone_axis   = axis;
+    bounds.cone_cutoff = std::sin(max_angle);
+
+    return bounds;
+}
+
+MeshletReport BuildMeshlets(Geometry* geometry, const MeshletOptions& options, ThreadPool* thread_pool)
+{
+    auto pieces     = std::vector<Piece>{};
+    auto mesh_count = size_t{ 0 };
+
+    for (const auto& shape : geometry->shapes) {
+        for (const auto& mesh : shape.meshes) {
+            auto min    = glm::vec3(mesh.aabb.min.x, mesh.aabb.min.y, mesh.aabb.min.z);
+            auto max    = glm::vec3(mesh.aabb.max.x, mesh.aabb.max.y, mesh.aabb.max.z);
+            auto center = 0.5f * (min + max);
+
+            for (size_t first = 0; first < mesh.index_count; first += 3 * kPieceTriangleCount) {
+                auto count = std::min(mesh.index_count - first, 3 * kPieceTriangleCount);
+                pieces.push_back({ mesh_count, mesh.first_index + first, count, center });
+            }
+            ++mesh_count;
+        }
+    }
+
+    auto piece_meshlets = std::vector<MeshletRecords>(pieces.size());
+    auto piece_vertices = std::vector<size_t>(pieces.size());
+    auto piece_stats    = std::vector<VertexCacheStats>(pieces.size());
+
+    auto partition_piece = [&](size_t p) {
+        auto indices = std::span(geometry->indices).subspan(pieces[p].first_index, pieces[p].index_count);
+
+        // Number the vertices of the piece compactly, so the per vertex state is proportional to the piece
+        auto ids = std::vector<uint32_t>(indices.begin(), indices.end());
+        std::ranges::sort(ids);
+        ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
+        auto local     = std::vector<uint32_t>(indices.size());
+        auto positions = std::vector<glm::vec3>(ids.size(), glm::vec3(0.0f));
+
+        for (size_t i = 0; i != indices.size(); ++i) {
+            local[i] = static_cast<uint32_t>(std::ranges::lower_bound(ids, indices[i]) - ids.begin());
+        }
+        for (size_t v = 0; v != ids.size(); ++v) {
+            positions[v] = geometry->vertices[ids[v]].position;
+        }
+
+        auto ranges = PartitionTriangles(local, positions, options);
+
+        for (size_t i = 0; i != indices.size(); ++i) {
+            indices[i] = ids[local[i]];
+        }
+
+        // Outward facing meshlets first, which keeps the overdraw order of OptimizeGeometry at the meshlet level
+        if (options.overdraw && ranges.size() > 1) {
+            auto keys = std::vector<float>(ranges.size());
+            for (size_t r = 0; r != ranges.size(); ++r) {
+                auto meshlet_indices = indices.subspan(3 * ranges[r].first_triangle, 3 * ranges[r].triangle_count);
+                keys[r]              = ComputeOverdrawKey(meshlet_indices, geometry->vertices, pieces[p].center);
+            }
+
+            auto order = std::vector<size_t>(ranges.size());
+            std::iota(order.begin(), order.end(), size_t{ 0 });
+            std::ranges::stable_sort(order, std::greater{}, [&keys](size_t r) { return keys[r]; });
+
+            auto sorted_indices = std::vector<uint32_t>{};
+            auto sorted_ranges  = std::vector<MeshletRange>{};
+
+            sorted_indices.reserve(indices.size());
+            sorted_ranges.reserve(ranges.size());
+
+            for (auto r : order) {
+                const auto& range           = ranges[r];
+                auto        meshlet_indices = indices.subspan(3 * range.first_triangle, 3 * range.triangle_count);
+
+                sorted_ranges.push_back({ sorted_indices.size() / 3, range.triangle_count, range.vertex_count });
+                sorted_indices.insert(sorted_indices.end(), meshlet_indices.begin(), meshlet_indices.end());
+            }
+
+            std::ranges::copy(sorted_indices, indices.begin());
+            ranges = std::move(sorted_ranges);
+        }
+
+        piece_stats[p] = AnalyzeVertexCache(indices);
+
+        auto& meshlets = piece_meshlets[p];
+        meshlets.reserve(ranges.size());
+
+        for (const auto& [first_triangle, triangle_count, vertex_count] : ranges) {
+            auto meshlet_indices = indices.subspan(3 * first_triangle, 3 * triangle_count);
+
+            meshlets.push_back({ .first_index = pieces[p].first_index + 3 * first_triangle,
+                                 .index_count = 3 * triangle_count,
+                                 .bounds      = ComputeClusterBounds(meshlet_indices, geometry->vertices) });
+            piece_vertices[p] += vertex_count;
+        }
+    };
+
+    ParallelFor(thread_pool, pieces.size(), partition_piece);
+
+    auto report = MeshletReport{};
+    auto piece  = size_t{ 0 };
+    auto number = size_t{ 0 };
+
+    geometry->meshlets.clear();
+
+    for (auto& shape : geometry->shapes) {
+        for (auto& mesh : shape.meshes) {
+            mesh.first_meshlet = geometry->meshlets.size();
+
+            for (; piece != pieces.size() && pieces[piece].mesh == number; ++piece) {
+                for (const auto& meshlet : piece_meshlets[piece]) {
+                    geometry->meshlets.push_back(meshlet);
+                    report.triangle_count += meshlet.index_count / 3;
+                    report.cone_count += (meshlet.bounds.cone_cutoff < 1.0f);
+                }
+                report.vertex_count += piece_vertices[piece];
+                report.vertex_cache += piece_stats[piece];
+            }
+
+            mesh.meshlet_count = geometry->meshlets.size() - mesh.first_meshlet;
+            ++number;
+        }
+    }
+
+    report.meshlet_count = geometry->meshlets.size();
+
+    return report;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "geometry.hpp"
+#include "mesh_optimizer.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+class ThreadPool;
+
+struct MeshletOptions final {
+    size_t max_vertices  = 64;
+    size_t max_triangles = 124;
+    bool   overdraw      = true; // Order meshlets like the clusters of the overdraw optimization, see OptimizeGeometry
+};
+
+struct MeshletReport final {
+    size_t meshlet_count  = 0;
+    size_t vertex_count   = 0; // Summed over the meshlets, a vertex shared by several meshlets counts once for each
+    size_t triangle_count = 0;
+    size_t cone_count     = 0; // Meshlets whose normal cone is narrow enough to cull them
+
+    VertexCacheStats vertex_cache; // Of the reordered index ranges
+};
+
+// Bounding sphere and normal cone of the triangles 'indices'. Seen from 'eye', all of the triangles face away if
+// dot(center - eye, cone_axis) >= cone_cutoff * length(center - eye) + radius.
+auto ComputeClusterBounds(std::span<const uint32_t> indices, std::span<const VertexPN> vertices) -> ClusterBounds;
+
+// True if all triangles within 'bounds' face away from 'eye', the test described above
+auto IsBackFacing(const ClusterBounds& bounds, const glm::vec3& eye) noexcept -> bool;
+
+// Bounds that enclose all of 'clusters'. The sphere is grown over the cluster spheres, the cone is widened over the
+// cluster cones around their average axis, so the result is looser than the bounds of the triangles themselves.
+auto MergeClusterBounds(std::span<const ClusterBounds> clusters) -> ClusterBounds;
+
+// Partitions every mesh record of 'geometry' into meshlets of at most 'options.max_vertices' vertices and
+// 'options.max_triangles' triangles. A meshlet grows from a seed triangle over the triangles that add the fewest new
+// vertices, ties going to the one closest to its center, which keeps meshlets compact and their bounds tight.
+// Triangles are reordered within their mesh record so that every meshlet is a contiguous index range, and the meshlets
+// replace geometry->meshlets. Every meshlet is optimized for the vertex cache on its own, and with 'options.overdraw'
+// the meshlets of a piece are ordered by ComputeOverdrawKey, which takes the place of the triangle order of
+// OptimizeGeometry. The vertices are left as they are, so OptimizeVertexFetch is to run afterwards. Large records are
+// processed in parallel pieces, like in OptimizeGeometry.
+auto BuildMeshlets(Geometry* geometry, const MeshletOptions& options, ThreadPool* thread_pool) -> MeshletReport;
@@ -0,0 +1,341 @@
+#include "normal_generator.hpp"
+
+#include "thread_pool.hpp"
+#include "utils/misc.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <span>
+#include <tuple>
+#include <vector>
+
+namespace {
+
+constexpr size_t kBlockSize = size_t{ 1 } << 16;
+
+// Calls 'function' with the bounds of every block of [0, count), in parallel if a thread pool is available and there
+// is more than one block
+void ForEachBlock(size_t count, ThreadPool* thread_pool, const std::function<void(size_t, size_t)>& function)
+{
+    auto block_count = (count + kBlockSize - 1) / kBlockSize;
+
+    auto run_block = [&](size_t block) { function(block * kBlockSize, std::min(count, (block + 1) * kBlockSize)); };
+
+    ParallelFor(block_count < 2 ? nullptr : thread_pool, block_count, run_block);
+}
+
+glm::vec3 SafeNormalize(const glm::vec3& vector) noexcept
+{
+    auto length = glm::length(vector);
+    return length > 0.0f ? vector / length : glm::vec3(0.0f, 0.0f, 0.0f);
+}
+
+// Angle at 'p0' of the triangle (p0, p1, p2)
+float CornerAngle(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2) noexcept
+{
+    auto cosine = glm::dot(SafeNormalize(p1 - p0), SafeNormalize(p2 - p0));
+    return std::acos(std::clamp(cosine, -1.0f, 1.0f));
+}
+
+// Bitwise lexicographic order of unit normals, which is a total order even for NaN
+bool DirectionLess(const glm::vec3& lhs, const glm::vec3& rhs) noexcept
+{
+    auto bits = [](const glm::vec3& v) {
+        return std::tuple(std::bit_cast<uint32_t>(v.x), std::bit_cast<uint32_t>(v.y), std::bit_cast<uint32_t>(v.z));
+    };
+    return bits(lhs) < bits(rhs);
+}
+
+// Computes the normals of the corners of one vertex and groups equal normals. 'corners' holds the positions of the
+// corners in the index array. Compute stores the group of each corner in 'groups', GetNormals returns the normal of
+// each group.
+//
+// Corners whose faces have bitwise equal directions always get the same normal, so they are merged into one direction
+// first, which turns a fan of coplanar faces into a single direction however many faces it has. The directions are
+// then compared pairwise, unless there are more than kMaxDirections of them, e.g. at the pole of a finely tessellated
+// sphere. All of them are then smoothed together if they lie within half the crease angle of their mean, since every
+// pair is within the crease angle then, and otherwise each direction keeps its own normal.
+class CornerNormals final {
+  public:
+    static constexpr size_t kMaxDirections = 256;
+
+    CornerNormals(
+        const Geometry&            geometry,
+        std::span<const glm::vec3> face_normals,
+        const NormalOptions&       options) noexcept
+        : m_geometry(geometry), m_face_normals(face_normals), m_options(options),
+          m_min_cosine(std::cos(options.crease_angle)), m_min_half_cosine(std::cos(0.5f * options.crease_angle))
+    {}
+
+    void Compute(std::span<const uint32_t> corners, std::span<uint32_t> groups)
+    {
+        constexpr auto kNoGroup = std::numeric_limits<uint32_t>::max();
+
+        const auto& vertices = m_geometry.vertices;
+        const auto& indices  = m_geometry.indices;
+
+        m_units.clear();
+        m_weighted.clear();
+        m_order.clear();
+        m_corner_directions.resize(corners.size());
+        m_directions.clear();
+        m_direction_weights.clear();
+        m_direction_groups.clear();
+        m_normals.clear();
+
+        for (auto corner : corners) {
+            auto face   = corner / 3;
+            auto normal = m_face_normals[face];
+
+            m_units.push_back(SafeNormalize(normal));
+
+            if (m_options.weighting == NormalWeighting::Area) {
+                m_weighted.push_back(normal);
+            } else {
+                auto first = 3 * size_t{ face };
+                auto p0    = vertices[indices[corner]].position;
+                auto p1    = vertices[indices[first + (corner - first + 1) % 3]].position;
+                auto p2    = vertices[indices[first + (corner - first + 2) % 3]].position;
+                m_weighted.push_back(CornerAngle(p0, p1, p2) * m_units.back());
+            }
+        }
+
+        m_order.resize(corners.size());
+        std::iota(m_order.begin(), m_order.end(), uint32_t{ 0 });
+        std::ranges::sort(m_order, [this](uint32_t lhs, uint32_t rhs) {
+            const auto& a = m_units[lhs];
+            const auto& b = m_units[rhs];
+            return DirectionLess(a, b) || (!DirectionLess(b, a) && lhs < rhs);
+        });
+
+        for (auto i : m_order) {
+            if (m_directions.empty() || DirectionLess(m_directions.back(), m_units[i])) {
+                m_directions.push_back(m_units[i]);
+                m_direction_weights.push_back(glm::vec3(0.0f, 0.0f, 0.0f));
+            }
+            m_direction_weights.back() += m_weighted[i];
+            m_corner_directions[i] = static_cast<uint32_t>(m_directions.size() - 1);
+        }
+
+        auto direction_count = m_directions.size();
+        auto is_pairwise     = direction_count <= kMaxDirections;
+        auto total_weight    = std::accumulate(m_direction_weights.begin(), m_direction_weights.end(), glm::vec3(0.0f));
+        auto is_smooth       = false;
+
+        if (!is_pairwise) {
+            auto mean = SafeNormalize(std::accumulate(m_directions.begin(), m_directions.end(), glm::vec3(0.0f)));
+            is_smooth = std::ranges::all_of(m_directions, [&](const glm::vec3& direction) {
+                return direction == glm::vec3(0.0f, 0.0f, 0.0f) || glm::dot(direction, mean) >= m_min_half_cosine;
+            });
+        }
+
+        m_direction_groups.resize(direction_count, kNoGroup);
+
+        // Groups are numbered in the order of the corners, so the first corner is always in group 0
+        for (size_t i = 0; i != corners.size(); ++i) {
+            auto  d     = m_corner_directions[i];
+            auto& group = m_direction_groups[d];
+
+            if (group == kNoGroup) {
+                // Degenerate faces have no direction to compare with, their corners take the normal of the whole vertex
+                auto is_degenerate = m_directions[d] == glm::vec3(0.0f, 0.0f, 0.0f);
+                auto sum           = (is_degenerate || is_smooth) ? total_weight : m_direction_weights[d];
+
+                if (is_pairwise && !is_degenerate) {
+                    sum = glm::vec3(0.0f, 0.0f, 0.0f);
+                    for (size_t e = 0; e != direction_count; ++e) {
+                        if (glm::dot(m_directions[d], m_directions[e]) >= m_min_cosine) {
+                            sum += m_direction_weights[e];
+                        }
+                    }
+                }
+
+                auto normal = SafeNormalize(sum);
+
+                // Directions that see the same neighbours get bitwise equal sums, so only creases produce more than
+                // one group. Without the pairwise comparison every direction is a group of its own, unless all of
+                // them are smoothed together.
+                auto it = (is_pairwise || is_smooth) ? std::ranges::find(m_normals, normal) : m_normals.end();
+                if (it == m_normals.end()) {
+                    it = m_normals.insert(m_normals.end(), normal);
+                }
+                group = static_cast<uint32_t>(it - m_normals.begin());
+            }
+
+            groups[i] = group;
+        }
+    }
+
+    auto GetNormals() const noexcept -> std::span<const glm::vec3> { return m_normals; }
+
+  private:
+    const Geometry&            m_geometry;
+    std::span<const glm::vec3> m_face_normals;
+    const NormalOptions&       m_options;
+    float                      m_min_cosine;
+    float                      m_min_half_cosine;
+
+    std::vector<glm::vec3> m_units;             // Per corner
+    std::vector<glm::vec3> m_weighted;          // Per corner
+    std::vector<uint32_t>  m_order;             // Corners sorted by direction
+    std::vector<uint32_t>  m_corner_directions; // Per corner
+    std::vector<glm::vec3> m_directions;
+    std::vector<glm::vec3> m_direction_weights; // Sum of the weighted normals of the corners of every direction
+    std::vector<uint32_t>  m_direction_groups;
+    std::vector<glm::vec3> m_normals;
+};
+
+} // namespace
+
+size_t GenerateNormals(Geometry* geometry, const NormalOptions& options, ThreadPool* thread_pool)
+{
+    auto& vertices = geometry->vertices;
+    auto& indices  = geometry->indices;
+
+    utils::throw_runtime_error_if(
+        indices.size() > std::numeric_limits<uint32_t>::max(),
+        "Too many indices to generate normals");
+
+    auto vertex_count   = vertices.size();
+    auto triangle_count = indices.size() / 3;
+
+    auto is_missing    = std::vector<uint8_t>(vertex_count);
+    auto missing_count = std::atomic_size_t{ 0 };
+
+    ForEachBlock(vertex_count, thread_pool, [&](size_t begin, size_t end) {
+        auto count = size_t{ 0 };
+        for (auto v = begin; v != end; ++v) {
+            is_missing[v] = vertices[v].normal == glm::vec3(0.0f, 0.0f, 0.0f);
+            count += is_missing[v];
+        }
+        missing_count += count;
+    });
+
+    if (missing_count == 0) {
+        return 0;
+    }
+
+    // Corners of every vertex without a normal, as ranges of 'corners' delimited by 'offsets'. Corners are counted
+    // and placed concurrently, so the order inside a range is arbitrary until it is sorted.
+    auto offsets = std::vector<uint32_t>(vertex_count + 1);
+
+    ForEachBlock(indices.size(), thread_pool, [&](size_t begin, size_t end) {
+        for (auto i = begin; i != end; ++i) {
+            if (is_missing[indices[i]]) {
+                std::atomic_ref(offsets[indices[i]]).fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    });
+
+    std::exclusive_scan(offsets.begin(), offsets.end(), offsets.begin(), uint32_t{ 0 });
+
+    auto corners = std::vector<uint32_t>(offsets.back());
+    {
+        auto cursors = std::vector<uint32_t>(offsets.begin(), offsets.end() - 1);
+
+        ForEachBlock(indices.size(), thread_pool, [&](size_t begin, size_t end) {
+            for (auto i = begin; i != end; ++i) {
+                if (is_missing[indices[i]]) {
+                    auto slot     = std::atomic_ref(cursors[indices[i]]).fetch_add(1, std::memory_order_relaxed);
+                    corners[slot] = static_cast<uint32_t>(i);
+                }
+            }
+        });
+    }
+
+    // Unnormalized face normals, their length is twice the area of the face
+    auto face_normals = std::vector<glm::vec3>(triangle_count);
+
+    ForEachBlock(triangle_count, thread_pool, [&](size_t begin, size_t end) {
+        for (auto face = begin; face != end; ++face) {
+            auto p0 = vertices[indices[3 * face + 0]].position;
+            auto p1 = vertices[indices[3 * face + 1]].position;
+            auto p2 = vertices[indices[3 * face + 2]].position;
+
+            face_normals[face] = glm::cross(p1 - p0, p2 - p0);
+        }
+    });
+
+    // The first group of every vertex keeps the vertex, every further group gets a new vertex. 'first_split' starts
+    // out as the number of new vertices of each vertex and is turned into the first of them.
+    auto groups      = std::vector<uint32_t>(corners.size());
+    auto first_split = std::vector<size_t>(vertex_count + 1);
+
+    auto vertex_corners = [&](size_t v) { return std::span(corners).subspan(offsets[v], offsets[v + 1] - offsets[v]); };
+    auto vertex_groups  = [&](size_t v) { return std::span(groups).subspan(offsets[v], offsets[v + 1] - offsets[v]); };
+
+    ForEachBlock(vertex_count, thread_pool, [&](size_t begin, size_t end) {
+        auto corner_normals = CornerNormals(*geometry, face_normals, options);
+
+        for (auto v = begin; v != end; ++v) {
+            if (!is_missing[v]) {
+                continue;
+            }
+
+            std::ranges::sort(vertex_corners(v));
+
+            corner_normals.Compute(vertex_corners(v), vertex_groups(v));
+
+            auto normals = corner_normals.GetNormals();
+            if (!normals.empty()) {
+                vertices[v].normal = normals.front();
+                first_split[v]     = normals.size() - 1;
+            }
+        }
+    });
+
+    std::exclusive_scan(first_split.begin(), first_split.end(), first_split.begin(), vertex_count);
+
+    auto split_count = first_split.back() - vertex_count;
+    if (split_count == 0) {
+        return missing_count;
+    }
+
+    vertices.resize(vertex_count + split_count, VertexPN(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 0.0f)));
+
+    // The normals of the split vertices are computed again rather than kept for all vertices, since creases are rare
+    ForEachBlock(vertex_count, thread_pool, [&](size_t begin, size_t end) {
+        auto corner_normals = CornerNormals(*geometry, face_normals, options);
+        auto scratch        = std::vector<uint32_t>{};
+
+        for (auto v = begin; v != end; ++v) {
+            if (first_split[v + 1] == first_split[v]) {
+                continue;
+            }
+
+            scratch.resize(vertex_corners(v).size());
+            corner_normals.Compute(vertex_corners(v), scratch);
+
+            auto normals = corner_normals.GetNormals();
+            for (size_t group = 1; group != normals.size(); ++group) {
+                vertices[first_split[v] + group - 1] = VertexPN(vertices[v].position, normals[group]);
+            }
+        }
+    });
+
+    // Indices are only rewritten once all normals are known, the pass above reads the positions through them
+    ForEachBlock(vertex_count, thread_pool, [&](size_t begin, size_t end) {
+        for (auto v = begin; v != end; ++v) {
+            if (first_split[v + 1] == first_split[v]) {
+                continue;
+            }
+
+            auto corners_of_v = vertex_corners(v);
+            auto groups_of_v  = vertex_groups(v);
+
+            for (size_t i = 0; i != corners_of_v.size(); ++i) {
+                if (groups_of_v[i] != 0) {
+                    indices[corners_of_v[i]] = static_cast<uint32_t>(first_split[v] + groups_of_v[i] - 1);
+                }
+            }
+        }
+    });
+
+    return missing_count + split_count;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "geometry.hpp"
+
+#include <cstddef>
+#include <numbers>
+
+class ThreadPool;
+
+enum class NormalWeighting {
+    Area,  // Faces contribute in proportion to their area
+    Angle, // Faces contribute in proportion to their angle at the vertex, which does not depend on the tessellation
+};
+
+struct NormalOptions final {
+    NormalWeighting weighting = NormalWeighting::Angle;
+    // Faces whose normals are further apart than this angle in radians do not smooth each other, the edge between
+    // them stays sharp
+    float crease_angle = std::numbers::pi_v<float> / 3.0f;
+};
+
+// Generates smooth normals for the vertices of 'geometry' that have none, i.e. a zero normal, which is what the OBJ
+// loader produces for faces without 'vn' indices. The normal of a corner is the weighted sum of the normals of the
+// faces around its vertex that lie within the crease angle of its own face. Corners of one vertex that end up with
+// different normals are split into new vertices appended to the vertex array, and the indices are updated, so the
+// index ranges of the mesh records stay valid. Returns the number of vertices that received a normal.
+auto GenerateNormals(Geometry* geometry, const NormalOptions& options, ThreadPool* thread_pool) -> size_t;
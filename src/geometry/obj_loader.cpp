@@ -0,0 +1,487 @@
+#include "obj_loader.hpp"
+
+#include "compressed_text.hpp"
+#include "load_progress.hpp"
+#include "mesh_deduplicator.hpp"
+#include "mesh_optimizer.hpp"
+#include "mesh_simplifier.hpp"
+#include "meshlet_builder.hpp"
+#include "normal_generator.hpp"
+#include "ply_loader.hpp"
+#include "stl_loader.hpp"
+#include "utils/cast.hpp"
+#include "utils/memory.hpp"
+#include "vertex_welder.hpp"
+
+BEGIN_DISABLE_WARNINGS
+
+#include <spdlog/spdlog.h>
+
+END_DISABLE_WARNINGS
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <functional>
+#include <limits>
+#include <map>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace {
+
+bool HasExtension(const std::filesystem::path& filepath, std::string_view expected)
+{
+    auto extension = filepath.extension().string();
+    for (auto& c : extension) {
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    return extension == expected;
+}
+
+// Splits the triangles of 'mesh' by material. 'vertex_ids' holds the welded vertex of every index of the mesh.
+MeshRecords GenerateMeshRecords(
+    const tinyobj::mesh_t&       mesh,
+    std::span<const uint32_t>    vertex_ids,
+    const std::vector<VertexPN>& vertices,
+    std::vector<uint32_t>*       indices)
+{
+    auto mesh_map = std::map<int, std::vector<uint32_t>>{};
+
+    for (size_t i = 0; i < vertex_ids.size(); ++i) {
+        const auto material_id = mesh.material_ids[i / 3];
+
+        auto& index_buffer = mesh_map[material_id];
+        if (index_buffer.empty()) {
+            index_buffer.reserve(vertex_ids.size());
+        }
+        index_buffer.push_back(vertex_ids[i]);
+    }
+
+    auto mesh_records = MeshRecords{};
+
+    for (auto& [material_id, index_buffer] : mesh_map) {
+        auto aabb        = ComputeBoundingBox(index_buffer, vertices);
+        auto first_index = indices->size();
+
+        indices->insert(indices->end(), index_buffer.begin(), index_buffer.end());
+
+        mesh_records.push_back({ aabb, material_id, first_index, index_buffer.size() });
+    }
+
+    return mesh_records;
+}
+
+} // namespace
+
+Geometry BuildGeometry(const ObjData& obj_data, ThreadPool* thread_pool, LoadProgress* progress)
+{
+    const auto& [attributes, shapes, materials] = obj_data;
+    const auto& [positions, normals, texcoords, colors] = attributes;
+
+    auto geometry = Geometry{};
+
+    // Vertices are shared between shapes, so the index triples of all shapes are welded together. VertexPN has no
+    // texcoords, so they are left out of the triples; otherwise the two sides of a UV seam would be separate vertices
+    // and GenerateNormals would smooth each over only its half of the faces around it.
+    auto all_indices = std::vector<tinyobj::index_t>{};
+    {
+        auto index_count = size_t{ 0 };
+        for (auto& shape : shapes) {
+            index_count += shape.mesh.indices.size();
+        }
+        all_indices.reserve(index_count);
+        for (auto& shape : shapes) {
+            all_indices.insert(all_indices.end(), shape.mesh.indices.begin(), shape.mesh.indices.end());
+        }
+        for (auto& index : all_indices) {
+            index.texcoord_index = -1;
+        }
+    }
+
+    StartProgress(progress, "Welding");
+
+    auto [vertex_ids, unique_indices] = WeldIndices(all_indices, thread_pool);
+
+    StartProgress(progress, "Building meshes", shapes.size());
+
+    geometry.vertices.reserve(unique_indices.size());
+
+    for (auto unique_index : unique_indices) {
+        const auto& index    = all_indices[unique_index];
+        const auto  pindex   = 3 * utils::narrow_cast<size_t>(index.vertex_index);
+        const auto  position = glm::vec3(positions[pindex + 0], positions[pindex + 1], positions[pindex + 2]);
+
+        auto normal = glm::vec3(0.0f, 0.0f, 0.0f);
+        if (index.normal_index >= 0) {
+            const auto nindex = 3 * static_cast<size_t>(index.normal_index);
+            normal            = glm::vec3(normals[nindex + 0], normals[nindex + 1], normals[nindex + 2]);
+        }
+
+        geometry.vertices.emplace_back(position, normal);
+    }
+
+    all_indices = {};
+
+    geometry.indices.reserve(vertex_ids.size());
+    geometry.shapes.reserve(shapes.size());
+    geometry.material_count = materials.size();
+
+    auto offset = size_t{ 0 };
+
+    for (const auto& shape : shapes) {
+        auto shape_ids = std::span<const uint32_t>(vertex_ids).subspan(offset, shape.mesh.indices.size());
+        auto records   = GenerateMeshRecords(shape.mesh, shape_ids, geometry.vertices, &geometry.indices);
+
+        geometry.shapes.push_back({ shape.name, std::move(records) });
+        offset += shape.mesh.indices.size();
+
+        AdvanceProgress(progress);
+    }
+
+    return geometry;
+}
+
+std::optional<Geometry> StreamGeometry(
+    const std::filesystem::path& filepath,
+    ThreadPool*                  thread_pool,
+    LoadProgress*                progress,
+    size_t                       window_size)
+{
+    constexpr auto kNone = std::numeric_limits<uint32_t>::max();
+
+    auto geometry = Geometry{};
+    auto runs     = std::vector<ObjFaceRun>{};
+
+    auto& vertices = geometry.vertices;
+    auto& indices  = geometry.indices;
+
+    // Corners are welded by their position and normal index as in BuildGeometry, so vertices are numbered in order of
+    // their first occurrence. The vertices sharing a position form a list that starts at first_vertex[position] and
+    // continues through next_vertex[vertex]; lists are short, since they only hold the distinct normals of a position.
+    auto first_vertex = std::vector<uint32_t>{};
+    auto next_vertex  = std::vector<uint32_t>{};
+    auto vertex_keys  = std::vector<int>{}; // Normal index of each vertex
+
+    auto consume = [&](const ObjBlock& block) {
+        first_vertex.resize(block.positions.size() / 3, kNone);
+
+        for (const auto& run : block.runs) {
+            if (!runs.empty() && runs.back().shape == run.shape && runs.back().material_id == run.material_id) {
+                runs.back().triangle_count += run.triangle_count;
+            } else {
+                runs.push_back(run);
+            }
+        }
+
+        for (const auto& index : block.indices) {
+            auto position = static_cast<size_t>(index.vertex_index);
+            auto key      = index.normal_index;
+            auto vertex   = first_vertex[position];
+
+            while (vertex != kNone && vertex_keys[vertex] != key) {
+                vertex = next_vertex[vertex];
+            }
+
+            if (vertex == kNone) {
+                auto normal = glm::vec3(0.0f, 0.0f, 0.0f);
+                if (index.normal_index >= 0) {
+                    const auto nindex = 3 * static_cast<size_t>(index.normal_index);
+
+                    normal = glm::vec3(block.normals[nindex + 0], block.normals[nindex + 1], block.normals[nindex + 2]);
+                }
+
+                const auto pindex = 3 * position;
+
+                vertex = utils::narrow_cast<uint32_t>(vertices.size());
+                vertices.emplace_back(
+                    glm::vec3(block.positions[pindex + 0], block.positions[pindex + 1], block.positions[pindex + 2]),
+                    normal);
+                vertex_keys.push_back(key);
+                next_vertex.push_back(first_vertex[position]);
+                first_vertex[position] = vertex;
+            }
+
+            indices.push_back(vertex);
+        }
+    };
+
+    auto layout = StreamObjFile(filepath, thread_pool, progress, consume, window_size);
+    if (!layout) {
+        return std::nullopt;
+    }
+
+    first_vertex = {};
+    next_vertex  = {};
+    vertex_keys  = {};
+
+    StartProgress(progress, "Building meshes", layout->shape_names.size());
+
+    geometry.material_count = layout->materials.size();
+    geometry.shapes.reserve(layout->shape_names.size());
+
+    // Every shape is split into one index range per material in ascending material order, as in BuildGeometry. The
+    // runs of a shape are consecutive, so its indices only have to be reordered if its runs are not in that order.
+    auto shape_indices = std::vector<uint32_t>{};
+    auto shape_first   = size_t{ 0 };
+    auto run_first     = runs.begin();
+
+    for (size_t shape = 0; shape != layout->shape_names.size(); ++shape) {
+        auto run_last   = std::find_if(run_first, runs.end(), [shape](const auto& run) { return run.shape != shape; });
+        auto shape_runs = std::span<const ObjFaceRun>(run_first, run_last);
+
+        auto material_sizes = std::map<int, size_t>{};
+        for (const auto& run : shape_runs) {
+            material_sizes[run.material_id] += 3 * run.triangle_count;
+        }
+
+        auto material_firsts = std::map<int, size_t>{};
+        auto shape_size      = size_t{ 0 };
+        for (const auto& [material_id, size] : material_sizes) {
+            material_firsts[material_id] = shape_first + shape_size;
+            shape_size += size;
+        }
+
+        auto is_ordered = std::ranges::adjacent_find(shape_runs, std::greater_equal{}, &ObjFaceRun::material_id) ==
+                          shape_runs.end();
+
+        if (!is_ordered) {
+            auto shape_span = std::span(indices).subspan(shape_first, shape_size);
+            auto targets    = material_firsts;
+            auto source     = size_t{ 0 };
+
+            shape_indices.assign(shape_span.begin(), shape_span.end());
+
+            for (const auto& run : shape_runs) {
+                auto& target = targets[run.material_id];
+                std::copy_n(shape_indices.data() + source, 3 * run.triangle_count, indices.data() + target);
+                source += 3 * run.triangle_count;
+                target += 3 * run.triangle_count;
+            }
+        }
+
+        auto records = MeshRecords{};
+
+        for (const auto& [material_id, size] : material_sizes) {
+            auto first = material_firsts[material_id];
+            auto aabb  = ComputeBoundingBox(std::span(indices).subspan(first, size), vertices);
+            records.push_back({ aabb, material_id, first, size });
+        }
+
+        geometry.shapes.push_back({ std::move(layout->shape_names[shape]), std::move(records) });
+
+        shape_first += shape_size;
+        run_first = run_last;
+
+        AdvanceProgress(progress);
+    }
+
+    return geometry;
+}
+
+LoadedGeometry ReadGeometry(
+    const std::filesystem::path& filepath,
+    const LoadOptions&           options,
+    ThreadPool*                  thread_pool,
+    const GeometryCache*         geometry_cache,
+    LoadProgress*                progress)
+{
+    namespace fs = std::filesystem;
+
+    if (false == fs::exists(filepath)) {
+        throw std::runtime_error("File does not exist");
+    }
+
+    spdlog::info("Loading file {}", filepath.string());
+
+    auto start = std::chrono::system_clock::now();
+
+    auto cache_key = GeometryCache::Key{};
+
+    if (geometry_cache) {
+        cache_key = GeometryCache::ComputeKey(filepath, options.GetCacheVariant());
+
+        StartProgress(progress, "Reading cache");
+
+        if (auto cached_geometry = geometry_cache->Find(cache_key, thread_pool, progress)) {
+            auto end     = std::chrono::system_clock::now();
+            auto elapsed = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
+
+            spdlog::info("Geometry cache hit. Elapsed time: {} seconds.", elapsed);
+
+            return LoadedGeometry(std::move(*cached_geometry));
+        }
+    }
+
+    auto geometry = std::optional<Geometry>{};
+    auto step     = "streamed";
+
+    if (GetCompression(filepath) != Compression::None) {
+        if (false == HasExtension(filepath.stem(), ".obj")) {
+            throw std::runtime_error("Only .obj files can be compressed");
+        }
+        geometry = StreamGeometry(filepath, thread_pool, progress, options.obj_window_size);
+    } else if (HasExtension(filepath, ".ply")) {
+        geometry = ReadPlyGeometry(filepath, thread_pool, progress);
+        step     = "mapped and read";
+    } else if (HasExtension(filepath, ".stl")) {
+        geometry = ReadStlGeometry(filepath, options.stl, thread_pool, progress);
+        step     = "mapped, read and welded";
+    } else {
+        geometry = StreamGeometry(filepath, thread_pool, progress, options.obj_window_size);
+    }
+
+    if (geometry) {
+        auto end     = std::chrono::system_clock::now();
+        auto elapsed = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
+
+        spdlog::info("File {}. Elapsed time: {} seconds.", step, elapsed);
+    } else {
+        spdlog::info("File refers to vertices before defining them, reading all of its faces first");
+
+        start = std::chrono::system_clock::now();
+
+        auto obj_data =
+            ReadObjFile(filepath, ObjIngestion::MemoryMapped, thread_pool, progress, options.obj_window_size);
+
+        auto end     = std::chrono::system_clock::now();
+        auto elapsed = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
+
+        spdlog::info("File loaded. Elapsed time: {} seconds.", elapsed);
+
+        start    = std::chrono::system_clock::now();
+        geometry = BuildGeometry(obj_data, thread_pool, progress);
+
+        end     = std::chrono::system_clock::now();
+        elapsed = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
+
+        spdlog::info("Geometry generation finished. Elapsed time: {} seconds.", elapsed);
+    }
+
+    // The stages below work on triangles, point clouds are drawn as they are read
+    if (IsPointCloud(geometry->shapes)) {
+        spdlog::info("File holds {} points", geometry->indices.size());
+
+        return LoadedGeometry(std::move(*geometry));
+    }
+
+    StartProgress(progress, "Generating normals");
+
+    start = std::chrono::system_clock::now();
+
+    if (auto count = GenerateNormals(&*geometry, NormalOptions{}, thread_pool)) {
+        auto end     = std::chrono::system_clock::now();
+        auto elapsed = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
+
+        spdlog::info("Generated normals of {} vertices. Elapsed time: {} seconds.", count, elapsed);
+    }
+
+    if (options.deduplicate) {
+        StartProgress(progress, "Deduplicating meshes");
+
+        start = std::chrono::system_clock::now();
+
+        auto report = DeduplicateMeshes(&*geometry, DeduplicatorOptions{}, thread_pool);
+
+        auto end     = std::chrono::system_clock::now();
+        auto elapsed = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
+
+        spdlog::info(
+            "Found {} duplicates of {} meshes, removed {} vertices and {} indices. Elapsed time: {} seconds.",
+            report.duplicate_count,
+            report.prototype_count,
+            report.vertex_count,
+            report.index_count,
+            elapsed);
+    }
+
+    if (options.optimize) {
+        StartProgress(progress, "Optimizing meshes");
+
+        start = std::chrono::system_clock::now();
+
+        // The meshlets reorder the triangles again, the vertices are renumbered after them
+        auto optimizer_options = MeshOptimizerOptions{ .vertex_fetch = !options.build_meshlets };
+        auto report            = OptimizeGeometry(&*geometry, optimizer_options, thread_pool);
+
+        auto end     = std::chrono::system_clock::now();
+        auto elapsed = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
+
+        spdlog::info(
+            "Meshes optimized, ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}. Elapsed time: {} seconds.",
+            report.before.GetACMR(),
+            report.after.GetACMR(),
+            report.before.GetATVR(),
+            report.after.GetATVR(),
+            elapsed);
+    }
+
+    if (options.build_meshlets) {
+        StartProgress(progress, "Building meshlets");
+
+        start = std::chrono::system_clock::now();
+
+        auto report = BuildMeshlets(&*geometry, MeshletOptions{ .overdraw = options.optimize }, thread_pool);
+
+        if (options.optimize) {
+            OptimizeVertexFetch(&geometry->vertices, geometry->indices);
+        }
+
+        auto end     = std::chrono::system_clock::now();
+        auto elapsed = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
+        auto count   = static_cast<double>(std::max<size_t>(report.meshlet_count, 1));
+
+        spdlog::info(
+            "Built {} meshlets, {:.1f} vertices and {:.1f} triangles on average, {} with a normal cone, ACMR {:.3f}, "
+            "ATVR {:.3f}. Elapsed time: {} seconds.",
+            report.meshlet_count,
+            static_cast<double>(report.vertex_count) / count,
+            static_cast<double>(report.triangle_count) / count,
+            report.cone_count,
+            report.vertex_cache.GetACMR(),
+            report.vertex_cache.GetATVR(),
+            elapsed);
+    }
+
+    if (options.build_lods) {
+        StartProgress(progress, "Building LODs");
+
+        start = std::chrono::system_clock::now();
+
+        auto report = BuildLods(&*geometry, SimplifierOptions{}, thread_pool);
+
+        auto end     = std::chrono::system_clock::now();
+        auto elapsed = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
+
+        for (size_t level = 0; level != report.levels.size(); ++level) {
+            const auto& stats = report.levels[level];
+
+            spdlog::info(
+                "LOD {}: {} meshes, {} triangles, error {:.2e} on average and {:.2e} at most",
+                level + 1,
+                stats.mesh_count,
+                stats.triangle_count,
+                stats.mean_error,
+                stats.max_error);
+        }
+
+        spdlog::info("Built {} LOD levels. Elapsed time: {} seconds.", report.levels.size(), elapsed);
+    }
+
+    auto geometry_size = geometry->vertices.size() * sizeof(VertexPN) + geometry->indices.size() * sizeof(uint32_t);
+
+    spdlog::info(
+        "Geometry size: {:.1f} MB, peak RSS: {:.1f} MB",
+        static_cast<double>(geometry_size) / (1024.0 * 1024.0),
+        static_cast<double>(utils::GetPeakResidentSetSize()) / (1024.0 * 1024.0));
+
+    if (geometry_cache) {
+        StartProgress(progress, "Caching");
+        geometry_cache->Store(cache_key, *geometry, thread_pool);
+    }
+
+    return LoadedGeometry(std::move(*geometry));
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "geometry.hpp"
+#include "geometry_cache.hpp"
+#include "obj_parser.hpp"
+#include "scene.hpp"
+#include "stl_loader.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <utility>
+
+class LoadProgress;
+class ThreadPool;
+
+// Welded geometry of an .obj, .ply or .stl file, either built from the file or read back from the geometry cache
+class LoadedGeometry final {
+  public:
+    explicit LoadedGeometry(Geometry geometry) noexcept : m_geometry(std::move(geometry)) {}
+
+    auto View() const noexcept -> GeometryView { return m_geometry.View(); }
+
+  private:
+    Geometry m_geometry;
+};
+
+// Stages of ReadGeometry that can be left out, all of them run by default, and the options of the readers of the
+// formats that have any. Leaving out a stage only costs rendering speed: without deduplication every mesh keeps its own
+// vertices, without optimization the triangles stay in file order, and without meshlets or LODs the meshes are drawn
+// whole and at full resolution.
+struct LoadOptions final {
+    bool       deduplicate     = true; // DeduplicateMeshes
+    bool       optimize        = true; // OptimizeGeometry
+    bool       build_meshlets  = true; // BuildMeshlets
+    bool       build_lods      = true; // BuildLods
+    StlOptions stl;                    // Of .stl files
+    size_t     obj_window_size = 0;    // Of .obj files, see StreamObjFile
+
+    // Zero for the default options, so their geometry and that of other options is cached apart. The window size does
+    // not change the geometry and is left out.
+    auto GetCacheVariant() const noexcept -> uint64_t
+    {
+        return uint64_t{ !deduplicate } | uint64_t{ !optimize } << 1 | uint64_t{ !build_meshlets } << 2 |
+               uint64_t{ !build_lods } << 3 | uint64_t{ stl.normals == StlNormals::Stored } << 4;
+    }
+};
+
+// Welds the vertices of 'obj_data' into a shared vertex array and splits every shape into one index range per
+// material.
+auto BuildGeometry(const ObjData& obj_data, ThreadPool* thread_pool, LoadProgress* progress = nullptr) -> Geometry;
+
+// Reads and welds an .obj file in a single streaming pass. The welded vertices and indices are appended to their final
+// arrays while the file is parsed, and parser state is released as it is consumed, so the peak memory use stays close
+// to the size of the result. The result is the same as that of BuildGeometry. Returns std::nullopt if the file cannot
+// be streamed, see StreamObjFile, which 'window_size' is passed to.
+auto StreamGeometry(
+    const std::filesystem::path& filepath,
+    ThreadPool*                  thread_pool,
+    LoadProgress*                progress    = nullptr,
+    size_t                       window_size = 0) -> std::optional<Geometry>;
+
+// Reads the welded geometry of an .obj, .ply or .stl file without touching any scene, so it may run on any thread. .ply
+// and .stl files are read by ReadPlyGeometry and ReadStlGeometry instead of the OBJ parser and then go through the same
+// stages, the ones left out by 'options' are skipped. Point clouds skip all of them and are not cached, see
+// IsPointCloud.
+// .obj.gz and .obj.zst files are decompressed while they are streamed, or while they are read when they cannot be.
+// If 'geometry_cache' is not null the geometry is read from the cache when the file has been loaded before, and stored
+// in the cache otherwise. If 'progress' is not null every stage is reported to it and LoadCancelled is thrown once it
+// has been cancelled.
+auto ReadGeometry(
+    const std::filesystem::path& filepath,
+    const LoadOptions&           options,
+    ThreadPool*                  thread_pool,
+    const GeometryCache*         geometry_cache,
+    LoadProgress*                progress = nullptr) -> LoadedGeometry;
@@ -0,0 +1,954 @@
+#include "obj_parser.hpp"
+
+#include "compressed_text.hpp"
+#include "load_progress.hpp"
+#include "mapped_file.hpp"
+#include "thread_pool.hpp"
+#include "utils/cast.hpp"
+#include "utils/misc.hpp"
+
+BEGIN_DISABLE_WARNINGS
+
+#define TINYOBJLOADER_IMPLEMENTATION
+#include "tiny_obj_loader.h"
+
+#include <spdlog/spdlog.h>
+
+END_DISABLE_WARNINGS
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+constexpr size_t kMinChunkSize     = size_t{ 1 } << 20;
+constexpr size_t kChunksPerThread  = 4;
+constexpr size_t kMinWindowSize    = size_t{ 64 } << 20;
+constexpr size_t kProgressStep     = size_t{ 1 } << 20;
+constexpr size_t kMaxFloatLength   = 64;
+constexpr int    kMaxFastExponent  = 22;
+constexpr int    kMaxMantissaDigit = 19;
+
+constexpr double kPowersOf10[] = { 1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                   1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+struct Statement final {
+    enum class Kind { Object, Group, UseMtl, MtlLib };
+
+    Kind             kind;
+    size_t           triangle_offset; // Number of triangles parsed in the chunk before this statement
+    std::string_view argument;        // Points into the parsed text
+};
+
+struct ObjChunk final {
+    std::vector<float>            positions;
+    std::vector<float>            normals;
+    std::vector<float>            texcoords;
+    std::vector<tinyobj::index_t> indices; // Three indices per triangle
+    std::vector<Statement>        statements;
+
+    // Slots in 'indices' holding negative (relative) references. They are resolved against the chunk, and are
+    // rebased once the number of attributes in the preceding chunks is known.
+    std::vector<size_t> relative_positions;
+    std::vector<size_t> relative_normals;
+    std::vector<size_t> relative_texcoords;
+};
+
+struct Segment final {
+    size_t chunk;
+    size_t first_triangle;
+    size_t triangle_count;
+    size_t shape;
+    size_t shape_offset;
+    int    material_id;
+};
+
+inline bool IsSpace(char c) noexcept
+{
+    return c == ' ' || c == '\t';
+}
+
+inline bool IsDigit(char c) noexcept
+{
+    return c >= '0' && c <= '9';
+}
+
+inline void SkipSpaces(const char*& ptr, const char* end) noexcept
+{
+    while (ptr != end && IsSpace(*ptr)) {
+        ++ptr;
+    }
+}
+
+inline void SkipToken(const char*& ptr, const char* end) noexcept
+{
+    while (ptr != end && !IsSpace(*ptr)) {
+        ++ptr;
+    }
+}
+
+inline bool StartsWith(const char* ptr, const char* end, std::string_view keyword) noexcept
+{
+    auto length = keyword.size();
+    return utils::narrow_cast<size_t>(end - ptr) > length && std::memcmp(ptr, keyword.data(), length) == 0 &&
+           IsSpace(ptr[length]);
+}
+
+std::string_view Trim(const char* ptr, const char* end) noexcept
+{
+    SkipSpaces(ptr, end);
+    while (end != ptr && IsSpace(end[-1])) {
+        --end;
+    }
+    return std::string_view(ptr, utils::narrow_cast<size_t>(end - ptr));
+}
+
+bool ParseFloatSlow(const char*& ptr, const char* end, float* value)
+{
+    auto token_end = ptr;
+    SkipToken(token_end, end);
+
+    auto length = utils::narrow_cast<size_t>(token_end - ptr);
+    if (length == 0 || length >= kMaxFloatLength) {
+        return false;
+    }
+
+    char buffer[kMaxFloatLength];
+    std::memcpy(buffer, ptr, length);
+    buffer[length] = '\0';
+
+    char* parse_end = nullptr;
+    auto  result    = std::strtod(buffer, &parse_end);
+    if (parse_end == buffer) {
+        return false;
+    }
+
+    *value = static_cast<float>(result);
+    ptr += parse_end - buffer;
+
+    return true;
+}
+
+// Parses a decimal floating point number. Numbers whose mantissa and exponent are small enough to be represented
+// exactly by a double are converted with a single multiplication or division; everything else goes through strtod.
+bool ParseFloat(const char*& ptr, const char* end, float* value)
+{
+    auto p        = ptr;
+    bool negative = false;
+
+    if (p != end && (*p == '-' || *p == '+')) {
+        negative = (*p == '-');
+        ++p;
+    }
+
+    auto mantissa  = uint64_t{ 0 };
+    int  exponent  = 0;
+    int  digits    = 0;
+    bool any_digit = false;
+    bool truncated = false;
+
+    for (; p != end && IsDigit(*p); ++p) {
+        any_digit = true;
+        if (digits < kMaxMantissaDigit) {
+            mantissa = 10 * mantissa + static_cast<uint64_t>(*p - '0');
+            digits += (mantissa != 0);
+        } else {
+            ++exponent;
+            truncated = true;
+        }
+    }
+
+    if (p != end && *p == '.') {
+        for (++p; p != end && IsDigit(*p); ++p) {
+            any_digit = true;
+            if (digits < kMaxMantissaDigit) {
+                mantissa = 10 * mantissa + static_cast<uint64_t>(*p - '0');
+                digits += (mantissa != 0);
+                --exponent;
+            } else {
+                truncated = true;
+            }
+        }
+    }
+
+    if (!any_digit) {
+        return ParseFloatSlow(ptr, end, value); // inf, nan, ...
+    }
+
+    if (p != end && (*p == 'e' || *p == 'E')) {
+        auto q                 = p + 1;
+        bool negative_exponent = false;
+        if (q != end && (*q == '-' || *q == '+')) {
+            negative_exponent = (*q == '-');
+            ++q;
+        }
+        if (q != end && IsDigit(*q)) {
+            int explicit_exponent = 0;
+            for (; q != end && IsDigit(*q); ++q) {
+                if (explicit_exponent < 100000) {
+                    explicit_exponent = 10 * explicit_exponent + (*q - '0');
+                }
+            }
+            exponent += negative_exponent ? -explicit_exponent : explicit_exponent;
+            p = q;
+        }
+    }
+
+    if (truncated || mantissa > (uint64_t{ 1 } << 53) || exponent < -kMaxFastExponent ||
+        exponent > kMaxFastExponent) {
+        return ParseFloatSlow(ptr, end, value);
+    }
+
+    auto result = static_cast<double>(mantissa);
+    if (exponent < 0) {
+        result /= kPowersOf10[-exponent];
+    } else {
+        result *= kPowersOf10[exponent];
+    }
+
+    *value = static_cast<float>(negative ? -result : result);
+    ptr    = p;
+
+    return true;
+}
+
+bool ParseInt(const char*& ptr, const char* end, int* value) noexcept
+{
+    auto p        = ptr;
+    bool negative = false;
+
+    if (p != end && (*p == '-' || *p == '+')) {
+        negative = (*p == '-');
+        ++p;
+    }
+
+    if (p == end || !IsDigit(*p)) {
+        return false;
+    }
+
+    auto result = int64_t{ 0 };
+    for (; p != end && IsDigit(*p); ++p) {
+        result = 10 * result + (*p - '0');
+        if (result > INT32_MAX) {
+            return false;
+        }
+    }
+
+    *value = static_cast<int>(negative ? -result : result);
+    ptr    = p;
+
+    return true;
+}
+
+void ParseFloats(const char* ptr, const char* end, std::vector<float>* out, size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+        SkipSpaces(ptr, end);
+        auto value = 0.0f;
+        if (ptr != end && !ParseFloat(ptr, end, &value)) {
+            utils::throw_runtime_error("Failed to parse OBJ file: invalid number");
+        }
+        out->push_back(value);
+    }
+}
+
+// Converts a 1-based OBJ index to a 0-based index. Negative indices are resolved against the number of elements
+// parsed so far in this chunk, and their slot is recorded so that they can be rebased later.
+int ResolveIndex(int index, size_t local_count, size_t slot, std::vector<size_t>* relative_slots)
+{
+    if (index > 0) {
+        return index - 1;
+    }
+
+    utils::throw_runtime_error_if(index == 0, "Failed to parse OBJ file: face index cannot be zero");
+
+    relative_slots->push_back(slot);
+
+    return utils::narrow_cast<int>(local_count) + index;
+}
+
+void ParseFace(const char* ptr, const char* end, ObjChunk* chunk, std::vector<tinyobj::index_t>* polygon)
+{
+    polygon->clear();
+
+    auto first_slot     = chunk->indices.size();
+    auto position_count = chunk->positions.size() / 3;
+    auto normal_count   = chunk->normals.size() / 3;
+    auto texcoord_count = chunk->texcoords.size() / 2;
+
+    auto relative_positions = std::vector<size_t>{};
+    auto relative_normals   = std::vector<size_t>{};
+    auto relative_texcoords = std::vector<size_t>{};
+
+    SkipSpaces(ptr, end);
+
+    while (ptr != end) {
+        auto index = tinyobj::index_t{ -1, -1, -1 };
+        auto value = 0;
+        auto slot  = polygon->size();
+
+        if (!ParseInt(ptr, end, &value)) {
+            utils::throw_runtime_error("Failed to parse OBJ file: invalid face statement");
+        }
+        index.vertex_index = ResolveIndex(value, position_count, slot, &relative_positions);
+
+        if (ptr != end && *ptr == '/') {
+            ++ptr;
+            if (ptr != end && *ptr != '/' && ParseInt(ptr, end, &value)) {
+                index.texcoord_index = ResolveIndex(value, texcoord_count, slot, &relative_texcoords);
+            }
+            if (ptr != end && *ptr == '/') {
+                ++ptr;
+                if (ParseInt(ptr, end, &value)) {
+                    index.normal_index = ResolveIndex(value, normal_count, slot, &relative_normals);
+                }
+            }
+        }
+
+        polygon->push_back(index);
+
+        SkipToken(ptr, end);
+        SkipSpaces(ptr, end);
+    }
+
+    if (polygon->size() < 3) {
+        return; // Degenerate faces are skipped, as in tinyobj
+    }
+
+    // Fan triangulation: polygon vertex k > 0 ends up in the slots of triangles k - 2 and k - 1
+    auto map_slots = [&](const std::vector<size_t>& slots, std::vector<size_t>* out) {
+        for (auto slot : slots) {
+            if (slot == 0) {
+                for (size_t t = 0; t + 2 < polygon->size(); ++t) {
+                    out->push_back(first_slot + 3 * t);
+                }
+                continue;
+            }
+            if (slot >= 2) {
+                out->push_back(first_slot + 3 * (slot - 2) + 2);
+            }
+            if (slot + 1 < polygon->size()) {
+                out->push_back(first_slot + 3 * (slot - 1) + 1);
+            }
+        }
+    };
+
+    for (size_t k = 1; k + 1 < polygon->size(); ++k) {
+        chunk->indices.push_back((*polygon)[0]);
+        chunk->indices.push_back((*polygon)[k]);
+        chunk->indices.push_back((*polygon)[k + 1]);
+    }
+
+    map_slots(relative_positions, &chunk->relative_positions);
+    map_slots(relative_normals, &chunk->relative_normals);
+    map_slots(relative_texcoords, &chunk->relative_texcoords);
+}
+
+void ParseLine(const char* ptr, const char* end, ObjChunk* chunk, std::vector<tinyobj::index_t>* polygon)
+{
+    using Kind = Statement::Kind;
+
+    SkipSpaces(ptr, end);
+
+    if (ptr == end || *ptr == '#') {
+        return;
+    }
+
+    auto add_statement = [chunk](Kind kind, std::string_view argument) {
+        chunk->statements.push_back({ kind, chunk->indices.size() / 3, argument });
+    };
+
+    switch (*ptr) {
+    case 'v':
+        if (StartsWith(ptr, end, "v")) {
+            ParseFloats(ptr + 2, end, &chunk->positions, 3);
+        } else if (StartsWith(ptr, end, "vn")) {
+            ParseFloats(ptr + 3, end, &chunk->normals, 3);
+        } else if (StartsWith(ptr, end, "vt")) {
+            ParseFloats(ptr + 3, end, &chunk->texcoords, 2);
+        }
+        break;
+    case 'f':
+        if (StartsWith(ptr, end, "f")) {
+            ParseFace(ptr + 2, end, chunk, polygon);
+        }
+        break;
+    case 'o':
+        if (StartsWith(ptr, end, "o")) {
+            add_statement(Kind::Object, Trim(ptr + 2, end));
+        }
+        break;
+    case 'g':
+        if (StartsWith(ptr, end, "g")) {
+            add_statement(Kind::Group, Trim(ptr + 2, end));
+        }
+        break;
+    case 'u':
+        if (StartsWith(ptr, end, "usemtl")) {
+            add_statement(Kind::UseMtl, Trim(ptr + 7, end));
+        }
+        break;
+    case 'm':
+        if (StartsWith(ptr, end, "mtllib")) {
+            add_statement(Kind::MtlLib, Trim(ptr + 7, end));
+        }
+        break;
+    default: break;
+    }
+}
+
+// Parsed bytes are reported to 'progress' in steps of kProgressStep, which also bounds the latency of a cancellation
+void ParseChunk(std::string_view text, ObjChunk* chunk, LoadProgress* progress)
+{
+    auto ptr      = text.data();
+    auto end      = text.data() + text.size();
+    auto reported = text.data();
+    auto polygon  = std::vector<tinyobj::index_t>{};
+
+    // Rough estimate of the attribute count, assuming ~30 bytes per statement
+    chunk->positions.reserve(text.size() / 30);
+    chunk->indices.reserve(text.size() / 15);
+
+    while (ptr != end) {
+        auto newline  = static_cast<const char*>(std::memchr(ptr, '\n', utils::narrow_cast<size_t>(end - ptr)));
+        auto line_end = newline ? newline : end;
+        auto next     = newline ? newline + 1 : end;
+
+        if (line_end != ptr && line_end[-1] == '\r') {
+            --line_end;
+        }
+
+        ParseLine(ptr, line_end, chunk, &polygon);
+
+        ptr = next;
+
+        if (progress && static_cast<size_t>(ptr - reported) >= kProgressStep) {
+            AdvanceProgress(progress, static_cast<size_t>(ptr - reported));
+            reported = ptr;
+        }
+    }
+
+    AdvanceProgress(progress, static_cast<size_t>(ptr - reported));
+}
+
+// Text parsed at a time by StreamObjFile and ParseCompressedObj, 'window_size' unless it is 0
+auto GetWindowSize(size_t window_size, const ThreadPool* thread_pool) noexcept -> size_t
+{
+    if (window_size != 0) {
+        return window_size;
+    }
+    return std::max(kMinWindowSize, kChunksPerThread * kMinChunkSize * ThreadCount(thread_pool));
+}
+
+auto SplitIntoChunks(std::string_view text, size_t thread_count) -> std::vector<std::string_view>
+{
+    auto chunk_count = std::clamp(text.size() / kMinChunkSize, size_t{ 1 }, kChunksPerThread * thread_count);
+    auto chunks      = std::vector<std::string_view>{};
+    auto first       = size_t{ 0 };
+
+    for (size_t i = 1; i <= chunk_count && first < text.size(); ++i) {
+        auto last = (i == chunk_count) ? text.size() : std::max(first, i * text.size() / chunk_count);
+        if (last < text.size()) {
+            auto newline = text.find('\n', last);
+            last         = (newline == std::string_view::npos) ? text.size() : newline + 1;
+        }
+        chunks.push_back(text.substr(first, last - first));
+        first = last;
+    }
+
+    return chunks;
+}
+
+// Multiple group names are joined with a single space, as in tinyobj
+std::string JoinGroupNames(std::string_view names)
+{
+    auto ptr  = names.data();
+    auto end  = names.data() + names.size();
+    auto name = std::string{};
+
+    for (SkipSpaces(ptr, end); ptr != end; SkipSpaces(ptr, end)) {
+        auto token = ptr;
+        SkipToken(ptr, end);
+        name.append(name.empty() ? "" : " ").append(token, ptr);
+    }
+
+    return name;
+}
+
+void LoadMaterials(
+    std::string_view                  filenames,
+    const std::filesystem::path&      material_dir,
+    std::map<std::string, int>*       material_map,
+    std::vector<tinyobj::material_t>* materials)
+{
+    auto ptr = filenames.data();
+    auto end = filenames.data() + filenames.size();
+
+    // As in tinyobj, the first material library that can be opened is used
+    for (SkipSpaces(ptr, end); ptr != end; SkipSpaces(ptr, end)) {
+        auto token = ptr;
+        SkipToken(ptr, end);
+
+        auto stream = std::ifstream(material_dir / std::string(token, ptr));
+        if (!stream) {
+            continue;
+        }
+
+        auto warning = std::string{};
+        auto error   = std::string{};
+
+        tinyobj::LoadMtl(material_map, materials, &stream, &warning, &error);
+
+        if (!warning.empty()) {
+            spdlog::warn("{}", warning);
+        }
+        if (!error.empty()) {
+            spdlog::error("{}", error);
+        }
+
+        return;
+    }
+
+    spdlog::warn("Failed to load material file(s) '{}'. Using default material.", filenames);
+}
+
+// Replays the statements of the chunks in file order and assigns a shape and a material to every run of triangles
+class FaceLayout final {
+  public:
+    using AddRun = std::function<void(size_t shape, int material_id, size_t first_triangle, size_t triangle_count)>;
+
+    FaceLayout(std::filesystem::path material_dir, std::vector<tinyobj::material_t>* materials) noexcept
+        : m_material_dir(std::move(material_dir)), m_materials(materials)
+    {}
+
+    // Calls 'add_run' for the runs of triangles of 'chunk', which has to be the chunk following the previously
+    // replayed one. Shapes are split on 'o' and 'g' statements and only started once they get a triangle.
+    void Replay(const ObjChunk& chunk, const AddRun& add_run)
+    {
+        using Kind = Statement::Kind;
+
+        auto add = [&](size_t first, size_t last) {
+            if (first == last) {
+                return;
+            }
+            if (!m_shape_open) {
+                m_shape_names.push_back(m_shape_name);
+                m_shape_open = true;
+            }
+            add_run(m_shape_names.size() - 1, m_material_id, first, last - first);
+        };
+
+        auto first = size_t{ 0 };
+
+        for (const auto& [kind, triangle_offset, argument] : chunk.statements) {
+            add(first, triangle_offset);
+            first = triangle_offset;
+            switch (kind) {
+            case Kind::Object:
+                m_shape_name = argument;
+                m_shape_open = false;
+                break;
+            case Kind::Group:
+                m_shape_name = JoinGroupNames(argument);
+                m_shape_open = false;
+                break;
+            case Kind::UseMtl: {
+                auto it       = m_material_map.find(std::string(argument));
+                m_material_id = (it == m_material_map.end()) ? -1 : it->second;
+                break;
+            }
+            case Kind::MtlLib: LoadMaterials(argument, m_material_dir, &m_material_map, m_materials); break;
+            default: break;
+            }
+        }
+
+        add(first, chunk.indices.size() / 3);
+    }
+
+    auto GetShapeNames() noexcept -> std::vector<std::string>& { return m_shape_names; }
+
+  private:
+    std::filesystem::path             m_material_dir;
+    std::vector<tinyobj::material_t>* m_materials = nullptr;
+    std::map<std::string, int>        m_material_map;
+    std::vector<std::string>          m_shape_names;
+    std::string                       m_shape_name;
+    int                               m_material_id = -1;
+    bool                              m_shape_open  = false;
+};
+
+// Rebases the relative indices of 'chunks' onto the attributes of all preceding chunks, which are in 'attributes', and
+// moves the attributes of the chunks to 'attributes'. Texcoords are only counted in 'texcoord_count' unless
+// 'keep_texcoords' is set. Returns false if a face refers to an attribute that is neither in the preceding chunks nor
+// in 'chunks'.
+bool MergeChunks(
+    std::span<ObjChunk> chunks,
+    tinyobj::attrib_t*  attributes,
+    size_t*             texcoord_count,
+    bool                keep_texcoords,
+    ThreadPool*         thread_pool)
+{
+    // Prefix sums of attribute counts, used to rebase relative indices and to place attributes
+    auto position_base = std::vector<size_t>(chunks.size() + 1, attributes->vertices.size() / 3);
+    auto normal_base   = std::vector<size_t>(chunks.size() + 1, attributes->normals.size() / 3);
+    auto texcoord_base = std::vector<size_t>(chunks.size() + 1, *texcoord_count);
+
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        position_base[i + 1] = position_base[i] + chunks[i].positions.size() / 3;
+        normal_base[i + 1]   = normal_base[i] + chunks[i].normals.size() / 3;
+        texcoord_base[i + 1] = texcoord_base[i] + chunks[i].texcoords.size() / 2;
+    }
+
+    attributes->vertices.resize(3 * position_base.back());
+    attributes->normals.resize(3 * normal_base.back());
+    if (keep_texcoords) {
+        attributes->texcoords.resize(2 * texcoord_base.back());
+    }
+    *texcoord_count = texcoord_base.back();
+
+    auto is_valid = std::atomic_bool{ true };
+
+    ParallelFor(thread_pool, chunks.size(), [&](size_t i) {
+        auto& chunk = chunks[i];
+
+        for (auto slot : chunk.relative_positions) {
+            chunk.indices[slot].vertex_index += utils::narrow_cast<int>(position_base[i]);
+        }
+        for (auto slot : chunk.relative_normals) {
+            chunk.indices[slot].normal_index += utils::narrow_cast<int>(normal_base[i]);
+        }
+        for (auto slot : chunk.relative_texcoords) {
+            chunk.indices[slot].texcoord_index += utils::narrow_cast<int>(texcoord_base[i]);
+        }
+
+        auto position_count = utils::narrow_cast<int>(position_base.back());
+        auto normal_count   = utils::narrow_cast<int>(normal_base.back());
+        auto texcoord_count = utils::narrow_cast<int>(texcoord_base.back());
+
+        for (const auto& index : chunk.indices) {
+            bool valid = index.vertex_index >= 0 && index.vertex_index < position_count &&
+                         index.normal_index >= -1 && index.normal_index < normal_count &&
+                         index.texcoord_index >= -1 && index.texcoord_index < texcoord_count;
+            if (!valid) {
+                is_valid = false;
+                break;
+            }
+        }
+
+        std::ranges::copy(chunk.positions, attributes->vertices.data() + 3 * position_base[i]);
+        std::ranges::copy(chunk.normals, attributes->normals.data() + 3 * normal_base[i]);
+        if (keep_texcoords) {
+            std::ranges::copy(chunk.texcoords, attributes->texcoords.data() + 2 * texcoord_base[i]);
+        }
+
+        chunk.positions = {};
+        chunk.normals   = {};
+        chunk.texcoords = {};
+    });
+
+    return is_valid;
+}
+
+ObjData ParseObj(
+    std::string_view             text,
+    const std::filesystem::path& material_dir,
+    ThreadPool*                  thread_pool,
+    const MappedFile*            mapped_file,
+    LoadProgress*                progress)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    auto views  = SplitIntoChunks(text, ThreadCount(thread_pool));
+    auto chunks = std::vector<ObjChunk>(views.size());
+
+    StartProgress(progress, "Parsing", text.size());
+
+    ParallelFor(thread_pool, chunks.size(), [&](size_t i) {
+        ParseChunk(views[i], &chunks[i], progress);
+        if (mapped_file) {
+            mapped_file->Discard(views[i]);
+        }
+    });
+
+    StartProgress(progress, "Merging");
+
+    auto data           = ObjData{};
+    auto texcoord_count = size_t{ 0 };
+
+    auto is_valid = MergeChunks(chunks, &data.attributes, &texcoord_count, true, thread_pool);
+    utils::throw_runtime_error_if(!is_valid, "Failed to parse OBJ file: face index out of range");
+
+    // Replay the statements in file order to lay out shapes and materials
+    auto segments    = std::vector<Segment>{};
+    auto shape_sizes = std::vector<size_t>{};
+    auto layout      = FaceLayout(material_dir, &data.materials);
+
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        layout.Replay(chunks[i], [&](size_t shape, int material_id, size_t first_triangle, size_t triangle_count) {
+            if (shape == shape_sizes.size()) {
+                data.shapes.emplace_back().name = layout.GetShapeNames()[shape];
+                shape_sizes.push_back(0);
+            }
+            segments.push_back({ i, first_triangle, triangle_count, shape, shape_sizes[shape], material_id });
+            shape_sizes[shape] += triangle_count;
+        });
+    }
+
+    for (size_t i = 0; i < data.shapes.size(); ++i) {
+        auto& mesh = data.shapes[i].mesh;
+        mesh.indices.resize(3 * shape_sizes[i]);
+        mesh.num_face_vertices.resize(shape_sizes[i], 3);
+        mesh.material_ids.resize(shape_sizes[i]);
+        mesh.smoothing_group_ids.resize(shape_sizes[i], 0);
+    }
+
+    ParallelFor(thread_pool, segments.size(), [&](size_t i) {
+        const auto& segment = segments[i];
+        auto&       mesh    = data.shapes[segment.shape].mesh;
+        auto        source  = chunks[segment.chunk].indices.data() + 3 * segment.first_triangle;
+        auto        offset  = segment.shape_offset;
+
+        std::copy_n(source, 3 * segment.triangle_count, mesh.indices.data() + 3 * offset);
+        std::fill_n(mesh.material_ids.data() + offset, segment.triangle_count, segment.material_id);
+    });
+
+    auto end     = std::chrono::steady_clock::now();
+    auto elapsed = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
+    auto size_mb = static_cast<double>(text.size()) / (1024.0 * 1024.0);
+
+    spdlog::info(
+        "Parsed {:.1f} MB in {:.3f} seconds ({:.1f} MB/s, {} chunks, {} threads)",
+        size_mb,
+        elapsed,
+        elapsed > 0 ? size_mb / elapsed : 0.0,
+        chunks.size(),
+        ThreadCount(thread_pool));
+
+    return data;
+}
+
+// Parses a compressed .obj file window by window as it is decompressed, so the decompressed text is never held as a
+// whole. Unlike StreamObjFile it keeps every index, so faces may refer to attributes that are defined further on; the
+// indices are only checked once all attributes are known.
+ObjData ParseCompressedObj(
+    const std::filesystem::path& filepath,
+    Compression                  compression,
+    const std::filesystem::path& material_dir,
+    size_t                       window_size,
+    ThreadPool*                  thread_pool,
+    LoadProgress*                progress)
+{
+    auto data           = ObjData{};
+    auto layout         = FaceLayout(material_dir, &data.materials);
+    auto texcoord_count = size_t{ 0 };
+    auto reader         = CompressedTextReader(filepath, compression, GetWindowSize(window_size, thread_pool));
+    auto reported       = size_t{ 0 };
+
+    StartProgress(progress, "Decompressing", reader.GetCompressedSize());
+
+    for (auto block = reader.Next(); !block.text.empty(); block = reader.Next()) {
+        auto views  = SplitIntoChunks(block.text, ThreadCount(thread_pool));
+        auto chunks = std::vector<ObjChunk>(views.size());
+
+        ParallelFor(thread_pool, chunks.size(), [&](size_t i) { ParseChunk(views[i], &chunks[i], nullptr); });
+
+        // Forward references fail this check, all indices are checked at the end instead
+        MergeChunks(chunks, &data.attributes, &texcoord_count, true, thread_pool);
+
+        for (auto& chunk : chunks) {
+            layout.Replay(chunk, [&](size_t shape, int material_id, size_t first_triangle, size_t triangle_count) {
+                if (shape == data.shapes.size()) {
+                    data.shapes.emplace_back().name = layout.GetShapeNames()[shape];
+                }
+
+                auto& mesh   = data.shapes[shape].mesh;
+                auto  source = chunk.indices.data() + 3 * first_triangle;
+
+                mesh.indices.insert(mesh.indices.end(), source, source + 3 * triangle_count);
+                mesh.num_face_vertices.insert(mesh.num_face_vertices.end(), triangle_count, 3);
+                mesh.material_ids.insert(mesh.material_ids.end(), triangle_count, material_id);
+                mesh.smoothing_group_ids.insert(mesh.smoothing_group_ids.end(), triangle_count, 0);
+            });
+
+            chunk = ObjChunk{};
+        }
+
+        AdvanceProgress(progress, block.compressed_size - reported);
+        reported = block.compressed_size;
+    }
+
+    auto position_count = utils::narrow_cast<int>(data.attributes.vertices.size() / 3);
+    auto normal_count   = utils::narrow_cast<int>(data.attributes.normals.size() / 3);
+    auto texcoords      = utils::narrow_cast<int>(texcoord_count);
+
+    for (const auto& shape : data.shapes) {
+        auto is_valid = std::ranges::all_of(shape.mesh.indices, [&](const tinyobj::index_t& index) {
+            return index.vertex_index >= 0 && index.vertex_index < position_count && index.normal_index >= -1 &&
+                   index.normal_index < normal_count && index.texcoord_index >= -1 && index.texcoord_index < texcoords;
+        });
+        utils::throw_runtime_error_if(!is_valid, "Failed to parse OBJ file: face index out of range");
+    }
+
+    return data;
+}
+
+} // namespace
+
+ObjData ParseObj(
+    std::string_view             text,
+    const std::filesystem::path& material_dir,
+    ThreadPool*                  thread_pool,
+    LoadProgress*                progress)
+{
+    return ParseObj(text, material_dir, thread_pool, nullptr, progress);
+}
+
+ObjData ReadObjFile(
+    const std::filesystem::path& filepath,
+    ObjIngestion                 ingestion,
+    ThreadPool*                  thread_pool,
+    LoadProgress*                progress,
+    size_t                       window_size)
+{
+    auto material_dir = filepath.parent_path();
+
+    if (auto compression = GetCompression(filepath); compression != Compression::None) {
+        return ParseCompressedObj(filepath, compression, material_dir, window_size, thread_pool, progress);
+    }
+
+    if (ingestion == ObjIngestion::MemoryMapped) {
+        auto mapped_file = MappedFile{};
+        auto is_mapped   = false;
+
+        try {
+            mapped_file = MappedFile(filepath, MappedFile::Access::Sequential);
+            is_mapped   = true;
+        } catch (const std::runtime_error& error) {
+            spdlog::warn("Failed to map {}: {}. Reading it into memory instead.", filepath.string(), error.what());
+        }
+
+        if (is_mapped) {
+            return ParseObj(mapped_file.View(), material_dir, thread_pool, &mapped_file, progress);
+        }
+    }
+
+    auto text = std::string(std::filesystem::file_size(filepath), '\0');
+    {
+        auto stream = std::ifstream(filepath, std::ios::binary);
+        auto size   = utils::narrow_cast<std::streamsize>(text.size());
+        utils::throw_runtime_error_if(!stream.read(text.data(), size), "Failed to read object file");
+    }
+
+    return ParseObj(text, material_dir, thread_pool, nullptr, progress);
+}
+
+std::optional<ObjLayout> StreamObjFile(
+    const std::filesystem::path&                filepath,
+    ThreadPool*                                 thread_pool,
+    LoadProgress*                               progress,
+    const std::function<void(const ObjBlock&)>& consume,
+    size_t                                      window_size)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    auto result         = ObjLayout{};
+    auto layout         = FaceLayout(filepath.parent_path(), &result.materials);
+    auto compression    = GetCompression(filepath);
+    auto attributes     = tinyobj::attrib_t{};
+    auto texcoord_count = size_t{ 0 };
+    auto runs           = std::vector<ObjFaceRun>{};
+    auto text_size      = size_t{ 0 };
+    auto window_bytes   = GetWindowSize(window_size, thread_pool);
+
+    // Parses a window of whole lines and hands out its triangles. Returns false if a face refers to an attribute that
+    // is defined further on than the end of the window.
+    auto parse_window = [&](std::string_view window, const MappedFile* mapped_file, LoadProgress* chunk_progress) {
+        auto views  = SplitIntoChunks(window, ThreadCount(thread_pool));
+        auto chunks = std::vector<ObjChunk>(views.size());
+
+        ParallelFor(thread_pool, chunks.size(), [&](size_t i) {
+            ParseChunk(views[i], &chunks[i], chunk_progress);
+            if (mapped_file) {
+                mapped_file->Discard(views[i]);
+            }
+        });
+
+        if (!MergeChunks(chunks, &attributes, &texcoord_count, false, thread_pool)) {
+            return false;
+        }
+
+        for (auto& chunk : chunks) {
+            runs.clear();
+            layout.Replay(chunk, [&runs](size_t shape, int material_id, size_t, size_t triangle_count) {
+                runs.push_back({ shape, material_id, triangle_count });
+            });
+
+            consume({ attributes.vertices, attributes.normals, chunk.indices, runs });
+
+            chunk = ObjChunk{};
+        }
+
+        text_size += window.size();
+
+        return true;
+    };
+
+    if (compression != Compression::None) {
+        // The next window is decompressed while the current one is parsed. Progress is measured in compressed bytes,
+        // so it is reported per window rather than by the chunks.
+        auto reader   = CompressedTextReader(filepath, compression, window_bytes);
+        auto reported = size_t{ 0 };
+
+        StartProgress(progress, "Decompressing", reader.GetCompressedSize());
+
+        for (auto block = reader.Next(); !block.text.empty(); block = reader.Next()) {
+            if (!parse_window(block.text, nullptr, nullptr)) {
+                return std::nullopt;
+            }
+            AdvanceProgress(progress, block.compressed_size - reported);
+            reported = block.compressed_size;
+        }
+    } else {
+        auto mapped_file = MappedFile(filepath, MappedFile::Access::Sequential);
+        auto text        = mapped_file.View();
+
+        StartProgress(progress, "Parsing", text.size());
+
+        for (auto first = size_t{ 0 }; first < text.size();) {
+            auto last = std::min(first + window_bytes, text.size());
+            if (last < text.size()) {
+                auto newline = text.find('\n', last);
+                last         = (newline == std::string_view::npos) ? text.size() : newline + 1;
+            }
+
+            if (!parse_window(text.substr(first, last - first), &mapped_file, progress)) {
+                return std::nullopt;
+            }
+
+            first = last;
+        }
+    }
+
+    result.shape_names = std::move(layout.GetShapeNames());
+
+    auto end     = std::chrono::steady_clock::now();
+    auto elapsed = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
+    auto size_mb = static_cast<double>(text_size) / (1024.0 * 1024.0);
+
+    spdlog::info(
+        "Streamed {:.1f} MB in {:.3f} seconds ({:.1f} MB/s, {} threads)",
+        size_mb,
+        elapsed,
+        elapsed > 0 ? size_mb / elapsed : 0.0,
+        ThreadCount(thread_pool));
+
+    return result;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "platform.hpp"
+
+BEGIN_DISABLE_WARNINGS
+
+#include "tiny_obj_loader.h"
+
+END_DISABLE_WARNINGS
+
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class LoadProgress;
+class ThreadPool;
+
+// How the file contents are brought into memory. Buffered reads the whole text into a buffer first. MemoryMapped parses
+// directly out of a read-only mapping of the file, which avoids copying the text and lets the kernel drop pages that
+// have already been parsed, and falls back to Buffered for files that cannot be mapped.
+enum class ObjIngestion { Buffered, MemoryMapped };
+
+struct ObjData final {
+    tinyobj::attrib_t                attributes;
+    std::vector<tinyobj::shape_t>    shapes;
+    std::vector<tinyobj::material_t> materials;
+};
+
+// Parses the contents of an .obj file. The text is split into line-aligned chunks which are parsed in parallel and
+// merged afterwards. Faces are triangulated, and the result follows the tinyobj::LoadObj conventions: shapes are
+// split on 'o' and 'g' statements, material ids are stored per triangle and missing indices are set to -1. If
+// 'progress' is not null, parsed chunks are reported to it and LoadCancelled is thrown once it has been cancelled.
+auto ParseObj(
+    std::string_view             text,
+    const std::filesystem::path& material_dir,
+    ThreadPool*                  thread_pool,
+    LoadProgress*                progress = nullptr) -> ObjData;
+
+// Reads and parses an .obj file. Material libraries are searched for in the directory of the file. Files ending in .gz
+// or .zst are parsed window by window as they are decompressed, regardless of 'ingestion', so their decompressed text
+// is never held in memory as a whole. 'window_size' is the size of those windows, see StreamObjFile.
+auto ReadObjFile(
+    const std::filesystem::path& filepath,
+    ObjIngestion                 ingestion,
+    ThreadPool*                  thread_pool,
+    LoadProgress*                progress    = nullptr,
+    size_t                       window_size = 0) -> ObjData;
+
+// Consecutive triangles of one shape with one material
+struct ObjFaceRun final {
+    size_t shape{};
+    int    material_id{};
+    size_t triangle_count{};
+};
+
+// Triangles of a part of an .obj file, as handed out by StreamObjFile. The indices are absolute and only refer to
+// attributes in 'positions' and 'normals', which hold all attributes parsed so far.
+struct ObjBlock final {
+    std::span<const float>            positions;
+    std::span<const float>            normals;
+    std::span<const tinyobj::index_t> indices; // Three per triangle
+    std::span<const ObjFaceRun>       runs;    // Shape and material of the triangles, in order
+};
+
+struct ObjLayout final {
+    std::vector<std::string>         shape_names;
+    std::vector<tinyobj::material_t> materials;
+};
+
+// Parses an .obj file in windows of bounded size and passes the triangles to 'consume' in file order. The chunks of a
+// window are parsed in parallel and released once consumed, only positions and normals are kept for the whole file,
+// and texcoords are only counted. Returns std::nullopt if a face refers to an attribute that is defined further on
+// than the end of its window. Such files have to be read with ReadObjFile instead.
+//
+// Files ending in .gz or .zst are decompressed through a CompressedTextReader, which decodes the next window on a
+// thread of its own while the current one is parsed, so the decompressed text is never held in memory as a whole.
+//
+// 'window_size' is the text parsed at a time, and the block size of the CompressedTextReader. Lines longer than it
+// make a window of their own. 0 selects 64 MB, or 4 MB per thread of 'thread_pool' if that is more.
+auto StreamObjFile(
+    const std::filesystem::path&                filepath,
+    ThreadPool*                                 thread_pool,
+    LoadProgress*                               progress,
+    const std::function<void(const ObjBlock&)>& consume,
+    size_t                                      window_size = 0) -> std::optional<ObjLayout>;
@@ -0,0 +1,541 @@
+#include "ply_loader.hpp"
+
+#include "load_progress.hpp"
+#include "mapped_file.hpp"
+#include "thread_pool.hpp"
+#include "utils/misc.hpp"
+
+BEGIN_DISABLE_WARNINGS
+
+#include <spdlog/spdlog.h>
+
+END_DISABLE_WARNINGS
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cfloat>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Records per block of work. Large enough to amortize the scheduling, small enough to balance the workers and to drop
+// the pages of the file early.
+constexpr size_t kBlockSize = size_t{ 1 } << 16;
+
+enum class PlyType { Int8, Uint8, Int16, Uint16, Int32, Uint32, Float32, Float64 };
+
+struct PlyProperty final {
+    std::string            name;
+    PlyType                type{};
+    std::optional<PlyType> count_type; // Set for list properties
+};
+
+struct PlyElement final {
+    std::string              name;
+    size_t                   count{};
+    std::vector<PlyProperty> properties;
+    size_t                   record_size{}; // Zero if the element has list properties, whose records vary in size
+};
+
+struct PlyHeader final {
+    std::vector<PlyElement> elements;
+    bool                    is_big_endian{};
+    size_t                  size{}; // Up to and including the end_header line
+};
+
+// Start of a block of records in the element data, and of its triangles in the index array
+struct PlyBlock final {
+    size_t offset{};
+    size_t first_index{};
+};
+
+auto ParseType(std::string_view name) -> PlyType
+{
+    static constexpr auto types = std::array<std::pair<std::string_view, PlyType>, 16>{ {
+        { "char", PlyType::Int8 },
+        { "int8", PlyType::Int8 },
+        { "uchar", PlyType::Uint8 },
+        { "uint8", PlyType::Uint8 },
+        { "short", PlyType::Int16 },
+        { "int16", PlyType::Int16 },
+        { "ushort", PlyType::Uint16 },
+        { "uint16", PlyType::Uint16 },
+        { "int", PlyType::Int32 },
+        { "int32", PlyType::Int32 },
+        { "uint", PlyType::Uint32 },
+        { "uint32", PlyType::Uint32 },
+        { "float", PlyType::Float32 },
+        { "float32", PlyType::Float32 },
+        { "double", PlyType::Float64 },
+        { "float64", PlyType::Float64 },
+    } };
+
+    auto it = std::ranges::find(types, name, &std::pair<std::string_view, PlyType>::first);
+    utils::throw_runtime_error_if(it == types.end(), "Failed to parse PLY file: unknown property type");
+
+    return it->second;
+}
+
+size_t SizeOf(PlyType type) noexcept
+{
+    switch (type) {
+    case PlyType::Int8:
+    case PlyType::Uint8: return 1;
+    case PlyType::Int16:
+    case PlyType::Uint16: return 2;
+    case PlyType::Int32:
+    case PlyType::Uint32:
+    case PlyType::Float32: return 4;
+    case PlyType::Float64: return 8;
+    }
+    return 0;
+}
+
+bool IsInteger(PlyType type) noexcept
+{
+    return type != PlyType::Float32 && type != PlyType::Float64;
+}
+
+template <typename T>
+T Load(const char* data, bool swap) noexcept
+{
+    auto bytes = std::array<char, sizeof(T)>{};
+    std::memcpy(bytes.data(), data, sizeof(T));
+    if (swap) {
+        std::ranges::reverse(bytes);
+    }
+    auto value = T{};
+    std::memcpy(&value, bytes.data(), sizeof(T));
+    return value;
+}
+
+// Every type converts to double without loss
+double ReadValue(const char* data, PlyType type, bool swap) noexcept
+{
+    switch (type) {
+    case PlyType::Int8: return Load<int8_t>(data, swap);
+    case PlyType::Uint8: return Load<uint8_t>(data, swap);
+    case PlyType::Int16: return Load<int16_t>(data, swap);
+    case PlyType::Uint16: return Load<uint16_t>(data, swap);
+    case PlyType::Int32: return Load<int32_t>(data, swap);
+    case PlyType::Uint32: return Load<uint32_t>(data, swap);
+    case PlyType::Float32: return Load<float>(data, swap);
+    case PlyType::Float64: return Load<double>(data, swap);
+    }
+    return 0.0;
+}
+
+auto ParseHeader(std::string_view text) -> PlyHeader
+{
+    auto header = PlyHeader{};
+    auto offset = size_t{ 0 };
+
+    auto next_line = [&text, &offset]() -> std::optional<std::string_view> {
+        auto end = text.find('\n', offset);
+        if (end == std::string_view::npos) {
+            return std::nullopt;
+        }
+        auto line = text.substr(offset, end - offset);
+        offset    = end + 1;
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        return line;
+    };
+
+    auto split = [](std::string_view line) {
+        auto tokens = std::vector<std::string_view>{};
+        while (!line.empty()) {
+            auto begin = line.find_first_not_of(" \t");
+            if (begin == std::string_view::npos) {
+                break;
+            }
+            auto end = std::min(line.find_first_of(" \t", begin), line.size());
+            tokens.push_back(line.substr(begin, end - begin));
+            line.remove_prefix(end);
+        }
+        return tokens;
+    };
+
+    auto magic = next_line();
+    utils::throw_runtime_error_if(!magic || *magic != "ply", "Failed to parse PLY file: missing magic number");
+
+    auto has_format = false;
+
+    while (true) {
+        auto line = next_line();
+        utils::throw_runtime_error_if(!line, "Failed to parse PLY file: missing end_header");
+
+        auto tokens = split(*line);
+
+        if (tokens.empty() || tokens[0] == "comment" || tokens[0] == "obj_info") {
+            continue;
+        }
+        if (tokens[0] == "end_header") {
+            break;
+        }
+
+        if (tokens[0] == "format") {
+            utils::throw_runtime_error_if(tokens.size() < 2, "Failed to parse PLY file: invalid format");
+            utils::throw_runtime_error_if(
+                tokens[1] != "binary_little_endian" && tokens[1] != "binary_big_endian",
+                "Failed to parse PLY file: only binary files are supported");
+
+            header.is_big_endian = tokens[1] == "binary_big_endian";
+            has_format           = true;
+        } else if (tokens[0] == "element") {
+            utils::throw_runtime_error_if(tokens.size() != 3, "Failed to parse PLY file: invalid element");
+
+            auto count  = size_t{};
+            auto result = std::from_chars(tokens[2].data(), tokens[2].data() + tokens[2].size(), count);
+            utils::throw_runtime_error_if(result.ec != std::errc{}, "Failed to parse PLY file: invalid element count");
+
+            header.elements.push_back({ std::string(tokens[1]), count, {}, 0 });
+        } else if (tokens[0] == "property") {
+            utils::throw_runtime_error_if(
+                header.elements.empty(),
+                "Failed to parse PLY file: property without element");
+
+            auto& properties = header.elements.back().properties;
+
+            if (tokens.size() == 5 && tokens[1] == "list") {
+                auto count_type = ParseType(tokens[2]);
+                utils::throw_runtime_error_if(!IsInteger(count_type), "Failed to parse PLY file: invalid list count");
+
+                properties.push_back({ std::string(tokens[4]), ParseType(tokens[3]), count_type });
+            } else {
+                utils::throw_runtime_error_if(tokens.size() != 3, "Failed to parse PLY file: invalid property");
+
+                properties.push_back({ std::string(tokens[2]), ParseType(tokens[1]), std::nullopt });
+            }
+        } else {
+            utils::throw_runtime_error("Failed to parse PLY file: unknown header keyword");
+        }
+    }
+
+    utils::throw_runtime_error_if(!has_format, "Failed to parse PLY file: missing format");
+
+    for (auto& element : header.elements) {
+        utils::throw_runtime_error_if(
+            element.count > 0 && element.properties.empty(),
+            "Failed to parse PLY file: element without properties");
+
+        auto is_list  = [](const PlyProperty& property) { return property.count_type.has_value(); };
+        auto is_fixed = std::ranges::none_of(element.properties, is_list);
+        if (is_fixed) {
+            for (const auto& property : element.properties) {
+                element.record_size += SizeOf(property.type);
+            }
+        }
+    }
+
+    header.size = offset;
+
+    return header;
+}
+
+// Finds where every property of the record at 'data' starts. Returns the size of the record, or zero if it does not
+// fit into 'size' bytes.
+size_t LayoutRecord(const PlyElement& element, const char* data, size_t size, bool swap, size_t* offsets) noexcept
+{
+    auto offset = size_t{ 0 };
+
+    for (size_t i = 0; i != element.properties.size(); ++i) {
+        const auto& property = element.properties[i];
+
+        offsets[i] = offset;
+
+        if (property.count_type) {
+            auto count_size = SizeOf(*property.count_type);
+            if (count_size > size - offset) {
+                return 0;
+            }
+            auto count = ReadValue(data + offset, *property.count_type, swap);
+            if (count < 0.0) {
+                return 0;
+            }
+            offset += count_size;
+
+            auto list_size = static_cast<size_t>(count) * SizeOf(property.type);
+            if (list_size > size - offset) {
+                return 0;
+            }
+            offset += list_size;
+        } else {
+            if (SizeOf(property.type) > size - offset) {
+                return 0;
+            }
+            offset += SizeOf(property.type);
+        }
+    }
+
+    return offset;
+}
+
+// Start of every block of 'element' in 'data', followed by the end of the element. Elements of fixed size are laid out
+// arithmetically, the others are walked record by record. If 'list' is set, first_index counts the indices of the
+// triangle fans of that list property.
+auto ScanElement(const PlyElement& element, std::string_view data, bool swap, std::optional<size_t> list)
+    -> std::vector<PlyBlock>
+{
+    auto blocks      = std::vector<PlyBlock>{};
+    auto block_count = (element.count + kBlockSize - 1) / kBlockSize;
+
+    blocks.reserve(block_count + 1);
+
+    if (element.record_size != 0) {
+        utils::throw_runtime_error_if(
+            element.count > data.size() / element.record_size,
+            "Failed to parse PLY file: element out of file");
+
+        for (size_t block = 0; block <= block_count; ++block) {
+            blocks.push_back({ std::min(block * kBlockSize, element.count) * element.record_size, 0 });
+        }
+        return blocks;
+    }
+
+    auto offsets     = std::vector<size_t>(element.properties.size());
+    auto offset      = size_t{ 0 };
+    auto index_count = size_t{ 0 };
+
+    for (size_t i = 0; i != element.count; ++i) {
+        if (i % kBlockSize == 0) {
+            blocks.push_back({ offset, index_count });
+        }
+
+        auto record = data.data() + offset;
+        auto size   = LayoutRecord(element, record, data.size() - offset, swap, offsets.data());
+        utils::throw_runtime_error_if(size == 0, "Failed to parse PLY file: element out of file");
+
+        if (list) {
+            const auto& property = element.properties[*list];
+
+            auto count = static_cast<size_t>(ReadValue(record + offsets[*list], *property.count_type, swap));
+            index_count += count >= 3 ? 3 * (count - 2) : 0;
+        }
+
+        offset += size;
+    }
+
+    blocks.push_back({ offset, index_count });
+
+    return blocks;
+}
+
+auto FindProperty(const PlyElement& element, std::string_view name) -> std::optional<size_t>
+{
+    auto it = std::ranges::find(element.properties, name, &PlyProperty::name);
+    if (it == element.properties.end()) {
+        return std::nullopt;
+    }
+    return static_cast<size_t>(it - element.properties.begin());
+}
+
+} // namespace
+
+Geometry ReadPlyGeometry(const std::filesystem::path& filepath, ThreadPool* thread_pool, LoadProgress* progress)
+{
+    StartProgress(progress, "Reading header");
+
+    auto file   = MappedFile(filepath);
+    auto header = ParseHeader(file.View());
+    auto swap   = header.is_big_endian != (std::endian::native == std::endian::big);
+    auto data   = file.View().substr(header.size);
+
+    auto vertex_element = std::ranges::find(header.elements, "vertex", &PlyElement::name);
+    auto face_element   = std::ranges::find(header.elements, "face", &PlyElement::name);
+
+    utils::throw_runtime_error_if(
+        vertex_element == header.elements.end(),
+        "Failed to parse PLY file: missing vertices");
+
+    auto has_faces = face_element != header.elements.end() && face_element->count != 0;
+
+    auto vertex_count = vertex_element->count;
+
+    utils::throw_runtime_error_if(
+        vertex_count > std::numeric_limits<uint32_t>::max(),
+        "Failed to parse PLY file: too many vertices");
+
+    auto geometry = Geometry{};
+    auto aabb     = AABB{ { FLT_MAX, FLT_MAX, FLT_MAX }, { -FLT_MAX, -FLT_MAX, -FLT_MAX } };
+
+    // Elements after the last one that is read are not even scanned
+    auto last_element = has_faces ? std::max(vertex_element, face_element) : vertex_element;
+
+    for (auto element_it = header.elements.begin(); element_it <= last_element; ++element_it) {
+        const auto& element = *element_it;
+
+        auto list = std::optional<size_t>{};
+
+        if (element_it == face_element) {
+            list = FindProperty(element, "vertex_indices");
+            if (!list) {
+                list = FindProperty(element, "vertex_index");
+            }
+            auto is_valid = list && element.properties[*list].count_type && IsInteger(element.properties[*list].type);
+            utils::throw_runtime_error_if(!is_valid, "Failed to parse PLY file: faces without vertex indices");
+        }
+
+        auto blocks = ScanElement(element, data, swap, list);
+
+        auto block_count = blocks.size() - 1;
+        auto block_size  = [&element](size_t block) {
+            return std::min(kBlockSize, element.count - block * kBlockSize);
+        };
+
+        if (element_it == vertex_element) {
+            auto position = std::array{
+                FindProperty(element, "x"),
+                FindProperty(element, "y"),
+                FindProperty(element, "z"),
+            };
+            auto normal = std::array{
+                FindProperty(element, "nx"),
+                FindProperty(element, "ny"),
+                FindProperty(element, "nz"),
+            };
+
+            auto is_scalar = [&element](std::optional<size_t> property) {
+                return property && !element.properties[*property].count_type;
+            };
+
+            utils::throw_runtime_error_if(
+                !std::ranges::all_of(position, is_scalar),
+                "Failed to parse PLY file: vertices without position");
+
+            auto has_normal = std::ranges::all_of(normal, is_scalar);
+
+            geometry.vertices.assign(vertex_count, VertexPN(glm::vec3(0.0f), glm::vec3(0.0f)));
+
+            auto block_aabbs = std::vector<AABB>(block_count, aabb);
+
+            StartProgress(progress, "Reading vertices", vertex_count);
+
+            ParallelFor(thread_pool, block_count, [&](size_t block) {
+                auto offsets = std::vector<size_t>(element.properties.size());
+                auto offset  = blocks[block].offset;
+                auto first   = block * kBlockSize;
+                auto size    = size_t{ 0 };
+
+                auto& block_aabb = block_aabbs[block];
+
+                for (auto i = first; i != first + block_size(block); ++i) {
+                    auto record = data.data() + offset;
+
+                    if (element.record_size == 0 || i == first) {
+                        size = LayoutRecord(element, record, data.size() - offset, swap, offsets.data());
+                    }
+
+                    auto read = [&](const std::optional<size_t>& property) {
+                        const auto& type = element.properties[*property].type;
+                        return static_cast<float>(ReadValue(record + offsets[*property], type, swap));
+                    };
+
+                    auto& vertex = geometry.vertices[i];
+
+                    vertex.position = { read(position[0]), read(position[1]), read(position[2]) };
+                    if (has_normal) {
+                        vertex.normal = { read(normal[0]), read(normal[1]), read(normal[2]) };
+                    }
+
+                    block_aabb.Expand({ vertex.position.x, vertex.position.y, vertex.position.z });
+
+                    offset += size;
+                }
+
+                file.Discard(data.substr(blocks[block].offset, blocks[block + 1].offset - blocks[block].offset));
+
+                AdvanceProgress(progress, block_size(block));
+            });
+
+            for (const auto& block_aabb : block_aabbs) {
+                aabb.Expand(block_aabb.min);
+                aabb.Expand(block_aabb.max);
+            }
+        } else if (element_it == face_element) {
+            const auto& property = element.properties[*list];
+
+            geometry.indices.resize(blocks.back().first_index);
+
+            StartProgress(progress, "Reading faces", element.count);
+
+            ParallelFor(thread_pool, block_count, [&](size_t block) {
+                auto offsets = std::vector<size_t>(element.properties.size());
+                auto offset  = blocks[block].offset;
+                auto index   = geometry.indices.begin() + static_cast<ptrdiff_t>(blocks[block].first_index);
+
+                for (size_t i = 0; i != block_size(block); ++i) {
+                    auto record = data.data() + offset;
+
+                    offset += LayoutRecord(element, record, data.size() - offset, swap, offsets.data());
+
+                    auto list_data = record + offsets[*list];
+                    auto count     = static_cast<size_t>(ReadValue(list_data, *property.count_type, swap));
+
+                    list_data += SizeOf(*property.count_type);
+
+                    auto read = [&](size_t k) {
+                        auto value = ReadValue(list_data + k * SizeOf(property.type), property.type, swap);
+                        utils::throw_runtime_error_if(
+                            value < 0.0 || value >= static_cast<double>(vertex_count),
+                            "Failed to parse PLY file: vertex index out of range");
+                        return static_cast<uint32_t>(value);
+                    };
+
+                    if (count < 3) {
+                        continue;
+                    }
+
+                    auto first    = read(0);
+                    auto previous = read(1);
+
+                    for (size_t k = 2; k != count; ++k) {
+                        auto current = read(k);
+
+                        *index++ = first;
+                        *index++ = previous;
+                        *index++ = current;
+
+                        previous = current;
+                    }
+                }
+
+                file.Discard(data.substr(blocks[block].offset, blocks[block + 1].offset - blocks[block].offset));
+
+                AdvanceProgress(progress, block_size(block));
+            });
+        }
+
+        data.remove_prefix(blocks.back().offset);
+    }
+
+    // Files without faces are point clouds, drawn as one point per vertex
+    auto topology = has_faces ? Topology::Triangles : Topology::Points;
+
+    if (topology == Topology::Points) {
+        geometry.indices.resize(vertex_count);
+        std::iota(geometry.indices.begin(), geometry.indices.end(), uint32_t{ 0 });
+    }
+
+    // Faces of fewer than three vertices add no triangles
+    if (geometry.indices.empty()) {
+        spdlog::warn("File {} has nothing to draw", filepath.string());
+    } else {
+        auto mesh = MeshRecord{ .aabb = aabb, .material_id = -1, .index_count = geometry.indices.size() };
+        mesh.topology = topology;
+        geometry.shapes.push_back({ filepath.stem().string(), { mesh } });
+    }
+
+    return geometry;
+}
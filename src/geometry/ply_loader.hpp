@@ -0,0 +1,21 @@
+#pragma once
+
+#include "geometry.hpp"
+
+#include <filesystem>
+
+class LoadProgress;
+class ThreadPool;
+
+// Reads a binary .ply file, little or big endian, into a geometry of one shape holding one mesh. The header describes
+// the elements of the file. Vertices take their position from the x, y and z properties and their normal from nx, ny
+// and nz if present, and are zero otherwise, so GenerateNormals fills them in. Polygons of the vertex_indices list of
+// the face element are split into triangle fans. Other elements and properties are skipped.
+//
+// The file is mapped and every element is converted in blocks of records on the thread pool, straight into the vertex
+// and index arrays of the result, and the pages of a block are dropped once it is converted. Faces are variable in
+// size, so a sequential pass over their counts first finds where every block starts in the file and in the indices.
+// Files without faces, such as point clouds, get a mesh of Topology::Points with one index per vertex instead, and keep
+// zero normals where there are none. Throws std::runtime_error if the file is malformed or if an index is out of range.
+auto ReadPlyGeometry(const std::filesystem::path& filepath, ThreadPool* thread_pool, LoadProgress* progress = nullptr)
+    -> Geometry;
@@ -2,6 +2,7 @@
 
 #include "utils/cast.hpp"
 
+#include <array>
 #include <atomic>
 #include <ranges>
 #include <tuple>
@@ -18,6 +19,23 @@ static void to_json(json& json, ID id)
     json = id.value;
 }
 
+static void to_json(json& json, VertexLayout vertex_layout)
+{
+    switch (vertex_layout) {
+    case VertexLayout::Float: json = "float"; break;
+    case VertexLayout::Quantized: json = "quantized"; break;
+    case VertexLayout::Flat: json = "flat"; break;
+    }
+}
+
+static void to_json(json& json, Topology topology)
+{
+    switch (topology) {
+    case Topology::Triangles: json = "triangles"; break;
+    case Topology::Points: json = "points"; break;
+    }
+}
+
 struct ValueToJson final {
     void operator()(std::monostate) {}
     void operator()(ObjectPtr value) { j[key] = value->GetID(); }
@@ -94,7 +112,7 @@ static void to_json(json& json, const TranslateValues& values)
 }
 
 struct ScaleValues final {
-    const float factor;
+    const Float3 factor;
 };
 
 static void to_json(json& json, const ScaleValues& values)
@@ -374,27 +392,37 @@ json Mesh::ToJson() const
 
     json["value.first-index"]       = m_first_index;
     json["value.index-count"]       = m_index_count;
+    json["value.index-format"]      = m_index_format == IndexFormat::Uint16 ? 16 : 32;
+    json["value.vertex-offset"]     = m_vertex_offset;
+    json["value.vertex-layout"]     = m_vertex_layout;
+    json["value.topology"]          = m_topology;
     json["value.ref.vertex-buffer"] = m_vertex_buffer->GetID();
     json["value.ref.index-buffer"]  = m_index_buffer->GetID();
+    json["value.cluster-count"]     = m_clusters.size();
+
+    for (const auto& [first_index, index_count, error] : m_lods) {
+        json["value.lods"].push_back(
+            { { "first-index", first_index }, { "index-count", index_count }, { "error", error } });
+    }
 
     return json;
 }
 
 PropertyValue Mesh::GetProperty(std::string_view name) const
 {
-    auto triangles = utils::narrow_cast<int>(m_index_count / 3);
+    auto triangles = utils::narrow_cast<int>(m_topology == Topology::Triangles ? m_index_count / 3 : 0);
     return ObjectAccess::GetProperty(name, *this, std::make_tuple(triangles, m_aabb.min, m_aabb.max));
 }
 
 PropertyValue Mesh::GetProperty(std::string_view primary, std::string_view alternative) const
 {
-    auto triangles = utils::narrow_cast<int>(m_index_count / 3);
+    auto triangles = utils::narrow_cast<int>(m_topology == Topology::Triangles ? m_index_count / 3 : 0);
     return ObjectAccess::GetProperty(primary, alternative, *this, std::make_tuple(triangles, m_aabb.min, m_aabb.max));
 }
 
 std::vector<Property> Mesh::GetProperties() const
 {
-    auto triangles = utils::narrow_cast<int>(m_index_count / 3);
+    auto triangles = utils::narrow_cast<int>(m_topology == Topology::Triangles ? m_index_count / 3 : 0);
     return ObjectAccess::GetProperties(this, std::make_tuple(triangles, m_aabb.min, m_aabb.max));
 }
 
@@ -450,7 +478,13 @@ DrawList Scene::ComputeDrawList() const
     for (const auto& shader : m_shaders) {
         for (auto material : shader->GetMaterials()) {
             for (auto instance : material->GetInstanceNodes()) {
-                draw_list.push_back({ index++, instance->GetMeshPtr(), instance->GetTransform() });
+                auto mesh = instance->GetMeshPtr();
+                draw_list.push_back({ index++,
+                                      instance,
+                                      mesh,
+                                      instance->GetTransform(),
+                                      mesh->GetFirstIndex(),
+                                      mesh->GetIndexCount() });
             }
         }
     }
@@ -788,7 +822,8 @@ void ScaleNode::ApplyTransform(const glm::mat4& matrix) noexcept
 {
     for (auto& node : m_children) {
         auto node_ptr = static_cast<NodePtr>(node.get());
-        ObjectAccess::ApplyTransform(node_ptr, matrix * glm::scale(glm::vec3{ m_factor, m_factor, m_factor }));
+        auto factor   = glm::vec3(m_factor.x, m_factor.y, m_factor.z);
+        ObjectAccess::ApplyTransform(node_ptr, matrix * glm::scale(factor));
     }
 }
 
@@ -812,7 +847,7 @@ UniqueRotateNode Scene::CreateRotateNode(Float3 axis, Radians angle)
     return ObjectAccess::MakeUnique<RotateNode>(GetUniqueID(), NullParent, axis, angle);
 }
 
-UniqueScaleNode Scene::CreateScaleNode(float factor)
+UniqueScaleNode Scene::CreateScaleNode(Float3 factor)
 {
     return ObjectAccess::MakeUnique<ScaleNode>(GetUniqueID(), NullParent, factor);
 }
@@ -822,7 +857,7 @@ UniqueInstanceNode Scene::CreateInstanceNode(MeshPtr mesh, MaterialPtr material)
     return ObjectAccess::MakeUnique<InstanceNode>(GetUniqueID(), NullParent, mesh, material);
 }
 
-VertexBufferPtr Scene::CreateVertexBuffer(void* data, size_t size, std::align_val_t alignment)
+VertexBufferPtr Scene::CreateVertexBuffer(const void* data, size_t size, std::align_val_t alignment)
 {
     auto temp_owner    = ObjectAccess::MakeUnique<VertexBuffer>(GetUniqueID(), data, size, alignment);
     auto vertex_buffer = temp_owner.release();
@@ -831,7 +866,7 @@ VertexBufferPtr Scene::CreateVertexBuffer(void* data, size_t size, std::align_va
     return vertex_buffer;
 }
 
-IndexBufferPtr Scene::CreateIndexBuffer(void* data, size_t size, std::align_val_t alignment)
+IndexBufferPtr Scene::CreateIndexBuffer(const void* data, size_t size, std::align_val_t alignment)
 {
     auto temp_owner   = ObjectAccess::MakeUnique<IndexBuffer>(GetUniqueID(), data, size, alignment);
     auto index_buffer = temp_owner.release();
@@ -864,10 +899,29 @@ MeshPtr Scene::CreateMesh(
     VertexBufferPtr vertex_buffer,
     IndexBufferPtr  index_buffer,
     size_t          first_index,
-    size_t          index_count)
-{
-    auto unique_mesh =
-        ObjectAccess::MakeUnique<Mesh>(GetUniqueID(), aabb, vertex_buffer, index_buffer, first_index, index_count);
+    size_t          index_count,
+    IndexFormat     index_format,
+    size_t          vertex_offset,
+    VertexLayout    vertex_layout,
+    MeshLods        lods,
+    ClusterBounds   bounds,
+    MeshClusters    clusters,
+    Topology        topology)
+{
+    auto unique_mesh = ObjectAccess::MakeUnique<Mesh>(
+        GetUniqueID(),
+        aabb,
+        vertex_buffer,
+        index_buffer,
+        first_index,
+        index_count,
+        index_format,
+        vertex_offset,
+        vertex_layout,
+        std::move(lods),
+        bounds,
+        std::move(clusters),
+        topology);
     auto mesh = unique_mesh.release();
     if (auto [it, success] = m_objects.insert({ mesh->GetID(), std::unique_ptr<Object>(mesh) }); !success) {
         utils::throw_runtime_error("Cannot create mesh");
@@ -877,6 +931,26 @@ MeshPtr Scene::CreateMesh(
     return mesh;
 }
 
+void Scene::DestroyMesh(MeshPtr mesh)
+{
+    auto vertex_buffer = mesh->GetVertexBuffer();
+    auto index_buffer  = mesh->GetIndexBuffer();
+
+    std::erase(m_meshes, mesh);
+    std::erase(m_vertex_buffers, vertex_buffer);
+    std::erase(m_index_buffers, index_buffer);
+
+    auto ids = std::array{ mesh->GetID(),
+                           vertex_buffer ? vertex_buffer->GetID() : ID{},
+                           index_buffer ? index_buffer->GetID() : ID{} };
+
+    for (auto id : ids) {
+        if (id != ID{}) {
+            m_objects.erase(id);
+        }
+    }
+}
+
 json Scene::ToJson() const
 {
     json json;
@@ -992,7 +1066,7 @@ void Material::AddInstanceNodePtr(InstanceNodePtr instance_node)
     m_instances.push_back(instance_node);
 }
 
-Buffer::Buffer(ID id, void* src, size_t size, std::align_val_t alignment)
+Buffer::Buffer(ID id, const void* src, size_t size, std::align_val_t alignment)
     : Object(id), m_size(size), m_deleter{ alignment }
 {
     m_data.reset(::operator new(m_size, alignment));
@@ -73,6 +73,43 @@ using Meshes    = std::vector<MeshPtr>;
 using Nodes     = std::vector<NodePtr>;
 using Shaders   = std::vector<ShaderPtr>;
 
+// Width of the indices of a mesh in its index buffer
+enum class IndexFormat { Uint16, Uint32 };
+
+// Vertex type of a mesh, VertexPN, VertexPN16 or VertexP. Quantized positions are relative to the bounding box of the
+// mesh. Flat meshes have no normals and are shaded with their face normals, which spares the vertices that faceted
+// meshes duplicate for every face around a corner.
+enum class VertexLayout { Float, Quantized, Flat };
+
+// What the indices of a mesh draw. Point meshes have one index per point and no LODs or clusters.
+enum class Topology { Triangles, Points };
+
+// Simplified version of a mesh, a range in the index buffer of the mesh that uses the same vertices
+struct MeshLod final {
+    size_t first_index{}; // In indices of the index format of the mesh
+    size_t index_count{};
+    float  error{}; // Deviation from the full resolution surface, relative to the largest extent of the mesh
+};
+
+using MeshLods = std::vector<MeshLod>;
+
+// Bounding sphere and normal cone of a set of triangles, see ComputeClusterBounds
+struct ClusterBounds final {
+    glm::vec3 center{ 0.0f };
+    float     radius{};
+    glm::vec3 cone_axis{ 0.0f };   // Average face normal
+    float     cone_cutoff{ 1.0f }; // Sine of the largest angle of a face normal to the axis, 1 if above 90 degrees
+};
+
+// Cluster of triangles of a mesh, a range in the index buffer of the mesh within its full resolution range
+struct MeshCluster final {
+    size_t        first_index{}; // In indices of the index format of the mesh
+    size_t        index_count{};
+    ClusterBounds bounds;
+};
+
+using MeshClusters = std::vector<MeshCluster>;
+
 struct ID final {
     int value = 0;
 
@@ -137,7 +174,7 @@ class Buffer : public Object {
     auto Size() const noexcept { return m_size; }
 
   protected:
-    Buffer(ID id, void* src, size_t size, std::align_val_t alignment);
+    Buffer(ID id, const void* src, size_t size, std::align_val_t alignment);
 
     struct Deleter final {
         void             operator()(void* data) { ::operator delete(data, alignment); };
@@ -174,7 +211,9 @@ class VertexBuffer final : public Buffer {
     static constexpr std::array<std::string_view, 1> kFieldNames    = { "Size" };
     static constexpr std::array<bool, 1>             kFieldWritable = { false };
 
-    VertexBuffer(ID id, void* src, size_t size, std::align_val_t alignment) : Buffer(id, src, size, alignment) {}
+    VertexBuffer(ID id, const void* src, size_t size, std::align_val_t alignment)
+        : Buffer(id, src, size, alignment)
+    {}
 };
 
 class IndexBuffer final : public Buffer {
@@ -202,7 +241,9 @@ class IndexBuffer final : public Buffer {
     static constexpr std::array<std::string_view, 1> kFieldNames    = { "Size" };
     static constexpr std::array<bool, 1>             kFieldWritable = { false };
 
-    IndexBuffer(ID id, void* src, size_t size, std::align_val_t alignment) : Buffer(id, src, size, alignment) {}
+    IndexBuffer(ID id, const void* src, size_t size, std::align_val_t alignment)
+        : Buffer(id, src, size, alignment)
+    {}
 };
 
 class Mesh : public Object {
@@ -225,6 +266,17 @@ class Mesh : public Object {
     auto GetIndexBuffer() const noexcept { return m_index_buffer; }
     auto GetFirstIndex() const noexcept { return m_first_index; }
     auto GetIndexCount() const noexcept { return m_index_count; }
+    auto GetIndexFormat() const noexcept { return m_index_format; }
+    auto GetVertexOffset() const noexcept { return m_vertex_offset; }
+    auto GetVertexLayout() const noexcept { return m_vertex_layout; }
+    auto GetTopology() const noexcept { return m_topology; }
+
+    // Simplified levels, finest first
+    const auto& GetLods() const noexcept { return m_lods; }
+
+    // Bounds of the full resolution triangles, and the clusters they are split into in index order
+    auto        GetBounds() const noexcept { return m_bounds; }
+    const auto& GetClusters() const noexcept { return m_clusters; }
 
     json ToJson() const;
 
@@ -242,16 +294,32 @@ class Mesh : public Object {
         VertexBufferPtr vertex_buffer,
         IndexBufferPtr  index_buffer,
         size_t          first_index,
-        size_t          index_count) noexcept
+        size_t          index_count,
+        IndexFormat     index_format,
+        size_t          vertex_offset,
+        VertexLayout    vertex_layout,
+        MeshLods        lods,
+        ClusterBounds   bounds,
+        MeshClusters    clusters,
+        Topology        topology) noexcept
         : Object(id), m_aabb(aabb), m_vertex_buffer(vertex_buffer), m_index_buffer(index_buffer),
-          m_first_index(first_index), m_index_count(index_count)
+          m_first_index(first_index), m_index_count(index_count), m_index_format(index_format),
+          m_vertex_offset(vertex_offset), m_vertex_layout(vertex_layout), m_lods(std::move(lods)), m_bounds(bounds),
+          m_clusters(std::move(clusters)), m_topology(topology)
     {}
 
     AABB            m_aabb{};
     VertexBufferPtr m_vertex_buffer;
     IndexBufferPtr  m_index_buffer;
-    size_t          m_first_index;
+    size_t          m_first_index;   // In indices of 'm_index_format'
     size_t          m_index_count;
+    IndexFormat     m_index_format;
+    size_t          m_vertex_offset; // Added to every index before fetching the vertex
+    VertexLayout    m_vertex_layout;
+    MeshLods        m_lods;
+    ClusterBounds   m_bounds;
+    MeshClusters    m_clusters;
+    Topology        m_topology;
 };
 
 class Shader : public Object {
@@ -502,11 +570,11 @@ class ScaleNode final : public InnerNode {
     static constexpr std::array<std::string_view, 1> kFieldNames    = { "Factor" };
     static constexpr std::array<bool, 1>             kFieldWritable = { true };
 
-    ScaleNode(ID id, NodePtr parent, float factor) noexcept : InnerNode(id, parent), m_factor(factor) {}
+    ScaleNode(ID id, NodePtr parent, Float3 factor) noexcept : InnerNode(id, parent), m_factor(factor) {}
 
     virtual void ApplyTransform(const glm::mat4& matrix) noexcept override;
 
-    float m_factor;
+    Float3 m_factor; // Per axis
 };
 
 class InstanceNode final : public Node {
@@ -557,9 +625,12 @@ class InstanceNode final : public Node {
 };
 
 struct DrawRecord final {
-    size_t    index{};
-    MeshPtr   mesh{};
-    glm::mat4 transform{};
+    size_t          index{};
+    InstanceNodePtr instance{};
+    MeshPtr         mesh{};
+    glm::mat4       transform{};
+    size_t          first_index{}; // In indices of the index format of the mesh
+    size_t          index_count{}; // Of the mesh, of one of its LODs or of a run of its clusters
 };
 
 using DrawList = std::vector<DrawRecord>;
@@ -581,11 +652,11 @@ class Scene {
     auto CreateGroupNode() -> UniqueGroupNode;
     auto CreateTranslateNode(Float3 distance) -> UniqueTranslateNode;
     auto CreateRotateNode(Float3 axis, Radians angle) -> UniqueRotateNode;
-    auto CreateScaleNode(float factor) -> UniqueScaleNode;
+    auto CreateScaleNode(Float3 factor) -> UniqueScaleNode;
     auto CreateInstanceNode(MeshPtr mesh, MaterialPtr material) -> UniqueInstanceNode;
 
-    auto CreateVertexBuffer(void* data, size_t size, std::align_val_t alignment) -> VertexBufferPtr;
-    auto CreateIndexBuffer(void* data, size_t size, std::align_val_t alignment) -> IndexBufferPtr;
+    auto CreateVertexBuffer(const void* data, size_t size, std::align_val_t alignment) -> VertexBufferPtr;
+    auto CreateIndexBuffer(const void* data, size_t size, std::align_val_t alignment) -> IndexBufferPtr;
 
     auto CreateShader() -> ShaderPtr;
     auto CreateMaterial(ShaderPtr shader) -> MaterialPtr;
@@ -595,8 +666,20 @@ class Scene {
         VertexBufferPtr vertex_buffer,
         IndexBufferPtr  index_buffer,
         size_t          first_index,
-        size_t          index_count) -> MeshPtr;
-
+        size_t          index_count,
+        IndexFormat     index_format  = IndexFormat::Uint32,
+        size_t          vertex_offset = 0,
+        VertexLayout    vertex_layout = VertexLayout::Float,
+        MeshLods        lods          = {},
+        ClusterBounds   bounds        = {},
+        MeshClusters    clusters      = {},
+        Topology        topology      = Topology::Triangles) -> MeshPtr;
+
+    // Destroys 'mesh' along with its vertex and index buffers, which must not be shared with other meshes. No instance
+    // may refer to the mesh.
+    void DestroyMesh(MeshPtr mesh);
+
+    // Draw records of all instances at full resolution, see DrawListBuilder for the LOD selection
     auto ComputeDrawList() const -> DrawList;
 
     auto ComputeAxisAlignedBoundingBox() const -> AABB;
@@ -0,0 +1,158 @@
+#include "stl_loader.hpp"
+
+#include "load_progress.hpp"
+#include "mapped_file.hpp"
+#include "thread_pool.hpp"
+#include "utils/misc.hpp"
+#include "vertex_welder.hpp"
+
+BEGIN_DISABLE_WARNINGS
+
+#include <spdlog/spdlog.h>
+
+END_DISABLE_WARNINGS
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+constexpr size_t kHeaderSize   = 84; // 80 bytes of text followed by the triangle count
+constexpr size_t kTriangleSize = 50; // Normal, three vertices and a 16 bit attribute
+
+// Triangles per block of work
+constexpr size_t kBlockSize = size_t{ 1 } << 16;
+
+auto ReadFloat3(const char* data) noexcept -> glm::vec3
+{
+    auto value = glm::vec3{};
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+} // namespace
+
+Geometry ReadStlGeometry(
+    const std::filesystem::path& filepath,
+    const StlOptions&            options,
+    ThreadPool*                  thread_pool,
+    LoadProgress*                progress)
+{
+    auto file = MappedFile(filepath);
+    auto data = file.View();
+
+    auto triangle_count = uint32_t{};
+    if (data.size() >= kHeaderSize) {
+        std::memcpy(&triangle_count, data.data() + 80, sizeof(triangle_count));
+    }
+
+    // ASCII files start with "solid", but so do the headers of some binary exporters, so the size decides
+    if (data.size() < kHeaderSize || data.size() - kHeaderSize < size_t{ triangle_count } * kTriangleSize) {
+        utils::throw_runtime_error_if(
+            data.starts_with("solid"),
+            "Failed to parse STL file: only binary files are supported");
+        utils::throw_runtime_error_if(data.size() < kHeaderSize, "Failed to parse STL file: missing header");
+        utils::throw_runtime_error("Failed to parse STL file: truncated triangle data");
+    }
+
+    utils::throw_runtime_error_if(
+        size_t{ triangle_count } * 3 > std::numeric_limits<uint32_t>::max(),
+        "Failed to parse STL file: too many triangles");
+
+    auto is_stored = options.normals == StlNormals::Stored;
+    auto soup      = std::vector<VertexPN>(size_t{ triangle_count } * 3, VertexPN(glm::vec3(0.0f), glm::vec3(0.0f)));
+
+    auto block_count = (size_t{ triangle_count } + kBlockSize - 1) / kBlockSize;
+    auto empty_aabb  = AABB{ { FLT_MAX, FLT_MAX, FLT_MAX }, { -FLT_MAX, -FLT_MAX, -FLT_MAX } };
+    auto block_aabbs = std::vector<AABB>(block_count, empty_aabb);
+
+    StartProgress(progress, "Decoding triangles", triangle_count);
+
+    ParallelFor(thread_pool, block_count, [&](size_t block) {
+        auto first = block * kBlockSize;
+        auto last  = std::min(first + kBlockSize, size_t{ triangle_count });
+        auto range = data.substr(kHeaderSize + first * kTriangleSize, (last - first) * kTriangleSize);
+
+        auto& aabb = block_aabbs[block];
+
+        for (auto i = first; i != last; ++i) {
+            auto record = range.data() + (i - first) * kTriangleSize;
+
+            auto normal   = glm::vec3(0.0f);
+            auto vertices = &soup[3 * i];
+
+            for (size_t k = 0; k != 3; ++k) {
+                vertices[k].position = ReadFloat3(record + 12 * (k + 1));
+                aabb.Expand({ vertices[k].position.x, vertices[k].position.y, vertices[k].position.z });
+            }
+
+            if (is_stored) {
+                normal = ReadFloat3(record);
+
+                auto length = std::sqrt(glm::dot(normal, normal));
+                if (!(length > 0.0f) || !std::isfinite(length)) {
+                    auto edge1 = vertices[1].position - vertices[0].position;
+                    auto edge2 = vertices[2].position - vertices[0].position;
+
+                    normal = glm::cross(edge1, edge2);
+                    length = std::sqrt(glm::dot(normal, normal));
+                }
+                normal = length > 0.0f ? normal / length : glm::vec3(0.0f);
+
+                for (size_t k = 0; k != 3; ++k) {
+                    vertices[k].normal = normal;
+                }
+            }
+        }
+
+        file.Discard(range);
+
+        AdvanceProgress(progress, last - first);
+    });
+
+    StartProgress(progress, "Welding");
+
+    // Stored normals take part in the weld, so corners of different facets stay apart
+    auto [remap, unique] = is_stored ? WeldVertices(soup, WeldOptions{}, thread_pool)
+                                     : WeldPositions(soup, thread_pool);
+
+    auto geometry = Geometry{};
+
+    geometry.vertices.assign(unique.size(), VertexPN(glm::vec3(0.0f), glm::vec3(0.0f)));
+
+    ParallelFor(thread_pool, (unique.size() + kBlockSize - 1) / kBlockSize, [&](size_t block) {
+        auto last = std::min((block + 1) * kBlockSize, unique.size());
+        for (auto i = block * kBlockSize; i != last; ++i) {
+            geometry.vertices[i] = soup[unique[i]];
+        }
+    });
+
+    soup = {};
+
+    geometry.indices = std::move(remap);
+
+    spdlog::info(
+        "File {}: welded {} triangle corners into {} vertices",
+        filepath.string(),
+        geometry.indices.size(),
+        geometry.vertices.size());
+
+    if (!geometry.indices.empty()) {
+        auto aabb = empty_aabb;
+        for (const auto& block_aabb : block_aabbs) {
+            aabb.Expand(block_aabb.min);
+            aabb.Expand(block_aabb.max);
+        }
+
+        auto mesh = MeshRecord{ .aabb = aabb, .material_id = -1, .index_count = geometry.indices.size() };
+        geometry.shapes.push_back({ filepath.stem().string(), { mesh } });
+    }
+
+    return geometry;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "geometry.hpp"
+
+#include <filesystem>
+
+class LoadProgress;
+class ThreadPool;
+
+enum class StlNormals {
+    Smooth, // Left zero for GenerateNormals, which keeps the edges sharper than its crease angle
+    Stored, // The normal stored with every triangle, or its geometric normal if that is zero, so the facets stay flat
+};
+
+struct StlOptions final {
+    StlNormals normals = StlNormals::Smooth;
+};
+
+// Reads a binary .stl file into a geometry of one shape holding one mesh. Triangles are fixed-size records, which are
+// decoded in blocks on the thread pool into three vertices each, and the pages of a block are dropped once it is
+// decoded. The vertices are then welded through the sharded hash of WeldPositions, or of WeldVertices if stored
+// normals are kept, since STL has no shared vertices. Throws std::runtime_error if the file is ASCII or truncated.
+auto ReadStlGeometry(
+    const std::filesystem::path& filepath,
+    const StlOptions&            options,
+    ThreadPool*                  thread_pool,
+    LoadProgress*                progress = nullptr) -> Geometry;
@@ -0,0 +1,130 @@
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+ThreadPool::ThreadPool(size_t thread_count)
+{
+    thread_count = std::max(thread_count, size_t{ 1 });
+
+    m_threads.reserve(thread_count);
+
+    for (size_t i = 0; i < thread_count; ++i) {
+        m_threads.emplace_back([this]() { WorkerLoop(); });
+    }
+}
+
+ThreadPool::~ThreadPool() noexcept
+{
+    {
+        auto lock  = std::scoped_lock(m_mutex);
+        m_stopping = true;
+    }
+
+    m_condition.notify_all();
+
+    for (auto& thread : m_threads) {
+        thread.join();
+    }
+}
+
+void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t)>& function)
+{
+    if (count == 0) {
+        return;
+    }
+
+    struct State final {
+        std::atomic_size_t      next{ 0 };
+        std::atomic_size_t      done{ 0 };
+        std::mutex              mutex;
+        std::condition_variable condition;
+        std::exception_ptr      exception;
+    };
+
+    auto state = std::make_shared<State>();
+
+    auto run = [state, count, &function]() {
+        for (auto i = state->next++; i < count; i = state->next++) {
+            try {
+                function(i);
+            } catch (...) {
+                auto lock = std::scoped_lock(state->mutex);
+                if (!state->exception) {
+                    state->exception = std::current_exception();
+                }
+            }
+            if (++state->done == count) {
+                auto lock = std::scoped_lock(state->mutex);
+                state->condition.notify_all();
+            }
+        }
+    };
+
+    auto helper_count = std::min(count - 1, m_threads.size());
+
+    for (size_t i = 0; i < helper_count; ++i) {
+        Enqueue(run);
+    }
+
+    run();
+
+    {
+        auto lock = std::unique_lock(state->mutex);
+        state->condition.wait(lock, [&state, count]() { return state->done == count; });
+    }
+
+    if (state->exception) {
+        std::rethrow_exception(state->exception);
+    }
+}
+
+size_t ThreadPool::DefaultThreadCount() noexcept
+{
+    return std::max(std::thread::hardware_concurrency(), 1U);
+}
+
+void ThreadPool::Enqueue(std::function<void()> task)
+{
+    {
+        auto lock = std::scoped_lock(m_mutex);
+        m_tasks.push_back(std::move(task));
+    }
+
+    m_condition.notify_one();
+}
+
+void ThreadPool::WorkerLoop()
+{
+    while (true) {
+        auto task = std::function<void()>{};
+        {
+            auto lock = std::unique_lock(m_mutex);
+            m_condition.wait(lock, [this]() { return m_stopping || !m_tasks.empty(); });
+            if (m_stopping && m_tasks.empty()) {
+                return;
+            }
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+        }
+        task();
+    }
+}
+
+void ParallelFor(ThreadPool* thread_pool, size_t count, const std::function<void(size_t)>& function)
+{
+    if (thread_pool) {
+        thread_pool->ParallelFor(count, function);
+        return;
+    }
+
+    for (size_t i = 0; i != count; ++i) {
+        function(i);
+    }
+}
+
+size_t ThreadCount(const ThreadPool* thread_pool) noexcept
+{
+    return thread_pool ? thread_pool->ThreadCount() : 1;
+}
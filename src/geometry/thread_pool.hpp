@@ -0,0 +1,61 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+class ThreadPool {
+  public:
+    explicit ThreadPool(size_t thread_count = DefaultThreadCount());
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool() noexcept;
+
+    template <typename Function>
+    auto Submit(Function&& function) -> std::future<std::invoke_result_t<Function>>;
+
+    // Calls function(i) for every i in [0, count). The calling thread takes part in the work, so it is safe to call
+    // ParallelFor from inside a task that is already running on this pool.
+    void ParallelFor(size_t count, const std::function<void(size_t)>& function);
+
+    auto ThreadCount() const noexcept { return m_threads.size(); }
+
+    static size_t DefaultThreadCount() noexcept;
+
+  private:
+    void Enqueue(std::function<void()> task);
+    void WorkerLoop();
+
+    std::vector<std::thread>          m_threads;
+    std::deque<std::function<void()>> m_tasks;
+    std::mutex                        m_mutex;
+    std::condition_variable           m_condition;
+    bool                              m_stopping = false;
+};
+
+// Calls function(i) for every i in [0, count), on 'thread_pool' if it is not null and on the calling thread otherwise
+void ParallelFor(ThreadPool* thread_pool, size_t count, const std::function<void(size_t)>& function);
+
+// Threads of 'thread_pool', one if it is null
+size_t ThreadCount(const ThreadPool* thread_pool) noexcept;
+
+template <typename Function>
+auto ThreadPool::Submit(Function&& function) -> std::future<std::invoke_result_t<Function>>
+{
+    using Result = std::invoke_result_t<Function>;
+
+    auto task   = std::make_shared<std::packaged_task<Result()>>(std::forward<Function>(function));
+    auto future = task->get_future();
+
+    Enqueue([task]() { (*task)(); });
+
+    return future;
+}
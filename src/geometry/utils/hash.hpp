@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace detail {
+
+constexpr uint64_t kPrime1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t kPrime3 = 0x165667B19E3779F9ULL;
+constexpr uint64_t kPrime4 = 0x85EBCA77C2B2AE63ULL;
+constexpr uint64_t kPrime5 = 0x27D4EB2F165667C5ULL;
+
+inline uint64_t Rotl(uint64_t value, int bits) noexcept
+{
+    return (value << bits) | (value >> (64 - bits));
+}
+
+inline uint64_t Read64(const unsigned char* ptr) noexcept
+{
+    uint64_t value;
+    std::memcpy(&value, ptr, sizeof(value));
+    return value;
+}
+
+inline uint32_t Read32(const unsigned char* ptr) noexcept
+{
+    uint32_t value;
+    std::memcpy(&value, ptr, sizeof(value));
+    return value;
+}
+
+inline uint64_t Round(uint64_t acc, uint64_t input) noexcept
+{
+    return Rotl(acc + input * kPrime2, 31) * kPrime1;
+}
+
+inline uint64_t MergeRound(uint64_t acc, uint64_t value) noexcept
+{
+    return (acc ^ Round(0, value)) * kPrime1 + kPrime4;
+}
+
+} // namespace detail
+
+namespace utils {
+
+// 64-bit non-cryptographic hash (XXH64). Used to fingerprint file contents and geometry.
+inline uint64_t Hash64(const void* data, size_t size, uint64_t seed = 0) noexcept
+{
+    using namespace detail;
+
+    auto ptr  = static_cast<const unsigned char*>(data);
+    auto end  = ptr + size;
+    auto hash = uint64_t{};
+
+    if (size >= 32) {
+        uint64_t v1 = seed + kPrime1 + kPrime2;
+        uint64_t v2 = seed + kPrime2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - kPrime1;
+
+        for (; end - ptr >= 32; ptr += 32) {
+            v1 = Round(v1, Read64(ptr + 0));
+            v2 = Round(v2, Read64(ptr + 8));
+            v3 = Round(v3, Read64(ptr + 16));
+            v4 = Round(v4, Read64(ptr + 24));
+        }
+
+        hash = Rotl(v1, 1) + Rotl(v2, 7) + Rotl(v3, 12) + Rotl(v4, 18);
+        hash = MergeRound(hash, v1);
+        hash = MergeRound(hash, v2);
+        hash = MergeRound(hash, v3);
+        hash = MergeRound(hash, v4);
+    } else {
+        hash = seed + kPrime5;
+    }
+
+    hash += static_cast<uint64_t>(size);
+
+    for (; end - ptr >= 8; ptr += 8) {
+        hash ^= Round(0, Read64(ptr));
+        hash = Rotl(hash, 27) * kPrime1 + kPrime4;
+    }
+
+    if (end - ptr >= 4) {
+        hash ^= static_cast<uint64_t>(Read32(ptr)) * kPrime1;
+        hash = Rotl(hash, 23) * kPrime2 + kPrime3;
+        ptr += 4;
+    }
+
+    for (; ptr != end; ++ptr) {
+        hash ^= static_cast<uint64_t>(*ptr) * kPrime5;
+        hash = Rotl(hash, 11) * kPrime1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= kPrime2;
+    hash ^= hash >> 29;
+    hash *= kPrime3;
+    hash ^= hash >> 32;
+
+    return hash;
+}
+
+inline uint64_t HashCombine(uint64_t seed, uint64_t value) noexcept
+{
+    return Hash64(&value, sizeof(value), seed);
+}
+
+} // namespace utils
@@ -0,0 +1,91 @@
+#include "memory.hpp"
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <psapi.h>
+#elif defined(__APPLE__)
+#include <mach/mach.h>
+#include <sys/resource.h>
+#else
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <cstdio>
+#endif
+
+namespace utils {
+
+#ifdef _WIN32
+
+size_t GetResidentSetSize() noexcept
+{
+    auto counters = PROCESS_MEMORY_COUNTERS{};
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return 0;
+    }
+    return counters.WorkingSetSize;
+}
+
+size_t GetPeakResidentSetSize() noexcept
+{
+    auto counters = PROCESS_MEMORY_COUNTERS{};
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return 0;
+    }
+    return counters.PeakWorkingSetSize;
+}
+
+#elif defined(__APPLE__)
+
+size_t GetResidentSetSize() noexcept
+{
+    auto info   = mach_task_basic_info_data_t{};
+    auto count  = mach_msg_type_number_t{ MACH_TASK_BASIC_INFO_COUNT };
+    auto result = task_info(mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t>(&info), &count);
+    if (result != KERN_SUCCESS) {
+        return 0;
+    }
+    return static_cast<size_t>(info.resident_size);
+}
+
+size_t GetPeakResidentSetSize() noexcept
+{
+    auto usage = rusage{};
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+    return static_cast<size_t>(usage.ru_maxrss); // Bytes on macOS
+}
+
+#else
+
+size_t GetResidentSetSize() noexcept
+{
+    auto file = std::fopen("/proc/self/statm", "r");
+    if (file == nullptr) {
+        return 0;
+    }
+
+    long size     = 0;
+    long resident = 0;
+    auto count    = std::fscanf(file, "%ld %ld", &size, &resident);
+
+    std::fclose(file);
+
+    return count == 2 ? static_cast<size_t>(resident) * static_cast<size_t>(sysconf(_SC_PAGESIZE)) : 0;
+}
+
+size_t GetPeakResidentSetSize() noexcept
+{
+    auto usage = rusage{};
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+    return static_cast<size_t>(usage.ru_maxrss) * 1024; // Kilobytes on Linux
+}
+
+#endif
+
+} // namespace utils
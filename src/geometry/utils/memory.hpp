@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstddef>
+
+namespace utils {
+
+// Resident set size of the process in bytes, or zero if it cannot be determined
+auto GetResidentSetSize() noexcept -> size_t;
+
+// Highest resident set size of the process so far in bytes, or zero if it cannot be determined
+auto GetPeakResidentSetSize() noexcept -> size_t;
+
+} // namespace utils
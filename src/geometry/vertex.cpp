@@ -28,6 +28,8 @@ static const char* to_string_helper(VertexFlags value)
     switch (value) {
     case Position3f: return "Position3f";
     case Normal3f: return "Normal3f";
+    case Position4Unorm16: return "Position4Unorm16";
+    case NormalOctahedral2Snorm16: return "NormalOctahedral2Snorm16";
     default: utils::throw_runtime_error("Bad Enum");
     }
     return nullptr;
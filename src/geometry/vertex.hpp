@@ -3,7 +3,7 @@
 #include <string>
 #include <type_traits>
 
-enum VertexFlags { Position3f = 1, Normal3f = 2 };
+enum VertexFlags { Position3f = 1, Normal3f = 2, Position4Unorm16 = 4, NormalOctahedral2Snorm16 = 8 };
 
 std::string to_string(VertexFlags value);
 
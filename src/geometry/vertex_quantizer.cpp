@@ -0,0 +1,123 @@
+#include "vertex_quantizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+auto ToUnorm16(float value) noexcept
+{
+    return static_cast<uint16_t>(std::lround(std::clamp(value, 0.0f, 1.0f) * 65535.0f));
+}
+
+auto ToSnorm16(float value) noexcept
+{
+    return static_cast<int16_t>(std::lround(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+}
+
+} // namespace
+
+auto QuantizePosition(const glm::vec3& position, const AABB& aabb) noexcept -> glm::u16vec4
+{
+    auto normalize = [](float value, float min, float max) { return max > min ? (value - min) / (max - min) : 0.0f; };
+
+    return {
+        ToUnorm16(normalize(position.x, aabb.min.x, aabb.max.x)),
+        ToUnorm16(normalize(position.y, aabb.min.y, aabb.max.y)),
+        ToUnorm16(normalize(position.z, aabb.min.z, aabb.max.z)),
+        uint16_t{ 0 },
+    };
+}
+
+auto DequantizePosition(const glm::u16vec4& position, const AABB& aabb) noexcept -> glm::vec3
+{
+    return {
+        aabb.min.x + aabb.ExtentX() * static_cast<float>(position.x) / 65535.0f,
+        aabb.min.y + aabb.ExtentY() * static_cast<float>(position.y) / 65535.0f,
+        aabb.min.z + aabb.ExtentZ() * static_cast<float>(position.z) / 65535.0f,
+    };
+}
+
+auto EncodeOctahedral(const glm::vec3& normal) noexcept -> glm::i16vec2
+{
+    auto sum = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+    if (sum == 0.0f) {
+        return { int16_t{ 0 }, int16_t{ 0 } };
+    }
+
+    auto x = normal.x / sum;
+    auto y = normal.y / sum;
+
+    if (normal.z < 0.0f) {
+        auto folded_x = (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        auto folded_y = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+
+        x = folded_x;
+        y = folded_y;
+    }
+
+    return { ToSnorm16(x), ToSnorm16(y) };
+}
+
+auto DecodeOctahedral(const glm::i16vec2& normal) noexcept -> glm::vec3
+{
+    auto x    = std::max(static_cast<float>(normal.x) / 32767.0f, -1.0f);
+    auto y    = std::max(static_cast<float>(normal.y) / 32767.0f, -1.0f);
+    auto z    = 1.0f - std::abs(x) - std::abs(y);
+    auto fold = std::max(-z, 0.0f);
+
+    x += x >= 0.0f ? -fold : fold;
+    y += y >= 0.0f ? -fold : fold;
+
+    auto length = std::sqrt(x * x + y * y + z * z);
+
+    return length > 0.0f ? glm::vec3(x / length, y / length, z / length) : glm::vec3(0.0f);
+}
+
+auto QuantizeGeometry(const GeometryView& geometry) -> QuantizedGeometry
+{
+    constexpr auto kUnused = std::numeric_limits<uint32_t>::max();
+
+    // Geometry vertex -> vertex of the current mesh. Only the entries of the current mesh are set.
+    auto remap     = std::vector<uint32_t>(geometry.vertices.size(), kUnused);
+    auto used      = std::vector<uint32_t>{};
+    auto quantized = QuantizedGeometry{};
+
+    quantized.vertices.reserve(geometry.vertices.size());
+    quantized.indices.resize(geometry.indices.size());
+
+    for (const auto& shape : geometry.shapes) {
+        for (const auto& mesh : shape.meshes) {
+            auto quantize_range = [&](size_t first_index, size_t index_count) {
+                for (auto i = first_index; i != first_index + index_count; ++i) {
+                    auto  vertex = geometry.indices[i];
+                    auto& local  = remap[vertex];
+
+                    if (local == kUnused) {
+                        const auto& [position, normal] = geometry.vertices[vertex];
+
+                        local = utils::narrow_cast<uint32_t>(quantized.vertices.size());
+                        quantized.vertices.push_back(
+                            { QuantizePosition(position, mesh.aabb), EncodeOctahedral(normal) });
+                        used.push_back(vertex);
+                    }
+                    quantized.indices[i] = local;
+                }
+            };
+
+            quantize_range(mesh.first_index, mesh.index_count);
+
+            for (const auto& lod : geometry.lods.subspan(mesh.first_lod, mesh.lod_count)) {
+                quantize_range(lod.first_index, lod.index_count);
+            }
+
+            for (auto vertex : used) {
+                remap[vertex] = kUnused;
+            }
+            used.clear();
+        }
+    }
+
+    return quantized;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "geometry.hpp"
+
+#include <cstdint>
+#include <vector>
+
+// Maps 'position' to 16 bit unsigned normalized coordinates over 'aabb'. Axes along which the box is flat map to 0.
+auto QuantizePosition(const glm::vec3& position, const AABB& aabb) noexcept -> glm::u16vec4;
+
+// Inverse of QuantizePosition, up to the precision of the quantization
+auto DequantizePosition(const glm::u16vec4& position, const AABB& aabb) noexcept -> glm::vec3;
+
+// Octahedral encoding of a unit vector into two 16 bit signed normalized values. The vector is projected onto the
+// octahedron |x| + |y| + |z| = 1, whose lower half is folded over the upper half, and the result is stored as x and
+// y. shader.vert decodes it.
+auto EncodeOctahedral(const glm::vec3& normal) noexcept -> glm::i16vec2;
+
+// Inverse of EncodeOctahedral, the same as the one of shader.vert
+auto DecodeOctahedral(const glm::i16vec2& normal) noexcept -> glm::vec3;
+
+// Vertices of a geometry converted to VertexPN16. Every mesh has its own vertex range, quantized relative to the
+// bounding box of its mesh record, and indices[i] is the vertex of geometry.indices[i] in that range, so the mesh and
+// LOD records of the geometry stay valid. Vertices shared by several meshes are duplicated.
+struct QuantizedGeometry final {
+    std::vector<VertexPN16> vertices;
+    std::vector<uint32_t>   indices;
+};
+
+auto QuantizeGeometry(const GeometryView& geometry) -> QuantizedGeometry;
@@ -0,0 +1,641 @@
+#include "vertex_welder.hpp"
+
+#include "thread_pool.hpp"
+#include "utils/misc.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <tuple>
+
+namespace {
+
+constexpr uint32_t kEmptySlot         = std::numeric_limits<uint32_t>::max();
+constexpr size_t   kShardingThreshold = size_t{ 1 } << 16;
+constexpr size_t   kBlockSize         = size_t{ 1 } << 16;
+constexpr size_t   kMaxShardCount     = 1024;
+constexpr int64_t  kMaxCell           = int64_t{ 1 } << 40;
+
+// Open addressing hash table with linear probing. It stores element numbers only, the keys are compared through the
+// callbacks. The upper half of the hash is kept in every slot so most mismatches are rejected without a key compare.
+class ProbeTable final {
+  public:
+    explicit ProbeTable(size_t count) : m_slots(std::bit_ceil(std::max<size_t>(2 * count, 16)), Slot{ 0, kEmptySlot })
+    {}
+
+    // Returns the first element in the table equal to 'item', or inserts 'item' and returns it if there is none
+    template <typename Equal>
+    uint32_t FindOrInsert(uint64_t hash, uint32_t item, Equal&& equal) noexcept
+    {
+        auto mask = m_slots.size() - 1;
+        auto tag  = static_cast<uint32_t>(hash >> 32);
+
+        for (auto pos = static_cast<size_t>(hash) & mask;; pos = (pos + 1) & mask) {
+            auto& slot = m_slots[pos];
+            if (slot.item == kEmptySlot) {
+                slot = Slot{ tag, item };
+                return item;
+            }
+            if (slot.tag == tag && equal(slot.item)) {
+                return slot.item;
+            }
+        }
+    }
+
+    // Calls visit(item) for every element that was inserted with 'hash'. Elements with other hashes may be visited too.
+    template <typename Visit>
+    void ForEach(uint64_t hash, Visit&& visit) const noexcept
+    {
+        auto mask = m_slots.size() - 1;
+        auto tag  = static_cast<uint32_t>(hash >> 32);
+
+        for (auto pos = static_cast<size_t>(hash) & mask; m_slots[pos].item != kEmptySlot; pos = (pos + 1) & mask) {
+            if (m_slots[pos].tag == tag) {
+                visit(m_slots[pos].item);
+            }
+        }
+    }
+
+    void Insert(uint64_t hash, uint32_t item) noexcept
+    {
+        FindOrInsert(hash, item, [](uint32_t) { return false; });
+    }
+
+  private:
+    struct Slot final {
+        uint32_t tag;
+        uint32_t item;
+    };
+
+    std::vector<Slot> m_slots;
+};
+
+// SplitMix64 finalizer
+constexpr uint64_t Mix64(uint64_t value) noexcept
+{
+    value ^= value >> 30;
+    value *= 0xBF58476D1CE4E5B9ULL;
+    value ^= value >> 27;
+    value *= 0x94D049BB133111EBULL;
+    value ^= value >> 31;
+    return value;
+}
+
+constexpr uint64_t Combine(uint64_t seed, uint64_t value) noexcept
+{
+    return Mix64(seed ^ (value + 0x9E3779B97F4A7C15ULL + (seed << 6) + (seed >> 2)));
+}
+
+// Adding zero turns -0.0 into +0.0, so values that compare equal also hash equal
+inline uint64_t FloatBits(float value) noexcept
+{
+    return std::bit_cast<uint32_t>(value + 0.0f);
+}
+
+inline uint64_t HashPosition(const glm::vec3& position) noexcept
+{
+    return Combine(FloatBits(position.x) | (FloatBits(position.y) << 32), FloatBits(position.z));
+}
+
+inline uint64_t HashNormal(uint64_t seed, const glm::vec3& normal) noexcept
+{
+    return Combine(Combine(seed, FloatBits(normal.x) | (FloatBits(normal.y) << 32)), FloatBits(normal.z));
+}
+
+inline uint64_t HashIndex(const tinyobj::index_t& index) noexcept
+{
+    auto vertex   = static_cast<uint64_t>(static_cast<uint32_t>(index.vertex_index));
+    auto normal   = static_cast<uint64_t>(static_cast<uint32_t>(index.normal_index));
+    auto texcoord = static_cast<uint64_t>(static_cast<uint32_t>(index.texcoord_index));
+
+    return Combine(vertex | (normal << 32), texcoord);
+}
+
+inline bool IsFinite(const glm::vec3& position) noexcept
+{
+    return std::isfinite(position.x) && std::isfinite(position.y) && std::isfinite(position.z);
+}
+
+struct Cell final {
+    int64_t x, y, z;
+
+    bool operator==(const Cell&) const noexcept = default;
+};
+
+// 'position' must be finite, NaN has no cell. Beyond kMaxCell cells the cells are narrower than the spacing of floats,
+// so every float value gets a cell of its own there instead of all of them sharing the last one.
+inline Cell ComputeCell(const glm::vec3& position, float inverse_cell_size) noexcept
+{
+    auto coordinate = [inverse_cell_size](float value) {
+        auto cell = std::floor(static_cast<double>(value) * static_cast<double>(inverse_cell_size));
+        if (std::abs(cell) < static_cast<double>(kMaxCell)) {
+            return static_cast<int64_t>(cell);
+        }
+        auto bits = static_cast<int64_t>(std::bit_cast<uint32_t>(std::abs(value)));
+        return value < 0.0f ? -kMaxCell - bits : kMaxCell + bits;
+    };
+    return Cell{ coordinate(position.x), coordinate(position.y), coordinate(position.z) };
+}
+
+inline uint64_t HashCell(const Cell& cell) noexcept
+{
+    auto x = static_cast<uint64_t>(cell.x);
+    auto y = static_cast<uint64_t>(cell.y);
+    auto z = static_cast<uint64_t>(cell.z);
+
+    return Combine(Combine(Mix64(x), y), z);
+}
+
+// Welds elements [0, count) with a single table. Used for small inputs and when no thread pool is available.
+template <typename Hash, typename Equal>
+WeldResult WeldSequential(size_t count, Hash&& hash, Equal&& equal)
+{
+    auto result = WeldResult{};
+    auto table  = ProbeTable(count);
+
+    result.remap.resize(count);
+
+    for (uint32_t i = 0; i != count; ++i) {
+        auto first = table.FindOrInsert(hash(i), i, [&](uint32_t other) { return equal(i, other); });
+        if (first == i) {
+            result.remap[i] = static_cast<uint32_t>(result.unique.size());
+            result.unique.push_back(i);
+        } else {
+            result.remap[i] = result.remap[first];
+        }
+    }
+
+    return result;
+}
+
+// Welds elements [0, count) in parallel. Elements are distributed over shards by the top bits of their hash, so equal
+// elements always meet in the same shard, and every shard is welded by one task with its own table. Each shard is
+// processed in input order, which makes the result identical to the one of WeldSequential.
+template <typename Hash, typename Equal>
+WeldResult WeldSharded(size_t count, Hash&& hash, Equal&& equal, ThreadPool* thread_pool)
+{
+    auto shard_count = std::min(std::bit_ceil(4 * thread_pool->ThreadCount()), kMaxShardCount);
+    auto shard_shift = 64 - std::countr_zero(shard_count);
+    auto block_count = (count + kBlockSize - 1) / kBlockSize;
+
+    auto shard_of = [shard_shift](uint64_t value) { return static_cast<size_t>(value >> shard_shift); };
+
+    // Hash all elements and count them per block and shard
+    auto hashes  = std::vector<uint64_t>(count);
+    auto offsets = std::vector<size_t>(block_count * shard_count);
+
+    thread_pool->ParallelFor(block_count, [&](size_t block) {
+        auto end = std::min(count, (block + 1) * kBlockSize);
+        for (auto i = block * kBlockSize; i != end; ++i) {
+            hashes[i] = hash(static_cast<uint32_t>(i));
+            ++offsets[block * shard_count + shard_of(hashes[i])];
+        }
+    });
+
+    // Exclusive prefix sum in shard-major order gives every block its output position inside every shard
+    auto shard_ranges = std::vector<size_t>(shard_count + 1);
+    {
+        auto running = size_t{ 0 };
+        for (size_t shard = 0; shard != shard_count; ++shard) {
+            shard_ranges[shard] = running;
+            for (size_t block = 0; block != block_count; ++block) {
+                auto block_size = offsets[block * shard_count + shard];
+
+                offsets[block * shard_count + shard] = running;
+                running += block_size;
+            }
+        }
+        shard_ranges[shard_count] = running;
+    }
+
+    auto order = std::vector<uint32_t>(count);
+
+    thread_pool->ParallelFor(block_count, [&](size_t block) {
+        auto end = std::min(count, (block + 1) * kBlockSize);
+        for (auto i = block * kBlockSize; i != end; ++i) {
+            order[offsets[block * shard_count + shard_of(hashes[i])]++] = static_cast<uint32_t>(i);
+        }
+    });
+
+    // Find the first occurrence of every element
+    auto first = std::vector<uint32_t>(count);
+
+    thread_pool->ParallelFor(shard_count, [&](size_t shard) {
+        auto begin = shard_ranges[shard];
+        auto end   = shard_ranges[shard + 1];
+        auto table = ProbeTable(end - begin);
+
+        for (auto k = begin; k != end; ++k) {
+            auto i = order[k];
+
+            first[i] = table.FindOrInsert(hashes[i], i, [&](uint32_t other) { return equal(i, other); });
+        }
+    });
+
+    hashes = {};
+    order  = {};
+
+    // Number the first occurrences in input order
+    auto block_uniques = std::vector<size_t>(block_count + 1);
+
+    thread_pool->ParallelFor(block_count, [&](size_t block) {
+        auto end = std::min(count, (block + 1) * kBlockSize);
+        for (auto i = block * kBlockSize; i != end; ++i) {
+            block_uniques[block] += (first[i] == i);
+        }
+    });
+
+    std::exclusive_scan(block_uniques.begin(), block_uniques.end(), block_uniques.begin(), size_t{ 0 });
+
+    auto result = WeldResult{};
+
+    result.remap.resize(count);
+    result.unique.resize(block_uniques.back());
+
+    thread_pool->ParallelFor(block_count, [&](size_t block) {
+        auto end    = std::min(count, (block + 1) * kBlockSize);
+        auto unique = block_uniques[block];
+        for (auto i = block * kBlockSize; i != end; ++i) {
+            if (first[i] == i) {
+                result.remap[i]         = static_cast<uint32_t>(unique);
+                result.unique[unique++] = static_cast<uint32_t>(i);
+            }
+        }
+    });
+
+    thread_pool->ParallelFor(block_count, [&](size_t block) {
+        auto end = std::min(count, (block + 1) * kBlockSize);
+        for (auto i = block * kBlockSize; i != end; ++i) {
+            if (first[i] != i) {
+                result.remap[i] = result.remap[first[i]];
+            }
+        }
+    });
+
+    return result;
+}
+
+template <typename Hash, typename Equal>
+WeldResult WeldExact(size_t count, Hash&& hash, Equal&& equal, ThreadPool* thread_pool)
+{
+    utils::throw_runtime_error_if(count >= kEmptySlot, "Too many vertices to weld");
+
+    if (thread_pool == nullptr || thread_pool->ThreadCount() < 2 || count < kShardingThreshold) {
+        return WeldSequential(count, hash, equal);
+    }
+
+    return WeldSharded(count, hash, equal, thread_pool);
+}
+
+// Tolerance test of the spatial weld. Vertices are near if their positions are within 'position_epsilon' of each other
+// and their normals pass 'normal_threshold'. Anything above 1 disables the dot product test and requires equal normals.
+class SpatialTolerance final {
+  public:
+    SpatialTolerance(std::span<const VertexPN> vertices, float position_epsilon, float normal_threshold) noexcept
+        : m_vertices(vertices), m_inverse_cell_size(0.25f / position_epsilon), m_extent(position_epsilon),
+          m_squared_epsilon(position_epsilon * position_epsilon), m_normal_threshold(normal_threshold)
+    {}
+
+    Cell GetCell(uint32_t i) const noexcept { return ComputeCell(m_vertices[i].position, m_inverse_cell_size); }
+
+    // Calls visit(cell) for every grid cell touched by the epsilon box around vertex 'i', as long as visit returns true
+    template <typename Visit>
+    void ForEachCell(uint32_t i, Visit&& visit) const noexcept
+    {
+        auto first = ComputeCell(m_vertices[i].position - m_extent, m_inverse_cell_size);
+        auto last  = ComputeCell(m_vertices[i].position + m_extent, m_inverse_cell_size);
+
+        for (auto z = first.z; z <= last.z; ++z) {
+            for (auto y = first.y; y <= last.y; ++y) {
+                for (auto x = first.x; x <= last.x; ++x) {
+                    if (!visit(Cell{ x, y, z })) {
+                        return;
+                    }
+                }
+            }
+        }
+    }
+
+    bool IsNear(uint32_t lhs, uint32_t rhs) const noexcept
+    {
+        const auto& a = m_vertices[lhs];
+        const auto& b = m_vertices[rhs];
+
+        auto distance = a.position - b.position;
+        if (glm::dot(distance, distance) > m_squared_epsilon) {
+            return false;
+        }
+        if (m_normal_threshold > 1.0f) {
+            return a.normal == b.normal;
+        }
+        return glm::dot(a.normal, b.normal) >= m_normal_threshold;
+    }
+
+  private:
+    std::span<const VertexPN> m_vertices;
+    float                     m_inverse_cell_size;
+    glm::vec3                 m_extent;
+    float                     m_squared_epsilon;
+    float                     m_normal_threshold;
+};
+
+// Welds vertices within tolerance of each other. Every vertex is compared against the unique vertices in the grid cells
+// touched by the epsilon box around it, and merged into the earliest one that is within tolerance. Cells are a few
+// epsilons wide, so most lookups touch one or two cells per axis.
+WeldResult WeldSpatial(std::span<const VertexPN> vertices, const SpatialTolerance& tolerance)
+{
+    auto count  = vertices.size();
+    auto result = WeldResult{};
+    auto table  = ProbeTable(count);
+
+    result.remap.resize(count);
+
+    for (uint32_t i = 0; i != count; ++i) {
+        // NaN is never within tolerance of anything and has no grid cell, so such vertices are kept as they are
+        if (!IsFinite(vertices[i].position)) {
+            result.remap[i] = static_cast<uint32_t>(result.unique.size());
+            result.unique.push_back(i);
+            continue;
+        }
+
+        auto match = kEmptySlot;
+
+        tolerance.ForEachCell(i, [&](const Cell& cell) {
+            table.ForEach(HashCell(cell), [&](uint32_t other) {
+                if (other < match && tolerance.IsNear(i, other)) {
+                    match = other;
+                }
+            });
+            return true;
+        });
+
+        if (match == kEmptySlot) {
+            table.Insert(HashCell(tolerance.GetCell(i)), i);
+            result.remap[i] = static_cast<uint32_t>(result.unique.size());
+            result.unique.push_back(i);
+        } else {
+            result.remap[i] = result.remap[match];
+        }
+    }
+
+    return result;
+}
+
+// Welds vertices within tolerance of each other in parallel, with the same result as WeldSpatial. The vertices are
+// distributed over shards by the hash of their cell, as WeldSharded does with the hashes of its elements, and every
+// shard keeps its vertices sorted by cell in input order. The parallel passes then find for every vertex the earlier
+// vertices within tolerance. A vertex without any, called a root here, is unique in WeldSpatial as well, so the search
+// of a vertex stops at the earliest root within tolerance. A sequential pass over these short candidate lists then
+// picks the earliest unique candidate, as WeldSpatial does.
+WeldResult WeldSpatialSharded(
+    std::span<const VertexPN> vertices,
+    const SpatialTolerance&   tolerance,
+    ThreadPool*               thread_pool)
+{
+    auto count       = vertices.size();
+    auto shard_count = std::min(std::bit_ceil(4 * thread_pool->ThreadCount()), kMaxShardCount);
+    auto shard_shift = 64 - std::countr_zero(shard_count);
+    auto block_count = (count + kBlockSize - 1) / kBlockSize;
+
+    auto shard_of = [shard_shift](uint64_t value) { return static_cast<size_t>(value >> shard_shift); };
+
+    // Cell of every finite vertex, counted per block and shard
+    auto is_finite = std::vector<uint8_t>(count);
+    auto cells     = std::vector<Cell>(count);
+    auto hashes    = std::vector<uint64_t>(count);
+    auto offsets   = std::vector<size_t>(block_count * shard_count);
+
+    thread_pool->ParallelFor(block_count, [&](size_t block) {
+        auto end = std::min(count, (block + 1) * kBlockSize);
+        for (auto i = block * kBlockSize; i != end; ++i) {
+            is_finite[i] = IsFinite(vertices[i].position);
+            if (is_finite[i]) {
+                cells[i]  = tolerance.GetCell(static_cast<uint32_t>(i));
+                hashes[i] = HashCell(cells[i]);
+                ++offsets[block * shard_count + shard_of(hashes[i])];
+            }
+        }
+    });
+
+    auto shard_ranges = std::vector<size_t>(shard_count + 1);
+    {
+        auto running = size_t{ 0 };
+        for (size_t shard = 0; shard != shard_count; ++shard) {
+            shard_ranges[shard] = running;
+            for (size_t block = 0; block != block_count; ++block) {
+                auto block_size = offsets[block * shard_count + shard];
+
+                offsets[block * shard_count + shard] = running;
+                running += block_size;
+            }
+        }
+        shard_ranges[shard_count] = running;
+    }
+
+    auto order = std::vector<uint32_t>(shard_ranges[shard_count]);
+
+    thread_pool->ParallelFor(block_count, [&](size_t block) {
+        auto end = std::min(count, (block + 1) * kBlockSize);
+        for (auto i = block * kBlockSize; i != end; ++i) {
+            if (is_finite[i]) {
+                order[offsets[block * shard_count + shard_of(hashes[i])]++] = static_cast<uint32_t>(i);
+            }
+        }
+    });
+
+    // Every shard sorts its vertices by cell, keeping the input order within a cell, and indexes the first of each cell
+    auto tables = std::vector<ProbeTable>{};
+
+    tables.reserve(shard_count);
+    for (size_t shard = 0; shard != shard_count; ++shard) {
+        tables.emplace_back(shard_ranges[shard + 1] - shard_ranges[shard]);
+    }
+
+    auto is_less = [&cells](uint32_t lhs, uint32_t rhs) {
+        return std::tie(cells[lhs].x, cells[lhs].y, cells[lhs].z) < std::tie(cells[rhs].x, cells[rhs].y, cells[rhs].z);
+    };
+
+    thread_pool->ParallelFor(shard_count, [&](size_t shard) {
+        auto begin = order.begin() + static_cast<ptrdiff_t>(shard_ranges[shard]);
+        auto end   = order.begin() + static_cast<ptrdiff_t>(shard_ranges[shard + 1]);
+
+        std::stable_sort(begin, end, is_less);
+
+        for (auto k = shard_ranges[shard]; k != shard_ranges[shard + 1]; ++k) {
+            if (k == shard_ranges[shard] || cells[order[k]] != cells[order[k - 1]]) {
+                tables[shard].Insert(hashes[order[k]], static_cast<uint32_t>(k));
+            }
+        }
+    });
+
+    // Calls visit(vertex) for the vertices of 'cell' in input order, as long as visit returns true
+    auto for_each_in_cell = [&](const Cell& cell, auto&& visit) {
+        auto hash  = HashCell(cell);
+        auto shard = shard_of(hash);
+        auto end   = shard_ranges[shard + 1];
+
+        tables[shard].ForEach(hash, [&](uint32_t start) {
+            if (cells[order[start]] != cell) {
+                return;
+            }
+            for (auto k = size_t{ start }; k != end && cells[order[k]] == cell; ++k) {
+                if (!visit(order[k])) {
+                    return;
+                }
+            }
+        });
+    };
+
+    // Roots have no earlier vertex within tolerance
+    auto is_root = std::vector<uint8_t>(count);
+
+    thread_pool->ParallelFor(block_count, [&](size_t block) {
+        auto end = std::min(count, (block + 1) * kBlockSize);
+        for (auto i = static_cast<uint32_t>(block * kBlockSize); i != end; ++i) {
+            auto has_earlier = false;
+            if (is_finite[i]) {
+                tolerance.ForEachCell(i, [&](const Cell& cell) {
+                    for_each_in_cell(cell, [&](uint32_t other) {
+                        if (other >= i) {
+                            return false;
+                        }
+                        has_earlier = tolerance.IsNear(i, other);
+                        return !has_earlier;
+                    });
+                    return !has_earlier;
+                });
+            }
+            is_root[i] = !has_earlier;
+        }
+    });
+
+    // Earlier vertices within tolerance of every other vertex, ascending and up to the earliest root among them
+    auto candidates      = std::vector<std::vector<uint32_t>>(block_count);
+    auto candidate_count = std::vector<uint32_t>(count);
+
+    thread_pool->ParallelFor(block_count, [&](size_t block) {
+        auto end = std::min(count, (block + 1) * kBlockSize);
+        for (auto i = static_cast<uint32_t>(block * kBlockSize); i != end; ++i) {
+            if (is_root[i]) {
+                continue;
+            }
+
+            auto& list  = candidates[block];
+            auto  first = list.size();
+            auto  limit = i;
+
+            tolerance.ForEachCell(i, [&](const Cell& cell) {
+                for_each_in_cell(cell, [&](uint32_t other) {
+                    if (other >= limit) {
+                        return false;
+                    }
+                    if (tolerance.IsNear(i, other)) {
+                        list.push_back(other);
+                        limit = is_root[other] ? other : limit;
+                    }
+                    return true;
+                });
+                return true;
+            });
+
+            std::sort(list.begin() + static_cast<ptrdiff_t>(first), list.end());
+            list.erase(std::upper_bound(list.begin() + static_cast<ptrdiff_t>(first), list.end(), limit), list.end());
+
+            candidate_count[i] = static_cast<uint32_t>(list.size() - first);
+        }
+    });
+
+    hashes = {};
+    order  = {};
+    tables = {};
+    cells  = {};
+
+    // Merge every vertex into its earliest unique candidate, in input order
+    auto result    = WeldResult{};
+    auto is_unique = std::vector<uint8_t>(count);
+
+    result.remap.resize(count);
+
+    for (size_t block = 0; block != block_count; ++block) {
+        auto end  = std::min(count, (block + 1) * kBlockSize);
+        auto next = candidates[block].begin();
+
+        for (auto i = static_cast<uint32_t>(block * kBlockSize); i != end; ++i) {
+            auto last  = next + candidate_count[i];
+            auto match = std::find_if(next, last, [&is_unique](uint32_t other) { return is_unique[other] != 0; });
+
+            if (match == last) {
+                is_unique[i]    = 1;
+                result.remap[i] = static_cast<uint32_t>(result.unique.size());
+                result.unique.push_back(i);
+            } else {
+                result.remap[i] = result.remap[*match];
+            }
+
+            next = last;
+        }
+    }
+
+    return result;
+}
+
+} // namespace
+
+WeldResult WeldIndices(std::span<const tinyobj::index_t> indices, ThreadPool* thread_pool)
+{
+    auto hash  = [indices](uint32_t i) { return HashIndex(indices[i]); };
+    auto equal = [indices](uint32_t lhs, uint32_t rhs) {
+        return (indices[lhs].vertex_index == indices[rhs].vertex_index) &&
+               (indices[lhs].normal_index == indices[rhs].normal_index) &&
+               (indices[lhs].texcoord_index == indices[rhs].texcoord_index);
+    };
+
+    return WeldExact(indices.size(), hash, equal, thread_pool);
+}
+
+WeldResult WeldVertices(std::span<const VertexPN> vertices, const WeldOptions& options, ThreadPool* thread_pool)
+{
+    utils::throw_runtime_error_if(vertices.size() >= kEmptySlot, "Too many vertices to weld");
+
+    // Anything above 1 disables the dot product test and requires equal normals instead
+    auto normal_threshold = options.normal_epsilon > 0.0f ? std::cos(options.normal_epsilon) : 2.0f;
+
+    if (options.position_epsilon > 0.0f) {
+        // Smaller tolerances would make the cells of the grid infinitely small
+        auto position_epsilon = std::max(options.position_epsilon, std::numeric_limits<float>::min());
+        auto tolerance        = SpatialTolerance(vertices, position_epsilon, normal_threshold);
+
+        if (thread_pool == nullptr || thread_pool->ThreadCount() < 2 || vertices.size() < kShardingThreshold) {
+            return WeldSpatial(vertices, tolerance);
+        }
+        return WeldSpatialSharded(vertices, tolerance, thread_pool);
+    }
+
+    if (options.normal_epsilon > 0.0f) {
+        // Only the position is hashed, the normals are compared with the tolerance
+        auto hash  = [vertices](uint32_t i) { return HashPosition(vertices[i].position); };
+        auto equal = [vertices, normal_threshold](uint32_t lhs, uint32_t rhs) {
+            return (vertices[lhs].position == vertices[rhs].position) &&
+                   (glm::dot(vertices[lhs].normal, vertices[rhs].normal) >= normal_threshold);
+        };
+        return WeldExact(vertices.size(), hash, equal, thread_pool);
+    }
+
+    auto hash = [vertices](uint32_t i) {
+        return HashNormal(HashPosition(vertices[i].position), vertices[i].normal);
+    };
+    auto equal = [vertices](uint32_t lhs, uint32_t rhs) {
+        return (vertices[lhs].position == vertices[rhs].position) && (vertices[lhs].normal == vertices[rhs].normal);
+    };
+    return WeldExact(vertices.size(), hash, equal, thread_pool);
+}
+
+WeldResult WeldPositions(std::span<const VertexPN> vertices, ThreadPool* thread_pool)
+{
+    auto hash  = [vertices](uint32_t i) { return HashPosition(vertices[i].position); };
+    auto equal = [vertices](uint32_t lhs, uint32_t rhs) { return vertices[lhs].position == vertices[rhs].position; };
+
+    return WeldExact(vertices.size(), hash, equal, thread_pool);
+}
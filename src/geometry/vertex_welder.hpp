@@ -0,0 +1,42 @@
+#pragma once
+
+#include "geometry.hpp"
+#include "platform.hpp"
+
+BEGIN_DISABLE_WARNINGS
+
+#include "tiny_obj_loader.h"
+
+END_DISABLE_WARNINGS
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+class ThreadPool;
+
+struct WeldOptions final {
+    // Vertices whose positions are within this distance of each other are merged. Zero requires equal positions.
+    float position_epsilon = 0.0f;
+    // Maximum angle in radians between the normals of merged vertices. Zero requires equal normals.
+    float normal_epsilon = 0.0f;
+};
+
+// Output of a weld. Unique vertices are numbered in order of their first occurrence in the input.
+struct WeldResult final {
+    std::vector<uint32_t> remap;  // Input element -> unique vertex
+    std::vector<uint32_t> unique; // Unique vertex -> input element of its first occurrence
+};
+
+// Merges equal OBJ index triples. The whole triple is hashed and compared.
+auto WeldIndices(std::span<const tinyobj::index_t> indices, ThreadPool* thread_pool) -> WeldResult;
+
+// Merges equal or, if 'options' has non-zero tolerances, nearby vertices. Nearby vertices are found through a spatial
+// hash of grid cells four times position_epsilon wide. Each vertex is merged into the earliest unique vertex within
+// tolerance, and the result does not depend on the thread count. With a position tolerance, vertices at non-finite
+// positions are left unmerged, and a position_epsilon below the smallest normal float is raised to it.
+auto WeldVertices(std::span<const VertexPN> vertices, const WeldOptions& options, ThreadPool* thread_pool)
+    -> WeldResult;
+
+// Merges vertices at equal positions regardless of their normals, see VertexLayout::Flat
+auto WeldPositions(std::span<const VertexPN> vertices, ThreadPool* thread_pool) -> WeldResult;
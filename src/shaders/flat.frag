@@ -0,0 +1,29 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+struct LightDescription
+{
+    vec4 color;
+    vec4 dir;
+};
+
+layout (binding = 10) uniform Lights
+{
+    LightDescription key;
+    LightDescription fill;
+};
+
+layout(location = 0) in vec3 inPosition;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    // The position varies linearly across a triangle, so its screen space derivatives span the plane of the triangle.
+    // Window y grows downwards, which makes dFdy x dFdx point towards the viewer for front faces.
+    vec3 normal = normalize(cross(dFdy(inPosition), dFdx(inPosition)));
+
+    vec4 key  = key.color * max(0, dot(vec3(key.dir), normal));
+    vec4 fill = fill.color * max(0, dot(vec3(fill.dir), normal));
+
+    outColor = key + fill;
+}
@@ -0,0 +1,30 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout (binding = 0) uniform ModelTransform
+{
+    mat4 model;
+    vec4 position_scale;
+    vec4 position_offset;
+    uint octahedral_normals;
+};
+
+layout (binding = 1) uniform CameraTransform
+{
+    mat4 view;
+    mat4 proj;
+};
+
+layout(location = 0) in vec3 inPosition;
+
+layout(location = 0) out vec3 outPosition;
+
+void main() {
+    vec3 position = position_offset.xyz + position_scale.xyz * inPosition;
+
+    // In world space like the lights, so the face normal derived from it follows the rotation of the mesh
+    vec4 world_position = model * vec4(position, 1.0);
+
+    gl_Position = proj * view * world_position;
+    outPosition = world_position.xyz;
+}
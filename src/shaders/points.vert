@@ -0,0 +1,32 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout (binding = 0) uniform ModelTransform
+{
+    mat4 model;
+    vec4 position_scale;
+    vec4 position_offset;
+    uint octahedral_normals;
+};
+
+layout (binding = 1) uniform CameraTransform
+{
+    mat4 view;
+    mat4 proj;
+};
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inNormal;
+
+layout(location = 0) out vec3 outNormal;
+
+void main() {
+    // Point meshes are always VertexLayout::Float, so the position and normal are taken as they are. Points without a
+    // normal face the camera, whose backward axis in world space is the third row of the view rotation.
+    vec3 normal = dot(inNormal, inNormal) > 0.0 ? transpose(inverse(mat3(model))) * inNormal
+                                                : vec3(0.0, 0.0, 1.0) * mat3(view);
+
+    gl_Position  = proj * view * model * vec4(inPosition, 1.0);
+    gl_PointSize = 1.0;
+    outNormal    = normalize(normal);
+}
@@ -4,6 +4,9 @@
 layout (binding = 0) uniform ModelTransform
 {
     mat4 model;
+    vec4 position_scale;
+    vec4 position_offset;
+    uint octahedral_normals;
 };
 
 layout (binding = 1) uniform CameraTransform
@@ -17,7 +20,25 @@ layout(location = 1) in vec3 inNormal;
 
 layout(location = 0) out vec3 outNormal;
 
+// Inverse of EncodeOctahedral in vertex_quantizer.cpp
+vec3 DecodeOctahedral(vec2 encoded)
+{
+    vec3  normal = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    float fold   = max(-normal.z, 0.0);
+
+    normal.x += normal.x >= 0.0 ? -fold : fold;
+    normal.y += normal.y >= 0.0 ? -fold : fold;
+
+    return normalize(normal);
+}
+
 void main() {
-    gl_Position = proj * view * model * vec4(inPosition, 1.0);
-    outNormal = inNormal;
+    // Quantized positions arrive as unorm values in [0, 1] relative to the bounding box of the mesh
+    vec3 position = position_offset.xyz + position_scale.xyz * inPosition;
+    vec3 normal   = octahedral_normals != 0 ? DecodeOctahedral(inNormal.xy) : inNormal;
+
+    // The lights are given in world space. The inverse transpose keeps normals perpendicular to their surface under
+    // any scale; for the rotations of deduplicated instances it is the rotation itself.
+    gl_Position = proj * view * model * vec4(position, 1.0);
+    outNormal = normalize(transpose(inverse(mat3(model))) * normal);
 }
@@ -2,6 +2,8 @@
 
 #include "etna/command.hpp"
 
+#include <algorithm>
+
 void BufferManager::CreateBuffer(BufferPtr buffer, etna::BufferUsage buffer_usage)
 {
     using namespace etna;
@@ -29,10 +31,24 @@ etna::Buffer BufferManager::GetBuffer(BufferPtr buffer) const noexcept
     return {};
 }
 
+void BufferManager::DestroyBuffer(BufferPtr buffer)
+{
+    if (auto it = std::ranges::find(m_records, buffer->GetID(), &Record::id); it != m_records.end()) {
+        if (it->gpu_buffer) {
+            m_retired.push_back({ std::move(it->gpu_buffer), m_frame });
+        }
+        m_records.erase(it);
+    }
+}
+
 void BufferManager::Upload()
 {
     using namespace etna;
 
+    if (std::ranges::all_of(m_records, [](const Record& record) { return static_cast<bool>(record.gpu_buffer); })) {
+        return;
+    }
+
     auto cmd_pool   = m_device.CreateCommandPool(m_transfer_queue.FamilyIndex(), CommandPoolCreate::Transient);
     auto cmd_buffer = cmd_pool->AllocateCommandBuffer();
 
@@ -48,9 +64,22 @@ void BufferManager::Upload()
 
     cmd_buffer->End();
 
-    m_transfer_queue.Submit(*cmd_buffer);
+    // Only the copies are waited for, the frames in flight do not read the new buffers
+    auto fence = m_device.CreateFence();
 
-    m_device.WaitIdle(); // TODO
+    m_transfer_queue.Submit(*cmd_buffer, {}, {}, {}, *fence);
+    m_device.WaitForFence(*fence);
+
+    // The staging copies are not needed once the data is on the GPU. Freeing them keeps progressive loading of large
+    // files from holding a second copy of the whole scene in host memory.
+    for (auto& record : m_records) {
+        record.host_buffer.reset();
+    }
+}
+
+void BufferManager::NextFrame()
+{
+    ++m_frame;
 
-    // TODO: Clear CPU buffers
+    std::erase_if(m_retired, [this](const RetiredBuffer& retired) { return retired.frame + m_frame_count <= m_frame; });
 }
@@ -8,7 +8,9 @@
 
 class BufferManager {
   public:
-    BufferManager(etna::Device device, etna::Queue transfer_queue) : m_device(device), m_transfer_queue(transfer_queue)
+    // 'frame_count' is the number of frames the render loop keeps in flight
+    BufferManager(etna::Device device, etna::Queue transfer_queue, uint32_t frame_count)
+        : m_device(device), m_transfer_queue(transfer_queue), m_frame_count(frame_count)
     {}
 
     BufferManager(const BufferManager&) = delete;
@@ -21,8 +23,17 @@ class BufferManager {
 
     auto GetBuffer(BufferPtr buffer) const noexcept -> etna::Buffer;
 
+    // Forgets the buffer. Frames in flight may still read its GPU copy, which is freed by NextFrame once they are done.
+    void DestroyBuffer(BufferPtr buffer);
+
+    // Copies the new buffers to the GPU and waits on a fence for the copies only, so frames in flight keep running.
+    // The buffers can be drawn from by anything submitted after the call.
     void Upload();
 
+    // Called by the render loop once the fence of the frame about to be recorded has been waited for, which means that
+    // the frame recorded 'frame_count' frames earlier is done. Frees the GPU copies destroyed before that frame.
+    void NextFrame();
+
   private:
     struct Record final {
         ID                 id{};
@@ -31,8 +42,16 @@ class BufferManager {
         etna::UniqueBuffer gpu_buffer{};
     };
 
+    struct RetiredBuffer final {
+        etna::UniqueBuffer gpu_buffer{};
+        uint64_t           frame{}; // Last frame recorded before the buffer was destroyed
+    };
+
     etna::Device m_device;
     etna::Queue  m_transfer_queue;
+    uint32_t     m_frame_count{};
+    uint64_t     m_frame{}; // Frames recorded so far
 
-    std::vector<Record> m_records;
+    std::vector<Record>        m_records;
+    std::vector<RetiredBuffer> m_retired;
 };
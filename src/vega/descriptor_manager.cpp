@@ -88,7 +88,7 @@ uint32_t DescriptorManager::Set(size_t frame_index, size_t transform_index, cons
 
     auto offset = transform_index * m_offset_multiplier;
 
-    std::memcpy(frame_state.model.mapped_memory + offset, &model, m_offset_multiplier);
+    std::memcpy(frame_state.model.mapped_memory + offset, &model, sizeof(model));
 
     return etna::narrow_cast<uint32_t>(offset);
 }
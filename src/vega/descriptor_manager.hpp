@@ -15,6 +15,12 @@ END_DISABLE_WARNINGS
 
 struct ModelUniform final {
     glm::mat4 model;
+
+    // Vertex decoding, see VertexLayout. Positions are scaled and offset, normals are octahedral encoded if
+    // 'octahedral_normals' is not zero. The defaults leave VertexPN vertices unchanged.
+    glm::vec4 position_scale     = glm::vec4(1.0f);
+    glm::vec4 position_offset    = glm::vec4(0.0f);
+    uint32_t  octahedral_normals = 0;
 };
 
 struct CameraUniform final {
@@ -0,0 +1,154 @@
+#include "draw_list_builder.hpp"
+
+#include "camera.hpp"
+#include "meshlet_builder.hpp"
+#include "static_batcher.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <span>
+#include <utility>
+
+namespace {
+
+// Bounding box of 'aabb' transformed by 'transform'
+AABB TransformBoundingBox(const AABB& aabb, const glm::mat4& transform) noexcept
+{
+    constexpr auto kMax = std::numeric_limits<float>::max();
+
+    auto out = AABB{ { kMax, kMax, kMax }, { -kMax, -kMax, -kMax } };
+
+    for (int corner = 0; corner != 8; ++corner) {
+        auto x = (corner & 1) ? aabb.max.x : aabb.min.x;
+        auto y = (corner & 2) ? aabb.max.y : aabb.min.y;
+        auto z = (corner & 4) ? aabb.max.z : aabb.min.z;
+        auto p = transform * glm::vec4(x, y, z, 1.0f);
+
+        out.Expand({ p.x, p.y, p.z });
+    }
+
+    return out;
+}
+
+} // namespace
+
+DrawList DrawListBuilder::Build(const Scene& scene, const Camera& camera, float viewport_height)
+{
+    auto draw_list = scene.ComputeDrawList();
+    auto levels    = std::unordered_map<ID, size_t, ID::Hash>{};
+    auto out       = DrawList{};
+
+    if (m_static_batcher) {
+        draw_list = m_static_batcher->Apply(std::move(draw_list));
+    }
+
+    auto view        = camera.ComputeViewMatrix();
+    auto perspective = camera.GetPerspective();
+    auto eye_world   = glm::vec3(glm::inverse(view)[3]);
+
+    // Pixels covered by one world unit at a distance of one
+    auto pixels_per_unit = viewport_height / (2.0f * std::tan(0.5f * perspective.fovy.value));
+
+    m_stats = {};
+
+    out.reserve(draw_list.size());
+
+    for (auto& record : draw_list) {
+        auto lods  = std::span(record.mesh->GetLods());
+        auto level = size_t{ 0 };
+
+        // Points have neither LODs nor clusters and do not count as triangles
+        if (record.mesh->GetTopology() == Topology::Points) {
+            out.push_back(record);
+            continue;
+        }
+
+        m_stats.full_triangle_count += record.index_count / 3;
+
+        if (m_lods_enabled && !lods.empty()) {
+            auto aabb     = TransformBoundingBox(record.mesh->GetBoundingBox(), record.transform);
+            auto center   = aabb.Center();
+            auto eye      = view * glm::vec4(center.x, center.y, center.z, 1.0f);
+            auto radius   = 0.5f * std::sqrt(aabb.ExtentX() * aabb.ExtentX() + aabb.ExtentY() * aabb.ExtentY() +
+                                           aabb.ExtentZ() * aabb.ExtentZ());
+            auto distance = std::sqrt(eye.x * eye.x + eye.y * eye.y + eye.z * eye.z) - radius;
+
+            // The extent of the world AABB overestimates the one of a rotated mesh, which errs on the finer side
+            auto extent = std::max({ aabb.ExtentX(), aabb.ExtentY(), aabb.ExtentZ() });
+            auto pixels = distance > perspective.near ? pixels_per_unit * extent / distance
+                                                      : std::numeric_limits<float>::max();
+
+            auto fits = [&](size_t level, float pixel_error) {
+                return level == 0 || lods[level - 1].error * pixels <= pixel_error;
+            };
+
+            level = lods.size();
+            while (level != 0 && !fits(level, m_pixel_error)) {
+                --level;
+            }
+
+            if (auto previous = m_levels.find(record.instance->GetID()); previous != m_levels.end()) {
+                if (level > previous->second) {
+                    auto coarser = std::min(previous->second, lods.size());
+                    while (coarser < level && fits(coarser + 1, m_pixel_error * (1.0f - m_hysteresis))) {
+                        ++coarser;
+                    }
+                    level = coarser;
+                }
+            }
+
+            if (level != 0) {
+                record.first_index = lods[level - 1].first_index;
+                record.index_count = lods[level - 1].index_count;
+            }
+
+            levels[record.instance->GetID()] = level;
+        }
+
+        auto clusters = std::span(record.mesh->GetClusters());
+
+        // The cones bound the full resolution faces only, the LODs have faces of their own
+        if (!m_cone_culling || level != 0 || clusters.empty()) {
+            m_stats.triangle_count += record.index_count / 3;
+            out.push_back(record);
+            continue;
+        }
+
+        // Facing is preserved by any invertible transform, so the cones are tested against the camera in mesh space
+        auto local_eye = glm::vec3(glm::inverse(record.transform) * glm::vec4(eye_world, 1.0f));
+
+        if (IsBackFacing(record.mesh->GetBounds(), local_eye)) {
+            m_stats.culled_triangle_count += record.index_count / 3;
+            continue;
+        }
+
+        // Draw runs of contiguous front facing clusters
+        auto run        = record;
+        run.index_count = 0;
+
+        for (const auto& [first_index, index_count, bounds] : clusters) {
+            if (IsBackFacing(bounds, local_eye)) {
+                m_stats.culled_triangle_count += index_count / 3;
+                continue;
+            }
+            if (run.index_count != 0 && run.first_index + run.index_count != first_index) {
+                out.push_back(run);
+                run.index_count = 0;
+            }
+            if (run.index_count == 0) {
+                run.first_index = first_index;
+            }
+            run.index_count += index_count;
+            m_stats.triangle_count += index_count / 3;
+        }
+
+        if (run.index_count != 0) {
+            out.push_back(run);
+        }
+    }
+
+    m_levels = std::move(levels);
+
+    return out;
+}
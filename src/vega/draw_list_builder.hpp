@@ -0,0 +1,49 @@
+#pragma once
+
+#include "scene.hpp"
+
+#include <cstddef>
+#include <unordered_map>
+
+class Camera;
+class StaticBatcher;
+
+// Triangles of the last draw list
+struct DrawListStats final {
+    size_t triangle_count        = 0; // As drawn
+    size_t full_triangle_count   = 0; // At full resolution
+    size_t culled_triangle_count = 0; // Skipped by the cone culling
+};
+
+// Builds the draw list of a scene and picks the LOD of every instance. The simplification error of a LOD, relative to
+// the extent of its mesh, is scaled by the projected size of the world AABB of the instance, and the coarsest LOD whose
+// error stays within the pixel error is drawn. A coarser LOD than the one of the previous frame is only taken once its
+// error is below the pixel error by the hysteresis fraction, so instances near a threshold do not switch every frame.
+// With cone culling, the clusters of instances drawn at full resolution whose normal cones face away from the camera
+// are skipped and the remaining ones are drawn in runs of contiguous clusters. The pipeline draws both sides of a
+// triangle, so this is only invisible for closed meshes and is off by default. With a static batcher, the records of
+// batched instances are replaced by those of their batches before the LODs are picked.
+class DrawListBuilder final {
+  public:
+    explicit DrawListBuilder(StaticBatcher* static_batcher = nullptr) noexcept : m_static_batcher(static_batcher) {}
+
+    auto Build(const Scene& scene, const Camera& camera, float viewport_height) -> DrawList;
+
+    auto GetStats() const noexcept { return m_stats; }
+
+    auto& LodsEnabledRef() noexcept { return m_lods_enabled; }
+    auto& PixelErrorRef() noexcept { return m_pixel_error; }
+    auto& HysteresisRef() noexcept { return m_hysteresis; }
+    auto& ConeCullingRef() noexcept { return m_cone_culling; }
+
+  private:
+    StaticBatcher* m_static_batcher = nullptr;
+
+    bool  m_lods_enabled{ true };
+    float m_pixel_error{ 1.0f };
+    float m_hysteresis{ 0.25f };
+    bool  m_cone_culling{ false };
+
+    DrawListStats                            m_stats;
+    std::unordered_map<ID, size_t, ID::Hash> m_levels; // LOD of every instance in the last draw list, 0 is full
+};
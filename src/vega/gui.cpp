@@ -1,8 +1,11 @@
 #include "gui.hpp"
 #include "camera.hpp"
+#include "draw_list_builder.hpp"
 #include "lights.hpp"
 #include "platform.hpp"
 #include "scene.hpp"
+#include "scene_loader.hpp"
+#include "static_batcher.hpp"
 #include "utils/cast.hpp"
 #include "utils/resource.hpp"
 
@@ -24,6 +27,7 @@ BEGIN_DISABLE_WARNINGS
 
 END_DISABLE_WARNINGS
 
+#include <array>
 #include <charconv>
 #include <string>
 
@@ -40,8 +44,14 @@ struct Window {
 
 class CameraWindow : public Window {
   public:
-    CameraWindow(Camera* camera, Lights* lights) noexcept
-        : Window{ VisibilityDefault }, m_camera(camera), m_lights(lights)
+    CameraWindow(
+        Camera*          camera,
+        Lights*          lights,
+        DrawListBuilder* draw_list_builder,
+        StaticBatcher*   static_batcher,
+        SceneLoader*     scene_loader) noexcept
+        : Window{ VisibilityDefault }, m_camera(camera), m_lights(lights), m_draw_list_builder(draw_list_builder),
+          m_static_batcher(static_batcher), m_scene_loader(scene_loader)
     {}
 
     void Draw();
@@ -49,8 +59,11 @@ class CameraWindow : public Window {
     static constexpr bool VisibilityDefault = true;
 
   private:
-    Camera* m_camera = nullptr;
-    Lights* m_lights = nullptr;
+    Camera*          m_camera            = nullptr;
+    Lights*          m_lights            = nullptr;
+    DrawListBuilder* m_draw_list_builder = nullptr;
+    StaticBatcher*   m_static_batcher    = nullptr;
+    SceneLoader*     m_scene_loader      = nullptr;
 };
 
 class SceneWindow : public Window {
@@ -79,7 +92,7 @@ class FileBrowserWindow {
     FileBrowserWindow() noexcept
     {
         m_file_browser.SetTitle("Import");
-        m_file_browser.SetTypeFilters({ ".obj" });
+        m_file_browser.SetTypeFilters({ ".obj", ".gz", ".zst", ".ply", ".stl", ".gltf", ".glb" });
         m_file_browser.SetWindowSize(1000, 800);
     }
 
@@ -87,17 +100,29 @@ class FileBrowserWindow {
 
     void Draw() { m_file_browser.Display(); }
 
-    bool HasSelectedPath() { return m_file_browser.HasSelected(); }
+    bool HasSelectedPaths() { return m_file_browser.HasSelected(); }
 
-    auto GetSelectedPath()
+    auto GetSelectedPaths()
     {
-        auto path = m_file_browser.GetSelected();
+        auto paths = m_file_browser.GetMultiSelected();
         m_file_browser.ClearSelected();
-        return path;
+        return paths;
     }
 
   private:
-    ImGui::FileBrowser m_file_browser = ImGui::FileBrowser(ImGuiFileBrowserFlags_CloseOnEsc);
+    ImGui::FileBrowser m_file_browser =
+        ImGui::FileBrowser(ImGuiFileBrowserFlags_CloseOnEsc | ImGuiFileBrowserFlags_MultipleSelection);
+};
+
+// Lists the files that are being loaded in the background. Only shown while there are any.
+class LoadingWindow {
+  public:
+    LoadingWindow(SceneLoader* scene_loader) noexcept : m_scene_loader(scene_loader) {}
+
+    void Draw();
+
+  private:
+    SceneLoader* m_scene_loader = nullptr;
 };
 
 static Gui& Self(GLFWwindow* window)
@@ -184,14 +209,17 @@ struct GuiAccessor final {
 };
 
 Gui::Gui(
-    Parameters  parameters,
-    Callbacks   callbacks,
-    GLFWwindow* window,
-    uint32_t    min_image_count,
-    uint32_t    image_count,
-    Camera*     camera,
-    Scene*      scene,
-    Lights*     lights)
+    Parameters       parameters,
+    Callbacks        callbacks,
+    GLFWwindow*      window,
+    uint32_t         min_image_count,
+    uint32_t         image_count,
+    Camera*          camera,
+    Scene*           scene,
+    Lights*          lights,
+    DrawListBuilder* draw_list_builder,
+    StaticBatcher*   static_batcher,
+    SceneLoader*     scene_loader)
     : m_callbacks(std::move(callbacks)), m_device(parameters.device), m_graphics_queue(parameters.graphics_queue),
       m_extent(parameters.extent)
 {
@@ -293,9 +321,11 @@ Gui::Gui(
         UploadFonts(parameters.device, parameters.graphics_queue);
     }
 
-    m_windows.camera      = std::make_unique<CameraWindow>(camera, lights);
+    m_windows.camera =
+        std::make_unique<CameraWindow>(camera, lights, draw_list_builder, static_batcher, scene_loader);
     m_windows.scene       = std::make_unique<SceneWindow>(scene);
     m_windows.filebrowser = std::make_unique<FileBrowserWindow>();
+    m_windows.loading     = std::make_unique<LoadingWindow>(scene_loader);
 
     auto settings_handler = ImGuiSettingsHandler{};
     {
@@ -427,9 +457,10 @@ void Gui::Draw(
     m_windows.camera->Draw();
     m_windows.scene->Draw();
     m_windows.filebrowser->Draw();
+    m_windows.loading->Draw();
 
-    if (m_windows.filebrowser->HasSelectedPath()) {
-        m_callbacks.OnFileOpen(m_windows.filebrowser->GetSelectedPath().string());
+    if (m_windows.filebrowser->HasSelectedPaths()) {
+        m_callbacks.OnFilesOpen(m_windows.filebrowser->GetSelectedPaths());
     }
 
     ImGui::Render();
@@ -806,6 +837,75 @@ void CameraWindow::Draw()
         }
     }
 
+    if (ImGui::CollapsingHeader("Level of Detail")) {
+        ImGui::PushID("camera/lods_enabled");
+        ImGui::Checkbox("", &m_draw_list_builder->LodsEnabledRef());
+        ImGui::PopID();
+        AddLabel("Enabled", "Draw Simplified Meshes", label_position);
+
+        ImGui::PushID("camera/pixel_error");
+        ImGui::SliderFloat(
+            "",
+            &m_draw_list_builder->PixelErrorRef(),
+            0.25f,
+            16.0f,
+            "%.2f px",
+            ImGuiSliderFlags_AlwaysClamp | ImGuiSliderFlags_Logarithmic);
+        ImGui::PopID();
+        AddLabel("Error", "Largest Simplification Error on Screen", label_position);
+
+        ImGui::PushID("camera/hysteresis");
+        ImGui::SliderFloat("", &m_draw_list_builder->HysteresisRef(), 0.0f, 0.9f, "%.2f", ImGuiSliderFlags_AlwaysClamp);
+        ImGui::PopID();
+        AddLabel("Hysteresis", "Error Margin Before Switching to a Coarser Level", label_position);
+
+        ImGui::PushID("camera/cone_culling");
+        ImGui::Checkbox("", &m_draw_list_builder->ConeCullingRef());
+        ImGui::PopID();
+        AddLabel("Cone Culling", "Skip Clusters Facing Away, for Closed Meshes", label_position);
+
+        auto stats = m_draw_list_builder->GetStats();
+        ImGui::Text("Triangles: %zu of %zu", stats.triangle_count, stats.full_triangle_count);
+        ImGui::Text("Culled: %zu", stats.culled_triangle_count);
+    }
+
+    if (ImGui::CollapsingHeader("Static Batching")) {
+        ImGui::PushID("camera/batching_enabled");
+        ImGui::Checkbox("", &m_static_batcher->EnabledRef());
+        ImGui::PopID();
+        AddLabel("Enabled", "Merge Small Static Instances Sharing a Material", label_position);
+
+        ImGui::PushID("camera/batching_max_triangles");
+        ImGui::SliderInt(
+            "",
+            &m_static_batcher->MaxTrianglesRef(),
+            16,
+            4096,
+            "%d",
+            ImGuiSliderFlags_AlwaysClamp | ImGuiSliderFlags_Logarithmic);
+        ImGui::PopID();
+        AddLabel("Triangles", "Largest Instance to Batch", label_position);
+
+        auto stats = m_static_batcher->GetStats();
+        ImGui::Text("Batches: %zu (%zu instances)", stats.batch_count, stats.instance_count);
+        ImGui::Text("Draws: %zu", stats.draw_count);
+    }
+
+    if (m_scene_loader && ImGui::CollapsingHeader("Loading")) {
+        // In the order of VertexLayout
+        static constexpr auto labels = std::array{ "Float", "Quantized", "Flat Shaded" };
+
+        auto& vertex_layout = m_scene_loader->VertexLayoutRef();
+        auto  layout_index  = static_cast<int>(vertex_layout);
+
+        ImGui::PushID("camera/vertex_layout");
+        if (ImGui::Combo("", &layout_index, labels.data(), static_cast<int>(labels.size()))) {
+            vertex_layout = static_cast<VertexLayout>(layout_index);
+        }
+        ImGui::PopID();
+        AddLabel("Vertices", "Vertex Layout of Files Loaded From Now On", label_position);
+    }
+
     ImGui::PopItemWidth();
 
     ImGui::PopStyleColor();
@@ -998,7 +1098,7 @@ NodePtr SceneWindow::DrawContextMenu(NodePtr node)
                     node->AttachNode(m_scene->CreateRotateNode(Float3{ 1, 0, 0 }, 0_rad));
                 }
                 if (ImGui::MenuItem("Scale")) {
-                    node->AttachNode(m_scene->CreateScaleNode(1.0f));
+                    node->AttachNode(m_scene->CreateScaleNode(Float3{ 1, 1, 1 }));
                 }
                 if (ImGui::MenuItem("Group")) {
                     node->AttachNode(m_scene->CreateGroupNode());
@@ -1077,3 +1177,37 @@ void SceneWindow::Draw()
 
     PostEnd();
 }
+
+void LoadingWindow::Draw()
+{
+    if (m_scene_loader == nullptr || m_scene_loader->IsLoading() == false) {
+        return;
+    }
+
+    const auto& io = ImGui::GetIO();
+
+    auto position = ImVec2{ 0.5f * io.DisplaySize.x, 0.95f * io.DisplaySize.y };
+    auto flags    = ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoSavedSettings;
+
+    ImGui::SetNextWindowPos(position, ImGuiCond_Always, ImVec2{ 0.5f, 1.0f });
+
+    ImGui::Begin("Loading", nullptr, flags);
+
+    auto bar_width = 20.0f * ImGui::GetFontSize();
+
+    for (const auto& status : m_scene_loader->GetStatus()) {
+        ImGui::PushID(static_cast<int>(status.id));
+
+        ImGui::TextUnformatted(status.filepath.filename().string().c_str());
+
+        ImGui::ProgressBar(status.fraction, ImVec2{ bar_width, 0.0f }, status.cancelled ? "Cancelling" : status.stage);
+        ImGui::SameLine();
+        if (ImGui::Button("Cancel")) {
+            m_scene_loader->Cancel(status.id);
+        }
+
+        ImGui::PopID();
+    }
+
+    ImGui::End();
+}
@@ -7,6 +7,7 @@
 #include "etna/queue.hpp"
 #include "etna/renderpass.hpp"
 
+#include <filesystem>
 #include <functional>
 #include <memory>
 
@@ -14,15 +15,20 @@ struct GLFWwindow;
 struct ImFont;
 
 class Camera;
+class DrawListBuilder;
 class Lights;
 class Scene;
+class SceneLoader;
+class StaticBatcher;
 
 class CameraWindow;
 class FileBrowserWindow;
+class LoadingWindow;
 class SceneWindow;
 
 using UniqueCameraWindow      = std::unique_ptr<CameraWindow>;
 using UniqueFileBrowserWindow = std::unique_ptr<FileBrowserWindow>;
+using UniqueLoadingWindow     = std::unique_ptr<LoadingWindow>;
 using UniqueSceneWindow       = std::unique_ptr<SceneWindow>;
 
 class Gui {
@@ -37,20 +43,23 @@ class Gui {
     };
 
     struct Callbacks final {
-        std::function<void()>                     OnWindowClose;
-        std::function<void(std::string filepath)> OnFileOpen;
+        std::function<void()>                                             OnWindowClose;
+        std::function<void(std::vector<std::filesystem::path> filepaths)> OnFilesOpen;
     };
 
     Gui() noexcept = default;
 
-    Gui(Parameters  parameters,
-        Callbacks   callbacks,
-        GLFWwindow* window,
-        uint32_t    min_image_count,
-        uint32_t    image_count,
-        Camera*     camera,
-        Scene*      scene,
-        Lights*     lights);
+    Gui(Parameters       parameters,
+        Callbacks        callbacks,
+        GLFWwindow*      window,
+        uint32_t         min_image_count,
+        uint32_t         image_count,
+        Camera*          camera,
+        Scene*           scene,
+        Lights*          lights,
+        DrawListBuilder* draw_list_builder,
+        StaticBatcher*   static_batcher,
+        SceneLoader*     scene_loader);
 
     Gui(const Gui&) = delete;
     Gui& operator=(const Gui&) = delete;
@@ -133,6 +142,7 @@ class Gui {
         UniqueSceneWindow       scene;
         UniqueCameraWindow      camera;
         UniqueFileBrowserWindow filebrowser;
+        UniqueLoadingWindow     loading;
     };
 
     Callbacks                  m_callbacks;
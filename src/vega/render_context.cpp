@@ -2,6 +2,7 @@
 
 #include "buffer_manager.hpp"
 #include "camera.hpp"
+#include "draw_list_builder.hpp"
 #include "gui.hpp"
 #include "lights.hpp"
 #include "scene.hpp"
@@ -9,10 +10,12 @@
 #define GLFW_INCLUDE_NONE
 #include <GLFW/glfw3.h>
 
+#include <optional>
+
 RenderContext::RenderContext(
     etna::Device         device,
     etna::Queue          graphics_queue,
-    etna::Pipeline       pipeline,
+    Pipelines            pipelines,
     etna::PipelineLayout pipeline_layout,
     GLFWwindow*          window,
     SwapchainManager*    swapchain_manager,
@@ -21,12 +24,15 @@ RenderContext::RenderContext(
     Gui*                 gui,
     Camera*              camera,
     Lights*              lights,
+    DrawListBuilder*     draw_list_builder,
     BufferManager*       buffer_manager,
-    Scene*               scene)
-    : m_device(device), m_graphics_queue(graphics_queue), m_pipeline(pipeline), m_pipeline_layout(pipeline_layout),
+    Scene*               scene,
+    Callbacks            callbacks)
+    : m_device(device), m_graphics_queue(graphics_queue), m_pipelines(pipelines), m_pipeline_layout(pipeline_layout),
       m_window(window), m_swapchain_manager(swapchain_manager), m_frame_manager(frame_manager),
       m_descriptor_manager(descriptor_manager), m_gui(gui), m_camera(camera), m_lights(lights),
-      m_buffer_manager(buffer_manager), m_scene(scene)
+      m_draw_list_builder(draw_list_builder), m_buffer_manager(buffer_manager), m_scene(scene),
+      m_callbacks(std::move(callbacks))
 {}
 
 void RenderContext::ProcessUserInput()
@@ -95,9 +101,15 @@ RenderContext::Status RenderContext::StartRenderLoop()
 
         glfwPollEvents();
 
+        if (m_callbacks.OnFrameBegin) {
+            m_callbacks.OnFrameBegin();
+        }
+
         auto frame       = m_frame_manager->NextFrame();
         auto image_index = uint32_t{};
 
+        m_buffer_manager->NextFrame();
+
         if (auto next_image = m_swapchain_manager->AcquireNextImage(frame.semaphores.image_acquired); next_image) {
             image_index = next_image.value();
             if (image_ready_fences[image_index] != Fence::Null &&
@@ -117,8 +129,8 @@ RenderContext::Status RenderContext::StartRenderLoop()
 
         ProcessUserInput();
 
-        auto draw_list = m_scene->ComputeDrawList();
         auto extent    = framebuffers.extent;
+        auto draw_list = m_draw_list_builder->Build(*m_scene, *m_camera, narrow_cast<float>(extent.height));
 
         auto view        = m_camera->ComputeViewMatrix();
         auto perspective = m_camera->ComputePerspectiveMatrix();
@@ -157,21 +169,40 @@ RenderContext::Status RenderContext::StartRenderLoop()
         frame.cmd_buffers.draw.ResetCommandBuffer();
         frame.cmd_buffers.draw.Begin(CommandBufferUsage::OneTimeSubmit);
         frame.cmd_buffers.draw.BeginRenderPass(framebuffer, render_area, { clear_color, clear_depth });
-        frame.cmd_buffers.draw.BindPipeline(PipelineBindPoint::Graphics, m_pipeline);
         frame.cmd_buffers.draw.SetViewport(viewport);
         frame.cmd_buffers.draw.SetScissor(scissor);
 
-        for (const auto& [index, mesh, transform] : draw_list) {
+        auto bound_pipeline = std::optional<size_t>{};
+
+        for (const auto& [index, instance, mesh, transform, first_index, index_count] : draw_list) {
             auto graphics        = PipelineBindPoint::Graphics;
             auto model_transform = ModelUniform{ transform };
-            auto offset          = m_descriptor_manager->Set(frame.index, index, model_transform);
-            auto vertex_buffer   = m_buffer_manager->GetBuffer(mesh->GetVertexBuffer());
-            auto index_buffer    = m_buffer_manager->GetBuffer(mesh->GetIndexBuffer());
+            auto is_points       = mesh->GetTopology() == Topology::Points;
+            auto pipeline        = is_points ? kPointPipeline : static_cast<size_t>(mesh->GetVertexLayout());
+
+            if (bound_pipeline != pipeline) {
+                bound_pipeline = pipeline;
+                frame.cmd_buffers.draw.BindPipeline(graphics, m_pipelines[pipeline]);
+            }
+
+            if (mesh->GetVertexLayout() == VertexLayout::Quantized) {
+                auto aabb = mesh->GetBoundingBox();
+
+                model_transform.position_scale     = { aabb.ExtentX(), aabb.ExtentY(), aabb.ExtentZ(), 0.0f };
+                model_transform.position_offset    = { aabb.min.x, aabb.min.y, aabb.min.z, 0.0f };
+                model_transform.octahedral_normals = 1;
+            }
+
+            auto offset        = m_descriptor_manager->Set(frame.index, index, model_transform);
+            auto vertex_buffer = m_buffer_manager->GetBuffer(mesh->GetVertexBuffer());
+            auto index_buffer  = m_buffer_manager->GetBuffer(mesh->GetIndexBuffer());
+            auto is_16_bit     = mesh->GetIndexFormat() == IndexFormat::Uint16;
+            auto index_type    = is_16_bit ? IndexType::Uint16 : IndexType::Uint32;
 
             frame.cmd_buffers.draw.BindVertexBuffers(vertex_buffer);
-            frame.cmd_buffers.draw.BindIndexBuffer(index_buffer, IndexType::Uint32);
+            frame.cmd_buffers.draw.BindIndexBuffer(index_buffer, index_type);
             frame.cmd_buffers.draw.BindDescriptorSet(graphics, m_pipeline_layout, descriptor_set, { offset });
-            frame.cmd_buffers.draw.DrawIndexed(mesh->GetIndexCount(), 1, mesh->GetFirstIndex());
+            frame.cmd_buffers.draw.DrawIndexed(index_count, 1, first_index, mesh->GetVertexOffset());
         }
 
         frame.cmd_buffers.draw.EndRenderPass();
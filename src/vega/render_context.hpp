@@ -8,10 +8,14 @@
 #include "frame_manager.hpp"
 #include "swapchain_manager.hpp"
 
+#include <array>
+#include <functional>
+
 struct GLFWwindow;
 
 class Gui;
 class Camera;
+class DrawListBuilder;
 class Lights;
 class BufferManager;
 class Scene;
@@ -21,12 +25,24 @@ class RenderContext {
     enum class Status { WindowClosed, SwapchainOutOfDate, GuiEvent };
     enum class MouseLook { None, Orbit, Zoom, Track };
 
+    // Indexed by VertexLayout, every triangle mesh is drawn with the pipeline of its own layout. Point meshes are
+    // always VertexLayout::Float and drawn with the point list pipeline that follows.
+    using Pipelines = std::array<etna::Pipeline, 4>;
+
+    static constexpr size_t kPointPipeline = 3;
+
+    struct Callbacks final {
+        // Called at the start of every frame, before the scene is read. Scene changes made by work running in the
+        // background are applied here.
+        std::function<void()> OnFrameBegin;
+    };
+
     RenderContext() noexcept = default;
 
     RenderContext(
         etna::Device         device,
         etna::Queue          graphics_queue,
-        etna::Pipeline       pipeline,
+        Pipelines            pipelines,
         etna::PipelineLayout pipeline_layout,
         GLFWwindow*          window,
         SwapchainManager*    swapchain_manager,
@@ -35,8 +51,10 @@ class RenderContext {
         Gui*                 gui,
         Camera*              camera,
         Lights*              lights,
+        DrawListBuilder*     draw_list_builder,
         BufferManager*       buffer_manager,
-        Scene*               scene);
+        Scene*               scene,
+        Callbacks            callbacks);
 
     RenderContext(const RenderContext&) = delete;
     RenderContext& operator=(const RenderContext&) = delete;
@@ -52,7 +70,7 @@ class RenderContext {
   private:
     etna::Device         m_device;
     etna::Queue          m_graphics_queue;
-    etna::Pipeline       m_pipeline;
+    Pipelines            m_pipelines;
     etna::PipelineLayout m_pipeline_layout;
     GLFWwindow*          m_window                = nullptr;
     SwapchainManager*    m_swapchain_manager     = nullptr;
@@ -61,8 +79,10 @@ class RenderContext {
     Gui*                 m_gui                   = nullptr;
     Camera*              m_camera                = nullptr;
     Lights*              m_lights                = nullptr;
+    DrawListBuilder*     m_draw_list_builder     = nullptr;
     BufferManager*       m_buffer_manager        = nullptr;
     Scene*               m_scene                 = nullptr;
+    Callbacks            m_callbacks;
     MouseLook            m_mouse_look            = MouseLook::None;
     bool                 m_is_any_window_hovered = false;
     bool                 m_is_running            = false;
@@ -0,0 +1,301 @@
+#include "scene_loader.hpp"
+
+#include "buffer_manager.hpp"
+#include "obj_loader.hpp"
+#include "thread_pool.hpp"
+
+BEGIN_DISABLE_WARNINGS
+
+#include <spdlog/spdlog.h>
+
+END_DISABLE_WARNINGS
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <exception>
+#include <utility>
+
+namespace {
+
+// Indices per batch. Small enough that a batch is attached and uploaded well within a frame.
+constexpr size_t kBatchIndexCount = size_t{ 1 } << 20;
+
+// Bytes of vertex and index data attached per frame
+constexpr size_t kAttachBudget = size_t{ 32 } << 20;
+
+// Batches a worker may produce ahead of the render thread
+constexpr size_t kMaxQueuedBatches = 8;
+
+size_t SizeOf(const BatchBuffers& buffers) noexcept
+{
+    return buffers.vertices.size() + buffers.indices.data.size() * sizeof(uint16_t);
+}
+
+bool IsGltf(const std::filesystem::path& filepath)
+{
+    auto extension = filepath.extension().string();
+    for (auto& c : extension) {
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    return extension == ".gltf" || extension == ".glb";
+}
+
+} // namespace
+
+void SceneLoader::Stream::Start(ShapeRecords shapes, size_t material_count)
+{
+    auto lock        = std::scoped_lock(m_mutex);
+    m_shapes         = std::move(shapes);
+    m_material_count = material_count;
+}
+
+void SceneLoader::Stream::Push(PreparedBatch batch, const LoadProgress& progress)
+{
+    using namespace std::chrono_literals;
+
+    auto lock = std::unique_lock(m_mutex);
+
+    // Cancellation is not signalled through the condition, so it is polled
+    while (m_batches.size() >= kMaxQueuedBatches && !progress.IsCancelled()) {
+        m_condition.wait_for(lock, 10ms);
+    }
+
+    progress.ThrowIfCancelled();
+
+    m_batches.push_back(std::move(batch));
+}
+
+auto SceneLoader::Stream::Pop() -> std::optional<PreparedBatch>
+{
+    auto batch = std::optional<PreparedBatch>{};
+    {
+        auto lock = std::scoped_lock(m_mutex);
+        if (m_batches.empty()) {
+            return std::nullopt;
+        }
+        batch = std::move(m_batches.front());
+        m_batches.pop_front();
+    }
+
+    m_condition.notify_one();
+
+    return batch;
+}
+
+SceneLoader::SceneLoader(
+    Scene*               scene,
+    BufferManager*       buffer_manager,
+    ThreadPool*          thread_pool,
+    const GeometryCache* geometry_cache,
+    VertexLayout         vertex_layout,
+    LoadOptions          load_options) noexcept
+    : m_scene(scene), m_buffer_manager(buffer_manager), m_thread_pool(thread_pool), m_geometry_cache(geometry_cache),
+      m_vertex_layout(vertex_layout), m_load_options(load_options)
+{}
+
+SceneLoader::~SceneLoader() noexcept
+{
+    for (auto& job : m_jobs) {
+        job.progress->Cancel();
+    }
+    for (auto& job : m_jobs) {
+        job.done.wait();
+    }
+}
+
+void SceneLoader::Load(std::filesystem::path filepath)
+{
+    if (m_jobs.empty()) {
+        m_batch_size  = 0;
+        m_batch_start = std::chrono::steady_clock::now();
+    }
+
+    ++m_batch_size;
+
+    auto job = Job{};
+
+    job.id            = m_next_id++;
+    job.filepath      = std::move(filepath);
+    job.vertex_layout = m_vertex_layout;
+    job.progress      = std::make_unique<LoadProgress>();
+    job.stream        = std::make_unique<Stream>();
+    job.start         = std::chrono::steady_clock::now();
+
+    auto progress      = job.progress.get();
+    auto stream        = job.stream.get();
+    auto vertex_layout = job.vertex_layout;
+
+    if (IsGltf(job.filepath)) {
+        job.model = std::make_unique<GltfModel>();
+
+        auto model = job.model.get();
+
+        job.done = std::async(std::launch::async, [this, filepath = job.filepath, vertex_layout, progress, model]() {
+            *model = ReadGltf(filepath, vertex_layout, m_thread_pool, progress);
+        });
+
+        m_jobs.push_back(std::move(job));
+        return;
+    }
+
+    // The worker is a thread of its own rather than a task of the pool, so waiting in Stream::Push while the render
+    // thread catches up does not hold a pool thread that the stages of the other files could use
+    job.done = std::async(std::launch::async, [this, filepath = job.filepath, vertex_layout, progress, stream]() {
+        auto geometry = ReadGeometry(filepath, m_load_options, m_thread_pool, m_geometry_cache, progress);
+        auto view     = geometry.View();
+
+        stream->Start(ShapeRecords(view.shapes.begin(), view.shapes.end()), view.material_count);
+
+        StartProgress(progress, "Streaming", view.indices.size());
+
+        SplitGeometry(view, kBatchIndexCount, [progress, stream, vertex_layout](GeometryBatch batch) {
+            auto index_count = batch.geometry.indices.size();
+            auto buffers     = PrepareBuffers(batch.geometry.View(), vertex_layout);
+
+            batch.geometry.vertices = {};
+            batch.geometry.indices  = {};
+
+            stream->Push({ std::move(batch), std::move(buffers) }, *progress);
+            AdvanceProgress(progress, index_count);
+        });
+    });
+
+    m_jobs.push_back(std::move(job));
+}
+
+void SceneLoader::Load(std::vector<std::filesystem::path> filepaths)
+{
+    for (auto& filepath : filepaths) {
+        Load(std::move(filepath));
+    }
+}
+
+void SceneLoader::Cancel(uint64_t id) noexcept
+{
+    if (auto it = std::ranges::find(m_jobs, id, &Job::id); it != m_jobs.end()) {
+        it->progress->Cancel();
+    }
+}
+
+bool SceneLoader::Attach()
+{
+    using namespace std::chrono_literals;
+
+    auto is_bounds_changed = false;
+    auto attached_size     = size_t{ 0 };
+
+    for (auto& job : m_jobs) {
+        // Checked first: once the worker is done, every batch it produced is in the stream
+        auto is_worker_done = job.done.wait_for(0s) == std::future_status::ready;
+        auto is_stream_done = false;
+
+        auto elapsed = [&job]() {
+            return std::chrono::duration<double>(std::chrono::steady_clock::now() - job.start).count();
+        };
+
+        while (attached_size < kAttachBudget) {
+            auto batch = job.stream->Pop();
+            if (!batch) {
+                is_stream_done = true;
+                break;
+            }
+            if (job.progress->IsCancelled()) {
+                continue;
+            }
+            if (!job.builder) {
+                auto shapes         = job.stream->GetShapes();
+                auto material_count = job.stream->GetMaterialCount();
+
+                job.builder = std::make_unique<SceneBuilder>(
+                    m_scene,
+                    shapes,
+                    material_count,
+                    job.filepath,
+                    job.vertex_layout);
+                is_bounds_changed = true;
+
+                spdlog::info("File {}: first batch attached after {:.3f} seconds", job.filepath.string(), elapsed());
+            }
+
+            auto size = SizeOf(batch->buffers);
+
+            auto [vertex_buffer, index_buffer] =
+                job.builder->Add(batch->batch.geometry.View(), std::move(batch->buffers), batch->batch.first_shape);
+
+            if (vertex_buffer && index_buffer) {
+                m_buffer_manager->CreateBuffer(vertex_buffer, etna::BufferUsage::VertexBuffer);
+                m_buffer_manager->CreateBuffer(index_buffer, etna::BufferUsage::IndexBuffer);
+            }
+
+            attached_size += size;
+        }
+
+        if (!is_worker_done || !is_stream_done) {
+            continue;
+        }
+
+        try {
+            job.done.get();
+
+            if (job.model) {
+                auto buffers = BuildGltfScene(m_scene, *job.model, job.filepath);
+
+                for (auto vertex_buffer : buffers.vertex_buffers) {
+                    m_buffer_manager->CreateBuffer(vertex_buffer, etna::BufferUsage::VertexBuffer);
+                    attached_size += vertex_buffer->Size();
+                }
+                for (auto index_buffer : buffers.index_buffers) {
+                    m_buffer_manager->CreateBuffer(index_buffer, etna::BufferUsage::IndexBuffer);
+                    attached_size += index_buffer->Size();
+                }
+
+                is_bounds_changed = true;
+            }
+
+            spdlog::info("File {}: attached after {:.3f} seconds", job.filepath.string(), elapsed());
+        } catch (const LoadCancelled&) {
+            spdlog::info("Loading of file {} cancelled", job.filepath.string());
+        } catch (const std::exception& exception) {
+            spdlog::error("Failed to load file {}: {}", job.filepath.string(), exception.what());
+        }
+
+        job.model.reset();
+
+        is_bounds_changed = is_bounds_changed || job.builder != nullptr;
+    }
+
+    if (attached_size > 0) {
+        m_buffer_manager->Upload();
+    }
+
+    auto is_loading = !m_jobs.empty();
+
+    std::erase_if(m_jobs, [](const Job& job) { return !job.done.valid(); });
+
+    if (is_loading && m_jobs.empty() && m_batch_size > 1) {
+        auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_batch_start).count();
+        spdlog::info("{} files loaded after {:.3f} seconds", m_batch_size, elapsed);
+    }
+
+    return is_bounds_changed;
+}
+
+auto SceneLoader::GetStatus() const -> std::vector<Status>
+{
+    auto status = std::vector<Status>{};
+
+    status.reserve(m_jobs.size());
+
+    for (const auto& job : m_jobs) {
+        status.push_back({
+            .id        = job.id,
+            .filepath  = job.filepath,
+            .stage     = job.progress->GetStage(),
+            .fraction  = job.progress->GetFraction(),
+            .cancelled = job.progress->IsCancelled(),
+        });
+    }
+
+    return status;
+}
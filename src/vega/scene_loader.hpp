@@ -0,0 +1,127 @@
+#pragma once
+
+#include "geometry.hpp"
+#include "gltf_loader.hpp"
+#include "load_progress.hpp"
+#include "obj_loader.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+class BufferManager;
+class GeometryCache;
+class Scene;
+class ThreadPool;
+
+// Loads files in the background while the render loop keeps running. Every file has a worker thread of its own, whose
+// stages run their parallel parts on the thread pool. The scene is not thread safe, so the workers only produce the
+// welded geometry, split into batches of whole meshes. Attach, which is to be called by the render thread between
+// frames, adds a bounded amount of these batches to the scene per call, so large files appear progressively instead of
+// all at once. glTF files are read into a GltfModel by the worker instead, which is attached as a whole since its
+// buffers are views of the file rather than welded geometry. 'load_options' selects the stages ReadGeometry runs on the
+// other files. All member functions must be called from the render thread.
+class SceneLoader final {
+  public:
+    struct Status final {
+        uint64_t              id{};
+        std::filesystem::path filepath;
+        const char*           stage{};
+        float                 fraction{};
+        bool                  cancelled{};
+    };
+
+    SceneLoader(
+        Scene*               scene,
+        BufferManager*       buffer_manager,
+        ThreadPool*          thread_pool,
+        const GeometryCache* geometry_cache,
+        VertexLayout         vertex_layout = VertexLayout::Float,
+        LoadOptions          load_options  = {}) noexcept;
+
+    SceneLoader(const SceneLoader&) = delete;
+    SceneLoader& operator=(const SceneLoader&) = delete;
+
+    // Cancels all loads and waits for them to stop. The thread pool must outlive the loader.
+    ~SceneLoader() noexcept;
+
+    void Load(std::filesystem::path filepath);
+
+    // Loads the files concurrently, each into its own group node under the root. The stages of the workers share the
+    // thread pool, so the files take about as long as the largest of them rather than the sum.
+    void Load(std::vector<std::filesystem::path> filepaths);
+
+    // Cancels the load with the given id. Batches that have already been attached stay in the scene.
+    void Cancel(uint64_t id) noexcept;
+
+    // Attaches the batches that are ready, up to a fixed amount of data per call. Returns true if a file has been
+    // attached for the first time or has been completed, which changes the bounds of the scene.
+    bool Attach();
+
+    auto GetStatus() const -> std::vector<Status>;
+
+    // Of the files loaded from now on, the ones already loading or loaded keep theirs
+    auto VertexLayoutRef() noexcept -> VertexLayout& { return m_vertex_layout; }
+
+    bool IsLoading() const noexcept { return !m_jobs.empty(); }
+
+  private:
+    // Batch whose buffer contents the worker has prepared in the vertex layout of its file, so the render thread only
+    // copies them into the scene. The vertices and indices of the batch geometry are released once they are prepared.
+    struct PreparedBatch final {
+        GeometryBatch batch;
+        BatchBuffers  buffers;
+    };
+
+    // Handoff of the batches of one file from its worker to the render thread. The queue is bounded, the worker thread
+    // waits while it is full.
+    class Stream final {
+      public:
+        void Start(ShapeRecords shapes, size_t material_count);
+        void Push(PreparedBatch batch, const LoadProgress& progress);
+        auto Pop() -> std::optional<PreparedBatch>;
+
+        // Only valid once a batch has been popped
+        auto GetShapes() const noexcept -> std::span<const ShapeRecord> { return m_shapes; }
+        auto GetMaterialCount() const noexcept { return m_material_count; }
+
+      private:
+        std::mutex                m_mutex;
+        std::condition_variable   m_condition;
+        std::deque<PreparedBatch> m_batches;
+        ShapeRecords              m_shapes;
+        size_t                    m_material_count{};
+    };
+
+    struct Job final {
+        uint64_t                              id{};
+        std::filesystem::path                 filepath;
+        VertexLayout                          vertex_layout{};
+        std::unique_ptr<LoadProgress>         progress;
+        std::unique_ptr<Stream>               stream;
+        std::unique_ptr<SceneBuilder>         builder;
+        std::unique_ptr<GltfModel>            model; // Of .gltf and .glb files, set once the worker is done
+        std::future<void>                     done;
+        std::chrono::steady_clock::time_point start;
+    };
+
+    Scene*               m_scene          = nullptr;
+    BufferManager*       m_buffer_manager = nullptr;
+    ThreadPool*          m_thread_pool    = nullptr;
+    const GeometryCache* m_geometry_cache = nullptr;
+    VertexLayout         m_vertex_layout  = VertexLayout::Float;
+    LoadOptions          m_load_options;
+    std::vector<Job>     m_jobs;
+    uint64_t             m_next_id = 0;
+
+    // Files loaded since the loader was last idle, and when the first of them was started
+    size_t                                m_batch_size = 0;
+    std::chrono::steady_clock::time_point m_batch_start;
+};
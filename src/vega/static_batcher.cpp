@@ -0,0 +1,458 @@
+#include "static_batcher.hpp"
+
+#include "buffer_manager.hpp"
+#include "geometry.hpp"
+#include "vertex_quantizer.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// Frames an instance has to keep its transform before it is batched, so instances being moved are not rebuilt
+// on every frame
+constexpr uint32_t kSettleFrames = 30;
+
+// Width of the cells of an instance relative to its extent, rounded up to a power of two
+constexpr float kCellScale = 16.0f;
+
+// Indices per batch
+constexpr size_t kBatchIndexCount = size_t{ 1 } << 16;
+
+// Indices built per update, the remaining bins are built by the following ones
+constexpr size_t kUpdateIndexBudget = size_t{ 1 } << 20;
+
+// Frames between updates that build bins, so the dirty bins of a burst of moves are collected and uploaded together
+// instead of once per frame
+constexpr uint64_t kUpdateIntervalFrames = 30;
+
+// Indices of the full resolution range of 'mesh', including its vertex offset
+std::vector<uint32_t> ReadIndices(const Mesh& mesh)
+{
+    const auto* data = static_cast<const std::byte*>(mesh.GetIndexBuffer()->Data());
+
+    auto indices = std::vector<uint32_t>(mesh.GetIndexCount());
+    auto offset  = utils::narrow_cast<uint32_t>(mesh.GetVertexOffset());
+
+    for (size_t i = 0; i != indices.size(); ++i) {
+        if (mesh.GetIndexFormat() == IndexFormat::Uint16) {
+            auto index = uint16_t{};
+            std::memcpy(&index, data + (mesh.GetFirstIndex() + i) * sizeof(index), sizeof(index));
+            indices[i] = offset + index;
+        } else {
+            auto index = uint32_t{};
+            std::memcpy(&index, data + (mesh.GetFirstIndex() + i) * sizeof(index), sizeof(index));
+            indices[i] = offset + index;
+        }
+    }
+
+    return indices;
+}
+
+// Vertex 'index' of the vertex buffer of 'mesh'. Flat meshes have no normals, theirs are zero.
+VertexPN ReadVertex(const Mesh& mesh, uint32_t index) noexcept
+{
+    const auto* data = mesh.GetVertexBuffer()->Data();
+
+    switch (mesh.GetVertexLayout()) {
+    case VertexLayout::Quantized: {
+        const auto& vertex = static_cast<const VertexPN16*>(data)[index];
+        return { DequantizePosition(vertex.position, mesh.GetBoundingBox()), DecodeOctahedral(vertex.normal) };
+    }
+    case VertexLayout::Flat: return { static_cast<const VertexP*>(data)[index].position, glm::vec3(0.0f) };
+    default: return static_cast<const VertexPN*>(data)[index];
+    }
+}
+
+} // namespace
+
+DrawList StaticBatcher::Apply(DrawList draw_list)
+{
+    m_stats = { .draw_count = draw_list.size() };
+
+    if (!m_enabled) {
+        return draw_list;
+    }
+
+    ++m_frame;
+    m_seen_count = 0;
+
+    // Candidate of every record, null for records too large to be batched
+    auto candidates    = std::vector<Candidate*>(draw_list.size(), nullptr);
+    auto max_triangles = static_cast<size_t>(std::max(m_max_triangles, 0));
+
+    for (size_t i = 0; i != draw_list.size(); ++i) {
+        const auto& record = draw_list[i];
+
+        auto is_points = record.mesh->GetTopology() == Topology::Points;
+
+        if (is_points || record.index_count == 0 || record.index_count / 3 > max_triangles) {
+            continue;
+        }
+
+        auto& candidate = m_candidates[record.instance->GetID()];
+
+        if (candidate.mesh != record.mesh || candidate.transform != record.transform) {
+            Invalidate(&candidate);
+            candidate.instance      = record.instance;
+            candidate.mesh          = record.mesh;
+            candidate.transform     = record.transform;
+            candidate.stable_frames = 0;
+        } else if (candidate.stable_frames < kSettleFrames && ++candidate.stable_frames == kSettleFrames) {
+            auto aabb = AABB{ { FLT_MAX, FLT_MAX, FLT_MAX }, { -FLT_MAX, -FLT_MAX, -FLT_MAX } };
+            {
+                auto mesh_aabb = record.mesh->GetBoundingBox();
+                for (int corner = 0; corner != 8; ++corner) {
+                    auto x = (corner & 1) ? mesh_aabb.max.x : mesh_aabb.min.x;
+                    auto y = (corner & 2) ? mesh_aabb.max.y : mesh_aabb.min.y;
+                    auto z = (corner & 4) ? mesh_aabb.max.z : mesh_aabb.min.z;
+                    auto p = record.transform * glm::vec4(x, y, z, 1.0f);
+                    aabb.Expand({ p.x, p.y, p.z });
+                }
+            }
+
+            auto extent = std::max({ aabb.ExtentX(), aabb.ExtentY(), aabb.ExtentZ(), FLT_MIN });
+            auto level  = static_cast<int>(std::ceil(std::log2(extent * kCellScale)));
+            auto width  = std::ldexp(1.0, level);
+            auto center = aabb.Center();
+
+            auto cell = [width](float coordinate) {
+                constexpr auto kLimit = 0x1p62;
+                return static_cast<int64_t>(std::clamp(std::floor(coordinate / width), -kLimit, kLimit));
+            };
+
+            auto material = record.instance->GetMaterialPtr();
+            auto layout   = record.mesh->GetVertexLayout();
+
+            candidate.key = { material, layout, level, cell(center.x), cell(center.y), cell(center.z) };
+
+            m_bins[candidate.key].is_dirty = true;
+        }
+
+        candidate.frame = m_frame;
+        ++m_seen_count;
+
+        if (auto batch = candidate.batch) {
+            if (batch->seen_frame != m_frame) {
+                batch->seen_frame = m_frame;
+                batch->seen_count = 0;
+            }
+            ++batch->seen_count;
+        }
+
+        candidates[i] = &candidate;
+    }
+
+    auto out = DrawList{};
+
+    out.reserve(draw_list.size());
+
+    for (size_t i = 0; i != draw_list.size(); ++i) {
+        const auto& record = draw_list[i];
+        const auto  batch  = candidates[i] ? candidates[i]->batch : nullptr;
+
+        // A batch is only drawn if all of its members are in the draw list at the transform they were baked with
+        if (!batch || !batch->is_valid || batch->seen_frame != m_frame || batch->seen_count != batch->members.size()) {
+            out.push_back(record);
+            continue;
+        }
+
+        ++m_stats.instance_count;
+
+        if (batch->drawn_frame != m_frame) {
+            batch->drawn_frame = m_frame;
+            ++m_stats.batch_count;
+
+            auto mesh = batch->mesh;
+            out.push_back({ record.index,
+                            record.instance,
+                            mesh,
+                            glm::identity<glm::mat4>(),
+                            mesh->GetFirstIndex(),
+                            mesh->GetIndexCount() });
+        }
+    }
+
+    m_stats.draw_count = out.size();
+
+    return out;
+}
+
+void StaticBatcher::Update()
+{
+    if (!m_enabled) {
+        if (!m_bins.empty()) {
+            for (auto& [key, bin] : m_bins) {
+                Destroy(&bin);
+            }
+            m_bins.clear();
+        }
+        m_candidates.clear();
+        return;
+    }
+
+    // Instances that have been removed, or have grown beyond the triangle limit, are forgotten
+    if (m_seen_count != m_candidates.size()) {
+        for (auto it = m_candidates.begin(); it != m_candidates.end();) {
+            if (it->second.frame == m_frame) {
+                ++it;
+                continue;
+            }
+            Invalidate(&it->second);
+            it = m_candidates.erase(it);
+        }
+        m_seen_count = m_candidates.size();
+    }
+
+    auto dirty = std::map<BinKey, Members>{};
+
+    for (const auto& [key, bin] : m_bins) {
+        if (bin.is_dirty) {
+            dirty[key];
+        }
+    }
+
+    if (dirty.empty() || m_frame - m_update_frame < kUpdateIntervalFrames) {
+        return;
+    }
+
+    m_update_frame = m_frame;
+
+    for (auto& [id, candidate] : m_candidates) {
+        if (candidate.stable_frames == kSettleFrames) {
+            if (auto it = dirty.find(candidate.key); it != dirty.end()) {
+                it->second.push_back({ id, &candidate });
+            }
+        }
+    }
+
+    auto index_count = size_t{ 0 };
+
+    for (auto& [key, members] : dirty) {
+        if (index_count >= kUpdateIndexBudget) {
+            break;
+        }
+
+        auto& bin = m_bins[key];
+
+        Destroy(&bin);
+
+        index_count += Build(&bin, key, std::move(members));
+        bin.is_dirty = false;
+
+        if (bin.batches.empty()) {
+            m_bins.erase(key);
+        }
+    }
+
+    m_buffer_manager->Upload();
+}
+
+InstanceNodePtr StaticBatcher::FindInstance(MeshPtr mesh, size_t index) const
+{
+    for (const auto& [key, bin] : m_bins) {
+        for (const auto& batch : bin.batches) {
+            if (batch.mesh != mesh) {
+                continue;
+            }
+            if (!batch.is_valid || batch.drawn_frame != m_frame) {
+                return nullptr;
+            }
+
+            auto member = std::ranges::upper_bound(batch.members, index, {}, &Member::first_index);
+            if (member == batch.members.begin()) {
+                return nullptr;
+            }
+
+            --member;
+
+            return index < member->first_index + member->index_count ? member->instance : nullptr;
+        }
+    }
+
+    return nullptr;
+}
+
+MeshPtr StaticBatcher::FindBatch(InstanceNodePtr instance) const
+{
+    if (auto it = m_candidates.find(instance->GetID()); it != m_candidates.end()) {
+        if (auto batch = it->second.batch; batch && batch->is_valid && batch->drawn_frame == m_frame) {
+            return batch->mesh;
+        }
+    }
+
+    return nullptr;
+}
+
+void StaticBatcher::Invalidate(Candidate* candidate)
+{
+    if (auto batch = candidate->batch) {
+        batch->is_valid                 = false;
+        m_bins[candidate->key].is_dirty = true;
+        candidate->batch                = nullptr;
+    }
+}
+
+void StaticBatcher::Destroy(Bin* bin)
+{
+    for (auto& batch : bin->batches) {
+        for (const auto& member : batch.members) {
+            if (auto it = m_candidates.find(member.id); it != m_candidates.end() && it->second.batch == &batch) {
+                it->second.batch = nullptr;
+            }
+        }
+
+        m_buffer_manager->DestroyBuffer(batch.mesh->GetVertexBuffer());
+        m_buffer_manager->DestroyBuffer(batch.mesh->GetIndexBuffer());
+        m_scene->DestroyMesh(batch.mesh);
+    }
+
+    bin->batches.clear();
+}
+
+size_t StaticBatcher::Build(Bin* bin, const BinKey& key, Members members)
+{
+    // The order of the members, and so the batches, does not depend on the order of the hash table
+    std::ranges::sort(members, {}, [](const auto& member) { return member.first.value; });
+
+    auto batches     = std::vector<Batch>{};
+    auto index_count = size_t{ 0 };
+    auto first       = members.begin();
+
+    while (first != members.end()) {
+        auto last  = first;
+        auto count = size_t{ 0 };
+
+        while (last != members.end()) {
+            auto mesh_index_count = last->second->mesh->GetIndexCount();
+            if (last != first && count + mesh_index_count > kBatchIndexCount) {
+                break;
+            }
+            count += mesh_index_count;
+            ++last;
+        }
+
+        // A batch of one instance would not save a draw
+        if (last - first > 1) {
+            batches.push_back(BuildBatch(key, { first, last }));
+            index_count += count;
+        }
+
+        first = last;
+    }
+
+    bin->batches = std::move(batches);
+
+    for (auto& batch : bin->batches) {
+        for (const auto& member : batch.members) {
+            m_candidates[member.id].batch = &batch;
+        }
+    }
+
+    return index_count;
+}
+
+auto StaticBatcher::BuildBatch(const BinKey& key, std::span<const std::pair<ID, Candidate*>> members) -> Batch
+{
+    auto batch    = Batch{};
+    auto vertices = std::vector<VertexPN>{};
+    auto indices  = std::vector<uint32_t>{};
+    auto aabb     = AABB{ { FLT_MAX, FLT_MAX, FLT_MAX }, { -FLT_MAX, -FLT_MAX, -FLT_MAX } };
+
+    for (const auto& [id, candidate] : members) {
+        const auto& mesh      = *candidate->mesh;
+        const auto& transform = candidate->transform;
+
+        auto source = ReadIndices(mesh);
+        auto unique = source;
+
+        std::ranges::sort(unique);
+        unique.erase(std::unique(unique.begin(), unique.end()), unique.end());
+
+        auto linear = glm::mat3(transform);
+        auto normal = glm::transpose(glm::inverse(linear));
+        auto base   = utils::narrow_cast<uint32_t>(vertices.size());
+
+        for (auto index : unique) {
+            auto vertex   = ReadVertex(mesh, index);
+            auto position = glm::vec3(transform * glm::vec4(vertex.position, 1.0f));
+            auto length   = glm::length(normal * vertex.normal);
+
+            vertex.position = position;
+            vertex.normal   = length > 0.0f ? normal * vertex.normal / length : glm::vec3(0.0f);
+
+            vertices.push_back(vertex);
+            aabb.Expand({ position.x, position.y, position.z });
+        }
+
+        auto first_index = indices.size();
+
+        for (auto index : source) {
+            auto local = std::ranges::lower_bound(unique, index) - unique.begin();
+            indices.push_back(base + utils::narrow_cast<uint32_t>(local));
+        }
+
+        // Mirroring transforms reverse the winding, which is restored
+        if (glm::determinant(linear) < 0.0f) {
+            for (auto i = first_index; i + 2 < indices.size(); i += 3) {
+                std::swap(indices[i + 1], indices[i + 2]);
+            }
+        }
+
+        batch.members.push_back({ id, candidate->instance, first_index, source.size() });
+    }
+
+    auto vertex_buffer = VertexBufferPtr{};
+
+    if (key.vertex_layout == VertexLayout::Quantized) {
+        auto quantized = std::vector<VertexPN16>{};
+        quantized.reserve(vertices.size());
+        for (const auto& [position, normal] : vertices) {
+            quantized.push_back({ QuantizePosition(position, aabb), EncodeOctahedral(normal) });
+        }
+        auto size     = quantized.size() * sizeof(VertexPN16);
+        vertex_buffer = m_scene->CreateVertexBuffer(quantized.data(), size, std::align_val_t(32));
+    } else if (key.vertex_layout == VertexLayout::Flat) {
+        auto positions = std::vector<VertexP>{};
+        positions.reserve(vertices.size());
+        for (const auto& vertex : vertices) {
+            positions.push_back({ vertex.position });
+        }
+        auto size     = positions.size() * sizeof(VertexP);
+        vertex_buffer = m_scene->CreateVertexBuffer(positions.data(), size, std::align_val_t(32));
+    } else {
+        auto size     = vertices.size() * sizeof(VertexPN);
+        vertex_buffer = m_scene->CreateVertexBuffer(vertices.data(), size, std::align_val_t(32));
+    }
+
+    auto shapes = ShapeRecords{ { {}, { MeshRecord{ .aabb = aabb, .index_count = indices.size() } } } };
+    auto packed = PackIndices(indices, shapes, {});
+
+    auto index_buffer = m_scene->CreateIndexBuffer(
+        packed.data.data(),
+        packed.data.size() * sizeof(uint16_t),
+        std::align_val_t(32));
+
+    const auto& [format, first, vertex_offset, lods] = packed.meshes.front();
+
+    batch.mesh = m_scene->CreateMesh(
+        aabb,
+        vertex_buffer,
+        index_buffer,
+        first,
+        indices.size(),
+        format,
+        vertex_offset,
+        key.vertex_layout);
+
+    for (auto& member : batch.members) {
+        member.first_index += first;
+    }
+
+    m_buffer_manager->CreateBuffer(vertex_buffer, etna::BufferUsage::VertexBuffer);
+    m_buffer_manager->CreateBuffer(index_buffer, etna::BufferUsage::IndexBuffer);
+
+    return batch;
+}
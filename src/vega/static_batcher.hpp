@@ -0,0 +1,119 @@
+#pragma once
+
+#include "scene.hpp"
+
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <span>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class BufferManager;
+
+struct StaticBatcherStats final {
+    size_t batch_count    = 0; // Drawn in the last draw list
+    size_t instance_count = 0; // Drawn as part of a batch
+    size_t draw_count     = 0; // Records of the last draw list
+};
+
+// Merges small instances that share a material into pre-transformed meshes, so scenes of many tiny shapes are not
+// bound by one draw per instance. An instance of a triangle mesh of at most 'max triangles' takes part once its
+// transform has stayed the same for a number of frames. Instances are binned by material and by a grid cell sized to
+// their extent, and every bin is baked into batches of a bounded index count in the vertex layout of their meshes. When
+// a member moves or leaves the scene, its batch is no longer drawn and its members are drawn on their own until the bin
+// is rebuilt. Apply is called by DrawListBuilder on every frame, Update between frames, which bounds the amount of
+// rebuilding per call and uploads the new batches. Bins are rebuilt at most every few frames, so a burst of moves is
+// uploaded once rather than on every frame. Off by default.
+class StaticBatcher final {
+  public:
+    StaticBatcher(Scene* scene, BufferManager* buffer_manager) noexcept
+        : m_scene(scene), m_buffer_manager(buffer_manager)
+    {}
+
+    StaticBatcher(const StaticBatcher&) = delete;
+    StaticBatcher& operator=(const StaticBatcher&) = delete;
+
+    // Replaces the records of the members of valid batches by one record per batch, with the index of its first member
+    auto Apply(DrawList draw_list) -> DrawList;
+
+    // Builds the bins that have gained or lost members, at most every few frames, and destroys all batches once
+    // disabled
+    void Update();
+
+    // Instance whose triangles are at 'index' of a batch mesh, for picking. Null if 'mesh' is not a drawn batch.
+    auto FindInstance(MeshPtr mesh, size_t index) const -> InstanceNodePtr;
+
+    // Batch mesh that 'instance' is drawn with, for property display. Null if it is drawn on its own.
+    auto FindBatch(InstanceNodePtr instance) const -> MeshPtr;
+
+    auto GetStats() const noexcept { return m_stats; }
+
+    auto& EnabledRef() noexcept { return m_enabled; }
+    auto& MaxTrianglesRef() noexcept { return m_max_triangles; }
+
+  private:
+    struct Member final {
+        ID              id;
+        InstanceNodePtr instance{};
+        size_t          first_index{}; // In indices of the batch mesh
+        size_t          index_count{};
+    };
+
+    struct Batch final {
+        MeshPtr             mesh{};
+        std::vector<Member> members; // In index order
+        bool                is_valid{ true };
+        size_t              seen_count{};  // Members in the draw list of 'seen_frame'
+        uint64_t            seen_frame{};
+        uint64_t            drawn_frame{}; // Last draw list the batch was emitted to
+    };
+
+    struct BinKey final {
+        MaterialPtr  material{};
+        VertexLayout vertex_layout{};
+        int          level{}; // The cells are 2^level wide
+        int64_t      x{};
+        int64_t      y{};
+        int64_t      z{};
+
+        auto operator<=>(const BinKey&) const = default;
+    };
+
+    struct Bin final {
+        std::vector<Batch> batches;
+        bool               is_dirty{};
+    };
+
+    struct Candidate final {
+        InstanceNodePtr instance{};
+        MeshPtr         mesh{};
+        glm::mat4       transform{};
+        uint32_t        stable_frames{};
+        uint64_t        frame{}; // Last draw list the instance was in
+        BinKey          key;     // Set once settled
+        Batch*          batch{};
+    };
+
+    using Members = std::vector<std::pair<ID, Candidate*>>;
+
+    void Invalidate(Candidate* candidate);
+    void Destroy(Bin* bin);
+    auto Build(Bin* bin, const BinKey& key, Members members) -> size_t;
+    auto BuildBatch(const BinKey& key, std::span<const std::pair<ID, Candidate*>> members) -> Batch;
+
+    Scene*         m_scene          = nullptr;
+    BufferManager* m_buffer_manager = nullptr;
+
+    bool m_enabled{ false };
+    int  m_max_triangles{ 256 };
+
+    std::unordered_map<ID, Candidate, ID::Hash> m_candidates;
+    std::map<BinKey, Bin>                       m_bins;
+    uint64_t                                    m_frame = 0;
+    uint64_t                                    m_update_frame{}; // Last frame bins were built and uploaded
+    size_t                                      m_seen_count{}; // Candidates in the current draw list
+    StaticBatcherStats                          m_stats;
+};
@@ -1,21 +1,27 @@
 #include "etna/etna.hpp"
 
+#include "cxxopts.hpp"
+
 #include "buffer_manager.hpp"
 #include "camera.hpp"
 #include "descriptor_manager.hpp"
+#include "draw_list_builder.hpp"
 #include "frame_manager.hpp"
+#include "geometry.hpp"
+#include "geometry_cache.hpp"
 #include "gui.hpp"
+#include "obj_loader.hpp"
 #include "render_context.hpp"
 #include "scene.hpp"
+#include "scene_loader.hpp"
+#include "static_batcher.hpp"
 #include "swapchain_manager.hpp"
+#include "thread_pool.hpp"
 #include "utils/misc.hpp"
 #include "utils/resource.hpp"
 
 BEGIN_DISABLE_WARNINGS
 
-#define TINYOBJLOADER_IMPLEMENTATION
-#include "tiny_obj_loader.h"
-
 #define GLFW_INCLUDE_NONE
 #include <GLFW/glfw3.h>
 
@@ -28,61 +34,23 @@ BEGIN_DISABLE_WARNINGS
 END_DISABLE_WARNINGS
 
 #include <algorithm>
+#include <array>
+#include <cstdlib>
 #include <filesystem>
+#include <iostream>
 #include <optional>
-#include <unordered_map>
+#include <string>
 #include <vector>
 
 enum class KhronosValidation { Disable, Enable };
 
-struct VertexPN final {
-    constexpr VertexPN(const glm::vec3& position, const glm::vec3 normal) noexcept : position(position), normal(normal)
-    {}
-    glm::vec3 position;
-    glm::vec3 normal;
-};
-
-bool operator==(const VertexPN& lhs, const VertexPN& rhs) noexcept
-{
-    return (lhs.position == rhs.position) && (glm::dot(lhs.normal, rhs.normal) > 0.999847695f);
-}
-
 DECLARE_VERTEX_ATTRIBUTE_TYPE(glm::vec3, etna::Format::R32G32B32Sfloat)
+DECLARE_VERTEX_ATTRIBUTE_TYPE(glm::u16vec4, etna::Format::R16G16B16A16Unorm)
+DECLARE_VERTEX_ATTRIBUTE_TYPE(glm::i16vec2, etna::Format::R16G16Snorm)
 
 DECLARE_VERTEX_TYPE(VertexPN, Position3f | Normal3f)
-
-namespace std {
-
-template <>
-struct hash<VertexPN> {
-    size_t operator()(const VertexPN& vertex) const noexcept
-    {
-        size_t hash = 23;
-
-        hash = hash * 31 + std::hash<float>{}(vertex.position.x);
-        hash = hash * 31 + std::hash<float>{}(vertex.position.y);
-        hash = hash * 31 + std::hash<float>{}(vertex.position.z);
-
-        return hash;
-    }
-};
-
-} // namespace std
-
-struct TinyIndex final {
-    struct Hash final {
-        size_t operator()(const tinyobj::index_t& index) const noexcept { return index.vertex_index; }
-    };
-    struct Equal final {
-        bool operator()(const tinyobj::index_t& lhs, const tinyobj::index_t& rhs) const noexcept
-        {
-            return (lhs.vertex_index == rhs.vertex_index) && (lhs.normal_index == rhs.normal_index) &&
-                   (lhs.texcoord_index == rhs.texcoord_index);
-        }
-    };
-};
-
-using IndexMap = std::unordered_map<tinyobj::index_t, size_t, TinyIndex::Hash, TinyIndex::Equal>;
+DECLARE_VERTEX_TYPE(VertexPN16, Position4Unorm16 | NormalOctahedral2Snorm16)
+DECLARE_VERTEX_TYPE(VertexP, Position3f)
 
 struct GLFW {
     GLFW()
@@ -93,278 +61,27 @@ struct GLFW {
     ~GLFW() { glfwTerminate(); }
 } glfw;
 
-struct MeshRecord final {
-    AABB   aabb{};
-    int    material_id{};
-    size_t first_index{};
-    size_t index_count{};
-};
-
-using MeshRecords = std::vector<MeshRecord>;
-
-static MeshRecords GenerateMeshRecords(
-    const tinyobj::attrib_t& attributes,
-    const tinyobj::mesh_t&   mesh,
-    IndexMap*                index_map,
-    std::vector<VertexPN>*   vertices,
-    std::vector<uint32_t>*   indices)
-{
-    const auto& [positions, normals, texcoords, colors] = attributes;
-
-    auto mesh_map = std::map<int, std::vector<uint32_t>>{};
-
-    for (size_t i = 0; i < mesh.indices.size(); ++i) {
-        const auto& index       = mesh.indices[i];
-        const auto  material_id = mesh.material_ids[i / 3];
-        const auto  pindex      = 3 * index.vertex_index;
-        const auto  nindex      = 3 * index.normal_index;
-        const auto  position    = glm::vec3(positions[pindex + 0], positions[pindex + 1], positions[pindex + 2]);
-        const auto  normal      = glm::vec3(normals[nindex + 0], normals[nindex + 1], normals[nindex + 2]);
-
-        auto new_index = vertices->size();
-
-        if (auto [it, success] = index_map->try_emplace(index, vertices->size()); success) {
-            vertices->emplace_back(position, normal);
-        } else {
-            new_index = it->second;
-        }
-
-        auto& index_buffer = mesh_map[material_id];
-        if (index_buffer.empty()) {
-            index_buffer.reserve(mesh.indices.size());
-        }
-        index_buffer.push_back(utils::narrow_cast<uint32_t>(new_index));
-    }
-
-    auto mesh_records = MeshRecords{};
-
-    for (auto& [material_id, index_buffer] : mesh_map) {
-        auto record = MeshRecord{
-
-            .aabb        = AABB{ { FLT_MAX, FLT_MAX, FLT_MAX }, { FLT_MIN, FLT_MIN, FLT_MIN } },
-            .material_id = material_id,
-            .first_index = indices->size(),
-            .index_count = index_buffer.size()
-        };
-
-        for (uint32_t index : index_buffer) {
-            auto position = (*vertices)[index].position;
-
-            record.aabb.min = { std::min(record.aabb.min.x, position.x),
-                                std::min(record.aabb.min.y, position.y),
-                                std::min(record.aabb.min.z, position.z) };
-
-            record.aabb.max = { std::max(record.aabb.max.x, position.x),
-                                std::max(record.aabb.max.y, position.y),
-                                std::max(record.aabb.max.z, position.z) };
-
-            indices->push_back(index);
-        }
-
-        mesh_records.push_back(record);
-    }
-
-    return mesh_records;
-}
-
-static MeshPtr GenerateMeshP(ScenePtr scene, const tinyobj::attrib_t& attributes, const tinyobj::mesh_t& mesh)
-{
-    auto num_indices = mesh.indices.size();
-
-    assert(num_indices % 3 == 0);
-
-    auto vertices = std::vector<VertexPN>{};
-    auto indices  = std::vector<uint32_t>{};
-
-    auto index_map = std::unordered_map<VertexPN, size_t>();
-
-    auto aabb = AABB{ { FLT_MAX, FLT_MAX, FLT_MAX }, { FLT_MIN, FLT_MIN, FLT_MIN } };
-
-    for (size_t i = 0; i < num_indices; i += 3) {
-        auto i0     = 3 * utils::narrow_cast<size_t>(mesh.indices[i + 0].vertex_index);
-        auto i1     = 3 * utils::narrow_cast<size_t>(mesh.indices[i + 1].vertex_index);
-        auto i2     = 3 * utils::narrow_cast<size_t>(mesh.indices[i + 2].vertex_index);
-        auto pos0   = glm::vec3(attributes.vertices[i0 + 0], attributes.vertices[i0 + 1], attributes.vertices[i0 + 2]);
-        auto pos1   = glm::vec3(attributes.vertices[i1 + 0], attributes.vertices[i1 + 1], attributes.vertices[i1 + 2]);
-        auto pos2   = glm::vec3(attributes.vertices[i2 + 0], attributes.vertices[i2 + 1], attributes.vertices[i2 + 2]);
-        auto e1     = pos1 - pos0;
-        auto e2     = pos2 - pos0;
-        auto normal = glm::normalize(glm::cross(e1, e2));
-
-        auto vertex0 = VertexPN(pos0, normal);
-        auto vertex1 = VertexPN(pos1, normal);
-        auto vertex2 = VertexPN(pos2, normal);
-
-        size_t index0 = vertices.size();
-        if (auto [kv, is_inserted] = index_map.insert({ vertex0, index0 }); is_inserted) {
-            vertices.push_back(vertex0);
-        } else {
-            index0 = kv->second;
-        }
-
-        size_t index1 = vertices.size();
-        if (auto [kv, is_inserted] = index_map.insert({ vertex1, index1 }); is_inserted) {
-            vertices.push_back(vertex1);
-        } else {
-            index1 = kv->second;
-        }
-
-        size_t index2 = vertices.size();
-        if (auto [kv, is_inserted] = index_map.insert({ vertex2, index2 }); is_inserted) {
-            vertices.push_back(vertex2);
-        } else {
-            index2 = kv->second;
-        }
-
-        indices.push_back(etna::narrow_cast<uint32_t>(index0));
-        indices.push_back(etna::narrow_cast<uint32_t>(index1));
-        indices.push_back(etna::narrow_cast<uint32_t>(index2));
-
-        aabb.Expand({ pos0.x, pos0.y, pos0.z });
-        aabb.Expand({ pos1.x, pos1.y, pos1.z });
-        aabb.Expand({ pos2.x, pos2.y, pos2.z });
-    }
-
-    auto vertex_size   = sizeof(vertices[0]);
-    auto vertex_count  = vertices.size();
-    auto vertex_buffer = scene->CreateVertexBuffer(vertices.data(), vertex_size * vertex_count, std::align_val_t(32));
-
-    auto index_size   = sizeof(indices[0]);
-    auto index_count  = indices.size();
-    auto index_buffer = scene->CreateIndexBuffer(indices.data(), index_size * index_count, std::align_val_t(32));
-
-    return scene->CreateMesh(aabb, vertex_buffer, index_buffer, 0, index_count);
-}
-
-void LoadObj(ScenePtr scene, std::filesystem::path filepath)
+// Binds the position and, unless 'Vertex' has none, the normal of 'Vertex' to the inputs of shader.vert, points.vert or
+// flat.vert
+template <typename Vertex>
+static void AddVertexInput(etna::Pipeline::Builder& builder)
 {
-    namespace fs = std::filesystem;
-
-    if (false == fs::exists(filepath)) {
-        throw std::runtime_error("File does not exist");
-    }
-
-    auto parent_dir = fs::path(filepath).parent_path();
-
-    auto attributes = tinyobj::attrib_t{};
-    auto shapes     = std::vector<tinyobj::shape_t>{};
-    auto materials  = std::vector<tinyobj::material_t>{};
-    auto warning    = std::string{};
-    auto error      = std::string{};
-
-    spdlog::info("Loading file {}", filepath.string());
-
-    auto start = std::chrono::system_clock::now();
-
-    bool success = tinyobj::LoadObj(
-        &attributes,
-        &shapes,
-        &materials,
-        &warning,
-        &error,
-        filepath.string().c_str(),
-        parent_dir.string().c_str(),
-        true,
-        false);
-
-    if (!success || !error.empty()) {
-        spdlog::error("{}", error);
-        utils::throw_runtime_error("Failed to load object file");
-    }
-
-    if (!warning.empty()) {
-        spdlog::warn("{}", warning);
-    }
-
-    auto end     = std::chrono::system_clock::now();
-    auto elapsed = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
-
-    spdlog::info("File loaded. Elapsed time: {} seconds.", elapsed);
-
-    spdlog::info("Generating scene");
-
-    start = std::chrono::system_clock::now();
-
-    auto shader       = scene->CreateShader();
-    auto material_map = std::map<int, MaterialPtr>{};
-    {
-        auto default_material = scene->CreateMaterial(shader);
-        material_map[-1]      = default_material;
-
-        for (size_t material_index = 0; material_index != materials.size(); ++material_index) {
-            auto material       = scene->CreateMaterial(shader);
-            auto index          = utils::narrow_cast<int>(material_index);
-            material_map[index] = material;
-        }
-    }
-
-    auto root_node = scene->GetRootNode();
-    auto file_node = root_node->AttachNode(scene->CreateGroupNode());
-
-    file_node->SetProperty("name", filepath.filename().string());
-    file_node->SetProperty("Path", filepath.string());
-
-    auto mesh_map      = std::map<size_t, MeshRecords>{};
-    auto vertex_buffer = VertexBufferPtr{};
-    auto index_buffer  = IndexBufferPtr{};
-
-    {
-        auto index_count = size_t{ 0 };
-        for (auto& shape : shapes) {
-            index_count += shape.mesh.indices.size();
-        }
-
-        auto vertices = std::vector<VertexPN>{};
-        vertices.reserve(2 * attributes.vertices.size());
-
-        auto indices = std::vector<uint32_t>{};
-        indices.reserve(index_count);
-
-        auto index_map = IndexMap{};
-        index_map.reserve(2 * attributes.vertices.size());
-
-        for (size_t shape_index = 0; shape_index < shapes.size(); ++shape_index) {
-            auto records = GenerateMeshRecords(attributes, shapes[shape_index].mesh, &index_map, &vertices, &indices);
-            mesh_map[shape_index] = std::move(records);
-        }
-
-        auto vertices_size = sizeof(vertices[0]) * vertices.size();
-        vertex_buffer      = scene->CreateVertexBuffer(vertices.data(), vertices_size, std::align_val_t(32));
-
-        auto indices_size = sizeof(indices[0]) * indices.size();
-        index_buffer      = scene->CreateIndexBuffer(indices.data(), indices_size, std::align_val_t(32));
-    }
-
-    auto shape_num = 1;
-
-    for (const auto& [shape_index, mesh_records] : mesh_map) {
-        auto parent = file_node;
-        auto name   = shapes[shape_index].name;
-        if (name.empty()) {
-            name = std::string("Mesh ") + std::to_string(shape_num++);
-        }
-        if (mesh_records.size() > 1) {
-            parent = file_node->AttachNode(scene->CreateGroupNode());
-            parent->SetProperty("name", name);
-        }
-        auto mesh_num = 1;
-        for (const auto& [aabb, material_id, first, count] : mesh_records) {
-            auto mesh     = scene->CreateMesh(aabb, vertex_buffer, index_buffer, first, count);
-            auto material = material_map[material_id];
-            auto instance = parent->AttachNode(scene->CreateInstanceNode(mesh, material));
-            if (mesh_records.size() == 1) {
-                instance->SetProperty("name", name);
-            } else {
-                auto suffix = std::string(" (") + std::to_string(mesh_num++) + (")");
-                instance->SetProperty("name", name + suffix);
-            }
-        }
+    using etna::Binding;
+    using etna::Location;
+
+    builder.AddVertexInputBindingDescription(Binding{ 0 }, sizeof(Vertex));
+    builder.AddVertexInputAttributeDescription(
+        Location{ 0 },
+        Binding{ 0 },
+        formatof(Vertex, position),
+        offsetof(Vertex, position));
+    if constexpr ((vertex_type_traits<Vertex>::value & (Normal3f | NormalOctahedral2Snorm16)) != 0) {
+        builder.AddVertexInputAttributeDescription(
+            Location{ 1 },
+            Binding{ 0 },
+            formatof(Vertex, normal),
+            offsetof(Vertex, normal));
     }
-
-    end     = std::chrono::system_clock::now();
-    elapsed = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
-
-    spdlog::info("Scene generation finished. Elapsed time: {} seconds.", elapsed);
 }
 
 struct QueueInfo final {
@@ -720,9 +437,10 @@ class EventHandler {
         GLFWwindow*    glfw_window,
         Scene*         scene,
         Camera*        camera,
-        BufferManager* buffer_manager)
+        SceneLoader*   scene_loader,
+        StaticBatcher* static_batcher)
         : m_render_context(render_context), m_glfw_window(glfw_window), m_scene(scene), m_camera(camera),
-          m_buffer_manager(buffer_manager)
+          m_scene_loader(scene_loader), m_static_batcher(static_batcher)
     {}
 
     void ScheduleCloseWindow() noexcept
@@ -731,11 +449,15 @@ class EventHandler {
         m_render_context->StopRenderLoop();
     }
 
-    void ScheduleLoadFile(std::string filepath) noexcept
+    // The files are loaded concurrently in the background, the render loop keeps running
+    void ScheduleLoadFiles(std::vector<std::filesystem::path> filepaths) { m_scene_loader->Load(std::move(filepaths)); }
+
+    void OnFrameBegin()
     {
-        m_event                         = Event::LoadFile;
-        m_load_file_parameters.filepath = std::move(filepath);
-        m_render_context->StopRenderLoop();
+        if (m_scene_loader->Attach()) {
+            ResetCamera();
+        }
+        m_static_batcher->Update();
     }
 
     void HandleEvent()
@@ -743,7 +465,6 @@ class EventHandler {
         switch (m_event) {
         case Event::None: break;
         case Event::CloseWindow: CloseWindow(); break;
-        case Event::LoadFile: LoadFile(); break;
         default: break;
         }
 
@@ -751,25 +472,12 @@ class EventHandler {
     }
 
   private:
-    enum class Event { None, CloseWindow, LoadFile };
-
-    struct LoadFileParameters final {
-        std::string filepath;
-    } m_load_file_parameters;
+    enum class Event { None, CloseWindow };
 
     void CloseWindow() { glfwSetWindowShouldClose(m_glfw_window, GLFW_TRUE); }
 
-    void LoadFile()
+    void ResetCamera()
     {
-        LoadObj(m_scene, m_load_file_parameters.filepath);
-
-        auto draw_list = m_scene->ComputeDrawList();
-        for (const DrawRecord& draw_record : draw_list) {
-            m_buffer_manager->CreateBuffer(draw_record.mesh->GetVertexBuffer(), etna::BufferUsage::VertexBuffer);
-            m_buffer_manager->CreateBuffer(draw_record.mesh->GetIndexBuffer(), etna::BufferUsage::IndexBuffer);
-        }
-        m_buffer_manager->Upload();
-
         auto aabb = m_scene->ComputeAxisAlignedBoundingBox();
 
         int width{}, height{};
@@ -791,11 +499,86 @@ class EventHandler {
     GLFWwindow*    m_glfw_window;
     Scene*         m_scene;
     Camera*        m_camera;
-    BufferManager* m_buffer_manager;
+    SceneLoader*   m_scene_loader;
+    StaticBatcher* m_static_batcher;
     Event          m_event = Event::None;
 };
 
-int main()
+// Options of the viewer given on the command line
+struct Settings final {
+    // VertexLayout::Quantized halves the vertex memory, at a precision of 1/65535 of the size of every mesh.
+    // VertexLayout::Flat stores positions only and shades every triangle with its face normal. The layout can be
+    // changed at runtime for the files loaded afterwards.
+    VertexLayout vertex_layout = VertexLayout::Float;
+
+    // Stages run on .obj, .ply and .stl files, all of them unless left out on the command line, and the STL options
+    LoadOptions load_options;
+
+    // Cache blobs are matched by the size and modification time of their file, and with Contents also by its hash
+    GeometryCache::Validation cache_validation = GeometryCache::Validation::Metadata;
+};
+
+// Returns std::nullopt if only the usage has been asked for, which is printed. Throws on invalid options.
+static auto ParseSettings(int argc, char** argv) -> std::optional<Settings>
+{
+    cxxopts::Options options(*argv, "Vega Viewer");
+
+    options.add_options()(
+        "vertex-layout",
+        "vertex layout of loaded meshes: float, quantized or flat",
+        cxxopts::value<std::string>()->default_value("float"))(
+        "no-deduplicate", "keep duplicate meshes instead of instancing them")(
+        "no-optimize", "keep the triangle and vertex order of the files")(
+        "no-meshlets", "skip building meshlets, which disables cone culling")(
+        "no-lods", "skip building simplified meshes")(
+        "stl-normals",
+        "normals of .stl files: smooth to generate them, stored to keep the flat facet normals of the file",
+        cxxopts::value<std::string>()->default_value("smooth"))(
+        "verify-cache", "hash loaded files to validate their cache blobs, which reads every file once more")(
+        "h,help", "print usage");
+
+    auto result = options.parse(argc, argv);
+
+    if (result.count("help")) {
+        std::cout << options.help();
+        return std::nullopt;
+    }
+
+    auto settings      = Settings{};
+    auto vertex_layout = result["vertex-layout"].as<std::string>();
+    auto stl_normals   = result["stl-normals"].as<std::string>();
+
+    settings.load_options.deduplicate    = result.count("no-deduplicate") == 0;
+    settings.load_options.optimize       = result.count("no-optimize") == 0;
+    settings.load_options.build_meshlets = result.count("no-meshlets") == 0;
+    settings.load_options.build_lods     = result.count("no-lods") == 0;
+
+    if (result.count("verify-cache")) {
+        settings.cache_validation = GeometryCache::Validation::Contents;
+    }
+
+    if (vertex_layout == "float") {
+        settings.vertex_layout = VertexLayout::Float;
+    } else if (vertex_layout == "quantized") {
+        settings.vertex_layout = VertexLayout::Quantized;
+    } else if (vertex_layout == "flat") {
+        settings.vertex_layout = VertexLayout::Flat;
+    } else {
+        utils::throw_runtime_error("Unknown vertex layout, expected float, quantized or flat");
+    }
+
+    if (stl_normals == "smooth") {
+        settings.load_options.stl.normals = StlNormals::Smooth;
+    } else if (stl_normals == "stored") {
+        settings.load_options.stl.normals = StlNormals::Stored;
+    } else {
+        utils::throw_runtime_error("Unknown STL normals, expected smooth or stored");
+    }
+
+    return settings;
+}
+
+int main(int argc, char** argv)
 {
 #ifdef NDEBUG
     const KhronosValidation khronos_validation = KhronosValidation::Disable;
@@ -803,6 +586,19 @@ int main()
     const KhronosValidation khronos_validation = KhronosValidation::Enable;
 #endif
 
+    auto settings = std::optional<Settings>{};
+
+    try {
+        settings = ParseSettings(argc, argv);
+    } catch (const std::exception& e) {
+        std::cout << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+
+    if (!settings) {
+        return EXIT_SUCCESS;
+    }
+
     using namespace etna;
 
     auto instance       = CreateEtnaInstance(khronos_validation);
@@ -931,12 +727,17 @@ int main()
         pipeline_layout = device->CreatePipelineLayout(builder.state);
     }
 
-    // Create pipeline
-    auto pipeline = UniquePipeline();
-    {
+    // Create one pipeline per vertex layout, the layout of files loaded later can be changed at runtime, and one for
+    // point meshes
+    auto pipelines = std::array<UniquePipeline, 4>{};
+    for (size_t i = 0; i != pipelines.size(); ++i) {
+        auto is_points          = i == RenderContext::kPointPipeline;
+        auto vertex_layout      = is_points ? VertexLayout::Float : static_cast<VertexLayout>(i);
         auto builder            = Pipeline::Builder(*pipeline_layout, *renderpass);
-        auto [vs_data, vs_size] = GetResource("shaders/shader.vert");
-        auto [fs_data, fs_size] = GetResource("shaders/shader.frag");
+        auto is_flat            = vertex_layout == VertexLayout::Flat;
+        auto vs_name            = is_flat ? "shaders/flat.vert" : "shaders/shader.vert";
+        auto [vs_data, vs_size] = GetResource(is_points ? "shaders/points.vert" : vs_name);
+        auto [fs_data, fs_size] = GetResource(is_flat ? "shaders/flat.frag" : "shaders/shader.frag");
         auto vertex_shader      = device->CreateShaderModule(vs_data, vs_size);
         auto fragment_shader    = device->CreateShaderModule(fs_data, fs_size);
         auto width              = narrow_cast<float>(extent.width);
@@ -946,31 +747,30 @@ int main()
 
         builder.AddShaderStage(*vertex_shader, ShaderStage::Vertex);
         builder.AddShaderStage(*fragment_shader, ShaderStage::Fragment);
-        builder.AddVertexInputBindingDescription(Binding{ 0 }, sizeof(VertexPN));
-        builder.AddVertexInputAttributeDescription(
-            Location{ 0 },
-            Binding{ 0 },
-            formatof(VertexPN, position),
-            offsetof(VertexPN, position));
-        builder.AddVertexInputAttributeDescription(
-            Location{ 1 },
-            Binding{ 0 },
-            formatof(VertexPN, normal),
-            offsetof(VertexPN, normal));
+        if (vertex_layout == VertexLayout::Quantized) {
+            AddVertexInput<VertexPN16>(builder);
+        } else if (is_flat) {
+            AddVertexInput<VertexP>(builder);
+        } else {
+            AddVertexInput<VertexPN>(builder);
+        }
+        if (is_points) {
+            builder.SetPrimitiveTopology(PrimitiveTopology::PointList);
+        }
         builder.AddViewport(viewport);
         builder.AddScissor(scissor);
         builder.AddDynamicStates({ DynamicState::Viewport, DynamicState::Scissor });
         builder.SetDepthState(DepthTest::Enable, DepthWrite::Enable, CompareOp::Less);
         builder.AddColorBlendAttachmentState();
 
-        pipeline = device->CreateGraphicsPipeline(builder.state);
+        pipelines[i] = device->CreateGraphicsPipeline(builder.state);
     }
 
-    auto buffer_manager = BufferManager(*device, queues.transfer);
-
     uint32_t image_count = 3;
     uint32_t frame_count = 2;
 
+    auto buffer_manager = BufferManager(*device, queues.transfer, frame_count);
+
     auto descriptor_manager = DescriptorManager(*device, frame_count, *descriptor_set_layout, gpu_properties.limits);
 
     auto render_context = RenderContext();
@@ -999,7 +799,24 @@ int main()
         lights.FillRef().AzimuthRef()    = ToRadians(25_deg).value;
     }
 
-    auto event_handler = EventHandler(&render_context, glfw_window.get(), &scene, &camera, &buffer_manager);
+    auto static_batcher = StaticBatcher(&scene, &buffer_manager);
+
+    auto draw_list_builder = DrawListBuilder(&static_batcher);
+
+    auto thread_pool = ThreadPool();
+
+    auto geometry_cache = GeometryCache(GeometryCache::DefaultDirectory(), settings->cache_validation);
+
+    auto scene_loader = SceneLoader(
+        &scene,
+        &buffer_manager,
+        &thread_pool,
+        &geometry_cache,
+        settings->vertex_layout,
+        settings->load_options);
+
+    auto event_handler =
+        EventHandler(&render_context, glfw_window.get(), &scene, &camera, &scene_loader, &static_batcher);
 
     auto parameters = Gui::Parameters{
 
@@ -1014,10 +831,29 @@ int main()
     auto callbacks = Gui::Callbacks{
 
         .OnWindowClose = [&event_handler]() { event_handler.ScheduleCloseWindow(); },
-        .OnFileOpen = [&event_handler](std::string filepath) { event_handler.ScheduleLoadFile(std::move(filepath)); }
+        .OnFilesOpen =
+            [&event_handler](std::vector<std::filesystem::path> filepaths) {
+                event_handler.ScheduleLoadFiles(std::move(filepaths));
+            }
     };
 
-    auto gui = Gui(parameters, callbacks, glfw_window.get(), image_count, image_count, &camera, &scene, &lights);
+    auto gui = Gui(
+        parameters,
+        callbacks,
+        glfw_window.get(),
+        image_count,
+        image_count,
+        &camera,
+        &scene,
+        &lights,
+        &draw_list_builder,
+        &static_batcher,
+        &scene_loader);
+
+    auto render_callbacks = RenderContext::Callbacks{
+
+        .OnFrameBegin = [&event_handler]() { event_handler.OnFrameBegin(); }
+    };
 
     bool running = true;
 
@@ -1039,7 +875,7 @@ int main()
         render_context = RenderContext(
             *device,
             queues.graphics,
-            *pipeline,
+            RenderContext::Pipelines{ *pipelines[0], *pipelines[1], *pipelines[2], *pipelines[3] },
             *pipeline_layout,
             glfw_window.get(),
             &swapchain_manager,
@@ -1048,8 +884,10 @@ int main()
             &gui,
             &camera,
             &lights,
+            &draw_list_builder,
             &buffer_manager,
-            &scene);
+            &scene,
+            render_callbacks);
 
         auto status = render_context.StartRenderLoop();
 
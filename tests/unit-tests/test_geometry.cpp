@@ -0,0 +1,1112 @@
+#include "geometry_cache.hpp"
+#include "gltf_loader.hpp"
+#include "mesh_codec.hpp"
+#include "mesh_deduplicator.hpp"
+#include "mesh_optimizer.hpp"
+#include "mesh_simplifier.hpp"
+#include "meshlet_builder.hpp"
+#include "obj_loader.hpp"
+#include "obj_parser.hpp"
+#include "platform.hpp"
+#include "ply_loader.hpp"
+#include "thread_pool.hpp"
+#include "vertex_quantizer.hpp"
+#include "vertex_welder.hpp"
+
+BEGIN_DISABLE_WARNINGS
+
+#include <zlib.h>
+#include <zstd.h>
+
+END_DISABLE_WARNINGS
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <doctest/doctest.h>
+#include <filesystem>
+#include <fmt/format.h>
+#include <fstream>
+#include <limits>
+#include <span>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Triangles of unit size on a row, each with three vertices and a normal of its own. The faces use relative indices,
+// every second one also refers back to the first vertex of the file and to the vertices of the previous triangle.
+std::string MakeRelativeIndexObj(size_t triangle_count)
+{
+    auto text = std::string{};
+
+    for (size_t i = 0; i < triangle_count; ++i) {
+        auto x = static_cast<float>(i);
+        text += fmt::format("o triangle_{}\n", i);
+        text += fmt::format("v {} 0 0\nv {} 1 0\nv {} 0 1\n", x, x + 0.5f, x + 1.0f);
+        text += fmt::format("vn 0 {} 1\n", 1.0f / (x + 1.0f));
+        text += "f -3//-1 -2//-1 -1//-1\n";
+        if (i % 2 == 1) {
+            text += "f 1//-1 -4//-1 -1//-1\n";
+        }
+    }
+
+    return text;
+}
+
+void CheckEqual(const ObjData& lhs, const ObjData& rhs)
+{
+    CHECK(lhs.attributes.vertices == rhs.attributes.vertices);
+    CHECK(lhs.attributes.normals == rhs.attributes.normals);
+    REQUIRE(lhs.shapes.size() == rhs.shapes.size());
+
+    for (size_t i = 0; i < lhs.shapes.size(); ++i) {
+        const auto& lhs_mesh = lhs.shapes[i].mesh;
+        const auto& rhs_mesh = rhs.shapes[i].mesh;
+
+        CHECK(lhs.shapes[i].name == rhs.shapes[i].name);
+        CHECK(lhs_mesh.num_face_vertices == rhs_mesh.num_face_vertices);
+        CHECK(lhs_mesh.material_ids == rhs_mesh.material_ids);
+        REQUIRE(lhs_mesh.indices.size() == rhs_mesh.indices.size());
+
+        for (size_t j = 0; j < lhs_mesh.indices.size(); ++j) {
+            CHECK(lhs_mesh.indices[j].vertex_index == rhs_mesh.indices[j].vertex_index);
+            CHECK(lhs_mesh.indices[j].normal_index == rhs_mesh.indices[j].normal_index);
+            CHECK(lhs_mesh.indices[j].texcoord_index == rhs_mesh.indices[j].texcoord_index);
+        }
+    }
+}
+
+auto ParseWithTinyObj(const std::string& text) -> ObjData
+{
+    auto obj_data = ObjData{};
+    auto stream   = std::istringstream{ text };
+    auto warning  = std::string{};
+    auto error    = std::string{};
+
+    REQUIRE(tinyobj::LoadObj(
+        &obj_data.attributes, &obj_data.shapes, &obj_data.materials, &warning, &error, &stream, nullptr, true));
+
+    return obj_data;
+}
+
+auto MakeVertex(float x, float y, float z, float nx = 0.0f, float ny = 0.0f, float nz = 1.0f) -> VertexPN
+{
+    return VertexPN{ { x, y, z }, { nx, ny, nz } };
+}
+
+auto RotationMatrix(Float3 axis, Radians angle) -> glm::mat3
+{
+    auto k = glm::mat3(0.0f, axis.z, -axis.y, -axis.z, 0.0f, axis.x, axis.y, -axis.x, 0.0f);
+    return glm::mat3(1.0f) + std::sin(angle.value) * k + (1.0f - std::cos(angle.value)) * (k * k);
+}
+
+// Linear part of the local transform of 'node', the product of its rotation, scale and scale rotation
+auto LinearTransform(const GltfNode& node) -> glm::mat3
+{
+    auto scale = glm::mat3(1.0f);
+
+    scale[0][0] = node.scale.x;
+    scale[1][1] = node.scale.y;
+    scale[2][2] = node.scale.z;
+
+    return RotationMatrix(node.axis, node.angle) * scale * RotationMatrix(node.scale_axis, node.scale_angle);
+}
+
+// Appends 'value' to 'data' in the byte order of the file
+template <typename T>
+void Append(std::string* data, T value, bool big_endian)
+{
+    auto bytes = std::string(sizeof(T), '\0');
+    std::memcpy(bytes.data(), &value, sizeof(T));
+    if (big_endian != (std::endian::native == std::endian::big)) {
+        bytes = std::string(bytes.rbegin(), bytes.rend());
+    }
+    *data += bytes;
+}
+
+// A quad and a triangle sharing an edge, with normals, and an element after the faces that is not read
+auto MakePly(bool big_endian) -> std::string
+{
+    auto text = std::string{ "ply\n" };
+
+    text += big_endian ? "format binary_big_endian 1.0\n" : "format binary_little_endian 1.0\n";
+    text += "comment two faces\n";
+    text += "element vertex 5\nproperty float x\nproperty float y\nproperty float z\n";
+    text += "property float nx\nproperty float ny\nproperty float nz\nproperty uchar red\n";
+    text += "element face 2\nproperty list uchar int vertex_indices\n";
+    text += "element edge 1\nproperty int vertex1\nproperty int vertex2\n";
+    text += "end_header\n";
+
+    auto positions = std::vector<float>{ 0, 0, 0, 1, 0, 0, 1, 1, 0, 0, 1, 0, 2, 0, 0 };
+    for (size_t i = 0; i != 5; ++i) {
+        Append(&text, positions[3 * i + 0], big_endian);
+        Append(&text, positions[3 * i + 1], big_endian);
+        Append(&text, positions[3 * i + 2], big_endian);
+        Append(&text, 0.0f, big_endian);
+        Append(&text, 0.0f, big_endian);
+        Append(&text, 1.0f, big_endian);
+        Append(&text, uint8_t{ 255 }, big_endian);
+    }
+
+    Append(&text, uint8_t{ 4 }, big_endian);
+    for (int32_t index : { 0, 1, 2, 3 }) {
+        Append(&text, index, big_endian);
+    }
+    Append(&text, uint8_t{ 3 }, big_endian);
+    for (int32_t index : { 1, 4, 2 }) {
+        Append(&text, index, big_endian);
+    }
+
+    Append(&text, int32_t{ 0 }, big_endian);
+    Append(&text, int32_t{ 1 }, big_endian);
+
+    return text;
+}
+
+auto ReadPly(const std::string& contents) -> Geometry
+{
+    auto thread_pool = ThreadPool(2);
+    auto directory   = std::filesystem::temp_directory_path() / "vega-unit-tests";
+    auto filepath    = directory / "mesh.ply";
+
+    std::filesystem::create_directories(directory);
+    std::ofstream(filepath, std::ios::binary) << contents;
+
+    auto remove = [&directory]() { std::filesystem::remove_all(directory); };
+
+    try {
+        auto geometry = ReadPlyGeometry(filepath, &thread_pool);
+        remove();
+        return geometry;
+    } catch (...) {
+        remove();
+        throw;
+    }
+}
+
+void CheckEqual(const GeometryView& lhs, const GeometryView& rhs)
+{
+    REQUIRE(lhs.vertices.size() == rhs.vertices.size());
+
+    for (size_t i = 0; i < lhs.vertices.size(); ++i) {
+        CHECK(lhs.vertices[i].position == rhs.vertices[i].position);
+        CHECK(lhs.vertices[i].normal == rhs.vertices[i].normal);
+    }
+
+    CHECK(std::equal(lhs.indices.begin(), lhs.indices.end(), rhs.indices.begin(), rhs.indices.end()));
+    REQUIRE(lhs.shapes.size() == rhs.shapes.size());
+
+    for (size_t i = 0; i < lhs.shapes.size(); ++i) {
+        CHECK(lhs.shapes[i].name == rhs.shapes[i].name);
+        REQUIRE(lhs.shapes[i].meshes.size() == rhs.shapes[i].meshes.size());
+
+        for (size_t j = 0; j < lhs.shapes[i].meshes.size(); ++j) {
+            CHECK(lhs.shapes[i].meshes[j].material_id == rhs.shapes[i].meshes[j].material_id);
+            CHECK(lhs.shapes[i].meshes[j].first_index == rhs.shapes[i].meshes[j].first_index);
+            CHECK(lhs.shapes[i].meshes[j].index_count == rhs.shapes[i].meshes[j].index_count);
+        }
+    }
+}
+
+// Gzip member of 'text' in stored deflate blocks, since only the zlib decoder is built
+auto Gzip(std::string_view text) -> std::string
+{
+    auto data = std::string{ '\x1f', '\x8b', '\x08', '\0', '\0', '\0', '\0', '\0', '\0', '\xff' };
+
+    for (size_t first = 0;;) {
+        auto size    = std::min(text.size() - first, size_t{ 65535 });
+        auto is_last = first + size == text.size();
+
+        data += is_last ? '\x01' : '\0';
+        Append(&data, static_cast<uint16_t>(size), false);
+        Append(&data, static_cast<uint16_t>(~size), false);
+        data += text.substr(first, size);
+
+        first += size;
+        if (is_last) {
+            break;
+        }
+    }
+
+    auto crc = crc32(0, reinterpret_cast<const Bytef*>(text.data()), static_cast<uInt>(text.size()));
+
+    Append(&data, static_cast<uint32_t>(crc), false);
+    Append(&data, static_cast<uint32_t>(text.size()), false);
+
+    return data;
+}
+
+} // namespace
+
+TEST_CASE("testing ParseObj resolution of relative indices")
+{
+    auto thread_pool = ThreadPool(1);
+    auto text        = std::string{ "v 0 0 0\nv 1 0 0\nv 0 1 0\nv 1 1 0\nf -4 -3 -1 -2\nf 1 -3 -1\n" };
+    auto obj_data    = ParseObj(text, {}, &thread_pool);
+
+    REQUIRE(obj_data.shapes.size() == 1);
+
+    auto vertex_indices = std::vector<int>{};
+    for (const auto& index : obj_data.shapes[0].mesh.indices) {
+        vertex_indices.push_back(index.vertex_index);
+        CHECK(index.normal_index == -1);
+        CHECK(index.texcoord_index == -1);
+    }
+
+    CHECK(vertex_indices == std::vector<int>{ 0, 1, 3, 0, 3, 2, 0, 1, 3 });
+    CheckEqual(obj_data, ParseWithTinyObj(text));
+}
+
+TEST_CASE("testing OBJ welding across texcoord seams")
+{
+    // Two triangles of a quad that share an edge but not their texcoords
+    auto thread_pool = ThreadPool(1);
+    auto text        = std::string{ "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nvt 0 0\nvt 1 0\nvt 1 1\nvt 0 0.5\nvt 0.5 1\n"
+                                    "vt 0 1\nf 1/1 2/2 3/3\nf 1/4 3/5 4/6\n" };
+    auto directory   = std::filesystem::temp_directory_path() / "vega-unit-tests";
+    auto filepath    = directory / "seam.obj";
+
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+    std::ofstream(filepath) << text;
+
+    auto streamed = StreamGeometry(filepath, &thread_pool);
+    auto built    = BuildGeometry(ParseObj(text, {}, &thread_pool), &thread_pool);
+
+    REQUIRE(streamed.has_value());
+    CHECK(streamed->vertices.size() == 4);
+    CHECK(built.vertices.size() == 4);
+    CHECK(streamed->indices == built.indices);
+
+    std::filesystem::remove_all(directory);
+}
+
+TEST_CASE("testing ParseObj across chunk boundaries")
+{
+    // Several megabytes, so the text is split into multiple chunks whose faces refer to attributes of earlier chunks
+    auto thread_pool = ThreadPool(2);
+    auto text        = MakeRelativeIndexObj(60'000);
+
+    REQUIRE(text.size() > (size_t{ 4 } << 20));
+
+    CheckEqual(ParseObj(text, {}, &thread_pool), ParseWithTinyObj(text));
+}
+
+TEST_CASE("testing WeldIndices")
+{
+    auto thread_pool = ThreadPool(2);
+    auto indices     = std::vector<tinyobj::index_t>{
+        { 0, 0, -1 }, { 1, 0, -1 }, { 0, 0, -1 }, { 0, 1, -1 }, { 1, 0, -1 }, { 0, 0, 0 },
+    };
+
+    auto result = WeldIndices(indices, &thread_pool);
+
+    CHECK(result.remap == std::vector<uint32_t>{ 0, 1, 0, 2, 1, 3 });
+    CHECK(result.unique == std::vector<uint32_t>{ 0, 1, 3, 5 });
+}
+
+TEST_CASE("testing WeldVertices")
+{
+    auto thread_pool = ThreadPool(2);
+    auto vertices    = std::vector<VertexPN>{
+        MakeVertex(0.0f, 0.0f, 0.0f),
+        MakeVertex(1.0f, 0.0f, 0.0f),
+        MakeVertex(0.0f, 0.0f, 0.0f),
+        MakeVertex(0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f),
+        MakeVertex(1.0f + 1e-5f, 0.0f, 0.0f),
+        MakeVertex(1.0f, 0.0f, 0.0f, 0.0f, 0.01f, 1.0f),
+    };
+
+    SUBCASE("exact")
+    {
+        auto result = WeldVertices(vertices, {}, &thread_pool);
+
+        CHECK(result.remap == std::vector<uint32_t>{ 0, 1, 0, 2, 3, 4 });
+        CHECK(result.unique == std::vector<uint32_t>{ 0, 1, 3, 4, 5 });
+    }
+
+    SUBCASE("within tolerance")
+    {
+        auto result = WeldVertices(vertices, { .position_epsilon = 1e-4f, .normal_epsilon = 0.1f }, &thread_pool);
+
+        CHECK(result.remap == std::vector<uint32_t>{ 0, 1, 0, 2, 1, 1 });
+        CHECK(result.unique == std::vector<uint32_t>{ 0, 1, 3 });
+    }
+
+    SUBCASE("positions only")
+    {
+        auto result = WeldPositions(vertices, &thread_pool);
+
+        CHECK(result.remap == std::vector<uint32_t>{ 0, 1, 0, 0, 2, 1 });
+        CHECK(result.unique == std::vector<uint32_t>{ 0, 1, 4 });
+    }
+}
+
+TEST_CASE("testing WeldVertices within tolerance on a thread pool")
+{
+    // Enough vertices for the sharded weld, in clusters whose gaps are smaller than the tolerance, so merges chain
+    auto thread_pool = ThreadPool(4);
+    auto vertices    = std::vector<VertexPN>{};
+    auto state       = uint32_t{ 1 };
+
+    auto random = [&state]() {
+        state = state * 1664525u + 1013904223u;
+        return static_cast<float>(state >> 8) / static_cast<float>(1 << 24);
+    };
+
+    for (size_t i = 0; i < 100'000; ++i) {
+        auto x     = std::floor(random() * 64.0f) * 0.005f + random() * 0.004f;
+        auto y     = std::floor(random() * 64.0f) * 0.005f + random() * 0.004f;
+        auto angle = random() * 0.1f;
+        vertices.push_back(MakeVertex(x, y, 0.0f, 0.0f, std::sin(angle), std::cos(angle)));
+    }
+    vertices.push_back(MakeVertex(std::nanf(""), 0.0f, 0.0f));
+
+    auto options    = WeldOptions{ .position_epsilon = 0.003f, .normal_epsilon = 0.05f };
+    auto sequential = WeldVertices(vertices, options, nullptr);
+    auto sharded    = WeldVertices(vertices, options, &thread_pool);
+
+    CHECK(sequential.unique.size() < vertices.size() / 2);
+    CHECK(sharded.remap == sequential.remap);
+    CHECK(sharded.unique == sequential.unique);
+
+    SUBCASE("denormal tolerance")
+    {
+        auto denormal = WeldOptions{ .position_epsilon = std::numeric_limits<float>::denorm_min() };
+        auto exact    = WeldVertices(vertices, {}, &thread_pool);
+        auto result   = WeldVertices(vertices, denormal, &thread_pool);
+
+        CHECK(result.unique == exact.unique);
+        CHECK(WeldVertices(vertices, denormal, nullptr).unique == exact.unique);
+    }
+}
+
+TEST_CASE("testing EncodeMesh and DecodeMesh round trip")
+{
+    auto thread_pool = ThreadPool(2);
+    auto vertices    = std::vector<VertexPN>{};
+    auto indices     = std::vector<uint32_t>{};
+
+    for (uint32_t i = 0; i < 100'000; ++i) {
+        auto angle = static_cast<float>(i) * 0.001f;
+        vertices.push_back(MakeVertex(std::cos(angle), std::sin(angle), angle, std::cos(angle), std::sin(angle), 0.0f));
+        if (i >= 2) {
+            indices.insert(indices.end(), { i - 2, i - 1, i });
+        }
+    }
+
+    auto options = MeshCodecOptions{};
+    auto encoded = EncodeMesh(vertices, indices, options, &thread_pool);
+    auto decoded = DecodeMesh({ encoded.data(), encoded.size() }, &thread_pool);
+
+    REQUIRE(decoded.has_value());
+    CHECK(decoded->indices == indices);
+    REQUIRE(decoded->vertices.size() == vertices.size());
+
+    // One quantization step of the largest extent of the bounding box, and of the octahedral normals
+    auto position_step = 100.0f / static_cast<float>(1 << options.position_bits);
+    auto normal_step   = 1e-3f;
+
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        CHECK(glm::length(decoded->vertices[i].position - vertices[i].position) <= position_step);
+        CHECK(glm::length(decoded->vertices[i].normal - vertices[i].normal) <= normal_step);
+    }
+
+    encoded.resize(encoded.size() / 2);
+    CHECK_FALSE(DecodeMesh({ encoded.data(), encoded.size() }, &thread_pool).has_value());
+}
+
+TEST_CASE("testing GeometryCache round trip")
+{
+    auto thread_pool = ThreadPool(2);
+    auto directory   = std::filesystem::temp_directory_path() / "vega-unit-tests";
+    auto filepath    = directory / "triangles.obj";
+
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+    // A grid large enough to get LODs, and a part with a copy turned by a quarter about z that becomes its instance
+    auto text = MakeRelativeIndexObj(1'000);
+
+    text += "o grid\n";
+    for (int y = 0; y <= 24; ++y) {
+        for (int x = 0; x <= 24; ++x) {
+            auto z = 0.5f * std::sin(0.3f * static_cast<float>(x)) * std::cos(0.3f * static_cast<float>(y));
+            text += fmt::format("v {} {} {}\n", x, y + 10, z);
+        }
+    }
+    for (int y = 0; y != 24; ++y) {
+        for (int x = 0; x != 24; ++x) {
+            auto corner = y * 25 + x - 625;
+            text += fmt::format("f {} {} {}\n", corner, corner + 1, corner + 26);
+            text += fmt::format("f {} {} {}\n", corner, corner + 26, corner + 25);
+        }
+    }
+
+    auto part_faces = "f -4 -2 -3\nf -4 -3 -1\nf -3 -2 -1\nf -2 -4 -1\n";
+
+    text += "o part\nv 10 5 0\nv 12 5 0\nv 10.5 6.5 0\nv 10.3 5.4 1.2\n";
+    text += part_faces;
+    text += "o part_copy\nv 20 5 0\nv 20 7 0\nv 18.5 5.5 0\nv 19.6 5.3 1.2\n";
+    text += part_faces;
+
+    std::ofstream(filepath) << text;
+
+    auto cache   = GeometryCache(directory / "cache");
+    auto options = LoadOptions{};
+    auto key     = GeometryCache::ComputeKey(filepath, options.GetCacheVariant());
+
+    CHECK_FALSE(cache.Find(key, &thread_pool).has_value());
+
+    auto loaded = ReadGeometry(filepath, options, &thread_pool, &cache);
+    auto cached = cache.Find(key, &thread_pool);
+
+    REQUIRE(cached.has_value());
+    CHECK_FALSE(cache.Find(GeometryCache::ComputeKey(filepath, key.variant + 1), &thread_pool).has_value());
+
+    // The cached vertices are the loaded ones up to the quantization of EncodeMesh, the triangles span 1000 units
+    auto view          = loaded.View();
+    auto position_step = 1'000.0f / static_cast<float>(1 << MeshCodecOptions{}.position_bits);
+
+    REQUIRE(view.vertices.size() == cached->vertices.size());
+
+    for (size_t i = 0; i < view.vertices.size(); ++i) {
+        const auto& lhs = view.vertices[i];
+        const auto& rhs = cached->vertices[i];
+
+        CHECK(glm::length(lhs.position - rhs.position) <= position_step);
+        CHECK(glm::dot(glm::normalize(lhs.normal), glm::normalize(rhs.normal)) >= 0.9999f);
+    }
+
+    CHECK(std::equal(view.indices.begin(), view.indices.end(), cached->indices.begin(), cached->indices.end()));
+
+    // The records are stored as they are
+    auto vec3 = [](const Float3& value) { return glm::vec3(value.x, value.y, value.z); };
+
+    REQUIRE(view.shapes.size() == cached->shapes.size());
+
+    for (size_t i = 0; i < view.shapes.size(); ++i) {
+        CHECK(view.shapes[i].name == cached->shapes[i].name);
+        REQUIRE(view.shapes[i].meshes.size() == cached->shapes[i].meshes.size());
+
+        for (size_t j = 0; j < view.shapes[i].meshes.size(); ++j) {
+            const auto& lhs = view.shapes[i].meshes[j];
+            const auto& rhs = cached->shapes[i].meshes[j];
+
+            CHECK(vec3(lhs.aabb.min) == vec3(rhs.aabb.min));
+            CHECK(vec3(lhs.aabb.max) == vec3(rhs.aabb.max));
+            CHECK(lhs.material_id == rhs.material_id);
+            CHECK(lhs.first_index == rhs.first_index);
+            CHECK(lhs.index_count == rhs.index_count);
+            CHECK(lhs.first_meshlet == rhs.first_meshlet);
+            CHECK(lhs.meshlet_count == rhs.meshlet_count);
+            CHECK(lhs.first_lod == rhs.first_lod);
+            CHECK(lhs.lod_count == rhs.lod_count);
+            CHECK(lhs.prototype == rhs.prototype);
+            CHECK(lhs.transform.axis == rhs.transform.axis);
+            CHECK(lhs.transform.angle == rhs.transform.angle);
+            CHECK(lhs.transform.translation == rhs.transform.translation);
+            CHECK(lhs.topology == rhs.topology);
+        }
+    }
+
+    REQUIRE(view.meshlets.size() == cached->meshlets.size());
+
+    for (size_t i = 0; i < view.meshlets.size(); ++i) {
+        const auto& lhs = view.meshlets[i];
+        const auto& rhs = cached->meshlets[i];
+
+        CHECK(lhs.first_index == rhs.first_index);
+        CHECK(lhs.index_count == rhs.index_count);
+        CHECK(lhs.bounds.center == rhs.bounds.center);
+        CHECK(lhs.bounds.radius == rhs.bounds.radius);
+        CHECK(lhs.bounds.cone_axis == rhs.bounds.cone_axis);
+        CHECK(lhs.bounds.cone_cutoff == rhs.bounds.cone_cutoff);
+    }
+
+    REQUIRE(view.lods.size() == cached->lods.size());
+
+    for (size_t i = 0; i < view.lods.size(); ++i) {
+        CHECK(view.lods[i].first_index == cached->lods[i].first_index);
+        CHECK(view.lods[i].index_count == cached->lods[i].index_count);
+        CHECK(view.lods[i].error == cached->lods[i].error);
+    }
+
+    // Every kind of record was stored
+    auto has_instance = std::ranges::any_of(cached->shapes, [](const ShapeRecord& shape) {
+        return std::ranges::any_of(shape.meshes, [](const MeshRecord& mesh) { return mesh.prototype != kNoPrototype; });
+    });
+
+    CHECK(has_instance);
+    CHECK_FALSE(cached->meshlets.empty());
+    CHECK_FALSE(cached->lods.empty());
+
+    std::filesystem::remove_all(directory);
+}
+
+TEST_CASE("testing glTF node transforms")
+{
+    // A non-uniform scale, a mirroring matrix and a sheared matrix, each followed by the translation
+    auto matrices = std::array{
+        std::array{ 2.0f, 0.0f, 0.0f, 0.0f, 0.0f, 3.0f, 0.0f, -0.5f, 0.0f, 0.0f, 0.0f, 0.0f },
+        std::array{ -1.0f, 0.0f, 0.0f, 0.0f, 2.0f, 0.0f, 0.0f, 0.0f, 1.0f, 4.0f, 5.0f, 6.0f },
+        std::array{ 1.0f, 0.0f, 0.0f, 0.7f, 1.0f, 0.0f, 0.2f, -0.3f, 2.0f, 0.0f, 0.0f, 0.0f },
+    };
+
+    auto nodes = std::string{ R"([ { "scale": [ 1, 2, -3 ], "rotation": [ 0, 0.6, 0, 0.8 ] })" };
+    for (const auto& m : matrices) {
+        nodes += fmt::format(
+            R"(, {{ "matrix": [ {}, {}, {}, 0, {}, {}, {}, 0, {}, {}, {}, 0, {}, {}, {}, 1 ] }})",
+            m[0], m[1], m[2], m[3], m[4], m[5], m[6], m[7], m[8], m[9], m[10], m[11]);
+    }
+
+    auto directory = std::filesystem::temp_directory_path() / "vega-unit-tests";
+    auto filepath  = directory / "nodes.gltf";
+
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+    std::ofstream(filepath) << R"({ "asset": { "version": "2.0" }, "nodes": )" << nodes << " ] }";
+
+    {
+        auto model = ReadGltf(filepath, VertexLayout::Float, nullptr);
+
+        REQUIRE(model.GetNodes().size() == 4);
+
+        const auto& trs = model.GetNodes()[0];
+
+        CHECK(trs.scale.x == 1.0f);
+        CHECK(trs.scale.y == 2.0f);
+        CHECK(trs.scale.z == -3.0f);
+        CHECK(trs.scale_angle.value == 0.0f);
+
+        for (size_t i = 0; i != matrices.size(); ++i) {
+            const auto& m    = matrices[i];
+            const auto& node = model.GetNodes()[i + 1];
+
+            auto expected = glm::mat3(m[0], m[1], m[2], m[3], m[4], m[5], m[6], m[7], m[8]);
+            auto actual   = LinearTransform(node);
+
+            for (int column = 0; column != 3; ++column) {
+                for (int row = 0; row != 3; ++row) {
+                    CHECK(std::abs(actual[column][row] - expected[column][row]) <= 1e-4f);
+                }
+            }
+
+            CHECK(node.translation.x == m[9]);
+            CHECK(node.translation.y == m[10]);
+            CHECK(node.translation.z == m[11]);
+        }
+
+        // Only the sheared matrix needs a scale rotation
+        CHECK(model.GetNodes()[1].scale_angle.value == 0.0f);
+        CHECK(model.GetNodes()[2].scale_angle.value == 0.0f);
+        CHECK(model.GetNodes()[3].scale_angle.value != 0.0f);
+    }
+
+    std::filesystem::remove_all(directory);
+}
+
+TEST_CASE("testing ReadPlyGeometry")
+{
+    for (auto big_endian : { false, true }) {
+        auto geometry = ReadPly(MakePly(big_endian));
+
+        REQUIRE(geometry.vertices.size() == 5);
+        CHECK(geometry.vertices[2].position == glm::vec3(1.0f, 1.0f, 0.0f));
+        CHECK(geometry.vertices[4].position == glm::vec3(2.0f, 0.0f, 0.0f));
+        CHECK(geometry.vertices[4].normal == glm::vec3(0.0f, 0.0f, 1.0f));
+
+        // The quad is split into a fan around its first vertex
+        CHECK(geometry.indices == std::vector<uint32_t>{ 0, 1, 2, 0, 2, 3, 1, 4, 2 });
+
+        REQUIRE(geometry.shapes.size() == 1);
+        REQUIRE(geometry.shapes[0].meshes.size() == 1);
+        CHECK(geometry.shapes[0].name == "mesh");
+        CHECK(geometry.shapes[0].meshes[0].index_count == 9);
+        CHECK(geometry.shapes[0].meshes[0].aabb.max.x == 2.0f);
+    }
+}
+
+TEST_CASE("testing ReadPlyGeometry of point clouds")
+{
+    auto header = std::string{ "ply\nformat binary_little_endian 1.0\nelement vertex 2\nproperty float x\n"
+                               "property float y\nproperty float z\n" };
+    auto points = std::string{};
+
+    for (auto value : { 1.0f, 2.0f, 3.0f, -1.0f, 0.5f, 4.0f }) {
+        Append(&points, value, false);
+    }
+
+    auto empty_faces = "element face 0\nproperty list uchar int vertex_indices\n";
+
+    for (const auto& faces : { std::string{}, std::string{ empty_faces } }) {
+        auto geometry = ReadPly(header + faces + "end_header\n" + points);
+
+        REQUIRE(geometry.vertices.size() == 2);
+        CHECK(geometry.vertices[0].position == glm::vec3(1.0f, 2.0f, 3.0f));
+        CHECK(geometry.vertices[1].position == glm::vec3(-1.0f, 0.5f, 4.0f));
+        CHECK(geometry.vertices[1].normal == glm::vec3(0.0f));
+
+        // One point per vertex
+        CHECK(geometry.indices == std::vector<uint32_t>{ 0, 1 });
+
+        REQUIRE(geometry.shapes.size() == 1);
+        REQUIRE(geometry.shapes[0].meshes.size() == 1);
+        CHECK(geometry.shapes[0].meshes[0].topology == Topology::Points);
+        CHECK(geometry.shapes[0].meshes[0].index_count == 2);
+        CHECK(geometry.shapes[0].meshes[0].aabb.min.x == -1.0f);
+        CHECK(geometry.shapes[0].meshes[0].aabb.max.z == 4.0f);
+        CHECK(IsPointCloud(geometry.shapes));
+    }
+}
+
+TEST_CASE("testing ReadPlyGeometry of malformed files")
+{
+    auto valid = MakePly(false);
+
+    SUBCASE("ascii")
+    {
+        CHECK_THROWS(ReadPly("ply\nformat ascii 1.0\nelement vertex 0\nproperty float x\nend_header\n"));
+    }
+
+    SUBCASE("truncated")
+    {
+        CHECK_THROWS(ReadPly(valid.substr(0, valid.find("end_header"))));
+        CHECK_THROWS(ReadPly(valid.substr(0, valid.size() - 20)));
+    }
+
+    SUBCASE("index out of range")
+    {
+        auto corrupted = valid;
+        auto faces     = corrupted.find("end_header\n") + 11 + 5 * 25;
+
+        corrupted[faces + 1] = 5;
+        CHECK_THROWS(ReadPly(corrupted));
+    }
+}
+
+TEST_CASE("testing QuantizePosition and DequantizePosition round trip")
+{
+    // Flat along z, which maps to zero
+    auto aabb = AABB{ { -2.0f, 0.5f, 10.0f }, { 3.0f, 0.75f, 10.0f } };
+    auto step = glm::vec3(aabb.ExtentX(), aabb.ExtentY(), aabb.ExtentZ()) / 65535.0f;
+
+    CHECK(QuantizePosition({ -2.0f, 0.5f, 10.0f }, aabb) == glm::u16vec4(0, 0, 0, 0));
+    CHECK(QuantizePosition({ 3.0f, 0.75f, 10.0f }, aabb) == glm::u16vec4(65535, 65535, 0, 0));
+
+    for (int i = 0; i <= 1'000; ++i) {
+        auto t        = static_cast<float>(i) / 1'000.0f;
+        auto position = glm::vec3(-2.0f + 5.0f * t, 0.75f - 0.25f * t * t, 10.0f);
+        auto result   = DequantizePosition(QuantizePosition(position, aabb), aabb);
+
+        CHECK(std::abs(result.x - position.x) <= step.x);
+        CHECK(std::abs(result.y - position.y) <= step.y);
+        CHECK(result.z == position.z);
+    }
+}
+
+TEST_CASE("testing EncodeOctahedral and DecodeOctahedral round trip")
+{
+    auto normals = std::vector<glm::vec3>{};
+
+    for (float sign : { 1.0f, -1.0f }) {
+        normals.emplace_back(sign, 0.0f, 0.0f);
+        normals.emplace_back(0.0f, sign, 0.0f);
+        normals.emplace_back(0.0f, 0.0f, sign);
+    }
+
+    for (float x : { 1.0f, -1.0f }) {
+        for (float y : { 1.0f, -1.0f }) {
+            for (float z : { 1.0f, -1.0f }) {
+                normals.push_back(glm::normalize(glm::vec3(x, y, z)));
+            }
+        }
+    }
+
+    // The lower half, which is folded over the upper one
+    normals.push_back(glm::normalize(glm::vec3(0.3f, -0.2f, -0.9f)));
+    normals.push_back(glm::normalize(glm::vec3(-0.7f, 0.1f, -0.2f)));
+    normals.push_back(glm::normalize(glm::vec3(-0.05f, -0.6f, -0.01f)));
+
+    for (const auto& normal : normals) {
+        CHECK(glm::length(DecodeOctahedral(EncodeOctahedral(normal)) - normal) <= 1e-3f);
+    }
+}
+
+TEST_CASE("testing PackIndices index formats")
+{
+    // The first mesh spans 65536 vertices and the second one 65537, both above vertex zero. The second mesh has a LOD.
+    auto indices = std::vector<uint32_t>{ 100, 100 + 65535, 101, 10, 10 + 65536, 15, 10 + 65536, 15, 10 };
+    auto lods    = std::vector<LodRecord>{ { 6, 3, 0.5f } };
+    auto shapes  = std::vector<ShapeRecord>(1);
+
+    shapes[0].meshes.push_back({ .first_index = 0, .index_count = 3 });
+    shapes[0].meshes.push_back({ .first_index = 3, .index_count = 3, .first_lod = 0, .lod_count = 1 });
+
+    auto packed = PackIndices(indices, shapes, lods);
+
+    // Reads 32-bit indices from 'first' on, in 32-bit units
+    auto read = [&packed](size_t first, size_t count) {
+        auto values = std::vector<uint32_t>(count);
+        std::memcpy(values.data(), packed.data.data() + 2 * first, count * sizeof(uint32_t));
+        return values;
+    };
+
+    REQUIRE(packed.meshes.size() == 2);
+    REQUIRE(packed.data.size() == 16);
+
+    const auto& narrow = packed.meshes[0];
+    const auto& wide   = packed.meshes[1];
+
+    CHECK(narrow.index_format == IndexFormat::Uint16);
+    CHECK(narrow.first_index == 0);
+    CHECK(narrow.vertex_offset == 100);
+    CHECK(std::vector(packed.data.begin(), packed.data.begin() + 3) == std::vector<uint16_t>{ 0, 65535, 1 });
+
+    // The three 16-bit indices are padded to four bytes
+    CHECK(wide.index_format == IndexFormat::Uint32);
+    CHECK(wide.first_index == 2);
+    CHECK(wide.vertex_offset == 10);
+    CHECK(read(wide.first_index, 3) == std::vector<uint32_t>{ 0, 65536, 5 });
+
+    REQUIRE(wide.lods.size() == 1);
+    CHECK(wide.lods[0].first_index == 5);
+    CHECK(wide.lods[0].index_count == 3);
+    CHECK(read(wide.lods[0].first_index, 3) == std::vector<uint32_t>{ 65536, 5, 0 });
+}
+
+TEST_CASE("testing DeduplicateMeshes of rotated and mirrored copies")
+{
+    // An irregular tetrahedron, which differs from its mirror image, then a copy of it rotated and translated and a
+    // mirrored copy. The vertex normals point away from the centroid.
+    auto thread_pool = ThreadPool(2);
+    auto corners     = std::array{
+        glm::vec3(0.0f, 0.0f, 0.0f),
+        glm::vec3(2.0f, 0.0f, 0.0f),
+        glm::vec3(0.5f, 1.5f, 0.0f),
+        glm::vec3(0.3f, 0.4f, 1.2f),
+    };
+    auto triangles = std::array<uint32_t, 12>{ 0, 2, 1, 0, 1, 3, 1, 2, 3, 2, 0, 3 };
+    auto centroid  = 0.25f * (corners[0] + corners[1] + corners[2] + corners[3]);
+
+    auto axis        = glm::normalize(glm::vec3(1.0f, 2.0f, 3.0f));
+    auto rotation    = RotationMatrix({ axis.x, axis.y, axis.z }, Radians(0.7f));
+    auto translation = glm::vec3(5.0f, -2.0f, 3.0f);
+    auto mirror      = glm::mat3(-1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f);
+
+    auto geometry = Geometry{};
+    auto copies   = std::array{
+        std::pair{ glm::mat3(1.0f), glm::vec3(0.0f) },
+        std::pair{ rotation, translation },
+        std::pair{ mirror, glm::vec3(-4.0f, 1.0f, 0.0f) },
+    };
+
+    auto& shape = geometry.shapes.emplace_back();
+
+    for (const auto& [linear, offset] : copies) {
+        auto first_vertex = static_cast<uint32_t>(geometry.vertices.size());
+        auto first_index  = geometry.indices.size();
+
+        for (const auto& corner : corners) {
+            geometry.vertices.emplace_back(linear * corner + offset, linear * glm::normalize(corner - centroid));
+        }
+        for (auto corner : triangles) {
+            geometry.indices.push_back(first_vertex + corner);
+        }
+
+        auto mesh = MeshRecord{ .first_index = first_index, .index_count = triangles.size() };
+        mesh.aabb = ComputeBoundingBox(std::span(geometry.indices).subspan(first_index), geometry.vertices);
+        shape.meshes.push_back(mesh);
+    }
+
+    auto report = DeduplicateMeshes(&geometry, DeduplicatorOptions{}, &thread_pool);
+
+    CHECK(report.prototype_count == 1);
+    CHECK(report.duplicate_count == 1);
+    CHECK(report.vertex_count == 4);
+    CHECK(geometry.vertices.size() == 8);
+    CHECK(geometry.indices.size() == 24);
+
+    const auto& meshes = shape.meshes;
+
+    CHECK(meshes[0].prototype == kNoPrototype);
+    CHECK(meshes[1].prototype == 0);
+    CHECK(meshes[1].index_count == 0);
+    CHECK(meshes[2].prototype == kNoPrototype);
+    CHECK(meshes[2].index_count == triangles.size());
+
+    const auto& transform = meshes[1].transform;
+
+    auto recovered = RotationMatrix({ transform.axis.x, transform.axis.y, transform.axis.z }, Radians(transform.angle));
+
+    for (int column = 0; column != 3; ++column) {
+        for (int row = 0; row != 3; ++row) {
+            CHECK(std::abs(recovered[column][row] - rotation[column][row]) <= 1e-4f);
+        }
+    }
+
+    CHECK(glm::length(transform.translation - translation) <= 1e-4f);
+}
+
+TEST_CASE("testing ReadGeometry of binary STL files")
+{
+    // Two triangles of a quad, each with its own copy of the corners they share
+    auto thread_pool = ThreadPool(2);
+    auto positions   = std::array{
+        glm::vec3(0.0f, 0.0f, 0.0f),
+        glm::vec3(1.0f, 0.0f, 0.0f),
+        glm::vec3(1.0f, 1.0f, 0.0f),
+        glm::vec3(0.0f, 1.0f, 0.0f),
+    };
+    auto stl = std::string(80, ' ');
+
+    Append(&stl, uint32_t{ 2 }, false);
+    for (const auto& triangle : { std::array{ 0, 1, 2 }, std::array{ 0, 2, 3 } }) {
+        for (auto value : { 0.0f, 0.0f, 1.0f }) {
+            Append(&stl, value, false);
+        }
+        for (auto corner : triangle) {
+            Append(&stl, positions[corner].x, false);
+            Append(&stl, positions[corner].y, false);
+            Append(&stl, positions[corner].z, false);
+        }
+        Append(&stl, uint16_t{ 0 }, false);
+    }
+
+    auto directory = std::filesystem::temp_directory_path() / "vega-unit-tests";
+    auto filepath  = directory / "quad.stl";
+
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+    std::ofstream(filepath, std::ios::binary) << stl;
+
+    for (auto normals : { StlNormals::Smooth, StlNormals::Stored }) {
+        auto options = LoadOptions{
+            .deduplicate    = false,
+            .optimize       = false,
+            .build_meshlets = false,
+            .build_lods     = false,
+            .stl            = { .normals = normals },
+        };
+
+        auto loaded = ReadGeometry(filepath, options, &thread_pool, nullptr);
+        auto view   = loaded.View();
+
+        REQUIRE(view.vertices.size() == 4);
+        CHECK(std::vector(view.indices.begin(), view.indices.end()) == std::vector<uint32_t>{ 0, 1, 2, 0, 2, 3 });
+
+        for (size_t i = 0; i != positions.size(); ++i) {
+            CHECK(view.vertices[i].position == positions[i]);
+            CHECK(glm::dot(view.vertices[i].normal, glm::vec3(0.0f, 0.0f, 1.0f)) >= 0.9999f);
+        }
+    }
+
+    std::filesystem::remove_all(directory);
+}
+
+TEST_CASE("testing ReadGeometry of compressed OBJ files")
+{
+    auto thread_pool       = ThreadPool(2);
+    auto directory         = std::filesystem::temp_directory_path() / "vega-unit-tests";
+    auto text              = std::string{};
+    auto forward_reference = false;
+
+    // Small windows, so the files span many of them
+    constexpr size_t kWindowSize = 4096;
+
+    SUBCASE("streamed")
+    {
+        text = MakeRelativeIndexObj(1'000);
+    }
+
+    SUBCASE("forward reference")
+    {
+        // The face refers to vertices that follow more than a window of comments, so the file cannot be streamed
+        auto comment = "# " + std::string(125, 'x') + "\n";
+
+        text = "o forward\nf 1 2 3\n";
+        while (text.size() <= 2 * kWindowSize) {
+            text += comment;
+        }
+        text += "v 0 0 0\nv 1 0 0\nv 0 1 0\n";
+
+        forward_reference = true;
+    }
+
+    auto zst  = std::string(ZSTD_compressBound(text.size()), '\0');
+    auto size = ZSTD_compress(zst.data(), zst.size(), text.data(), text.size(), 1);
+
+    REQUIRE_FALSE(ZSTD_isError(size));
+    zst.resize(size);
+
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+    std::ofstream(directory / "mesh.obj", std::ios::binary) << text;
+    std::ofstream(directory / "mesh.obj.gz", std::ios::binary) << Gzip(text);
+    std::ofstream(directory / "mesh.obj.zst", std::ios::binary) << zst;
+
+    auto options = LoadOptions{ .deduplicate     = false,
+                                .optimize        = false,
+                                .build_meshlets  = false,
+                                .build_lods      = false,
+                                .obj_window_size = kWindowSize };
+    auto plain   = ReadGeometry(directory / "mesh.obj", options, &thread_pool, nullptr);
+
+    REQUIRE_FALSE(plain.View().indices.empty());
+
+    if (forward_reference) {
+        CHECK(plain.View().vertices.size() == 3);
+        CHECK(std::ranges::equal(plain.View().indices, std::vector<uint32_t>{ 0, 1, 2 }));
+    }
+
+    for (auto filename : { "mesh.obj.gz", "mesh.obj.zst" }) {
+        auto compressed = ReadGeometry(directory / filename, options, &thread_pool, nullptr);
+        CheckEqual(compressed.View(), plain.View());
+    }
+
+    std::filesystem::remove_all(directory);
+}
+
+TEST_CASE("testing the mesh stages on a grid")
+{
+    // A gently curved grid of 64 by 64 quads, split into two meshes of one shape
+    constexpr uint32_t kSize = 64;
+
+    auto thread_pool = ThreadPool(2);
+    auto geometry    = Geometry{};
+
+    for (uint32_t y = 0; y <= kSize; ++y) {
+        for (uint32_t x = 0; x <= kSize; ++x) {
+            auto u = static_cast<float>(x) / static_cast<float>(kSize);
+            auto v = static_cast<float>(y) / static_cast<float>(kSize);
+            geometry.vertices.push_back(MakeVertex(u, v, 0.02f * std::sin(6.0f * u) * std::cos(6.0f * v)));
+        }
+    }
+
+    for (uint32_t y = 0; y != kSize; ++y) {
+        for (uint32_t x = 0; x != kSize; ++x) {
+            auto corner = y * (kSize + 1) + x;
+            geometry.indices.insert(
+                geometry.indices.end(),
+                { corner, corner + 1, corner + kSize + 2, corner, corner + kSize + 2, corner + kSize + 1 });
+        }
+    }
+
+    auto  half  = geometry.indices.size() / 2;
+    auto& shape = geometry.shapes.emplace_back();
+
+    shape.name = "grid";
+    for (size_t m = 0; m != 2; ++m) {
+        auto mesh = MeshRecord{ .material_id = static_cast<int>(m), .first_index = m * half, .index_count = half };
+        mesh.aabb = ComputeBoundingBox(std::span(geometry.indices).subspan(m * half, half), geometry.vertices);
+        shape.meshes.push_back(mesh);
+    }
+    geometry.material_count = 2;
+
+    const auto& meshes = shape.meshes;
+
+    SUBCASE("OptimizeGeometry keeps the triangles of every mesh")
+    {
+        // Triangles of 'mesh' by their corner positions, each rotated to start at its lowest corner, which keeps the
+        // winding
+        auto triangles = [&geometry](const MeshRecord& mesh) {
+            auto result = std::vector<std::array<std::array<float, 3>, 3>>{};
+
+            for (auto i = mesh.first_index; i != mesh.first_index + mesh.index_count; i += 3) {
+                auto corners = std::array<std::array<float, 3>, 3>{};
+                for (size_t k = 0; k != 3; ++k) {
+                    const auto& position = geometry.vertices[geometry.indices[i + k]].position;
+                    corners[k]           = { position.x, position.y, position.z };
+                }
+                std::rotate(corners.begin(), std::min_element(corners.begin(), corners.end()), corners.end());
+                result.push_back(corners);
+            }
+
+            std::ranges::sort(result);
+            return result;
+        };
+
+        auto before = std::vector{ triangles(meshes[0]), triangles(meshes[1]) };
+
+        OptimizeGeometry(&geometry, MeshOptimizerOptions{}, &thread_pool);
+
+        CHECK(geometry.vertices.size() == (kSize + 1) * (kSize + 1));
+        CHECK(geometry.indices.size() == 2 * half);
+        CHECK(triangles(meshes[0]) == before[0]);
+        CHECK(triangles(meshes[1]) == before[1]);
+    }
+
+    SUBCASE("BuildMeshlets covers every mesh")
+    {
+        auto options = MeshletOptions{};
+
+        BuildMeshlets(&geometry, options, &thread_pool);
+
+        for (const auto& mesh : meshes) {
+            REQUIRE(mesh.meshlet_count > 1);
+
+            // Contiguous ranges from the first index of the mesh to its last one
+            auto next = mesh.first_index;
+            for (const auto& meshlet : std::span(geometry.meshlets).subspan(mesh.first_meshlet, mesh.meshlet_count)) {
+                CHECK(meshlet.first_index == next);
+                CHECK(meshlet.index_count > 0);
+                CHECK(meshlet.index_count <= 3 * options.max_triangles);
+                CHECK(meshlet.index_count % 3 == 0);
+                next = meshlet.first_index + meshlet.index_count;
+            }
+
+            CHECK(next == mesh.first_index + mesh.index_count);
+        }
+    }
+
+    SUBCASE("BuildLods coarsens every level")
+    {
+        BuildLods(&geometry, SimplifierOptions{}, &thread_pool);
+
+        for (const auto& mesh : meshes) {
+            REQUIRE(mesh.lod_count > 0);
+
+            auto index_count = mesh.index_count;
+            auto error       = 0.0f;
+
+            for (const auto& lod : std::span(geometry.lods).subspan(mesh.first_lod, mesh.lod_count)) {
+                CHECK(lod.index_count < index_count);
+                CHECK(lod.index_count % 3 == 0);
+                CHECK(lod.error >= error);
+                CHECK(lod.first_index + lod.index_count <= geometry.indices.size());
+                index_count = lod.index_count;
+                error       = lod.error;
+            }
+        }
+    }
+}
+
+TEST_CASE("testing IsBackFacing")
+{
+    // Two triangles in the plane z = 0 facing +z
+    auto vertices = std::vector<VertexPN>{
+        MakeVertex(0.0f, 0.0f, 0.0f),
+        MakeVertex(1.0f, 0.0f, 0.0f),
+        MakeVertex(1.0f, 1.0f, 0.0f),
+        MakeVertex(0.0f, 1.0f, 0.0f),
+    };
+    auto indices = std::vector<uint32_t>{ 0, 1, 2, 0, 2, 3 };
+    auto bounds  = ComputeClusterBounds(indices, vertices);
+
+    REQUIRE(bounds.cone_cutoff < 1.0f);
+    CHECK(IsBackFacing(bounds, glm::vec3(0.5f, 0.5f, -10.0f)));
+    CHECK_FALSE(IsBackFacing(bounds, glm::vec3(0.5f, 0.5f, 10.0f)));
+
+    // Seen edge on, some of the triangles could face the eye once the bounding sphere is taken into account
+    CHECK_FALSE(IsBackFacing(bounds, glm::vec3(10.0f, 0.5f, 0.0f)));
+
+    // Clusters without a cone are never culled
+    bounds.cone_cutoff = 1.0f;
+    CHECK_FALSE(IsBackFacing(bounds, glm::vec3(0.5f, 0.5f, -10.0f)));
+}
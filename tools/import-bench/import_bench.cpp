@@ -0,0 +1,92 @@
+#include <chrono>
+#include <cstdlib>
+#include <fmt/format.h>
+#include <iostream>
+#include <optional>
+#include <string>
+
+#include "cxxopts.hpp"
+
+#include "obj_loader.hpp"
+#include "thread_pool.hpp"
+#include "utils/memory.hpp"
+
+// Imports an .obj file the way the viewer does and reports the time and memory it takes. The peak resident set size
+// only ever grows, so every run measures a single import mode.
+
+static auto ImportFull(const std::filesystem::path& filepath, ThreadPool* thread_pool) -> Geometry
+{
+    auto obj_data = ReadObjFile(filepath, ObjIngestion::MemoryMapped, thread_pool);
+    return BuildGeometry(obj_data, thread_pool);
+}
+
+static auto ImportStreaming(const std::filesystem::path& filepath, ThreadPool* thread_pool) -> Geometry
+{
+    auto geometry = StreamGeometry(filepath, thread_pool);
+    if (!geometry) {
+        throw std::runtime_error("File cannot be streamed");
+    }
+    return std::move(*geometry);
+}
+
+static double ToMegabytes(size_t bytes)
+{
+    return static_cast<double>(bytes) / double(1 << 20);
+}
+
+int main(int argc, char** argv)
+{
+    using std::cout;
+
+    try {
+        cxxopts::Options options(*argv, "Measure the time and peak memory of importing an .obj file");
+
+        options.add_options()("m,mode", "import mode, full or streaming", cxxopts::value<std::string>()->default_value(
+            "streaming"))("t,threads", "worker threads, 0 for all cores", cxxopts::value<size_t>()->default_value("0"))(
+            "f,file", "path to the .obj file", cxxopts::value<std::string>())("h,help", "print usage");
+
+        auto result = options.parse(argc, argv);
+
+        if (result.count("help") || !result.count("file")) {
+            cout << options.help();
+            return result.count("help") ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+
+        auto mode     = result["mode"].as<std::string>();
+        auto threads  = result["threads"].as<size_t>();
+        auto filepath = std::filesystem::path(result["file"].as<std::string>());
+
+        if (mode != "full" && mode != "streaming") {
+            throw std::runtime_error(fmt::format("Unknown mode '{}'", mode));
+        }
+
+        auto thread_pool = ThreadPool(threads == 0 ? ThreadPool::DefaultThreadCount() : threads);
+        auto baseline    = utils::GetPeakResidentSetSize();
+
+        auto start    = std::chrono::steady_clock::now();
+        auto geometry = (mode == "full") ? ImportFull(filepath, &thread_pool) : ImportStreaming(filepath, &thread_pool);
+        auto end      = std::chrono::steady_clock::now();
+
+        auto peak = utils::GetPeakResidentSetSize();
+        auto size = geometry.vertices.size() * sizeof(VertexPN) + geometry.indices.size() * sizeof(uint32_t);
+
+        cout << fmt::format("mode:           {}\n", mode);
+        cout << fmt::format("threads:        {}\n", thread_pool.ThreadCount());
+        cout << fmt::format("time:           {:.3f} s\n", std::chrono::duration<double>(end - start).count());
+        cout << fmt::format("vertices:       {}\n", geometry.vertices.size());
+        cout << fmt::format("indices:        {}\n", geometry.indices.size());
+        cout << fmt::format("output size:    {:.1f} MB\n", ToMegabytes(size));
+        cout << fmt::format("baseline RSS:   {:.1f} MB\n", ToMegabytes(baseline));
+        cout << fmt::format("peak RSS:       {:.1f} MB\n", ToMegabytes(peak));
+
+        if (size > 0 && peak > baseline) {
+            auto ratio = static_cast<double>(peak - baseline) / static_cast<double>(size);
+            cout << fmt::format("peak / output:  {:.2f}\n", ratio);
+        }
+    } catch (const std::exception& e) {
+        cout << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
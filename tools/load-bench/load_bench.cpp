@@ -0,0 +1,382 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fmt/format.h>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "cxxopts.hpp"
+
+#include "mesh_codec.hpp"
+#include "mesh_deduplicator.hpp"
+#include "mesh_optimizer.hpp"
+#include "mesh_simplifier.hpp"
+#include "meshlet_builder.hpp"
+#include "normal_generator.hpp"
+#include "obj_generator.hpp"
+#include "obj_loader.hpp"
+#include "platform.hpp"
+#include "thread_pool.hpp"
+#include "utils/memory.hpp"
+
+BEGIN_DISABLE_WARNINGS
+
+#include <spdlog/spdlog.h>
+
+END_DISABLE_WARNINGS
+
+// Benchmark of the .obj import pipeline. Every case generates a synthetic file, or reuses it if an earlier run left it
+// in the work directory, and times each stage of the import separately. The results are printed as a table and
+// written as JSON, so runs of different builds can be compared. The peak resident set size only ever grows, so it is
+// reported for the whole run, and ingestion modes are compared by separate runs.
+
+namespace fs = std::filesystem;
+
+struct BenchCase final {
+    std::string                          name;
+    size_t                               triangle_count = 0;
+    std::function<void(const fs::path&)> generate;
+};
+
+struct StageTimes final {
+    double parse            = 0.0; // ReadObjFile
+    double build_geometry   = 0.0; // BuildGeometry: welding and GenerateMeshRecords
+    double generate_normals = 0.0; // GenerateNormals
+    double deduplicate      = 0.0; // DeduplicateMeshes
+    double optimize_meshes  = 0.0; // OptimizeGeometry
+    double build_meshlets   = 0.0; // BuildMeshlets and the OptimizeVertexFetch after it
+    double build_lods       = 0.0; // BuildLods
+    double build_scene      = 0.0; // BuildScene: scene nodes, meshes and the CPU side vertex and index buffers
+    double stream           = 0.0; // StreamGeometry, the alternative to parse and build_geometry
+    double encode_mesh      = 0.0; // EncodeMesh of the final vertices and indices, as the geometry cache stores them
+    double decode_mesh      = 0.0; // DecodeMesh of the same, as the geometry cache reads them
+
+    double Total() const noexcept
+    {
+        return parse + build_geometry + generate_normals + deduplicate + optimize_meshes + build_meshlets + build_lods +
+               build_scene;
+    }
+};
+
+struct BenchResult final {
+    std::string name;
+    size_t      file_size  = 0;
+    size_t      triangles  = 0;
+    size_t      vertices   = 0;
+    size_t      mesh_count = 0;
+    size_t      mesh_size  = 0; // Bytes of the final vertices and indices
+    size_t      coded_size = 0; // Bytes of them after EncodeMesh
+    StageTimes  times;
+
+    // Of the decoded vertices and indices per second
+    double DecodeThroughput() const noexcept
+    {
+        return times.decode_mesh > 0.0 ? static_cast<double>(mesh_size) / times.decode_mesh : 0.0;
+    }
+};
+
+static std::string ScaleName(size_t triangle_count)
+{
+    auto exponent = 0;
+    for (auto count = triangle_count; count >= 10 && count % 10 == 0; count /= 10) {
+        ++exponent;
+    }
+    return fmt::format("1e{}", exponent);
+}
+
+static std::vector<BenchCase> MakeCases(size_t max_triangles, const fs::path& models_dir)
+{
+    auto cases = std::vector<BenchCase>{};
+
+    for (size_t triangles = 100'000; triangles <= max_triangles; triangles *= 10) {
+        auto scale = ScaleName(triangles);
+
+        auto add_grid = [&](std::string name, GridOptions options) {
+            options.triangle_count = triangles;
+
+            auto generate = [options](const fs::path& filepath) { WriteGridObj(filepath, options); };
+            cases.push_back({ fmt::format("{}-{}", name, scale), triangles, generate });
+        };
+
+        add_grid("grid", { .normals = true });
+        add_grid("grid-no-normals", { .normals = false });
+        add_grid("grid-shapes", { .shape_count = 1000, .normals = true });
+        add_grid("grid-materials", { .material_count = 100, .normals = true });
+
+        for (auto model : { "cube", "suzanne", "teapot" }) {
+            auto source = models_dir / fmt::format("{}.obj", model);
+            if (!fs::exists(source)) {
+                continue;
+            }
+
+            auto generate = [source, triangles](const fs::path& filepath) {
+                WriteSubdividedObj(source, filepath, triangles);
+            };
+            cases.push_back({ fmt::format("{}-{}", model, scale), triangles, generate });
+        }
+    }
+
+    return cases;
+}
+
+template <typename Function>
+static double Measure(Function&& function)
+{
+    auto start = std::chrono::steady_clock::now();
+    function();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static BenchResult Run(
+    const BenchCase& bench_case,
+    const fs::path&  filepath,
+    ObjIngestion     ingestion,
+    int              repeat,
+    ThreadPool*      thread_pool)
+{
+    auto result = BenchResult{};
+
+    result.name      = bench_case.name;
+    result.file_size = fs::file_size(filepath);
+
+    for (int i = 0; i != repeat; ++i) {
+        auto times    = StageTimes{};
+        auto obj_data = ObjData{};
+        auto geometry = Geometry{};
+        auto coded    = std::vector<char>{};
+        auto scene    = Scene();
+
+        times.parse            = Measure([&]() { obj_data = ReadObjFile(filepath, ingestion, thread_pool); });
+        times.build_geometry   = Measure([&]() { geometry = BuildGeometry(obj_data, thread_pool); });
+        times.generate_normals = Measure([&]() { GenerateNormals(&geometry, NormalOptions{}, thread_pool); });
+        times.deduplicate      = Measure([&]() { DeduplicateMeshes(&geometry, DeduplicatorOptions{}, thread_pool); });
+        times.optimize_meshes  = Measure([&]() {
+            OptimizeGeometry(&geometry, MeshOptimizerOptions{ .vertex_fetch = false }, thread_pool);
+        });
+        times.build_meshlets   = Measure([&]() {
+            BuildMeshlets(&geometry, MeshletOptions{}, thread_pool);
+            OptimizeVertexFetch(&geometry.vertices, geometry.indices);
+        });
+        times.build_lods       = Measure([&]() { BuildLods(&geometry, SimplifierOptions{}, thread_pool); });
+        times.build_scene      = Measure([&]() { BuildScene(&scene, geometry.View(), filepath); });
+        times.encode_mesh      = Measure([&]() {
+            coded = EncodeMesh(geometry.vertices, geometry.indices, MeshCodecOptions{}, thread_pool);
+        });
+        times.decode_mesh      = Measure([&]() {
+            auto mesh = DecodeMesh(std::string_view(coded.data(), coded.size()), thread_pool);
+            if (!mesh) {
+                throw std::runtime_error(fmt::format("Failed to decode the encoded mesh of {}", bench_case.name));
+            }
+        });
+
+        result.triangles  = geometry.indices.size() / 3;
+        result.vertices   = geometry.vertices.size();
+        result.mesh_size  = geometry.vertices.size() * sizeof(VertexPN) + geometry.indices.size() * sizeof(uint32_t);
+        result.coded_size = coded.size();
+        result.mesh_count = 0;
+        for (const auto& shape : geometry.shapes) {
+            result.mesh_count += shape.meshes.size();
+        }
+
+        obj_data = {};
+        geometry = {};
+
+        times.stream = Measure([&]() { StreamGeometry(filepath, thread_pool); });
+
+        // Keep the fastest time of every stage
+        auto keep = [i](double& best, double time) { best = (i == 0) ? time : std::min(best, time); };
+
+        keep(result.times.parse, times.parse);
+        keep(result.times.build_geometry, times.build_geometry);
+        keep(result.times.generate_normals, times.generate_normals);
+        keep(result.times.deduplicate, times.deduplicate);
+        keep(result.times.optimize_meshes, times.optimize_meshes);
+        keep(result.times.build_meshlets, times.build_meshlets);
+        keep(result.times.build_lods, times.build_lods);
+        keep(result.times.build_scene, times.build_scene);
+        keep(result.times.stream, times.stream);
+        keep(result.times.encode_mesh, times.encode_mesh);
+        keep(result.times.decode_mesh, times.decode_mesh);
+    }
+
+    return result;
+}
+
+static nlohmann::json ToJson(const BenchResult& result)
+{
+    return {
+        { "name", result.name },
+        { "file_size", result.file_size },
+        { "triangles", result.triangles },
+        { "vertices", result.vertices },
+        { "meshes", result.mesh_count },
+        { "mesh_size", result.mesh_size },
+        { "coded_size", result.coded_size },
+        { "decode_bytes_per_second", result.DecodeThroughput() },
+        { "seconds",
+          {
+              { "parse", result.times.parse },
+              { "build_geometry", result.times.build_geometry },
+              { "generate_normals", result.times.generate_normals },
+              { "deduplicate", result.times.deduplicate },
+              { "optimize_meshes", result.times.optimize_meshes },
+              { "build_meshlets", result.times.build_meshlets },
+              { "build_lods", result.times.build_lods },
+              { "build_scene", result.times.build_scene },
+              { "total", result.times.Total() },
+              { "stream", result.times.stream },
+              { "encode_mesh", result.times.encode_mesh },
+              { "decode_mesh", result.times.decode_mesh },
+          } },
+    };
+}
+
+int main(int argc, char** argv)
+{
+    using std::cout;
+
+    try {
+        cxxopts::Options options(*argv, "Benchmark the .obj import pipeline on synthetic files");
+
+        options.add_options()(
+            "m,max-triangles",
+            "largest scale in triangles, scales go from 1e5 up to 1e8",
+            cxxopts::value<size_t>()->default_value("1000000"))(
+            "f,filter", "run cases whose name contains this", cxxopts::value<std::string>()->default_value(""))(
+            "d,dir", "work directory for the generated files", cxxopts::value<std::string>()->default_value(""))(
+            "models", "directory of the bundled models", cxxopts::value<std::string>()->default_value("data/models"))(
+            "o,output", "JSON output file", cxxopts::value<std::string>()->default_value("load_bench.json"))(
+            "t,threads", "worker threads, 0 for all cores", cxxopts::value<size_t>()->default_value("0"))(
+            "r,repeat", "repetitions per case", cxxopts::value<int>()->default_value("1"))(
+            "i,ingestion",
+            "how parse reads the files, mapped or buffered",
+            cxxopts::value<std::string>()->default_value("mapped"))(
+            "k,keep", "keep the generated files for later runs")("h,help", "print usage");
+
+        auto result = options.parse(argc, argv);
+
+        if (result.count("help")) {
+            cout << options.help();
+            return EXIT_SUCCESS;
+        }
+
+        auto max_triangles = std::min<size_t>(result["max-triangles"].as<size_t>(), 100'000'000);
+        auto filter        = result["filter"].as<std::string>();
+        auto work_dir      = fs::path(result["dir"].as<std::string>());
+        auto models_dir    = fs::path(result["models"].as<std::string>());
+        auto output        = fs::path(result["output"].as<std::string>());
+        auto threads       = result["threads"].as<size_t>();
+        auto repeat        = std::max(1, result["repeat"].as<int>());
+        auto keep          = result.count("keep") != 0;
+        auto ingestion     = result["ingestion"].as<std::string>();
+
+        if (ingestion != "mapped" && ingestion != "buffered") {
+            throw std::runtime_error(fmt::format("Unknown ingestion '{}'", ingestion));
+        }
+
+        auto obj_ingestion = (ingestion == "mapped") ? ObjIngestion::MemoryMapped : ObjIngestion::Buffered;
+
+        if (work_dir.empty()) {
+            work_dir = fs::temp_directory_path() / "vega-load-bench";
+        }
+        fs::create_directories(work_dir);
+
+        spdlog::set_level(spdlog::level::warn);
+
+        auto thread_pool = ThreadPool(threads == 0 ? ThreadPool::DefaultThreadCount() : threads);
+        auto results     = nlohmann::json::array();
+
+        cout << fmt::format(
+            "{} threads, {} ingestion, work directory {}\n\n", thread_pool.ThreadCount(), ingestion, work_dir.string());
+        cout << fmt::format(
+            "{:<26} {:>10} {:>10} {:>10} {:>10} {:>10} {:>10} {:>10} {:>10} {:>10} {:>10} {:>10} "
+            "{:>10} {:>10} {:>10}\n",
+            "case",
+            "triangles",
+            "parse",
+            "geometry",
+            "normals",
+            "dedup",
+            "optimize",
+            "meshlets",
+            "lods",
+            "scene",
+            "total",
+            "stream",
+            "encode",
+            "decode",
+            "decode/s");
+
+        for (const auto& bench_case : MakeCases(max_triangles, models_dir)) {
+            if (bench_case.name.find(filter) == std::string::npos) {
+                continue;
+            }
+
+            auto filepath = work_dir / fmt::format("{}.obj", bench_case.name);
+            if (!fs::exists(filepath)) {
+                bench_case.generate(filepath);
+            }
+
+            auto bench_result = Run(bench_case, filepath, obj_ingestion, repeat, &thread_pool);
+            auto ms           = [](double seconds) { return fmt::format("{:.1f} ms", 1000.0 * seconds); };
+
+            cout << fmt::format(
+                "{:<26} {:>10} {:>10} {:>10} {:>10} {:>10} {:>10} {:>10} {:>10} {:>10} {:>10} {:>10} "
+                "{:>10} {:>10} {:>10}\n",
+                bench_result.name,
+                bench_result.triangles,
+                ms(bench_result.times.parse),
+                ms(bench_result.times.build_geometry),
+                ms(bench_result.times.generate_normals),
+                ms(bench_result.times.deduplicate),
+                ms(bench_result.times.optimize_meshes),
+                ms(bench_result.times.build_meshlets),
+                ms(bench_result.times.build_lods),
+                ms(bench_result.times.build_scene),
+                ms(bench_result.times.Total()),
+                ms(bench_result.times.stream),
+                ms(bench_result.times.encode_mesh),
+                ms(bench_result.times.decode_mesh),
+                fmt::format("{:.2f} GB/s", bench_result.DecodeThroughput() / 1e9));
+
+            results.push_back(ToJson(bench_result));
+
+            if (!keep) {
+                fs::remove(filepath);
+                fs::remove(fs::path(filepath).replace_extension(".mtl"));
+            }
+        }
+
+        auto peak_rss = utils::GetPeakResidentSetSize();
+
+        cout << fmt::format("\nPeak RSS {:.1f} MB\n", static_cast<double>(peak_rss) / (1024.0 * 1024.0));
+
+        auto json = nlohmann::json{
+            { "threads", thread_pool.ThreadCount() },
+            { "repeat", repeat },
+            { "ingestion", ingestion },
+            { "peak_rss", peak_rss },
+            { "cases", results },
+        };
+
+        auto file = std::ofstream(output);
+        file << json.dump(4) << '\n';
+
+        if (!file) {
+            throw std::runtime_error(fmt::format("Failed to write {}", output.string()));
+        }
+
+        cout << fmt::format("\nResults written to {}\n", output.string());
+    } catch (const std::exception& e) {
+        cout << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,253 @@
+#include "obj_generator.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <fmt/format.h>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "obj_parser.hpp"
+#include "thread_pool.hpp"
+
+namespace {
+
+constexpr size_t kFlushSize = size_t{ 1 } << 20;
+
+// Buffered output, formatted text is appended to Text() and written out in large blocks
+class TextFile final {
+  public:
+    explicit TextFile(const std::filesystem::path& filepath) : m_file(filepath, std::ios::binary)
+    {
+        if (!m_file) {
+            throw std::runtime_error(fmt::format("Failed to create {}", filepath.string()));
+        }
+        m_text.reserve(2 * kFlushSize);
+    }
+
+    auto Text() noexcept { return std::back_inserter(m_text); }
+
+    void Flush(bool force = false)
+    {
+        if (force || m_text.size() >= kFlushSize) {
+            m_file.write(m_text.data(), static_cast<std::streamsize>(m_text.size()));
+            m_text.clear();
+        }
+    }
+
+    void Close()
+    {
+        Flush(true);
+        m_file.close();
+        if (!m_file) {
+            throw std::runtime_error("Failed to write file");
+        }
+    }
+
+  private:
+    std::ofstream m_file;
+    std::string   m_text;
+};
+
+float Height(float x, float y)
+{
+    return 0.1f * std::sin(8.0f * x) * std::cos(8.0f * y);
+}
+
+// Normal of the surface (x, y, Height(x, y))
+void WriteHeightNormal(TextFile& file, float x, float y)
+{
+    auto dx     = 0.8f * std::cos(8.0f * x) * std::cos(8.0f * y);
+    auto dy     = -0.8f * std::sin(8.0f * x) * std::sin(8.0f * y);
+    auto length = std::sqrt(dx * dx + dy * dy + 1.0f);
+
+    fmt::format_to(file.Text(), "vn {:.6f} {:.6f} {:.6f}\n", -dx / length, -dy / length, 1.0f / length);
+}
+
+} // namespace
+
+void WriteGridObj(const std::filesystem::path& filepath, const GridOptions& options)
+{
+    auto shape_count = std::max<size_t>(options.shape_count, 1);
+    auto quad_count  = std::max<size_t>((options.triangle_count / shape_count + 1) / 2, 1);
+    auto columns     = std::max<size_t>(static_cast<size_t>(std::sqrt(static_cast<double>(quad_count))), 1);
+    auto rows        = (quad_count + columns - 1) / columns;
+    auto tiles       = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(shape_count))));
+
+    auto file = TextFile(filepath);
+
+    if (options.material_count) {
+        auto library_path = std::filesystem::path(filepath).replace_extension(".mtl");
+        auto library      = TextFile(library_path);
+
+        for (size_t material = 0; material != options.material_count; ++material) {
+            auto hue = static_cast<float>(material) / static_cast<float>(options.material_count);
+            fmt::format_to(library.Text(), "newmtl material{}\nKd {:.3f} {:.3f} 0.5\n", material, hue, 1.0f - hue);
+            library.Flush();
+        }
+        library.Close();
+
+        fmt::format_to(file.Text(), "mtllib {}\n", library_path.filename().string());
+    }
+
+    auto first_vertex = size_t{ 1 };
+    auto material     = options.material_count; // None written yet
+
+    for (size_t shape = 0; shape != shape_count; ++shape) {
+        auto origin_x = static_cast<float>(shape % tiles);
+        auto origin_y = static_cast<float>(shape / tiles);
+
+        fmt::format_to(file.Text(), "o shape{}\n", shape);
+
+        for (size_t row = 0; row <= rows; ++row) {
+            for (size_t column = 0; column <= columns; ++column) {
+                auto x = origin_x + static_cast<float>(column) / static_cast<float>(columns);
+                auto y = origin_y + static_cast<float>(row) / static_cast<float>(rows);
+
+                fmt::format_to(file.Text(), "v {:.6f} {:.6f} {:.6f}\n", x, y, Height(x, y));
+                if (options.normals) {
+                    WriteHeightNormal(file, x, y);
+                }
+                file.Flush();
+            }
+        }
+
+        // At least as many bands as materials, so every shape uses all of them
+        auto band_rows = std::max<size_t>(rows / std::max<size_t>(options.material_count, 4), 1);
+
+        for (size_t row = 0; row != rows; ++row) {
+            if (options.material_count) {
+                auto row_material = (shape + row / band_rows) % options.material_count;
+                if (row_material != material) {
+                    material = row_material;
+                    fmt::format_to(file.Text(), "usemtl material{}\n", material);
+                }
+            }
+            for (size_t column = 0; column != columns; ++column) {
+                auto v0 = first_vertex + row * (columns + 1) + column;
+                auto v1 = v0 + 1;
+                auto v2 = v1 + columns + 1;
+                auto v3 = v0 + columns + 1;
+
+                if (options.normals) {
+                    fmt::format_to(file.Text(), "f {0}//{0} {1}//{1} {2}//{2}\n", v0, v1, v2);
+                    fmt::format_to(file.Text(), "f {0}//{0} {1}//{1} {2}//{2}\n", v0, v2, v3);
+                } else {
+                    fmt::format_to(file.Text(), "f {} {} {}\nf {} {} {}\n", v0, v1, v2, v0, v2, v3);
+                }
+                file.Flush();
+            }
+        }
+
+        first_vertex += (rows + 1) * (columns + 1);
+    }
+
+    file.Close();
+}
+
+size_t WriteSubdividedObj(
+    const std::filesystem::path& source,
+    const std::filesystem::path& filepath,
+    size_t                       triangle_count)
+{
+    auto thread_pool = ThreadPool(ThreadPool::DefaultThreadCount());
+    auto obj_data    = ReadObjFile(source, ObjIngestion::MemoryMapped, &thread_pool);
+
+    auto& positions = obj_data.attributes.vertices;
+    auto& normals   = obj_data.attributes.normals;
+
+    auto triangles = std::vector<tinyobj::index_t>{};
+    for (const auto& shape : obj_data.shapes) {
+        triangles.insert(triangles.end(), shape.mesh.indices.begin(), shape.mesh.indices.end());
+    }
+
+    using EdgeMap = std::unordered_map<uint64_t, int>;
+
+    // Midpoints of the edges of one attribute, shared between the two triangles of an edge
+    auto midpoint = [](EdgeMap& edges, std::vector<float>& values, int a, int b, bool unit) {
+        if (a < 0 || b < 0) {
+            return -1;
+        }
+
+        auto key = (uint64_t{ static_cast<uint32_t>(std::min(a, b)) } << 32) | static_cast<uint32_t>(std::max(a, b));
+
+        auto [it, inserted] = edges.try_emplace(key, static_cast<int>(values.size() / 3));
+        if (inserted) {
+            auto pa = 3 * static_cast<size_t>(a);
+            auto pb = 3 * static_cast<size_t>(b);
+            auto x  = 0.5f * (values[pa + 0] + values[pb + 0]);
+            auto y  = 0.5f * (values[pa + 1] + values[pb + 1]);
+            auto z  = 0.5f * (values[pa + 2] + values[pb + 2]);
+            auto s  = unit ? 1.0f / std::max(std::sqrt(x * x + y * y + z * z), 1e-12f) : 1.0f;
+            values.insert(values.end(), { s * x, s * y, s * z });
+        }
+        return it->second;
+    };
+
+    while (!triangles.empty() && triangles.size() / 3 < triangle_count) {
+        auto position_edges = EdgeMap{};
+        auto normal_edges   = EdgeMap{};
+        auto subdivided     = std::vector<tinyobj::index_t>{};
+
+        subdivided.reserve(4 * triangles.size());
+
+        for (size_t i = 0; i + 2 < triangles.size(); i += 3) {
+            auto corners = std::array<tinyobj::index_t, 6>{ triangles[i], triangles[i + 1], triangles[i + 2] };
+
+            for (size_t edge = 0; edge != 3; ++edge) {
+                auto& a = corners[edge];
+                auto& b = corners[(edge + 1) % 3];
+                auto& m = corners[3 + edge];
+
+                m.vertex_index   = midpoint(position_edges, positions, a.vertex_index, b.vertex_index, false);
+                m.normal_index   = midpoint(normal_edges, normals, a.normal_index, b.normal_index, true);
+                m.texcoord_index = -1;
+            }
+
+            for (auto corner : { 0, 3, 5, 3, 1, 4, 5, 4, 2, 3, 4, 5 }) {
+                subdivided.push_back(corners[static_cast<size_t>(corner)]);
+            }
+        }
+
+        triangles = std::move(subdivided);
+    }
+
+    auto file = TextFile(filepath);
+
+    for (size_t i = 0; i + 2 < positions.size(); i += 3) {
+        fmt::format_to(file.Text(), "v {:.6f} {:.6f} {:.6f}\n", positions[i], positions[i + 1], positions[i + 2]);
+        file.Flush();
+    }
+    for (size_t i = 0; i + 2 < normals.size(); i += 3) {
+        fmt::format_to(file.Text(), "vn {:.6f} {:.6f} {:.6f}\n", normals[i], normals[i + 1], normals[i + 2]);
+        file.Flush();
+    }
+
+    fmt::format_to(file.Text(), "o {}\n", source.stem().string());
+
+    for (size_t i = 0; i + 2 < triangles.size(); i += 3) {
+        auto has_normals = triangles[i].normal_index >= 0 && triangles[i + 1].normal_index >= 0 &&
+                           triangles[i + 2].normal_index >= 0;
+
+        fmt::format_to(file.Text(), "f");
+        for (size_t corner = i; corner != i + 3; ++corner) {
+            const auto& index = triangles[corner];
+            if (has_normals) {
+                fmt::format_to(file.Text(), " {}//{}", index.vertex_index + 1, index.normal_index + 1);
+            } else {
+                fmt::format_to(file.Text(), " {}", index.vertex_index + 1);
+            }
+        }
+        fmt::format_to(file.Text(), "\n");
+        file.Flush();
+    }
+
+    file.Close();
+
+    return triangles.size() / 3;
+}
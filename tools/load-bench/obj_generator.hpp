@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+
+// Synthetic .obj files for the loader benchmark. The output only depends on the arguments, so files generated by
+// different builds can be compared and reused.
+
+struct GridOptions final {
+    size_t triangle_count = 100'000;
+    size_t shape_count    = 1;
+    size_t material_count = 0; // Written to a .mtl file next to the .obj file if not zero
+    bool   normals        = true;
+};
+
+// Writes a height field split into 'shape_count' grids of quads. Faces are assigned to the materials in bands of
+// rows, cycling through all materials in every shape.
+void WriteGridObj(const std::filesystem::path& filepath, const GridOptions& options);
+
+// Writes the triangles of 'source' as a single shape, subdivided into four triangles each until there are at least
+// 'triangle_count'. Edges shared by triangles stay shared, and normals are interpolated if the source has them.
+// Returns the number of triangles written.
+auto WriteSubdividedObj(
+    const std::filesystem::path& source,
+    const std::filesystem::path& filepath,
+    size_t                       triangle_count) -> size_t;
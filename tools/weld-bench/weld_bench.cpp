@@ -0,0 +1,250 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fmt/format.h>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "cxxopts.hpp"
+
+#include "thread_pool.hpp"
+#include "vertex_welder.hpp"
+
+// Synthetic mesh: a grid of size x size quads. The left half is flat shaded, so every interior position there is shared
+// by the corners of several faces with different normals, which is the worst case for maps that only hash positions.
+// The right half is smooth shaded and shares one normal per position.
+struct SyntheticMesh final {
+    std::vector<tinyobj::index_t> indices;
+    std::vector<VertexPN>         corners;
+};
+
+static SyntheticMesh GenerateMesh(int size)
+{
+    auto mesh = SyntheticMesh{};
+
+    auto position = [size](int x, int y) {
+        auto fx = static_cast<float>(x) / static_cast<float>(size);
+        auto fy = static_cast<float>(y) / static_cast<float>(size);
+        return glm::vec3(fx, fy, 0.1f * std::sin(8.0f * fx) * std::cos(8.0f * fy));
+    };
+
+    auto add_triangle = [&](int face, int x0, int y0, int x1, int y1, int x2, int y2) {
+        auto p0     = position(x0, y0);
+        auto p1     = position(x1, y1);
+        auto p2     = position(x2, y2);
+        auto normal = glm::normalize(glm::cross(p1 - p0, p2 - p0));
+        auto v0     = y0 * (size + 1) + x0;
+        auto v1     = y1 * (size + 1) + x1;
+        auto v2     = y2 * (size + 1) + x2;
+
+        if (2 * x0 < size) {
+            mesh.indices.push_back({ v0, face, -1 });
+            mesh.indices.push_back({ v1, face, -1 });
+            mesh.indices.push_back({ v2, face, -1 });
+
+            mesh.corners.emplace_back(p0, normal);
+            mesh.corners.emplace_back(p1, normal);
+            mesh.corners.emplace_back(p2, normal);
+        } else {
+            mesh.indices.push_back({ v0, 2 * size * size + v0, -1 });
+            mesh.indices.push_back({ v1, 2 * size * size + v1, -1 });
+            mesh.indices.push_back({ v2, 2 * size * size + v2, -1 });
+
+            mesh.corners.emplace_back(p0, glm::vec3(0.0f, 0.0f, 1.0f));
+            mesh.corners.emplace_back(p1, glm::vec3(0.0f, 0.0f, 1.0f));
+            mesh.corners.emplace_back(p2, glm::vec3(0.0f, 0.0f, 1.0f));
+        }
+    };
+
+    auto quad_count = static_cast<size_t>(size) * static_cast<size_t>(size);
+
+    mesh.indices.reserve(6 * quad_count);
+    mesh.corners.reserve(6 * quad_count);
+
+    for (int y = 0, face = 0; y != size; ++y) {
+        for (int x = 0; x != size; ++x) {
+            add_triangle(face++, x, y, x + 1, y, x + 1, y + 1);
+            add_triangle(face++, x, y, x + 1, y + 1, x, y + 1);
+        }
+    }
+
+    return mesh;
+}
+
+// The maps used by the loader before the welding engine was introduced
+
+struct TinyIndex final {
+    struct Hash final {
+        size_t operator()(const tinyobj::index_t& index) const noexcept
+        {
+            return static_cast<size_t>(index.vertex_index);
+        }
+    };
+    struct Equal final {
+        bool operator()(const tinyobj::index_t& lhs, const tinyobj::index_t& rhs) const noexcept
+        {
+            return (lhs.vertex_index == rhs.vertex_index) && (lhs.normal_index == rhs.normal_index) &&
+                   (lhs.texcoord_index == rhs.texcoord_index);
+        }
+    };
+};
+
+using IndexMap = std::unordered_map<tinyobj::index_t, size_t, TinyIndex::Hash, TinyIndex::Equal>;
+
+struct VertexHash final {
+    size_t operator()(const VertexPN& vertex) const noexcept
+    {
+        size_t hash = 23;
+
+        hash = hash * 31 + std::hash<float>{}(vertex.position.x);
+        hash = hash * 31 + std::hash<float>{}(vertex.position.y);
+        hash = hash * 31 + std::hash<float>{}(vertex.position.z);
+
+        return hash;
+    }
+};
+
+using VertexMap = std::unordered_map<VertexPN, size_t, VertexHash>;
+
+static WeldResult WeldWithIndexMap(const std::vector<tinyobj::index_t>& indices)
+{
+    auto result    = WeldResult{};
+    auto index_map = IndexMap{};
+
+    index_map.reserve(indices.size());
+    result.remap.reserve(indices.size());
+
+    for (uint32_t i = 0; i != indices.size(); ++i) {
+        auto [it, success] = index_map.try_emplace(indices[i], result.unique.size());
+        if (success) {
+            result.unique.push_back(i);
+        }
+        result.remap.push_back(static_cast<uint32_t>(it->second));
+    }
+
+    return result;
+}
+
+static WeldResult WeldWithVertexMap(const std::vector<VertexPN>& corners)
+{
+    auto result     = WeldResult{};
+    auto vertex_map = VertexMap{};
+
+    vertex_map.reserve(corners.size());
+    result.remap.reserve(corners.size());
+
+    for (uint32_t i = 0; i != corners.size(); ++i) {
+        auto [it, success] = vertex_map.try_emplace(corners[i], result.unique.size());
+        if (success) {
+            result.unique.push_back(i);
+        }
+        result.remap.push_back(static_cast<uint32_t>(it->second));
+    }
+
+    return result;
+}
+
+static double Measure(int repeat, const std::function<WeldResult()>& function, WeldResult* result)
+{
+    auto best = 0.0;
+
+    for (int i = 0; i != repeat; ++i) {
+        auto start = std::chrono::high_resolution_clock::now();
+        *result    = function();
+        auto end   = std::chrono::high_resolution_clock::now();
+        auto time  = std::chrono::duration<double>(end - start).count();
+
+        best = (i == 0) ? time : std::min(best, time);
+    }
+
+    return best;
+}
+
+static void Report(std::string_view name, size_t count, double seconds, const WeldResult& result, bool matches)
+{
+    auto items_per_second = static_cast<double>(count) / seconds / 1e6;
+
+    std::cout << fmt::format(
+        "{:<36} {:>10.2f} ms {:>10.1f} M/s {:>12} unique {}\n",
+        name,
+        1000.0 * seconds,
+        items_per_second,
+        result.unique.size(),
+        matches ? "" : "(MISMATCH)");
+}
+
+int main(int argc, char** argv)
+{
+    using std::cout;
+
+    try {
+        cxxopts::Options options(*argv, "Benchmark the vertex welding engine against std::unordered_map");
+
+        options.add_options()("s,size", "grid size in quads per side", cxxopts::value<int>()->default_value("1000"))(
+            "t,threads", "worker threads, 0 for all cores", cxxopts::value<size_t>()->default_value("0"))(
+            "r,repeat", "repetitions per measurement", cxxopts::value<int>()->default_value("3"))(
+            "e,epsilon", "position epsilon of the spatial weld", cxxopts::value<float>()->default_value("1e-5"))(
+            "h,help", "print usage");
+
+        auto result = options.parse(argc, argv);
+
+        if (result.count("help")) {
+            cout << options.help();
+            return EXIT_SUCCESS;
+        }
+
+        auto size    = std::max(1, result["size"].as<int>());
+        auto threads = result["threads"].as<size_t>();
+        auto repeat  = std::max(1, result["repeat"].as<int>());
+        auto epsilon = result["epsilon"].as<float>();
+
+        auto thread_pool = ThreadPool(threads == 0 ? ThreadPool::DefaultThreadCount() : threads);
+        auto mesh        = GenerateMesh(size);
+        auto count       = mesh.indices.size();
+
+        cout << fmt::format("{} corners, {} threads\n\n", count, thread_pool.ThreadCount());
+
+        // OBJ index triples
+        auto reference = WeldResult{};
+        auto welded    = WeldResult{};
+        auto seconds   = 0.0;
+
+        seconds = Measure(repeat, [&]() { return WeldWithIndexMap(mesh.indices); }, &reference);
+        Report("index: unordered_map (IndexMap)", count, seconds, reference, true);
+
+        seconds = Measure(repeat, [&]() { return WeldIndices(mesh.indices, nullptr); }, &welded);
+        Report("index: open addressing", count, seconds, welded, welded.remap == reference.remap);
+
+        seconds = Measure(repeat, [&]() { return WeldIndices(mesh.indices, &thread_pool); }, &welded);
+        Report("index: open addressing, sharded", count, seconds, welded, welded.remap == reference.remap);
+
+        cout << "\n";
+
+        // Vertex values, equal positions and normals less than one degree apart. The tolerance makes the equality of
+        // the old map order dependent, so the unique counts may differ slightly from the other welds.
+        auto angle = WeldOptions{ .normal_epsilon = std::acos(0.999847695f) };
+
+        seconds = Measure(repeat, [&]() { return WeldWithVertexMap(mesh.corners); }, &welded);
+        Report("vertex: unordered_map (hash<VertexPN>)", count, seconds, welded, true);
+
+        seconds = Measure(repeat, [&]() { return WeldVertices(mesh.corners, angle, nullptr); }, &reference);
+        Report("vertex: open addressing", count, seconds, reference, true);
+
+        seconds = Measure(repeat, [&]() { return WeldVertices(mesh.corners, angle, &thread_pool); }, &welded);
+        Report("vertex: open addressing, sharded", count, seconds, welded, welded.remap == reference.remap);
+
+        auto spatial = WeldOptions{ .position_epsilon = epsilon, .normal_epsilon = angle.normal_epsilon };
+
+        seconds = Measure(repeat, [&]() { return WeldVertices(mesh.corners, spatial, nullptr); }, &welded);
+        Report("vertex: spatial hash", count, seconds, welded, true);
+    } catch (const std::exception& e) {
+        cout << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}